@@ -516,6 +516,176 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_put_and_get_single_file_eviction(void)
+{
+   struct disk_cache *cache;
+   uint8_t *blob;
+   const unsigned num_keys = 16;
+   uint8_t keys[16][20];
+   char *result;
+   size_t size;
+   unsigned i, count;
+
+#ifdef SHADER_CACHE_DISABLE_BY_DEFAULT
+   setenv("MESA_GLSL_CACHE_DISABLE", "false", 1);
+#endif /* SHADER_CACHE_DISABLE_BY_DEFAULT */
+
+   setenv("MESA_DISK_CACHE_SINGLE_FILE", "true", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "8K", 1);
+   cache = disk_cache_create("test_foz", "make_check", 0);
+
+   /* Fill the cache with 16 incompressible 1KB items, twice its size. */
+   blob = malloc(1024);
+   srand(42);
+   for (i = 0; i < num_keys; i++) {
+      for (unsigned j = 0; j < 1024; j++)
+         blob[j] = rand();
+
+      disk_cache_compute_key(cache, blob, 1024, keys[i]);
+      disk_cache_put(cache, keys[i], blob, 1024, NULL);
+
+      /* disk_cache_put() hands things off to a thread so wait for it. */
+      disk_cache_wait_for_idle(cache);
+   }
+   free(blob);
+
+   result = disk_cache_get(cache, keys[0], &size);
+   expect_null(result, "single file eviction of the oldest item");
+   free(result);
+
+   result = disk_cache_get(cache, keys[num_keys - 1], &size);
+   expect_non_null(result, "single file eviction keeps the newest item");
+   expect_equal(size, 1024, "single file eviction keeps the newest item (size)");
+   free(result);
+
+   disk_cache_destroy(cache);
+
+   /* Make sure the compacted db is still valid after reopening it. */
+   cache = disk_cache_create("test_foz", "make_check", 0);
+
+   count = 0;
+   for (i = 0; i < num_keys; i++) {
+      result = disk_cache_get(cache, keys[i], &size);
+      if (result)
+         count++;
+      free(result);
+   }
+
+   expect_true(count > 0 && count < 8,
+               "single file eviction keeps the cache under MAX_SIZE");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_DISK_CACHE_SINGLE_FILE");
+   unsetenv("MESA_GLSL_CACHE_MAX_SIZE");
+}
+
+static void
+test_mem_cache(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   char *result;
+   size_t size;
+   uint64_t hits, misses;
+
+#ifdef SHADER_CACHE_DISABLE_BY_DEFAULT
+   setenv("MESA_GLSL_CACHE_DISABLE", "false", 1);
+#endif /* SHADER_CACHE_DISABLE_BY_DEFAULT */
+
+   cache = disk_cache_create("test_mem", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+
+   /* disk_cache_put() hands things off to a thread so wait for it. */
+   disk_cache_wait_for_idle(cache);
+
+   /* The first get loads the item from disk, the second from memory. */
+   for (unsigned i = 0; i < 2; i++) {
+      result = disk_cache_get(cache, blob_key, &size);
+      expect_equal_str(blob, result, "disk_cache_get with memory cache (pointer)");
+      expect_equal(size, sizeof(blob), "disk_cache_get with memory cache (size)");
+      free(result);
+   }
+
+   disk_cache_get_mem_stats(cache, &hits, &misses);
+   expect_equal(hits, 1, "memory cache hits");
+   expect_equal(misses, 1, "memory cache misses");
+
+   /* Removing the item must also remove it from memory. */
+   disk_cache_remove(cache, blob_key);
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "disk_cache_get after disk_cache_remove");
+
+   disk_cache_destroy(cache);
+
+   /* And setting the size to 0 disables the memory cache. */
+   setenv("MESA_GLSL_CACHE_MEMORY_SIZE", "0", 1);
+   cache = disk_cache_create("test_mem", "make_check", 0);
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_wait_for_idle(cache);
+
+   for (unsigned i = 0; i < 2; i++)
+      free(disk_cache_get(cache, blob_key, &size));
+
+   disk_cache_get_mem_stats(cache, &hits, &misses);
+   expect_equal(hits, 0, "disabled memory cache hits");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_MEMORY_SIZE");
+}
+
+static void
+test_get_batch(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   char string[] = "While this string has thirty-four";
+   cache_key keys[3];
+   struct disk_cache_batch *batch;
+   char *result;
+   size_t size;
+
+#ifdef SHADER_CACHE_DISABLE_BY_DEFAULT
+   setenv("MESA_GLSL_CACHE_DISABLE", "false", 1);
+#endif /* SHADER_CACHE_DISABLE_BY_DEFAULT */
+
+   cache = disk_cache_create("test_batch", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), keys[0]);
+   disk_cache_compute_key(cache, string, sizeof(string), keys[1]);
+   disk_cache_compute_key(cache, keys, sizeof(keys[0]) * 2, keys[2]);
+
+   disk_cache_put(cache, keys[0], blob, sizeof(blob), NULL);
+   disk_cache_put(cache, keys[1], string, sizeof(string), NULL);
+
+   /* disk_cache_put() hands things off to a thread so wait for it. */
+   disk_cache_wait_for_idle(cache);
+
+   batch = disk_cache_get_batch(cache, (const cache_key *)keys, 3);
+   expect_non_null(batch, "disk_cache_get_batch");
+
+   /* Retrieve the items out of order. */
+   result = disk_cache_batch_get(batch, 1, &size);
+   expect_equal_str(string, result, "disk_cache_batch_get of 2nd item (pointer)");
+   expect_equal(size, sizeof(string), "disk_cache_batch_get of 2nd item (size)");
+   free(result);
+
+   result = disk_cache_batch_get(batch, 2, &size);
+   expect_null(result, "disk_cache_batch_get of non-existent item (pointer)");
+   expect_equal(size, 0, "disk_cache_batch_get of non-existent item (size)");
+
+   /* The 1st item is freed with the batch. */
+   disk_cache_batch_destroy(batch);
+
+   disk_cache_destroy(cache);
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -530,6 +700,12 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_put_and_get_single_file_eviction();
+
+   test_mem_cache();
+
+   test_get_batch();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
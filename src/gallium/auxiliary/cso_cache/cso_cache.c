@@ -35,6 +35,12 @@
 #include "cso_cache.h"
 #include "cso_hash.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Print the lookup statistics of each cache when it is destroyed. */
+DEBUG_GET_ONCE_BOOL_OPTION(cso_cache_stats, "CSO_CACHE_STATS", false)
+
 
 static inline struct cso_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso_cache_type type)
 {
@@ -128,17 +134,10 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 				        void *templ,
 				        int size )
 {
-   struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size)) {
-	 /* We found a match
-	  */
-         return iter_data;
-      }
-      iter = cso_hash_iter_next(iter);
-   }
-   return NULL;
+   struct cso_hash_iter iter =
+      cso_hash_find_template(hash, hash_key, templ, size, NULL);
+
+   return cso_hash_iter_data(iter);
 }
 
 
@@ -146,13 +145,18 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
                                              unsigned hash_key, enum cso_cache_type type,
                                              void *templ, unsigned size)
 {
-   struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size))
-         return iter;
-      iter = cso_hash_iter_next(iter);
-   }
+   struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   struct cso_cache_stats *stats = &sc->stats[type];
+   unsigned probes;
+   struct cso_hash_iter iter =
+      cso_hash_find_template(hash, hash_key, templ, size, &probes);
+
+   if (cso_hash_iter_is_null(iter))
+      stats->misses++;
+   else
+      stats->hits++;
+   stats->probes += probes;
+   stats->max_probes = MAX2(stats->max_probes, probes);
    return iter;
 }
 
@@ -185,10 +189,37 @@ static void cso_delete_all(struct cso_cache *sc, enum cso_cache_type type)
    }
 }
 
+static const char *cso_cache_type_names[CSO_CACHE_MAX] = {
+   [CSO_RASTERIZER] = "rasterizer",
+   [CSO_BLEND] = "blend",
+   [CSO_DEPTH_STENCIL_ALPHA] = "depth_stencil_alpha",
+   [CSO_SAMPLER] = "sampler",
+   [CSO_VELEMENTS] = "velements",
+};
+
+static void cso_cache_print_stats(struct cso_cache *sc)
+{
+   fprintf(stderr, "%-20s %10s %10s %10s %10s %8s\n", "cso cache", "entries",
+           "hits", "misses", "avg probes", "max");
+   for (int i = 0; i < CSO_CACHE_MAX; i++) {
+      const struct cso_cache_stats *stats = &sc->stats[i];
+      uint64_t lookups = stats->hits + stats->misses;
+
+      fprintf(stderr, "%-20s %10d %10"PRIu64" %10"PRIu64" %10.2f %8u\n",
+              cso_cache_type_names[i], cso_hash_size(&sc->hashes[i]),
+              stats->hits, stats->misses,
+              lookups ? (double)stats->probes / lookups : 0.0,
+              stats->max_probes);
+   }
+}
+
 void cso_cache_delete(struct cso_cache *sc)
 {
    int i;
 
+   if (debug_get_option_cso_cache_stats())
+      cso_cache_print_stats(sc);
+
    /* delete driver data */
    cso_delete_all(sc, CSO_BLEND);
    cso_delete_all(sc, CSO_DEPTH_STENCIL_ALPHA);
@@ -200,6 +231,12 @@ void cso_cache_delete(struct cso_cache *sc)
       cso_hash_deinit(&sc->hashes[i]);
 }
 
+void cso_cache_get_stats(struct cso_cache *sc, enum cso_cache_type type,
+                         struct cso_cache_stats *stats)
+{
+   *stats = sc->stats[type];
+}
+
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number)
 {
    int i;
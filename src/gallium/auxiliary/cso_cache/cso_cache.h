@@ -75,6 +75,7 @@
 
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
+#include "util/hash_table.h"
 
 /* cso_hash.h is necessary for cso_hash_iter, as MSVC requires structures
  * returned by value to be fully defined */
@@ -104,8 +105,19 @@ typedef void (*cso_sanitize_callback)(struct cso_hash *hash,
                                       int max_size,
                                       void *user_data);
 
+/**
+ * Lookup statistics of one state type, see cso_cache_get_stats().
+ */
+struct cso_cache_stats {
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t probes;       /* slots looked at, over all lookups */
+   unsigned max_probes;   /* longest single lookup */
+};
+
 struct cso_cache {
    struct cso_hash hashes[CSO_CACHE_MAX];
+   struct cso_cache_stats stats[CSO_CACHE_MAX];
    int    max_size;
 
    cso_sanitize_callback sanitize_cb;
@@ -165,21 +177,15 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
                                              unsigned hash_key, enum cso_cache_type type,
                                              void *templ, unsigned size);
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number);
+void cso_cache_get_stats(struct cso_cache *sc, enum cso_cache_type type,
+                         struct cso_cache_stats *stats);
 void cso_delete_state(struct pipe_context *pipe, void *state,
                       enum cso_cache_type type);
 
 static inline unsigned
 cso_construct_key(void *key, int key_size)
 {
-   unsigned hash = 0, *ikey = (unsigned *)key;
-   unsigned num_elements = key_size / 4;
-
-   assert(key_size % 4 == 0);
-
-   for (unsigned i = 0; i < num_elements; i++)
-      hash ^= ikey[i];
-
-   return hash;
+   return _mesa_hash_data(key, key_size);
 }
 
 #ifdef	__cplusplus
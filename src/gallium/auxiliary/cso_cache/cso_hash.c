@@ -31,235 +31,152 @@
   */
 
 #include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 
 #include "cso_hash.h"
 
-#ifndef MAX
-#define MAX(a, b) ((a > b) ? (a) : (b))
-#endif
+#define MIN_NUM_SLOTS 16
 
-static const int MinNumBits = 4;
+/* The address marks erased slots. */
+char cso_hash_deleted;
 
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
-};
-
-static int primeForNumBits(int numBits)
+static inline bool
+cso_node_is_live(const struct cso_node *node)
 {
-   return (1 << numBits) + prime_deltas[numBits];
+   return node->value && node->value != &cso_hash_deleted;
 }
 
 /*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
-
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
-
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
-}
-
-static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                     unsigned akey, void *avalue,
-                     struct cso_node **anextNode)
-{
-   struct cso_node *node = MALLOC(sizeof(struct cso_node));
-
-   if (!node)
-      return NULL;
-
-   node->key = akey;
-   node->value = avalue;
-
-   node->next = *anextNode;
-   *anextNode = node;
-   ++hash->size;
-   return node;
-}
-
-static void cso_data_rehash(struct cso_hash *hash, int hint)
-{
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
-   }
-
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)hash;
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
+ * Resize the slot array so that it is at most half full with the current
+ * entries, and drop the erased slots.
+ */
+static bool cso_data_rehash(struct cso_hash *hash, unsigned min_size)
+{
+   unsigned num_slots = MAX2(util_next_power_of_two(min_size * 2),
+                             MIN_NUM_SLOTS);
+   struct cso_node *slots = CALLOC(num_slots, sizeof(*slots));
+   struct cso_node *old_slots = hash->slots;
+   unsigned old_num_slots = hash->num_slots;
+
+   if (!slots)
+      return false;
+
+   hash->slots = slots;
+   hash->num_slots = num_slots;
+   hash->shift = 32 - util_logbase2(num_slots);
+   hash->used = hash->size;
+
+   for (unsigned i = 0; i < old_num_slots; i++) {
+      struct cso_node *old = &old_slots[i];
+
+      if (cso_node_is_live(old)) {
+         unsigned j = cso_hash_slot_index(hash, old->key);
+
+         while (slots[j].value)
+            j = (j + 1) & (num_slots - 1);
+         slots[j] = *old;
       }
-      FREE(oldBuckets);
    }
+   FREE(old_slots);
+   return true;
 }
 
-static void cso_data_might_grow(struct cso_hash *hash)
+static bool cso_data_might_grow(struct cso_hash *hash)
 {
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
+   /* Keep the load, erased slots included, at most 1/2. */
+   if ((hash->used + 1) * 2 > hash->num_slots)
+      return cso_data_rehash(hash, hash->size + 1);
+   return true;
 }
 
 static void cso_data_has_shrunk(struct cso_hash *hash)
 {
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
-   }
+   if (hash->num_slots > MIN_NUM_SLOTS &&
+       hash->size <= (int)(hash->num_slots >> 3))
+      cso_data_rehash(hash, hash->size);
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash *hash)
+static struct cso_node *cso_data_next_live(struct cso_hash *hash,
+                                           unsigned start)
 {
-   struct cso_node *e = (struct cso_node *)hash;
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
+   for (unsigned i = start; i < hash->num_slots; i++) {
+      if (cso_node_is_live(&hash->slots[i]))
+         return &hash->slots[i];
    }
-   return e;
+   return NULL;
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                      unsigned key, void *data)
 {
-   cso_data_might_grow(hash);
+   struct cso_hash_iter iter = {hash, NULL};
 
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-   if (!node) {
-      struct cso_hash_iter null_iter = {hash, 0};
-      return null_iter;
-   }
+   assert(data && data != &cso_hash_deleted);
 
-   struct cso_hash_iter iter = {hash, node};
+   if (!cso_data_might_grow(hash))
+      return iter;
+
+   /* Take the first free or erased slot of the probe sequence. */
+   const unsigned mask = hash->num_slots - 1;
+   unsigned i = cso_hash_slot_index(hash, key);
+
+   while (cso_node_is_live(&hash->slots[i]))
+      i = (i + 1) & mask;
+
+   if (!hash->slots[i].value)
+      hash->used++;
+   hash->slots[i].key = key;
+   hash->slots[i].value = data;
+   hash->size++;
+
+   iter.node = &hash->slots[i];
    return iter;
 }
 
 void cso_hash_init(struct cso_hash *hash)
 {
-   hash->fakeNext = 0;
-   hash->buckets = 0;
+   hash->slots = NULL;
+   hash->num_slots = 0;
+   hash->shift = 32;
    hash->size = 0;
-   hash->userNumBits = (short)MinNumBits;
-   hash->numBits = 0;
-   hash->numBuckets = 0;
-   hash->end = (struct cso_node*)hash;
+   hash->used = 0;
 }
 
 void cso_hash_deinit(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = hash->end;
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         FREE(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->buckets);
+   FREE(hash->slots);
+   cso_hash_init(hash);
 }
 
 unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->end == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->key;
 }
 
-struct cso_node *cso_hash_data_next(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
+   struct cso_hash_iter next = {iter.hash, NULL};
+
+   if (!iter.node) {
       debug_printf("iterating beyond the last element\n");
-      return NULL;
-   }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+      return next;
    }
-   return a.e;
+
+   next.node = cso_data_next_live(iter.hash,
+                                  iter.node - iter.hash->slots + 1);
+   return next;
 }
 
 void *cso_hash_take(struct cso_hash *hash, unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
+   struct cso_hash_iter iter = cso_hash_find(hash, akey);
 
-   if (*node != hash->end) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      FREE(*node);
-      *node = next;
+   if (iter.node) {
+      void *t = iter.node->value;
+      iter.node->value = &cso_hash_deleted;
       --hash->size;
       cso_data_has_shrunk(hash);
       return t;
@@ -269,7 +186,7 @@ void *cso_hash_take(struct cso_hash *hash, unsigned akey)
 
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash)};
+   struct cso_hash_iter iter = {hash, cso_data_next_live(hash, 0)};
    return iter;
 }
 
@@ -280,25 +197,47 @@ int cso_hash_size(struct cso_hash *hash)
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
-   struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
-
-   if (node == hash->end)
+   if (!iter.node)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = &hash->buckets[node->key % hash->numBuckets];
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   FREE(node);
+   /* Only mark the slot, so that the iteration order stays the same. */
+   iter.node->value = &cso_hash_deleted;
    --hash->size;
-   return ret;
+   return cso_hash_iter_next(iter);
 }
 
 bool cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return *node != hash->end;
+   return cso_hash_find(hash, key).node != NULL;
+}
+
+struct cso_hash_iter cso_hash_find_template(struct cso_hash *hash,
+                                            unsigned hash_key,
+                                            const void *templ, int size,
+                                            unsigned *probes)
+{
+   struct cso_hash_iter iter = {hash, NULL};
+   unsigned n = 0;
+
+   if (hash->num_slots) {
+      const unsigned mask = hash->num_slots - 1;
+
+      for (unsigned i = cso_hash_slot_index(hash, hash_key);;
+           i = (i + 1) & mask) {
+         struct cso_node *node = &hash->slots[i];
+
+         n++;
+         if (!node->value)
+            break;
+         if (node->key == hash_key && node->value != &cso_hash_deleted &&
+             !memcmp(node->value, templ, size)) {
+            iter.node = node;
+            break;
+         }
+      }
+   }
+
+   if (probes)
+      *probes = n;
+   return iter;
 }
@@ -30,13 +30,14 @@
  * Hash table implementation.
  * 
  * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
+ * with collisions. Entries live in a single open-addressed array with
+ * linear probing, so a lookup usually touches one or two cache lines.
+ * Several entries may share a key. cso_hash_find() returns the first of
+ * them, and client code should compare the data to find the exact entry
+ * (e.g. with cso_hash_find_data_from_template()).
+ *
+ * Iterators stay valid across cso_hash_erase(), which only marks the slot
+ * as deleted. Inserting or taking entries may move all of them.
  * 
  * @author Zack Rusin <zackr@vmware.com>
  */
@@ -52,9 +53,9 @@ extern "C" {
 
 
 struct cso_node {
-   struct cso_node *next;
-   void *value;
    unsigned key;
+   /* NULL for a free slot, cso_hash_deleted for an erased one */
+   void *value;
 };
 
 struct cso_hash_iter {
@@ -63,15 +64,15 @@ struct cso_hash_iter {
 };
 
 struct cso_hash {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   struct cso_node *end;
-   int size;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
+   struct cso_node *slots;
+   unsigned num_slots;     /* 0 or a power of two */
+   unsigned shift;         /* 32 - log2(num_slots) */
+   int size;               /* live entries */
+   unsigned used;          /* live and erased entries */
 };
 
+extern char cso_hash_deleted;
+
 void cso_hash_init(struct cso_hash *hash);
 void cso_hash_deinit(struct cso_hash *hash);
 
@@ -80,10 +81,10 @@ int cso_hash_size(struct cso_hash *hash);
 
 
 /**
- * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
- * Function returns iterator pointing to the inserted item in the hash.
+ * Adds a data with the given key to the hash. Entries already in the hash
+ * with the same key are kept.
+ * Function returns iterator pointing to the inserted item in the hash,
+ * or a null iterator if out of memory.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
                                      void *data);
@@ -112,8 +113,8 @@ unsigned cso_hash_iter_key(struct cso_hash_iter iter);
 
 
 /**
- * Convenience routine to iterate over the collision list while doing a memory
- * comparison to see which entry in the list is a direct copy of our template
+ * Convenience routine to go over the entries with the given key while doing
+ * a memory comparison to see which entry is a direct copy of our template
  * and returns that entry.
  */
 void *cso_hash_find_data_from_template(struct cso_hash *hash,
@@ -121,56 +122,65 @@ void *cso_hash_find_data_from_template(struct cso_hash *hash,
 				       void *templ,
 				       int size);
 
-struct cso_node *cso_hash_data_next(struct cso_node *node);
+/**
+ * Same as cso_hash_find_data_from_template(), but returns an iterator and
+ * the number of slots that were looked at.
+ */
+struct cso_hash_iter cso_hash_find_template(struct cso_hash *hash,
+                                            unsigned hash_key,
+                                            const void *templ, int size,
+                                            unsigned *probes);
 
 static inline bool
 cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   return !iter.node || iter.node == iter.hash->end;
+   return !iter.node;
 }
 
 static inline void *
 cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->end == iter.node)
+   if (!iter.node)
       return NULL;
    return iter.node->value;
 }
 
-static inline struct cso_node **
-cso_hash_find_node(struct cso_hash *hash, unsigned akey)
+/**
+ * Returns the slot where the probe sequence for key starts.
+ */
+static inline unsigned
+cso_hash_slot_index(const struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node;
-
-   if (hash->numBuckets) {
-      node = &hash->buckets[akey % hash->numBuckets];
-      assert(*node == hash->end || (*node)->next);
-      while (*node != hash->end && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = &hash->end;
-   }
-   return node;
+   /* Fibonacci hashing, so that small or clustered keys spread out. */
+   return (key * 0x9e3779b1u) >> hash->shift;
 }
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the given key.
  */
 static inline struct cso_hash_iter
 cso_hash_find(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
-   return iter;
-}
+   struct cso_hash_iter iter = {hash, NULL};
 
-static inline struct cso_hash_iter
-cso_hash_iter_next(struct cso_hash_iter iter)
-{
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
-   return next;
+   if (!hash->num_slots)
+      return iter;
+
+   const unsigned mask = hash->num_slots - 1;
+   for (unsigned i = cso_hash_slot_index(hash, key);; i = (i + 1) & mask) {
+      struct cso_node *node = &hash->slots[i];
+
+      if (!node->value)
+         return iter;
+      if (node->key == key && node->value != &cso_hash_deleted) {
+         iter.node = node;
+         return iter;
+      }
+   }
 }
 
+struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -42,6 +42,7 @@
 
 #include "frontend/api.h"
 #include "cso_cache/cso_context.h"
+#include "util/u_atomic.h"
 #include "util/u_draw_quad.h"
 #include "util/format/u_format.h"
 #include "util/u_inlines.h"
@@ -59,12 +60,22 @@ static boolean huds_visible = TRUE;
 static int hud_scale = 1;
 
 
+/* Set by GALLIUM_HUD_TRACE_SIGNAL to write out traces */
+static volatile sig_atomic_t hud_trace_flush_requested = 0;
+
+
 #ifdef PIPE_OS_UNIX
 static void
 signal_visible_handler(int sig, siginfo_t *siginfo, void *context)
 {
    huds_visible = !huds_visible;
 }
+
+static void
+signal_trace_flush_handler(int sig, siginfo_t *siginfo, void *context)
+{
+   hud_trace_flush_requested = 1;
+}
 #endif
 
 static void
@@ -638,13 +649,9 @@ hud_start_queries(struct hud_context *hud, struct pipe_context *pipe)
    }
 }
 
-/* Stop queries, query results, and record vertices for charts. */
-static void
-hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
+static bool
+hud_alloc_vertices(struct hud_context *hud, struct pipe_context *pipe)
 {
-   struct hud_pane *pane;
-   struct hud_graph *gr, *next;
-
    /* prepare vertex buffers */
    hud_prepare_vertices(hud, &hud->bg, 16 * 256, 2 * sizeof(float));
    hud_prepare_vertices(hud, &hud->whitelines, 4 * 256, 2 * sizeof(float));
@@ -660,7 +667,7 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
                   16, &hud->bg.vbuf.buffer_offset, &hud->bg.vbuf.buffer.resource,
                   (void**)&hud->bg.vertices);
    if (!hud->bg.vertices)
-      return;
+      return false;
 
    pipe_resource_reference(&hud->whitelines.vbuf.buffer.resource, hud->bg.vbuf.buffer.resource);
    pipe_resource_reference(&hud->text.vbuf.buffer.resource, hud->bg.vbuf.buffer.resource);
@@ -674,6 +681,18 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
                                   hud->whitelines.buffer_size;
    hud->text.vertices = hud->whitelines.vertices +
                         hud->whitelines.buffer_size / sizeof(float);
+   return true;
+}
+
+/* Stop queries, query results, and record vertices for charts. */
+static void
+hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
+{
+   struct hud_pane *pane;
+   struct hud_graph *gr, *next;
+
+   if (!hud->headless && !hud_alloc_vertices(hud, pipe))
+      return;
 
    /* prepare all graphs */
    hud_batch_query_update(hud->batch_query, pipe);
@@ -700,12 +719,27 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
          }
       }
 
+      if (hud->headless)
+         continue;
+
       if (hud->simple)
          hud_pane_accumulate_vertices_simple(hud, pane);
       else
          hud_pane_accumulate_vertices(hud, pane);
    }
 
+   if (hud->trace) {
+      hud_trace_add_sample(hud->trace);
+
+      if (hud_trace_flush_requested) {
+         hud_trace_flush_requested = 0;
+         hud_trace_flush(hud->trace);
+      }
+   }
+
+   if (hud->headless)
+      return;
+
    /* unmap the uploader's vertex buffer before drawing */
    u_upload_unmap(pipe->stream_uploader);
 }
@@ -1175,6 +1209,21 @@ has_pipeline_stats_query(struct pipe_screen *screen)
    return screen->get_param(screen, PIPE_CAP_QUERY_PIPELINE_STATISTICS) != 0;
 }
 
+/* Ask the state tracker of the recording context for its state validation
+ * counters.  If the recording context isn't set yet, this is done when it
+ * is.
+ */
+static void
+hud_enable_validation_stats(struct hud_context *hud)
+{
+   struct st_context_iface *st = hud->record_st;
+
+   hud->want_validation_stats = true;
+
+   if (st && st->get_validation_stats && !hud->validation_stats)
+      hud->validation_stats = st->get_validation_stats(st);
+}
+
 static void
 hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
                   const char *env)
@@ -1271,6 +1320,19 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "main-thread-busy") == 0) {
          hud_thread_busy_install(pane, name, true);
       }
+      else if (strcmp(name, "st-validations") == 0) {
+         hud_thread_counter_install(pane, name, HUD_COUNTER_ST_VALIDATIONS);
+         hud_enable_validation_stats(hud);
+      }
+      else if (strcmp(name, "st-atom-updates") == 0) {
+         hud_thread_counter_install(pane, name, HUD_COUNTER_ST_ATOM_UPDATES);
+         hud_enable_validation_stats(hud);
+      }
+      else if (strcmp(name, "st-validation-time") == 0) {
+         hud_thread_counter_install(pane, name,
+                                    HUD_COUNTER_ST_VALIDATION_TIME);
+         hud_enable_validation_stats(hud);
+      }
 #ifdef HAVE_GALLIUM_EXTRA_HUD
       else if (sscanf(name, "nic-rx-%s", arg_name) == 1) {
          hud_nic_graph_install(pane, arg_name, NIC_DIRECTION_RX);
@@ -1556,6 +1618,8 @@ print_help(struct pipe_screen *screen)
    puts("  You can change behavior of the whole HUD by adding these options at");
    puts("  the beginning of the environment variable:");
    puts("  'simple,' disables all the fancy stuff and only draws text.");
+   puts("  'headless,' records the data sources without drawing anything,");
+   puts("             for use with GALLIUM_HUD_TRACE or GALLIUM_HUD_DUMP_DIR.");
    puts("");
    puts("  Example: GALLIUM_HUD=\".w256.h64.x1600.y520.d.c1000fps+cpu,.datom-count\"");
    puts("");
@@ -1586,6 +1650,10 @@ print_help(struct pipe_screen *screen)
       puts("    cs-invocations");
    }
 
+   puts("    st-validations");
+   puts("    st-atom-updates");
+   puts("    st-validation-time");
+
 #ifdef HAVE_GALLIUM_EXTRA_HUD
    hud_get_num_disks(1);
    hud_get_num_nics(1);
@@ -1750,6 +1818,11 @@ hud_unset_record_context(struct hud_context *hud)
    if (!pipe)
       return;
 
+   if (hud->trace) {
+      hud_trace_destroy(hud->trace);
+      hud->trace = NULL;
+   }
+
    LIST_FOR_EACH_ENTRY_SAFE(pane, pane_tmp, &hud->pane_list, head) {
       LIST_FOR_EACH_ENTRY_SAFE(graph, graph_tmp, &pane->graph_list, head) {
          list_del(&graph->head);
@@ -1761,12 +1834,19 @@ hud_unset_record_context(struct hud_context *hud)
 
    hud_batch_query_cleanup(&hud->batch_query, pipe);
    hud->record_pipe = NULL;
+   hud->record_st = NULL;
+   hud->validation_stats = NULL;
 }
 
 static void
-hud_set_record_context(struct hud_context *hud, struct pipe_context *pipe)
+hud_set_record_context(struct hud_context *hud, struct pipe_context *pipe,
+                       struct st_context_iface *st)
 {
    hud->record_pipe = pipe;
+   hud->record_st = st;
+
+   if (hud->want_validation_stats)
+      hud_enable_validation_stats(hud);
 }
 
 /**
@@ -1799,10 +1879,10 @@ hud_create(struct cso_context *cso, struct st_context_iface *st,
 
       if (context_id == record_ctx) {
          assert(!share->record_pipe);
-         hud_set_record_context(share, cso_get_pipe_context(cso));
+         hud_set_record_context(share, cso_get_pipe_context(cso), st);
       }
 
-      if (context_id == draw_ctx) {
+      if (context_id == draw_ctx && !share->headless) {
          assert(!share->pipe);
          hud_set_draw_context(share, cso, st);
       }
@@ -1814,9 +1894,14 @@ hud_create(struct cso_context *cso, struct st_context_iface *st,
    struct hud_context *hud;
    unsigned i;
    const char *env = debug_get_option("GALLIUM_HUD", NULL);
+   const char *trace_file = debug_get_option("GALLIUM_HUD_TRACE", NULL);
+   const char *trace_format = debug_get_option("GALLIUM_HUD_TRACE_FORMAT", "csv");
+   unsigned trace_samples = debug_get_num_option("GALLIUM_HUD_TRACE_SAMPLES", 8192);
 #ifdef PIPE_OS_UNIX
    unsigned signo = debug_get_num_option("GALLIUM_HUD_TOGGLE_SIGNAL", 0);
+   unsigned trace_signo = debug_get_num_option("GALLIUM_HUD_TRACE_SIGNAL", 0);
    static boolean sig_handled = FALSE;
+   static boolean trace_sig_handled = FALSE;
    struct sigaction action;
 
    memset(&action, 0, sizeof(action));
@@ -1836,8 +1921,14 @@ hud_create(struct cso_context *cso, struct st_context_iface *st,
    if (!hud)
       return NULL;
 
+   if (strncmp(env, "headless,", 9) == 0) {
+      hud->headless = true;
+      env += 9;
+   }
+
    /* font (the context is only used for the texture upload) */
-   if (!util_font_create(cso_get_pipe_context(cso),
+   if (!hud->headless &&
+       !util_font_create(cso_get_pipe_context(cso),
                          UTIL_FONT_FIXED_8X13, &hud->font)) {
       FREE(hud);
       return NULL;
@@ -1906,14 +1997,48 @@ hud_create(struct cso_context *cso, struct st_context_iface *st,
 
       sig_handled = TRUE;
    }
+
+   if (!trace_sig_handled && trace_signo != 0) {
+      action.sa_sigaction = &signal_trace_flush_handler;
+      action.sa_flags = SA_SIGINFO;
+
+      if (trace_signo >= NSIG)
+         fprintf(stderr, "gallium_hud: invalid signal %u\n", trace_signo);
+      else if (sigaction(trace_signo, &action, NULL) < 0)
+         fprintf(stderr, "gallium_hud: unable to set handler for signal %u\n", trace_signo);
+      fflush(stderr);
+
+      trace_sig_handled = TRUE;
+   }
 #endif
 
    if (record_ctx == 0)
-      hud_set_record_context(hud, cso_get_pipe_context(cso));
-   if (draw_ctx == 0)
+      hud_set_record_context(hud, cso_get_pipe_context(cso), st);
+   if (draw_ctx == 0 && !hud->headless)
       hud_set_draw_context(hud, cso, st);
 
    hud_parse_env_var(hud, screen, env);
+
+   if (trace_file) {
+      /* Each HUD writes its own trace. The first one uses the file name as
+       * is, the next ones append ".1", ".2", etc.
+       */
+      static unsigned num_traces;
+      unsigned index = p_atomic_inc_return(&num_traces) - 1;
+      char *filename = NULL;
+
+      if (index == 0)
+         filename = strdup(trace_file);
+      else if (asprintf(&filename, "%s.%u", trace_file, index) < 0)
+         filename = NULL;
+
+      if (filename) {
+         hud->trace = hud_trace_create(hud, filename,
+                                       strcmp(trace_format, "binary") == 0,
+                                       trace_samples);
+         free(filename);
+      }
+   }
    return hud;
 }
 
@@ -1931,6 +2056,8 @@ hud_destroy(struct hud_context *hud, struct cso_context *cso)
       hud_unset_draw_context(hud);
 
    if (p_atomic_dec_zero(&hud->refcount)) {
+      if (hud->trace)
+         hud_trace_destroy(hud->trace);
       pipe_resource_reference(&hud->font.texture, NULL);
       FREE(hud);
    }
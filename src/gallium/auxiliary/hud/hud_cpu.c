@@ -29,6 +29,7 @@
  */
 
 #include "hud/hud_private.h"
+#include "frontend/api.h"
 #include "util/os_time.h"
 #include "os/os_thread.h"
 #include "util/u_memory.h"
@@ -402,6 +403,18 @@ struct counter_info {
 static unsigned get_counter(struct hud_graph *gr, enum hud_counter counter)
 {
    struct util_queue_monitoring *mon = gr->pane->hud->monitored_queue;
+   const struct st_validation_stats *st = gr->pane->hud->validation_stats;
+
+   switch (counter) {
+   case HUD_COUNTER_ST_VALIDATIONS:
+      return st ? st->validations : 0;
+   case HUD_COUNTER_ST_ATOM_UPDATES:
+      return st ? st->atom_updates : 0;
+   case HUD_COUNTER_ST_VALIDATION_TIME:
+      return st ? st->time_ns / 1000 : 0;
+   default:
+      break;
+   }
 
    if (!mon || !mon->queue)
       return 0;
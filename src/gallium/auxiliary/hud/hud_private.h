@@ -38,14 +38,19 @@ enum hud_counter {
    HUD_COUNTER_OFFLOADED,
    HUD_COUNTER_DIRECT,
    HUD_COUNTER_SYNCS,
+   HUD_COUNTER_ST_VALIDATIONS,
+   HUD_COUNTER_ST_ATOM_UPDATES,
+   HUD_COUNTER_ST_VALIDATION_TIME,
 };
 
 struct hud_context {
    int refcount;
    bool simple;
+   bool headless; /* record queries without drawing anything */
 
    /* Context where queries are executed. */
    struct pipe_context *record_pipe;
+   struct st_context_iface *record_st;
 
    /* Context where the HUD is drawn: */
    struct pipe_context *pipe;
@@ -57,6 +62,13 @@ struct hud_context {
 
    struct util_queue_monitoring *monitored_queue;
 
+   /* State validation counters of record_st, if a graph needs them. */
+   bool want_validation_stats;
+   const struct st_validation_stats *validation_stats;
+
+   /* GALLIUM_HUD_TRACE output */
+   struct hud_trace *trace;
+
    /* states */
    struct pipe_blend_state no_blend, alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -151,6 +163,14 @@ void hud_pane_add_graph(struct hud_pane *pane, struct hud_graph *gr);
 void hud_pane_set_max_value(struct hud_pane *pane, uint64_t value);
 void hud_graph_add_value(struct hud_graph *gr, double value);
 
+/* trace */
+struct hud_trace *hud_trace_create(struct hud_context *hud,
+                                   const char *filename, bool binary,
+                                   unsigned max_samples);
+void hud_trace_add_sample(struct hud_trace *trace);
+void hud_trace_flush(struct hud_trace *trace);
+void hud_trace_destroy(struct hud_trace *trace);
+
 /* graphs/queries */
 struct hud_batch_query_context;
 
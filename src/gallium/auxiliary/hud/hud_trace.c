@@ -0,0 +1,235 @@
+/**************************************************************************
+ *
+ * Copyright 2021 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* This file records the values of all HUD graphs, i.e. the data sources
+ * listed in GALLIUM_HUD, into a ring buffer at the HUD period and writes
+ * them to a file for offline analysis. Nothing is formatted or written
+ * while sampling; the ring buffer is written out on exit or when requested
+ * with a signal.
+ *
+ * The CSV format has a header line with the graph names, and one line
+ * per sample: the time in microseconds since the start of the trace
+ * followed by the value of each graph.
+ *
+ * The binary format uses the native byte order:
+ *    char     magic[8] = "HUDTRACE"
+ *    uint32_t num_graphs
+ *    char     name[128] for each graph, zero-terminated
+ *    double   time, value[num_graphs] for each sample
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "hud/hud_private.h"
+#include "util/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#define HUD_TRACE_MAGIC "HUDTRACE"
+
+struct hud_trace {
+   FILE *file;
+   bool binary;
+   uint64_t period; /* in microseconds */
+   uint64_t start_time;
+   uint64_t last_time;
+
+   struct hud_graph **graphs;
+   unsigned num_graphs;
+
+   /* Ring buffer of samples. A sample is the time followed by the value
+    * of each graph, all stored as doubles.
+    */
+   double *samples;
+   unsigned max_samples;
+   unsigned first_sample;
+   unsigned num_samples;
+   unsigned num_dropped_samples;
+};
+
+static void
+hud_trace_write_header(struct hud_trace *trace)
+{
+   if (trace->binary) {
+      uint32_t num_graphs = trace->num_graphs;
+
+      fwrite(HUD_TRACE_MAGIC, 1, strlen(HUD_TRACE_MAGIC), trace->file);
+      fwrite(&num_graphs, sizeof(num_graphs), 1, trace->file);
+
+      for (unsigned i = 0; i < trace->num_graphs; i++) {
+         fwrite(trace->graphs[i]->name, sizeof(trace->graphs[i]->name), 1,
+                trace->file);
+      }
+   } else {
+      fprintf(trace->file, "time_us");
+      for (unsigned i = 0; i < trace->num_graphs; i++)
+         fprintf(trace->file, ",%s", trace->graphs[i]->name);
+      fprintf(trace->file, "\n");
+   }
+}
+
+/**
+ * Create a trace of all graphs of the HUD, written to "filename".
+ * The ring buffer holds "max_samples" samples; the oldest ones are dropped
+ * if it's not written out in time.
+ */
+struct hud_trace *
+hud_trace_create(struct hud_context *hud, const char *filename, bool binary,
+                 unsigned max_samples)
+{
+   struct hud_trace *trace;
+   struct hud_pane *pane;
+   struct hud_graph *gr;
+   unsigned num_graphs = 0;
+
+   LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head)
+      num_graphs += pane->num_graphs;
+
+   if (!num_graphs || !max_samples)
+      return NULL;
+
+   trace = CALLOC_STRUCT(hud_trace);
+   if (!trace)
+      return NULL;
+
+   trace->graphs = MALLOC(num_graphs * sizeof(trace->graphs[0]));
+   trace->samples = MALLOC(max_samples * (num_graphs + 1) * sizeof(double));
+   if (!trace->graphs || !trace->samples)
+      goto fail;
+
+   trace->file = fopen(filename, binary ? "wb" : "w");
+   if (!trace->file) {
+      fprintf(stderr, "gallium_hud: unable to open the trace file %s\n",
+              filename);
+      goto fail;
+   }
+
+   LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+      /* All panes have the same period. */
+      trace->period = pane->period;
+
+      LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+         trace->graphs[trace->num_graphs++] = gr;
+      }
+   }
+
+   trace->binary = binary;
+   trace->max_samples = max_samples;
+   trace->start_time = os_time_get();
+   trace->last_time = trace->start_time;
+
+   hud_trace_write_header(trace);
+   return trace;
+
+fail:
+   FREE(trace->graphs);
+   FREE(trace->samples);
+   FREE(trace);
+   return NULL;
+}
+
+/**
+ * Record the current value of all graphs if the period has elapsed since
+ * the last sample. This is called after the graphs have been updated.
+ */
+void
+hud_trace_add_sample(struct hud_trace *trace)
+{
+   uint64_t now = os_time_get();
+   unsigned sample_size = trace->num_graphs + 1;
+
+   if (now < trace->last_time + trace->period)
+      return;
+
+   trace->last_time = now;
+
+   if (trace->num_samples == trace->max_samples) {
+      trace->first_sample = (trace->first_sample + 1) % trace->max_samples;
+      trace->num_samples--;
+      trace->num_dropped_samples++;
+   }
+
+   unsigned index = (trace->first_sample + trace->num_samples) %
+                    trace->max_samples;
+   double *sample = trace->samples + index * sample_size;
+
+   sample[0] = now - trace->start_time;
+   for (unsigned i = 0; i < trace->num_graphs; i++)
+      sample[i + 1] = trace->graphs[i]->current_value;
+
+   trace->num_samples++;
+}
+
+/**
+ * Write all recorded samples to the file and empty the ring buffer.
+ */
+void
+hud_trace_flush(struct hud_trace *trace)
+{
+   unsigned sample_size = trace->num_graphs + 1;
+
+   if (trace->num_dropped_samples) {
+      fprintf(stderr, "gallium_hud: %u trace samples were dropped, "
+              "increase GALLIUM_HUD_TRACE_SAMPLES\n",
+              trace->num_dropped_samples);
+      trace->num_dropped_samples = 0;
+   }
+
+   for (unsigned s = 0; s < trace->num_samples; s++) {
+      unsigned index = (trace->first_sample + s) % trace->max_samples;
+      double *sample = trace->samples + index * sample_size;
+
+      if (trace->binary) {
+         fwrite(sample, sizeof(double), sample_size, trace->file);
+         continue;
+      }
+
+      fprintf(trace->file, "%" PRIu64, (uint64_t)sample[0]);
+      for (unsigned i = 1; i < sample_size; i++) {
+         if (fabs(sample[i] - llround(sample[i])) > FLT_EPSILON)
+            fprintf(trace->file, ",%f", sample[i]);
+         else
+            fprintf(trace->file, ",%" PRId64, (int64_t)llround(sample[i]));
+      }
+      fprintf(trace->file, "\n");
+   }
+
+   fflush(trace->file);
+   trace->first_sample = 0;
+   trace->num_samples = 0;
+}
+
+void
+hud_trace_destroy(struct hud_trace *trace)
+{
+   hud_trace_flush(trace);
+   fclose(trace->file);
+   FREE(trace->graphs);
+   FREE(trace->samples);
+   FREE(trace);
+}
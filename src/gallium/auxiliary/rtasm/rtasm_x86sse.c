@@ -1508,6 +1508,94 @@ void sse2_rcpss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+/***********************************************************************
+ * SSE4.1 instructions
+ */
+
+static void sse41_op_0f38( struct x86_function *p,
+                           unsigned char op,
+                           struct x86_reg dst,
+                           struct x86_reg src )
+{
+   assert(dst.file == file_XMM && dst.mod == mod_REG);
+   emit_2ub(p, 0x66, X86_TWOB);
+   emit_2ub(p, 0x38, op);
+   emit_modrm(p, dst, src);
+}
+
+void sse41_pmovzxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse41_op_0f38(p, 0x31, dst, src);
+}
+
+void sse41_pmovsxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse41_op_0f38(p, 0x21, dst, src);
+}
+
+void sse41_pmovzxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse41_op_0f38(p, 0x33, dst, src);
+}
+
+void sse41_pmovsxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   sse41_op_0f38(p, 0x23, dst, src);
+}
+
+
+/***********************************************************************
+ * F16C and AVX2 instructions
+ */
+
+/* Three byte VEX prefix for a 128 bit 66 0F 38 instruction.  vvvv is the
+ * extra source register, if any.  Like emit_modrm(), no extended x86-64
+ * registers yet.
+ */
+static void emit_vex_66_0f38( struct x86_function *p,
+                              unsigned char op,
+                              struct x86_reg dst,
+                              struct x86_reg vvvv,
+                              struct x86_reg src )
+{
+   assert(dst.file == file_XMM && dst.mod == mod_REG);
+   assert(vvvv.idx < 8);
+
+   emit_3ub(p, 0xc4, 0xe2, ((~vvvv.idx & 0xf) << 3) | 0x1);
+   emit_1ub(p, op);
+   emit_modrm(p, dst, src);
+}
+
+void f16c_vcvtph2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   /* no vvvv operand, which is encoded like xmm0 */
+   emit_vex_66_0f38(p, 0x13, dst, x86_make_reg(file_XMM, 0), src);
+}
+
+void avx2_vpsllvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 )
+{
+   DUMP_RR( dst, src1 );
+   emit_vex_66_0f38(p, 0x47, dst, src0, src1);
+}
+
+void avx2_vpsrlvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 )
+{
+   DUMP_RR( dst, src1 );
+   emit_vex_66_0f38(p, 0x45, dst, src0, src1);
+}
+
+void avx2_vpsravd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 )
+{
+   DUMP_RR( dst, src1 );
+   emit_vex_66_0f38(p, 0x46, dst, src0, src1);
+}
+
+
 /***********************************************************************
  * x87 instructions
  */
@@ -2164,6 +2252,10 @@ static void x86_init_func_common( struct x86_function *p )
       p->caps |= X86_SSE3;
    if(util_cpu_caps.has_sse4_1)
       p->caps |= X86_SSE4_1;
+   if(util_cpu_caps.has_avx2)
+      p->caps |= X86_AVX2;
+   if(util_cpu_caps.has_f16c)
+      p->caps |= X86_F16C;
    p->csr = p->store;
 #if defined(PIPE_ARCH_X86)
    emit_1i(p, 0xfb1e0ff3);
@@ -47,6 +47,8 @@ struct x86_reg {
 #define X86_SSE2 8
 #define X86_SSE3 0x10
 #define X86_SSE4_1 0x20
+#define X86_AVX2 0x40
+#define X86_F16C 0x80
 
 struct x86_function {
    unsigned caps;
@@ -308,6 +310,18 @@ void sse_unpcklps( struct x86_function *p, struct x86_reg dst, struct x86_reg sr
 void sse_pmovmskb( struct x86_function *p, struct x86_reg dest, struct x86_reg src );
 void sse_movmskps( struct x86_function *p, struct x86_reg dst, struct x86_reg src);
 
+void sse41_pmovzxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse41_pmovsxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse41_pmovzxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void sse41_pmovsxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+
+/* VEX encoded, 128 bits wide.  dst = src0 op src1:
+ */
+void f16c_vcvtph2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx2_vpsllvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 );
+void avx2_vpsrlvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 );
+void avx2_vpsravd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0, struct x86_reg src1 );
+
 void x86_add( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void x86_and( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void x86_cmovcc( struct x86_function *p, struct x86_reg dst, struct x86_reg src, enum x86_cc cc );
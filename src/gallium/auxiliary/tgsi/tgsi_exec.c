@@ -1681,6 +1681,80 @@ get_index_registers(const struct tgsi_exec_machine *mach,
 }
 
 
+/**
+ * Fetch a channel of a register that is not indirectly addressed.
+ * The index is the same for all lanes, so the channel is copied (or the
+ * scalar broadcast) in one go instead of lane by lane through index
+ * vectors.  Returns FALSE for register files that need the general path.
+ */
+static inline boolean
+fetch_src_direct(const struct tgsi_exec_machine *mach,
+                 const struct tgsi_full_src_register *reg,
+                 const uint swizzle,
+                 union tgsi_exec_channel *chan)
+{
+   const int index = reg->Register.Index;
+   const int index2D = reg->Register.Dimension ? reg->Dimension.Index : 0;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      assert(index < TGSI_EXEC_NUM_TEMPS);
+      assert(index2D == 0);
+      *chan = mach->Temps[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_INPUT: {
+      const int pos = index2D * TGSI_EXEC_MAX_INPUT_ATTRIBS + index;
+      assert(pos >= 0);
+      assert(pos < TGSI_MAX_PRIM_VERTICES * PIPE_MAX_ATTRIBS);
+      *chan = mach->Inputs[pos].xyzw[swizzle];
+      return TRUE;
+   }
+
+   case TGSI_FILE_OUTPUT:
+      assert(index >= 0);
+      assert(index2D == 0);
+      *chan = mach->Outputs[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_SYSTEM_VALUE:
+      *chan = mach->SystemValue[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_ADDRESS:
+      assert(index >= 0 && index < ARRAY_SIZE(mach->Addrs));
+      assert(index2D == 0);
+      *chan = mach->Addrs[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_IMMEDIATE: {
+      float imm;
+
+      assert(index >= 0 && index < (int)mach->ImmLimit);
+      assert(index2D == 0);
+      imm = mach->Imms[index][swizzle];
+      chan->f[0] = chan->f[1] = chan->f[2] = chan->f[3] = imm;
+      return TRUE;
+   }
+
+   case TGSI_FILE_CONSTANT: {
+      const int pos = index * 4 + swizzle;
+      uint value = 0;
+
+      assert(index2D >= 0 && index2D < PIPE_MAX_CONSTANT_BUFFERS);
+
+      /* Same bounds check as fetch_src_file_channel(). */
+      if (index >= 0 && pos < (int) mach->ConstsSize[index2D])
+         value = ((const uint *)mach->Consts[index2D])[pos];
+      chan->u[0] = chan->u[1] = chan->u[2] = chan->u[3] = value;
+      return TRUE;
+   }
+
+   default:
+      return FALSE;
+   }
+}
+
 static void
 fetch_source_d(const struct tgsi_exec_machine *mach,
                union tgsi_exec_channel *chan,
@@ -1691,10 +1765,15 @@ fetch_source_d(const struct tgsi_exec_machine *mach,
    union tgsi_exec_channel index2D;
    uint swizzle;
 
-   get_index_registers(mach, reg, &index, &index2D);
+   swizzle = tgsi_util_get_full_src_register_swizzle( reg, chan_index );
+
+   if (!reg->Register.Indirect &&
+       !(reg->Register.Dimension && reg->Dimension.Indirect) &&
+       fetch_src_direct(mach, reg, swizzle, chan))
+      return;
 
+   get_index_registers(mach, reg, &index, &index2D);
 
-   swizzle = tgsi_util_get_full_src_register_swizzle( reg, chan_index );
    fetch_src_file_channel(mach,
                           reg->Register.File,
                           swizzle,
@@ -1931,6 +2010,11 @@ store_dest(struct tgsi_exec_machine *mach,
       return;
 
    if (!inst->Instruction.Saturate) {
+      /* All lanes enabled is the common case, write the whole channel. */
+      if (execmask == (1 << TGSI_QUAD_SIZE) - 1) {
+         *dst = *chan;
+         return;
+      }
       for (i = 0; i < TGSI_QUAD_SIZE; i++)
          if (execmask & (1 << i))
             dst->i[i] = chan->i[i];
@@ -64,7 +64,7 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_CONSTS 7
+#define NUM_CONSTS 13
 
 enum
 {
@@ -74,20 +74,40 @@ enum
    CONST_INV_32767,
    CONST_INV_65535,
    CONST_INV_2147483647,
-   CONST_255
+   CONST_255,
+   CONST_1010102_SHR,
+   CONST_1010102_MASK,
+   CONST_1010102_SHL,
+   CONST_1010102_SAR,
+   CONST_INV_1023_3,
+   CONST_INV_511_1
 };
 
-#define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
-static float consts[NUM_CONSTS][4] = {
-   {0, 0, 0, 1},
+union translate_sse_const
+{
+   float f[4];
+   int32_t i[4];
+};
+
+#define C(v) {{(float)(v), (float)(v), (float)(v), (float)(v)}}
+#define I(x, y, z, w) {.i = {(x), (y), (z), (w)}}
+static const union translate_sse_const consts[NUM_CONSTS] = {
+   {{0, 0, 0, 1}},
    C(1.0 / 127.0),
    C(1.0 / 255.0),
    C(1.0 / 32767.0),
    C(1.0 / 65535.0),
    C(1.0 / 2147483647.0),
-   C(255.0)
+   C(255.0),
+   I(0, 10, 20, 30),
+   I(0x3ff, 0x3ff, 0x3ff, 0x3),
+   I(22, 12, 2, 0),
+   I(22, 22, 22, 30),
+   {{1.0f / 0x3ff, 1.0f / 0x3ff, 1.0f / 0x3ff, 1.0f / 0x3}},
+   {{1.0f / 0x1ff, 1.0f / 0x1ff, 1.0f / 0x1ff, 1.0f}}
 };
 
+#undef I
 #undef C
 
 struct translate_sse
@@ -100,7 +120,7 @@ struct translate_sse
    struct x86_function elt8_func;
    struct x86_function *func;
 
-     PIPE_ALIGN_VAR(16) float consts[NUM_CONSTS][4];
+     PIPE_ALIGN_VAR(16) union translate_sse_const consts[NUM_CONSTS];
    int8_t reg_to_const[16];
    int8_t const_to_reg[NUM_CONSTS];
 
@@ -167,7 +187,7 @@ get_const(struct translate_sse *p, unsigned id)
    /* TODO: this should happen outside the loop, if possible */
    sse_movaps(p->func, reg,
               x86_make_disp(p->machine_EDI,
-                            get_offset(p, &p->consts[id][0])));
+                            get_offset(p, &p->consts[id])));
 
    return reg;
 }
@@ -329,6 +349,72 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* Whether two channels hold the same kind of data.  Unlike memcmp, this
+ * ignores where in the vertex the channels are.
+ */
+static boolean
+channels_equal(const struct util_format_channel_description *a,
+               const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
+/* Whether the format packs 10, 10, 10 and 2 bit channels of the same type,
+ * in that order, into 32 bits.
+ */
+static boolean
+is_format_1010102(const struct util_format_description *desc)
+{
+   return desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+          desc->block.bits == 32 &&
+          desc->nr_channels == 4 &&
+          desc->channel[0].size == 10 && desc->channel[0].shift == 0 &&
+          desc->channel[1].size == 10 && desc->channel[1].shift == 10 &&
+          desc->channel[2].size == 10 && desc->channel[2].shift == 20 &&
+          desc->channel[3].size == 2 && desc->channel[3].shift == 30 &&
+          (desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED ||
+           desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED) &&
+          !desc->channel[0].pure_integer &&
+          desc->channel[1].type == desc->channel[0].type &&
+          desc->channel[2].type == desc->channel[0].type &&
+          desc->channel[3].type == desc->channel[0].type &&
+          desc->channel[3].normalized == desc->channel[0].normalized;
+}
+
+
+/* Load a 10_10_10_2 value and convert its channels to floats, in the
+ * four lanes of the register.  Needs AVX2 for the per-lane shifts.
+ */
+static void
+emit_load_1010102(struct translate_sse *p, struct x86_reg data,
+                  struct x86_reg src,
+                  const struct util_format_description *desc)
+{
+   sse2_movd(p->func, data, src);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+
+   if (desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED) {
+      /* move each channel to the top, then shift it back, sign extending */
+      avx2_vpsllvd(p->func, data, data, get_const(p, CONST_1010102_SHL));
+      avx2_vpsravd(p->func, data, data, get_const(p, CONST_1010102_SAR));
+      sse2_cvtdq2ps(p->func, data, data);
+      if (desc->channel[0].normalized)
+         sse_mulps(p->func, data, get_const(p, CONST_INV_511_1));
+   }
+   else {
+      avx2_vpsrlvd(p->func, data, data, get_const(p, CONST_1010102_SHR));
+      sse_andps(p->func, data, get_const(p, CONST_1010102_MASK));
+      sse2_cvtdq2ps(p->func, data, data);
+      if (desc->channel[0].normalized)
+         sse_mulps(p->func, data, get_const(p, CONST_INV_1023_3));
+   }
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -471,28 +557,29 @@ translate_attr_convert(struct translate_sse *p,
         PIPE_SWIZZLE_NONE, PIPE_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed_1010102;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   packed_1010102 = (x86_target_caps(p->func) & X86_AVX2) &&
+                    is_format_1010102(input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !packed_1010102)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   for (i = 1; i < input_desc->nr_channels && !packed_1010102; ++i) {
+      if (!channels_equal(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!channels_equal(&output_desc->channel[i],
+                          &output_desc->channel[0])) {
          return FALSE;
       }
    }
@@ -522,7 +609,10 @@ translate_attr_convert(struct translate_sse *p,
             id_swizzle = FALSE;
       }
 
-      if (needed_chans > 0) {
+      if (needed_chans > 0 && packed_1010102) {
+         emit_load_1010102(p, dataXMM, src, input_desc);
+      }
+      else if (needed_chans > 0) {
          switch (input_desc->channel[0].type) {
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
@@ -531,9 +621,12 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovzx */
             switch (input_desc->channel[0].size) {
             case 8:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovzxbd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                /* TODO: this may be inefficient due to get_identity() being
                 *  used both as a float and integer register.
                 */
@@ -541,6 +634,10 @@ translate_attr_convert(struct translate_sse *p,
                sse2_punpcklbw(p->func, dataXMM, get_const(p, CONST_IDENTITY));
                break;
             case 16:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovzxwd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklwd(p->func, dataXMM, get_const(p, CONST_IDENTITY));
                break;
             case 32:           /* we lose precision here */
@@ -583,14 +680,21 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovsx */
             switch (input_desc->channel[0].size) {
             case 8:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovsxbd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklbw(p->func, dataXMM, dataXMM);
                sse2_punpcklbw(p->func, dataXMM, dataXMM);
                sse2_psrad_imm(p->func, dataXMM, 24);
                break;
             case 16:
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovsxwd(p->func, dataXMM, dataXMM);
+                  break;
+               }
                sse2_punpcklwd(p->func, dataXMM, dataXMM);
                sse2_psrad_imm(p->func, dataXMM, 16);
                break;
@@ -626,6 +730,14 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
+            if (input_desc->channel[0].size == 16) {
+               if (!(x86_target_caps(p->func) & X86_F16C))
+                  return FALSE;
+               /* zero padded, and half 0.0 converts to 0.0 */
+               emit_load_sse2(p, dataXMM, src, input_desc->nr_channels * 2);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               break;
+            }
             if (input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
@@ -653,11 +765,11 @@ translate_attr_convert(struct translate_sse *p,
          default:
             return FALSE;
          }
+      }
 
-         if (!id_swizzle) {
-            sse_shufps(p->func, dataXMM, dataXMM,
-                       SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
-         }
+      if (needed_chans > 0 && !id_swizzle) {
+         sse_shufps(p->func, dataXMM, dataXMM,
+                    SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
       }
 
       if (output_desc->nr_channels >= 4
@@ -883,8 +995,8 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
-   else if (!memcmp(&output_desc->channel[0], &input_desc->channel[0],
-                    sizeof(output_desc->channel[0]))) {
+   else if (channels_equal(&output_desc->channel[0],
+                           &input_desc->channel[0])) {
       struct x86_reg tmp = p->tmp_EAX;
       unsigned i;
 
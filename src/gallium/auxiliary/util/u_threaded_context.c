@@ -121,29 +121,6 @@ simplify_draw_info(struct pipe_draw_info *info)
    }
 }
 
-static bool
-is_next_call_a_mergeable_draw(struct tc_draw_single *first_info,
-                              struct tc_call *next,
-                              struct tc_draw_single **next_info)
-{
-   if (next->call_id != TC_CALL_draw_single)
-      return false;
-
-   *next_info = (struct tc_draw_single*)&next->payload;
-   simplify_draw_info(&(*next_info)->info);
-
-   STATIC_ASSERT(offsetof(struct pipe_draw_info, min_index) ==
-                 sizeof(struct pipe_draw_info) - 8);
-   STATIC_ASSERT(offsetof(struct pipe_draw_info, max_index) ==
-                 sizeof(struct pipe_draw_info) - 4);
-
-   /* All fields must be the same except start and count. */
-   /* u_threaded_context stores start/count in min/max_index for single draws. */
-   return memcmp((uint32_t*)&first_info->info,
-                 (uint32_t*)&(*next_info)->info,
-                 DRAW_INFO_SIZE_WITHOUT_MIN_MAX_INDEX) == 0;
-}
-
 static void
 tc_batch_execute(void *job, UNUSED int thread_index)
 {
@@ -157,55 +134,6 @@ tc_batch_execute(void *job, UNUSED int thread_index)
 
    for (struct tc_call *iter = batch->call; iter != last;) {
       tc_assert(iter->sentinel == TC_SENTINEL);
-
-      /* Draw call merging. */
-      if (iter->call_id == TC_CALL_draw_single) {
-         struct tc_call *first = iter;
-         struct tc_call *next = first + first->num_call_slots;
-         struct tc_draw_single *first_info =
-            (struct tc_draw_single*)&first->payload;
-         struct tc_draw_single *next_info;
-
-         simplify_draw_info(&first_info->info);
-
-         /* If at least 2 consecutive draw calls can be merged... */
-         if (next != last && next->call_id == TC_CALL_draw_single &&
-             first_info->info.drawid == 0 &&
-             is_next_call_a_mergeable_draw(first_info, next, &next_info)) {
-            /* Merge up to 256 draw calls. */
-            struct pipe_draw_start_count multi[256];
-            unsigned num_draws = 2;
-
-            /* u_threaded_context stores start/count in min/max_index for single draws. */
-            multi[0].start = first_info->info.min_index;
-            multi[0].count = first_info->info.max_index;
-            multi[1].start = next_info->info.min_index;
-            multi[1].count = next_info->info.max_index;
-
-            if (next_info->info.index_size)
-               pipe_resource_reference(&next_info->info.index.resource, NULL);
-
-            /* Find how many other draws can be merged. */
-            next = next + next->num_call_slots;
-            for (; next != last && num_draws < ARRAY_SIZE(multi) &&
-                 is_next_call_a_mergeable_draw(first_info, next, &next_info);
-                 next += next->num_call_slots, num_draws++) {
-               /* u_threaded_context stores start/count in min/max_index for single draws. */
-               multi[num_draws].start = next_info->info.min_index;
-               multi[num_draws].count = next_info->info.max_index;
-
-               if (next_info->info.index_size)
-                  pipe_resource_reference(&next_info->info.index.resource, NULL);
-            }
-
-            pipe->draw_vbo(pipe, &first_info->info, NULL, multi, num_draws);
-            if (first_info->info.index_size)
-               pipe_resource_reference(&first_info->info.index.resource, NULL);
-            iter = next;
-            continue;
-         }
-      }
-
       execute_func[iter->call_id](pipe, &iter->payload);
       iter += iter->num_call_slots;
    }
@@ -214,6 +142,17 @@ tc_batch_execute(void *job, UNUSED int thread_index)
    batch->num_total_call_slots = 0;
 }
 
+/* Called when no more calls will be added to the current batch. */
+static void
+tc_batch_end_recording(struct threaded_context *tc, struct tc_batch *batch)
+{
+   p_atomic_add(&tc->num_coalesced_calls, batch->num_coalesced_calls);
+   p_atomic_add(&tc->num_merged_draws, batch->num_merged_draws);
+   batch->num_coalesced_calls = 0;
+   batch->num_merged_draws = 0;
+   tc->last_call = NULL;
+}
+
 static void
 tc_batch_flush(struct threaded_context *tc)
 {
@@ -224,6 +163,7 @@ tc_batch_flush(struct threaded_context *tc)
    tc_debug_check(tc);
    tc->bytes_mapped_estimate = 0;
    p_atomic_add(&tc->num_offloaded_slots, next->num_total_call_slots);
+   tc_batch_end_recording(tc, next);
 
    if (next->token) {
       next->token->tc = NULL;
@@ -262,11 +202,31 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
    call->sentinel = TC_SENTINEL;
    call->call_id = id;
    call->num_call_slots = num_call_slots;
+   tc->last_call = call;
 
    tc_debug_check(tc);
    return &call->payload;
 }
 
+/* Resize the last call of the current batch, so that it can absorb a new
+ * call instead of adding it. Return false if the batch is too full.
+ */
+static bool
+tc_resize_last_call(struct threaded_context *tc, unsigned num_call_slots)
+{
+   struct tc_batch *next = &tc->batch_slots[tc->next];
+   struct tc_call *call = tc->last_call;
+   unsigned num_total_call_slots =
+      next->num_total_call_slots - call->num_call_slots + num_call_slots;
+
+   if (num_total_call_slots > TC_CALLS_PER_BATCH)
+      return false;
+
+   next->num_total_call_slots = num_total_call_slots;
+   call->num_call_slots = num_call_slots;
+   return true;
+}
+
 #define tc_payload_size_to_call_slots(size) \
    DIV_ROUND_UP(offsetof(struct tc_call, payload) + (size), sizeof(struct tc_call))
 
@@ -321,6 +281,7 @@ _tc_sync(struct threaded_context *tc, UNUSED const char *info, UNUSED const char
    /* .. and execute unflushed calls directly. */
    if (next->num_total_call_slots) {
       p_atomic_add(&tc->num_direct_slots, next->num_total_call_slots);
+      tc_batch_end_recording(tc, next);
       tc->bytes_mapped_estimate = 0;
       tc_batch_execute(next, 0);
       synced = true;
@@ -640,8 +601,68 @@ tc_render_condition(struct pipe_context *_pipe,
       return pipe->create_##name##_state(pipe, state); \
    }
 
-#define TC_CSO_BIND(name) TC_FUNC1(bind_##name##_state, cso, , void *, , *)
-#define TC_CSO_DELETE(name) TC_FUNC1(delete_##name##_state, cso, , void *, , *)
+static void
+tc_bind_cso(struct threaded_context *tc, enum tc_call_id id,
+            enum tc_cso_type type, void *cso)
+{
+   struct tc_batch *next = &tc->batch_slots[tc->next];
+
+   /* Drop binds of the CSO that is already bound. */
+   if (tc->bound_cso_mask & BITFIELD_BIT(type) && tc->bound_cso[type] == cso) {
+      next->num_coalesced_calls++;
+      return;
+   }
+
+   tc->bound_cso[type] = cso;
+   tc->bound_cso_mask |= BITFIELD_BIT(type);
+
+   /* Nothing has used the CSO bound by the last call, so replace it. */
+   if (tc->last_call && tc->last_call->call_id == id) {
+      *(void**)&tc->last_call->payload = cso;
+      next->num_coalesced_calls++;
+      return;
+   }
+
+   *(void**)tc_add_small_call(tc, id) = cso;
+}
+
+static void
+tc_delete_cso(struct threaded_context *tc, enum tc_call_id id,
+              enum tc_cso_type type, void *cso)
+{
+   /* A new CSO can be created at the same address. */
+   if (tc->bound_cso[type] == cso)
+      tc->bound_cso_mask &= ~BITFIELD_BIT(type);
+
+   *(void**)tc_add_small_call(tc, id) = cso;
+}
+
+#define TC_CSO_CALL(func) \
+   static void \
+   tc_call_##func(struct pipe_context *pipe, union tc_payload *payload) \
+   { \
+      pipe->func(pipe, *(void**)payload); \
+   }
+
+#define TC_CSO_BIND(name) \
+   TC_CSO_CALL(bind_##name##_state) \
+   \
+   static void \
+   tc_bind_##name##_state(struct pipe_context *_pipe, void *cso) \
+   { \
+      tc_bind_cso(threaded_context(_pipe), TC_CALL_bind_##name##_state, \
+                  TC_CSO_##name, cso); \
+   }
+
+#define TC_CSO_DELETE(name) \
+   TC_CSO_CALL(delete_##name##_state) \
+   \
+   static void \
+   tc_delete_##name##_state(struct pipe_context *_pipe, void *cso) \
+   { \
+      tc_delete_cso(threaded_context(_pipe), TC_CALL_delete_##name##_state, \
+                    TC_CSO_##name, cso); \
+   }
 
 #define TC_CSO_WHOLE2(name, sname) \
    TC_CSO_CREATE(name, sname) \
@@ -660,7 +681,7 @@ TC_CSO_WHOLE2(gs, shader)
 TC_CSO_WHOLE2(tcs, shader)
 TC_CSO_WHOLE2(tes, shader)
 TC_CSO_CREATE(sampler, sampler)
-TC_CSO_DELETE(sampler)
+TC_FUNC1(delete_sampler_state, cso, , void *, , *)
 TC_CSO_BIND(vertex_elements)
 TC_CSO_DELETE(vertex_elements)
 
@@ -788,6 +809,31 @@ tc_call_set_constant_buffer(struct pipe_context *pipe, union tc_payload *payload
    pipe->set_constant_buffer(pipe, p->info.shader, p->info.index, true, &p->cb);
 }
 
+/* If the last call set the same constant buffer slot, nothing has used it,
+ * so return its payload resized to the new call. Otherwise return NULL.
+ */
+static void *
+tc_replace_last_constant_buffer(struct threaded_context *tc, unsigned shader,
+                                unsigned index, unsigned size)
+{
+   struct tc_call *call = tc->last_call;
+
+   if (!call || call->call_id != TC_CALL_set_constant_buffer)
+      return NULL;
+
+   struct tc_constant_buffer *p = (struct tc_constant_buffer *)&call->payload;
+
+   if (p->info.shader != shader || p->info.index != index ||
+       !tc_resize_last_call(tc, tc_payload_size_to_call_slots(size)))
+      return NULL;
+
+   if (!p->info.is_null)
+      pipe_resource_reference(&p->cb.buffer, NULL);
+
+   tc->batch_slots[tc->next].num_coalesced_calls++;
+   return p;
+}
+
 static void
 tc_set_constant_buffer(struct pipe_context *_pipe,
                        enum pipe_shader_type shader, uint index,
@@ -798,8 +844,11 @@ tc_set_constant_buffer(struct pipe_context *_pipe,
 
    if (unlikely(!cb || (!cb->buffer && !cb->user_buffer))) {
       struct tc_constant_buffer_info *p =
-         tc_add_struct_typed_call(tc, TC_CALL_set_constant_buffer,
-                                  tc_constant_buffer_info);
+         tc_replace_last_constant_buffer(tc, shader, index, sizeof(*p));
+      if (!p) {
+         p = tc_add_struct_typed_call(tc, TC_CALL_set_constant_buffer,
+                                      tc_constant_buffer_info);
+      }
       p->shader = shader;
       p->index = index;
       p->is_null = true;
@@ -825,8 +874,11 @@ tc_set_constant_buffer(struct pipe_context *_pipe,
    }
 
    struct tc_constant_buffer *p =
-      tc_add_struct_typed_call(tc, TC_CALL_set_constant_buffer,
-                               tc_constant_buffer);
+      tc_replace_last_constant_buffer(tc, shader, index, sizeof(*p));
+   if (!p) {
+      p = tc_add_struct_typed_call(tc, TC_CALL_set_constant_buffer,
+                                   tc_constant_buffer);
+   }
    p->info.shader = shader;
    p->info.index = index;
    p->info.is_null = false;
@@ -2389,6 +2441,61 @@ tc_call_draw_multi(struct pipe_context *pipe, union tc_payload *payload)
 #define DRAW_INFO_SIZE_WITHOUT_INDEXBUF_AND_MIN_MAX_INDEX \
    offsetof(struct pipe_draw_info, index)
 
+/* Append a single draw to the last call if it's a draw with the same
+ * parameters, turning it into a multi draw. Return false if the draw
+ * can't be merged.
+ */
+static bool
+tc_merge_draw(struct threaded_context *tc, const struct pipe_draw_info *info,
+              struct pipe_resource *index_buffer, unsigned start,
+              unsigned count)
+{
+   struct tc_call *call = tc->last_call;
+
+   if (!call || info->drawid || info->increment_draw_id ||
+       (call->call_id != TC_CALL_draw_single &&
+        call->call_id != TC_CALL_draw_multi))
+      return false;
+
+   /* Both draw calls start with pipe_draw_info. */
+   struct pipe_draw_info *last = (struct pipe_draw_info*)&call->payload;
+   struct pipe_draw_info tmp;
+
+   if (last->increment_draw_id)
+      return false;
+
+   memcpy(&tmp, info, DRAW_INFO_SIZE_WITHOUT_INDEXBUF_AND_MIN_MAX_INDEX);
+   tmp.index.resource = index_buffer;
+   simplify_draw_info(&tmp);
+   simplify_draw_info(last);
+
+   /* All fields must be the same except start and count. */
+   if (memcmp(last, &tmp, DRAW_INFO_SIZE_WITHOUT_MIN_MAX_INDEX) != 0)
+      return false;
+
+   struct tc_draw_multi *multi = (struct tc_draw_multi*)&call->payload;
+   unsigned num_draws =
+      call->call_id == TC_CALL_draw_single ? 2 : multi->num_draws + 1;
+
+   if (!tc_resize_last_call(tc, tc_payload_size_to_call_slots(
+                                   sizeof(struct tc_draw_multi) +
+                                   sizeof(multi->slot[0]) * num_draws)))
+      return false;
+
+   if (call->call_id == TC_CALL_draw_single) {
+      /* u_threaded_context stores start/count in min/max_index for single draws. */
+      multi->slot[0].start = last->min_index;
+      multi->slot[0].count = last->max_index;
+      call->call_id = TC_CALL_draw_multi;
+   }
+   multi->slot[num_draws - 1].start = start;
+   multi->slot[num_draws - 1].count = count;
+   multi->num_draws = num_draws;
+
+   tc->batch_slots[tc->next].num_merged_draws++;
+   return true;
+}
+
 void
 tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info,
             const struct pipe_draw_indirect_info *indirect,
@@ -2445,6 +2552,12 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info,
          if (unlikely(!buffer))
             return;
 
+         if (tc_merge_draw(tc, info, buffer, offset >> util_logbase2(index_size),
+                           draws[0].count)) {
+            pipe_resource_reference(&buffer, NULL);
+            return;
+         }
+
          struct tc_draw_single *p =
             tc_add_struct_typed_call(tc, TC_CALL_draw_single, tc_draw_single);
          memcpy(&p->info, info, DRAW_INFO_SIZE_WITHOUT_INDEXBUF_AND_MIN_MAX_INDEX);
@@ -2454,6 +2567,15 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info,
          p->info.max_index = draws[0].count;
       } else {
          /* Non-indexed call or indexed with a real index buffer. */
+         if (tc_merge_draw(tc, info, info->index.resource, draws[0].start,
+                           draws[0].count)) {
+            if (index_size && info->take_index_buffer_ownership) {
+               struct pipe_resource *buffer = info->index.resource;
+               pipe_resource_reference(&buffer, NULL);
+            }
+            return;
+         }
+
          struct tc_draw_single *p =
             tc_add_struct_typed_call(tc, TC_CALL_draw_single, tc_draw_single);
          if (index_size && !info->take_index_buffer_ownership) {
@@ -330,6 +330,21 @@ struct ALIGN16 tc_call {
    union tc_payload payload;
 };
 
+/* CSO types whose bind calls are tracked for dropping redundant binds. */
+enum tc_cso_type {
+   TC_CSO_blend,
+   TC_CSO_rasterizer,
+   TC_CSO_depth_stencil_alpha,
+   TC_CSO_compute,
+   TC_CSO_fs,
+   TC_CSO_vs,
+   TC_CSO_gs,
+   TC_CSO_tcs,
+   TC_CSO_tes,
+   TC_CSO_vertex_elements,
+   TC_NUM_CSO_TYPES,
+};
+
 /**
  * A token representing an unflushed batch.
  *
@@ -344,6 +359,10 @@ struct tc_batch {
    struct pipe_context *pipe;
    unsigned sentinel;
    unsigned num_total_call_slots;
+   /* Calls that were coalesced into earlier calls of this batch instead of
+    * being added. Added to the threaded_context counters at flush time. */
+   unsigned num_coalesced_calls;
+   unsigned num_merged_draws;
    struct tc_unflushed_batch_token *token;
    struct util_queue_fence fence;
    struct tc_call call[TC_CALLS_PER_BATCH];
@@ -364,9 +383,20 @@ struct threaded_context {
    unsigned num_offloaded_slots;
    unsigned num_direct_slots;
    unsigned num_syncs;
+   unsigned num_coalesced_calls;
+   unsigned num_merged_draws;
 
    bool use_forced_staging_uploads;
 
+   /* The last call added to the current batch, or NULL if the batch is empty.
+    * Set state calls and draws can be coalesced into it.
+    */
+   struct tc_call *last_call;
+
+   /* CSOs bound by the last bind calls. Only valid for bits set in the mask. */
+   void *bound_cso[TC_NUM_CSO_TYPES];
+   unsigned bound_cso_mask;
+
    /* Estimation of how much vram/gtt bytes are mmap'd in
     * the current tc_batch.
     */
@@ -73,6 +73,29 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload);
 void
 u_upload_disable_persistent(struct u_upload_mgr *upload);
 
+/**
+ * Keep up to num_buffers full upload buffers mapped and reuse them once
+ * the GPU is done with them, instead of allocating a new buffer each time
+ * the current one is full.
+ *
+ * A buffer's fence is taken with pipe_context::flush(PIPE_FLUSH_DEFERRED)
+ * once nothing else references it, when it's retired or while looking for
+ * a buffer to reuse, so only enable this if the driver allows that from
+ * wherever it uploads.  Does nothing without persistent mappings.
+ */
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers);
+
+/** Counters of an upload manager, since its creation. */
+struct u_upload_stats {
+   uint64_t bytes;             /**< Bytes suballocated. */
+   uint64_t buffers_allocated; /**< Upload buffers created. */
+   uint64_t buffers_reused;    /**< Full buffers reused in ring mode. */
+};
+
+void
+u_upload_get_stats(struct u_upload_mgr *upload, struct u_upload_stats *stats);
+
 /**
  * Destroy the upload manager.
  */
@@ -45,6 +45,8 @@
  * All needed uploads and translations are performed every draw command, but
  * only the subset of vertices needed for that draw command is uploaded or
  * translated. (the module never translates whole buffers)
+ * The exception is vertices translated from real buffers whose contents
+ * don't change between draws, which are kept, see u_vbuf_translation.
  *
  *
  * The module consists of two main parts:
@@ -98,6 +100,9 @@
 #include "cso_cache/cso_cache.h"
 #include "cso_cache/cso_hash.h"
 
+#define XXH_INLINE_ALL
+#include "util/xxhash.h"
+
 struct u_vbuf_elements {
    unsigned count;
    struct pipe_vertex_element ve[PIPE_MAX_ATTRIBS];
@@ -137,6 +142,41 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+#define U_VBUF_NUM_TRANSLATIONS 16
+/* Smaller translations aren't worth hashing the source vertices for. */
+#define U_VBUF_TRANSLATION_MIN_VERTICES 64
+/* Stop caching buffers whose contents changed this many draws in a row. */
+#define U_VBUF_TRANSLATION_MAX_MISSES 8
+
+/* Vertices translated by an earlier draw.
+ *
+ * Nothing tells u_vbuf when a buffer is written: it may be mapped, written
+ * by the GPU or by another context sharing it.  So instead of a version,
+ * the source vertices are hashed every draw, and the translation is reused
+ * while the hash doesn't change.  The output is only kept once the same
+ * contents were seen twice, so that streaming buffers keep going through
+ * the uploader.
+ */
+struct u_vbuf_translation {
+   /* What was translated.  The source buffers are only compared, not
+    * referenced: a new buffer at the same address still needs the same hash.
+    */
+   struct translate_key key;
+   uint32_t vb_mask;
+   const struct pipe_resource *src[PIPE_MAX_ATTRIBS];
+   unsigned src_offset[PIPE_MAX_ATTRIBS];
+   unsigned src_stride[PIPE_MAX_ATTRIBS];
+   int start;
+   unsigned count;
+
+   uint64_t hash;    /* Of the source vertices. */
+   unsigned misses;  /* Number of draws in a row with different contents. */
+   uint64_t last_used;
+
+   /* The translated vertices, starting with vertex "start", or NULL. */
+   struct pipe_resource *out;
+};
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -184,6 +224,10 @@ struct u_vbuf {
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffers are allowed (supported by hardware). */
    uint32_t allowed_vb_mask;
+
+   /* Translations of real buffers, reused by later draws. */
+   struct u_vbuf_translation translations[U_VBUF_NUM_TRANSLATIONS];
+   uint64_t translation_stamp;
 };
 
 static void *
@@ -398,11 +442,80 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    for (i = 0; i < PIPE_MAX_ATTRIBS; i++)
       pipe_vertex_buffer_unreference(&mgr->real_vertex_buffer[i]);
 
+   for (i = 0; i < U_VBUF_NUM_TRANSLATIONS; i++)
+      pipe_resource_reference(&mgr->translations[i].out, NULL);
+
    translate_cache_destroy(mgr->translate_cache);
    cso_cache_delete(&mgr->cso_cache);
    FREE(mgr);
 }
 
+static bool
+u_vbuf_translation_matches(const struct u_vbuf *mgr,
+                           const struct u_vbuf_translation *t,
+                           const struct translate_key *key, uint32_t vb_mask,
+                           int start, unsigned count)
+{
+   if (t->vb_mask != vb_mask || t->start != start || t->count != count ||
+       translate_key_compare(&t->key, key))
+      return false;
+
+   while (vb_mask) {
+      unsigned i = u_bit_scan(&vb_mask);
+      const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+      if (t->src[i] != vb->buffer.resource ||
+          t->src_offset[i] != vb->buffer_offset ||
+          t->src_stride[i] != vb->stride)
+         return false;
+   }
+   return true;
+}
+
+/* Return the translation of these vertices, or start tracking them in the
+ * least recently used slot.
+ */
+static struct u_vbuf_translation *
+u_vbuf_get_translation(struct u_vbuf *mgr, const struct translate_key *key,
+                       uint32_t vb_mask, int start, unsigned count)
+{
+   struct u_vbuf_translation *t, *lru = &mgr->translations[0];
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_NUM_TRANSLATIONS; i++) {
+      t = &mgr->translations[i];
+
+      if (t->vb_mask && u_vbuf_translation_matches(mgr, t, key, vb_mask,
+                                                   start, count)) {
+         t->last_used = ++mgr->translation_stamp;
+         return t;
+      }
+      if (t->last_used < lru->last_used)
+         lru = t;
+   }
+
+   t = lru;
+   pipe_resource_reference(&t->out, NULL);
+   memcpy(&t->key, key, translate_keysize(key));
+   t->vb_mask = vb_mask;
+   t->start = start;
+   t->count = count;
+   t->hash = 0;
+   t->misses = 0;
+   t->last_used = ++mgr->translation_stamp;
+
+   while (vb_mask) {
+      const struct pipe_vertex_buffer *vb;
+
+      i = u_bit_scan(&vb_mask);
+      vb = &mgr->vertex_buffer[i];
+      t->src[i] = vb->buffer.resource;
+      t->src_offset[i] = vb->buffer_offset;
+      t->src_stride[i] = vb->stride;
+   }
+   return t;
+}
+
 static enum pipe_error
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          const struct pipe_draw_info *info,
@@ -413,9 +526,16 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 {
    struct translate *tr;
    struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   const uint8_t *src_map[PIPE_MAX_ATTRIBS];
+   unsigned src_size[PIPE_MAX_ATTRIBS];
    struct pipe_resource *out_buffer = NULL;
+   struct u_vbuf_translation *cached = NULL;
    uint8_t *out_map;
    unsigned out_offset, mask;
+   /* Only real buffers can be cached, and only in-place translations. */
+   bool cacheable = !unroll_indices &&
+                    !(vb_mask & mgr->user_vb_mask) &&
+                    (mgr->has_signed_vb_offset || start_vertex == 0);
 
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
@@ -437,8 +557,10 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
          unsigned size = vb->stride ? num_vertices * vb->stride
                                     : sizeof(double)*4;
 
-         if (!vb->buffer.resource)
+         if (!vb->buffer.resource) {
+            cacheable = false;
             continue;
+         }
 
          if (offset + size > vb->buffer.resource->width0) {
             /* Don't try to map past end of buffer.  This often happens when
@@ -460,6 +582,8 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 
          map = pipe_buffer_map_range(mgr->pipe, vb->buffer.resource, offset, size,
                                      PIPE_MAP_READ, &vb_transfer[i]);
+         src_map[i] = map;
+         src_size[i] = size;
       }
 
       /* Subtract min_index so that indexing with the index buffer works. */
@@ -470,8 +594,56 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       tr->set_buffer(tr, i, map, vb->stride, info->max_index);
    }
 
+   /* Reuse the translation of an earlier draw if the vertices are the same,
+    * or keep this one if they were the same as in the last draw.
+    */
+   if (cacheable && num_vertices >= U_VBUF_TRANSLATION_MIN_VERTICES)
+      cached = u_vbuf_get_translation(mgr, key, vb_mask, start_vertex,
+                                      num_vertices);
+
+   if (cached && cached->misses < U_VBUF_TRANSLATION_MAX_MISSES) {
+      uint64_t hash = 0;
+
+      mask = vb_mask;
+      while (mask) {
+         unsigned i = u_bit_scan(&mask);
+         hash = XXH64(src_map[i], src_size[i], hash);
+      }
+
+      if (cached->hash != hash) {
+         pipe_resource_reference(&cached->out, NULL);
+         cached->hash = hash;
+         cached->misses++;
+      } else if (!cached->out) {
+         struct pipe_transfer *transfer;
+
+         cached->misses = 0;
+         cached->out = pipe_buffer_create(mgr->pipe->screen,
+                                          PIPE_BIND_VERTEX_BUFFER,
+                                          PIPE_USAGE_DEFAULT,
+                                          key->output_stride * num_vertices);
+         out_map = cached->out ?
+            pipe_buffer_map(mgr->pipe, cached->out,
+                            PIPE_MAP_WRITE | PIPE_MAP_DISCARD_WHOLE_RESOURCE,
+                            &transfer) : NULL;
+         if (out_map) {
+            tr->run(tr, 0, num_vertices, 0, 0, out_map);
+            pipe_buffer_unmap(mgr->pipe, transfer);
+         } else {
+            pipe_resource_reference(&cached->out, NULL);
+         }
+      }
+
+      if (cached->out) {
+         pipe_resource_reference(&out_buffer, cached->out);
+         out_offset = -(int)(key->output_stride * start_vertex);
+      }
+   }
+
    /* Translate. */
-   if (unroll_indices) {
+   if (out_buffer) {
+      /* Already done. */
+   } else if (unroll_indices) {
       struct pipe_transfer *transfer = NULL;
       const unsigned offset = draw->start * info->index_size;
       uint8_t *map;
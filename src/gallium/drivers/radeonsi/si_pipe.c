@@ -528,6 +528,13 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen, unsign
          goto fail;
    }
 
+   /* Reuse full upload buffers once they are idle instead of allocating new ones.
+    * Deferred flushes don't submit anything, so they are fine in the middle of draws.
+    */
+   u_upload_enable_ring(sctx->b.stream_uploader, 4);
+   if (sctx->b.const_uploader != sctx->b.stream_uploader)
+      u_upload_enable_ring(sctx->b.const_uploader, 4);
+
    /* Border colors. */
    sctx->border_color_table = malloc(SI_MAX_BORDER_COLORS * sizeof(*sctx->border_color_table));
    if (!sctx->border_color_table)
@@ -116,6 +116,42 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
    }
 }
 
+/* Sum a counter over the uploaders of the context and of the threaded context.
+ * The latter are read without locking, like the other tc counters.
+ */
+static uint64_t si_upload_stat(struct si_context *sctx, unsigned type)
+{
+   struct u_upload_mgr *uploaders[] = {
+      sctx->b.stream_uploader,
+      sctx->b.const_uploader != sctx->b.stream_uploader ? sctx->b.const_uploader : NULL,
+      sctx->tc ? sctx->tc->base.stream_uploader : NULL,
+      sctx->tc && sctx->tc->base.const_uploader != sctx->tc->base.stream_uploader ?
+         sctx->tc->base.const_uploader : NULL,
+   };
+   uint64_t sum = 0;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(uploaders); i++) {
+      struct u_upload_stats stats;
+
+      if (!uploaders[i])
+         continue;
+
+      u_upload_get_stats(uploaders[i], &stats);
+      switch (type) {
+      case SI_QUERY_UPLOAD_BYTES:
+         sum += stats.bytes;
+         break;
+      case SI_QUERY_UPLOAD_BUFFER_ALLOCS:
+         sum += stats.buffers_allocated;
+         break;
+      case SI_QUERY_UPLOAD_BUFFER_REUSES:
+         sum += stats.buffers_reused;
+         break;
+      }
+   }
+   return sum;
+}
+
 static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
 {
    struct si_query_sw *query = (struct si_query_sw *)squery;
@@ -173,6 +209,17 @@ static bool si_query_sw_begin(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_TC_NUM_SYNCS:
       query->begin_result = sctx->tc ? sctx->tc->num_syncs : 0;
       break;
+   case SI_QUERY_TC_COALESCED_CALLS:
+      query->begin_result = sctx->tc ? sctx->tc->num_coalesced_calls : 0;
+      break;
+   case SI_QUERY_TC_MERGED_DRAWS:
+      query->begin_result = sctx->tc ? sctx->tc->num_merged_draws : 0;
+      break;
+   case SI_QUERY_UPLOAD_BYTES:
+   case SI_QUERY_UPLOAD_BUFFER_ALLOCS:
+   case SI_QUERY_UPLOAD_BUFFER_REUSES:
+      query->begin_result = si_upload_stat(sctx, query->b.type);
+      break;
    case SI_QUERY_REQUESTED_VRAM:
    case SI_QUERY_REQUESTED_GTT:
    case SI_QUERY_MAPPED_VRAM:
@@ -341,6 +388,17 @@ static bool si_query_sw_end(struct si_context *sctx, struct si_query *squery)
    case SI_QUERY_TC_NUM_SYNCS:
       query->end_result = sctx->tc ? sctx->tc->num_syncs : 0;
       break;
+   case SI_QUERY_TC_COALESCED_CALLS:
+      query->end_result = sctx->tc ? sctx->tc->num_coalesced_calls : 0;
+      break;
+   case SI_QUERY_TC_MERGED_DRAWS:
+      query->end_result = sctx->tc ? sctx->tc->num_merged_draws : 0;
+      break;
+   case SI_QUERY_UPLOAD_BYTES:
+   case SI_QUERY_UPLOAD_BUFFER_ALLOCS:
+   case SI_QUERY_UPLOAD_BUFFER_REUSES:
+      query->end_result = si_upload_stat(sctx, query->b.type);
+      break;
    case SI_QUERY_REQUESTED_VRAM:
    case SI_QUERY_REQUESTED_GTT:
    case SI_QUERY_MAPPED_VRAM:
@@ -1693,6 +1751,11 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
    X("tc-offloaded-slots", TC_OFFLOADED_SLOTS, UINT64, AVERAGE),
    X("tc-direct-slots", TC_DIRECT_SLOTS, UINT64, AVERAGE),
    X("tc-num-syncs", TC_NUM_SYNCS, UINT64, AVERAGE),
+   X("tc-coalesced-calls", TC_COALESCED_CALLS, UINT64, AVERAGE),
+   X("tc-merged-draws", TC_MERGED_DRAWS, UINT64, AVERAGE),
+   X("upload-bytes", UPLOAD_BYTES, BYTES, AVERAGE),
+   X("upload-buffer-allocs", UPLOAD_BUFFER_ALLOCS, UINT64, AVERAGE),
+   X("upload-buffer-reuses", UPLOAD_BUFFER_REUSES, UINT64, AVERAGE),
    X("CS-thread-busy", CS_THREAD_BUSY, UINT64, AVERAGE),
    X("gallium-thread-busy", GALLIUM_THREAD_BUSY, UINT64, AVERAGE),
    X("requested-VRAM", REQUESTED_VRAM, BYTES, AVERAGE),
@@ -58,6 +58,11 @@ enum
    SI_QUERY_TC_OFFLOADED_SLOTS,
    SI_QUERY_TC_DIRECT_SLOTS,
    SI_QUERY_TC_NUM_SYNCS,
+   SI_QUERY_TC_COALESCED_CALLS,
+   SI_QUERY_TC_MERGED_DRAWS,
+   SI_QUERY_UPLOAD_BYTES,
+   SI_QUERY_UPLOAD_BUFFER_ALLOCS,
+   SI_QUERY_UPLOAD_BUFFER_REUSES,
    SI_QUERY_CS_THREAD_BUSY,
    SI_QUERY_GALLIUM_THREAD_BUSY,
    SI_QUERY_REQUESTED_VRAM,
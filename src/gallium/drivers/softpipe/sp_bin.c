@@ -0,0 +1,628 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * Rasterizer threads.
+ *
+ * The framebuffer is split into the tiles of the tile caches, and each tile
+ * belongs to one of several threads, see sp_tile_owner().  Every thread has
+ * a quad pipeline of its own, with its own fragment shader machine, texture
+ * caches and framebuffer tile caches which only ever hold the thread's
+ * tiles.  Thread 0 is the context itself and uses the context's pipeline.
+ *
+ * While a draw is set up, the quads coming out of sp_setup.c are sorted
+ * into their tiles together with a copy of their primitive's interpolation
+ * coefficients.  At the end of the draw (see sp_setup_flush) each thread
+ * runs the quads of its tiles through its pipeline.  The quads of a tile
+ * are run in the order and the batches they were set up in, so the results
+ * are the same as without threads.
+ */
+
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "sp_bin.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of quads per batch, as emitted by sp_setup.c */
+#define SP_BIN_MAX_QUADS 16
+
+/** Run the scene once this many bytes have been binned */
+#define SP_BIN_MAX_SCENE_SIZE (8 * 1024 * 1024)
+
+/** Smaller scenes aren't worth waking up the threads for */
+#define SP_BIN_MIN_THREADED_BATCHES 32
+
+
+struct sp_bin_quad {
+   int16_t x0, y0;
+   unsigned mask;
+};
+
+/** A batch of quads of one primitive, as passed to quad_stage::run() */
+struct sp_bin_quads {
+   unsigned coefs;            /**< index of the primitive's coefficients */
+   unsigned layer;
+   uint16_t viewport_index;
+   uint8_t facing;
+   uint8_t nr;
+   struct sp_bin_quad quad[];
+};
+
+
+struct sp_bin_thread {
+   struct sp_bin_context *bin;
+   unsigned index;
+
+   /** Tiles owned by this thread with quads in the scene */
+   struct util_dynarray tiles;
+
+   /** The pipeline of threads other than 0 */
+   struct sp_quad_pipeline quad;
+   const struct sp_fragment_shader_variant *fs_variant;
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   struct util_queue_fence fence;
+
+   struct quad_header quads[SP_BIN_MAX_QUADS];
+   struct quad_header *quad_ptrs[SP_BIN_MAX_QUADS];
+};
+
+
+struct sp_bin_context {
+   struct softpipe_context *softpipe;
+   unsigned num_threads;
+   struct sp_bin_thread *threads[SP_MAX_THREADS];
+   struct util_queue queue;
+
+   /** Batches of quads per tile, for tiles_x * tiles_y tiles */
+   struct util_dynarray *tiles;
+   unsigned tiles_x, tiles_y, max_tiles;
+
+   /** posCoef followed by num_coefs coefficients for each primitive */
+   struct util_dynarray coefs;
+   unsigned num_coefs;
+   int prim_coefs;            /**< index of the current primitive's, or -1 */
+
+   unsigned num_batches;
+   size_t size;
+
+   /** Whether the scene may run on several threads at once */
+   boolean threaded;
+};
+
+
+/**
+ * Run the quads of the thread's tiles through its pipeline.
+ */
+static void
+rasterize_tiles(struct sp_bin_thread *thread)
+{
+   struct sp_bin_context *bin = thread->bin;
+   struct sp_quad_pipeline *qp = bin->softpipe->thread_quad[thread->index];
+   const struct tgsi_interp_coef *coefs = util_dynarray_begin(&bin->coefs);
+
+   util_dynarray_foreach(&thread->tiles, unsigned, index) {
+      const struct util_dynarray *tile = &bin->tiles[*index];
+      const uint8_t *p = tile->data;
+      const uint8_t *end = p + tile->size;
+
+      while (p < end) {
+         const struct sp_bin_quads *batch = (const struct sp_bin_quads *)p;
+         unsigned i;
+
+         for (i = 0; i < batch->nr; i++) {
+            struct quad_header *quad = &thread->quads[i];
+
+            quad->input.x0 = batch->quad[i].x0;
+            quad->input.y0 = batch->quad[i].y0;
+            quad->input.layer = batch->layer;
+            quad->input.viewport_index = batch->viewport_index;
+            quad->input.facing = batch->facing;
+            quad->inout.mask = batch->quad[i].mask;
+            quad->posCoef = &coefs[batch->coefs];
+            quad->coef = &coefs[batch->coefs + 1];
+            thread->quad_ptrs[i] = quad;
+         }
+
+         qp->first->run(qp->first, thread->quad_ptrs, batch->nr);
+
+         p += sizeof(*batch) + batch->nr * sizeof(batch->quad[0]);
+      }
+   }
+}
+
+
+static void
+rasterize_job(void *job, int thread_index)
+{
+   rasterize_tiles((struct sp_bin_thread *)job);
+}
+
+
+boolean
+sp_bin_create(struct softpipe_context *sp, unsigned num_threads)
+{
+   struct sp_bin_context *bin;
+   unsigned t, i;
+
+   sp->thread_quad[0] = &sp->quad;
+   sp->num_threads = 1;
+
+   if (num_threads <= 1)
+      return TRUE;
+
+   bin = CALLOC_STRUCT(sp_bin_context);
+   if (!bin)
+      return FALSE;
+
+   sp->bin = bin;
+   bin->softpipe = sp;
+   bin->num_threads = num_threads;
+   bin->prim_coefs = -1;
+   util_dynarray_init(&bin->coefs, NULL);
+
+   /* The context's thread rasterizes too, so it needs one thread less. */
+   if (!util_queue_init(&bin->queue, "sprast", num_threads, num_threads - 1,
+                        0))
+      return FALSE;
+
+   for (t = 0; t < num_threads; t++) {
+      struct sp_bin_thread *thread = CALLOC_STRUCT(sp_bin_thread);
+      struct sp_quad_pipeline *qp;
+
+      if (!thread)
+         return FALSE;
+
+      bin->threads[t] = thread;
+      thread->bin = bin;
+      thread->index = t;
+      util_dynarray_init(&thread->tiles, NULL);
+      util_queue_fence_init(&thread->fence);
+
+      if (t == 0)
+         continue;
+
+      qp = &thread->quad;
+      if (!sp_init_quad_pipeline(sp, qp))
+         return FALSE;
+
+      qp->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+      qp->fs_sampler = sp_create_tgsi_sampler();
+      if (!qp->fs_machine || !qp->fs_sampler)
+         return FALSE;
+
+      for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+         qp->cbuf_cache[i] = sp_create_tile_cache(&sp->pipe);
+         if (!qp->cbuf_cache[i])
+            return FALSE;
+      }
+      qp->zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+      if (!qp->zsbuf_cache)
+         return FALSE;
+
+      qp->occlusion_count = &thread->occlusion_count;
+      qp->ps_invocations = &thread->ps_invocations;
+
+      sp->thread_quad[t] = qp;
+   }
+
+   for (t = 0; t < num_threads; t++) {
+      struct sp_quad_pipeline *qp = sp->thread_quad[t];
+
+      for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+         sp_tile_cache_set_owner(qp->cbuf_cache[i], t, num_threads);
+      sp_tile_cache_set_owner(qp->zsbuf_cache, t, num_threads);
+   }
+
+   sp->num_threads = num_threads;
+   return TRUE;
+}
+
+
+void
+sp_bin_destroy(struct softpipe_context *sp)
+{
+   struct sp_bin_context *bin = sp->bin;
+   unsigned t, i;
+
+   if (!bin)
+      return;
+
+   if (util_queue_is_initialized(&bin->queue))
+      util_queue_destroy(&bin->queue);
+
+   for (t = 0; t < ARRAY_SIZE(bin->threads); t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+      struct sp_quad_pipeline *qp;
+
+      if (!thread)
+         continue;
+
+      qp = &thread->quad;
+      sp_destroy_quad_pipeline(qp);
+      tgsi_exec_machine_destroy(qp->fs_machine);
+      FREE(qp->fs_sampler);
+      for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+         /* Unbinding sampler views doesn't reach the caches of the threads,
+          * so they may still hold a texture.
+          */
+         if (qp->fs_tex_cache[i])
+            sp_tex_tile_cache_set_sampler_view(qp->fs_tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(qp->fs_tex_cache[i]);
+      }
+      for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+         sp_destroy_tile_cache(qp->cbuf_cache[i]);
+      sp_destroy_tile_cache(qp->zsbuf_cache);
+
+      util_queue_fence_destroy(&thread->fence);
+      util_dynarray_fini(&thread->tiles);
+      FREE(thread);
+   }
+
+   for (i = 0; i < bin->max_tiles; i++)
+      util_dynarray_fini(&bin->tiles[i]);
+   FREE(bin->tiles);
+   util_dynarray_fini(&bin->coefs);
+
+   FREE(bin);
+   sp->bin = NULL;
+   sp->num_threads = 1;
+}
+
+
+/**
+ * Make the tile grid cover the framebuffer.
+ */
+static boolean
+resize_tiles(struct sp_bin_context *bin, unsigned width, unsigned height)
+{
+   const unsigned tiles_x = DIV_ROUND_UP(width, TILE_SIZE);
+   const unsigned tiles_y = DIV_ROUND_UP(height, TILE_SIZE);
+   unsigned i;
+
+   if (tiles_x * tiles_y > bin->max_tiles) {
+      struct util_dynarray *tiles =
+         CALLOC(tiles_x * tiles_y, sizeof(struct util_dynarray));
+
+      if (!tiles)
+         return FALSE;
+
+      for (i = 0; i < bin->max_tiles; i++)
+         util_dynarray_fini(&bin->tiles[i]);
+      FREE(bin->tiles);
+
+      bin->tiles = tiles;
+      bin->max_tiles = tiles_x * tiles_y;
+      for (i = 0; i < bin->max_tiles; i++)
+         util_dynarray_init(&bin->tiles[i], NULL);
+   }
+
+   bin->tiles_x = tiles_x;
+   bin->tiles_y = tiles_y;
+   return TRUE;
+}
+
+
+/**
+ * Give the thread the fragment samplers and sampler views of the context,
+ * sampling through texture caches of its own.
+ * \return FALSE if a texture cache couldn't be allocated, in which case
+ * the thread shares the context's
+ */
+static boolean
+update_fs_sampler(struct softpipe_context *sp, struct sp_quad_pipeline *qp)
+{
+   const struct sp_tgsi_sampler *src = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   struct sp_tgsi_sampler *dst = qp->fs_sampler;
+   boolean ret = TRUE;
+   unsigned i;
+
+   memcpy(dst->sp_sampler, src->sp_sampler, sizeof(dst->sp_sampler));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = qp->fs_tex_cache[i];
+
+      dst->sp_sview[i] = src->sp_sview[i];
+      if (!view)
+         continue;
+
+      if (!tc) {
+         tc = qp->fs_tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!tc) {
+            ret = FALSE;
+            continue;
+         }
+      }
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+      dst->sp_sview[i].cache = tc;
+   }
+
+   return ret;
+}
+
+
+/**
+ * Called by setup before rasterizing the primitives of a draw.
+ * \return TRUE if setup should pass its quads to sp_bin_quads() rather
+ * than to the context's quad pipeline
+ */
+boolean
+sp_bin_begin(struct softpipe_context *sp)
+{
+   struct sp_bin_context *bin = sp->bin;
+   const struct tgsi_shader_info *info = &sp->fs_variant->info;
+   unsigned t;
+
+   if (!bin)
+      return FALSE;
+
+   assert(!bin->num_batches);
+
+   if (!resize_tiles(bin, sp->framebuffer.width, sp->framebuffer.height))
+      return FALSE;
+
+   bin->num_coefs = info->num_inputs;
+   bin->prim_coefs = -1;
+
+   /* Stores and atomics would race between the threads, so their tiles are
+    * rasterized one after the other.
+    */
+   bin->threaded = !info->writes_memory;
+
+   for (t = 1; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+      struct sp_quad_pipeline *qp = &thread->quad;
+
+      if (!update_fs_sampler(sp, qp))
+         bin->threaded = FALSE;
+
+      if (thread->fs_variant != sp->fs_variant) {
+         sp->fs_variant->prepare(sp->fs_variant, qp->fs_machine,
+                                 (struct tgsi_sampler *)qp->fs_sampler,
+                                 (struct tgsi_image *)
+                                 sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                                 (struct tgsi_buffer *)
+                                 sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+         thread->fs_variant = sp->fs_variant;
+      }
+
+      sp_build_quad_pipeline(sp, qp);
+      qp->first->begin(qp->first);
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Called by setup when it starts on a new primitive.
+ */
+void
+sp_bin_new_prim(struct softpipe_context *sp)
+{
+   sp->bin->prim_coefs = -1;
+}
+
+
+/**
+ * Add a batch of quads of the current primitive to the scene.  The quads
+ * are all in the same tile.
+ */
+void
+sp_bin_quads(struct softpipe_context *sp,
+             struct quad_header *quads[], unsigned nr)
+{
+   struct sp_bin_context *bin = sp->bin;
+   const unsigned tx = quads[0]->input.x0 >> TILE_SIZE_LOG2;
+   const unsigned ty = quads[0]->input.y0 >> TILE_SIZE_LOG2;
+   const unsigned index = ty * bin->tiles_x + tx;
+   const unsigned size = sizeof(struct sp_bin_quads) +
+                         nr * sizeof(struct sp_bin_quad);
+   struct util_dynarray *tile = &bin->tiles[index];
+   struct sp_bin_quads *batch;
+   unsigned i;
+
+   assert(nr <= SP_BIN_MAX_QUADS);
+   assert(tx < bin->tiles_x && ty < bin->tiles_y);
+
+   if (bin->prim_coefs < 0) {
+      struct tgsi_interp_coef *coefs =
+         util_dynarray_grow(&bin->coefs, struct tgsi_interp_coef,
+                            1 + bin->num_coefs);
+      if (!coefs)
+         goto rasterize_now;
+
+      coefs[0] = *quads[0]->posCoef;
+      memcpy(&coefs[1], quads[0]->coef, bin->num_coefs * sizeof(coefs[0]));
+      bin->prim_coefs =
+         coefs - (struct tgsi_interp_coef *)util_dynarray_begin(&bin->coefs);
+      bin->size += (1 + bin->num_coefs) * sizeof(coefs[0]);
+   }
+
+   if (!tile->size) {
+      const unsigned owner = sp_tile_owner(tx, ty, bin->num_threads);
+      util_dynarray_append(&bin->threads[owner]->tiles, unsigned, index);
+   }
+
+   batch = util_dynarray_grow_bytes(tile, 1, size);
+   if (!batch)
+      goto rasterize_now;
+
+   batch->coefs = bin->prim_coefs;
+   batch->layer = quads[0]->input.layer;
+   batch->viewport_index = quads[0]->input.viewport_index;
+   batch->facing = quads[0]->input.facing;
+   batch->nr = nr;
+   for (i = 0; i < nr; i++) {
+      batch->quad[i].x0 = quads[i]->input.x0;
+      batch->quad[i].y0 = quads[i]->input.y0;
+      batch->quad[i].mask = quads[i]->inout.mask;
+   }
+
+   bin->num_batches++;
+   bin->size += size;
+   if (bin->size >= SP_BIN_MAX_SCENE_SIZE)
+      sp_bin_flush(sp);
+   return;
+
+rasterize_now:
+   /* Out of memory: run what we have, then these quads directly. */
+   sp_bin_flush(sp);
+   {
+      struct sp_quad_pipeline *qp =
+         sp->thread_quad[sp_tile_owner(tx, ty, bin->num_threads)];
+      qp->first->run(qp->first, quads, nr);
+   }
+}
+
+
+/**
+ * Rasterize the scene and start a new one.
+ */
+void
+sp_bin_flush(struct softpipe_context *sp)
+{
+   struct sp_bin_context *bin = sp->bin;
+   const boolean threaded =
+      bin->threaded && bin->num_batches >= SP_BIN_MIN_THREADED_BATCHES;
+   unsigned t;
+
+   if (!bin->num_batches)
+      goto done;
+
+   for (t = 1; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      if (!thread->tiles.size)
+         continue;
+
+      if (threaded) {
+         util_queue_add_job(&bin->queue, thread, &thread->fence,
+                            rasterize_job, NULL, 0);
+      }
+      else {
+         rasterize_tiles(thread);
+      }
+   }
+
+   rasterize_tiles(bin->threads[0]);
+
+   for (t = 1; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      if (threaded && thread->tiles.size)
+         util_queue_fence_wait(&thread->fence);
+
+      *sp->quad.occlusion_count += thread->occlusion_count;
+      *sp->quad.ps_invocations += thread->ps_invocations;
+      thread->occlusion_count = 0;
+      thread->ps_invocations = 0;
+   }
+
+   for (t = 0; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      util_dynarray_foreach(&thread->tiles, unsigned, index)
+         util_dynarray_clear(&bin->tiles[*index]);
+      util_dynarray_clear(&thread->tiles);
+   }
+
+done:
+   util_dynarray_clear(&bin->coefs);
+   bin->prim_coefs = -1;
+   bin->num_batches = 0;
+   bin->size = 0;
+}
+
+
+/**
+ * Flush the fragment texture caches of the threads, like softpipe_flush()
+ * does for the context's.
+ */
+void
+sp_bin_flush_tex_caches(struct softpipe_context *sp)
+{
+   struct sp_bin_context *bin = sp->bin;
+   unsigned t, i;
+
+   if (!bin)
+      return;
+
+   for (t = 1; t < bin->num_threads; t++) {
+      struct sp_quad_pipeline *qp = &bin->threads[t]->quad;
+
+      for (i = 0; i < ARRAY_SIZE(qp->fs_tex_cache); i++) {
+         if (qp->fs_tex_cache[i])
+            sp_flush_tex_tile_cache(qp->fs_tex_cache[i]);
+      }
+   }
+}
+
+
+/**
+ * Called before a fragment shader variant is deleted.
+ */
+void
+sp_bin_release_fs_variant(struct softpipe_context *sp,
+                          const struct sp_fragment_shader_variant *var)
+{
+   struct sp_bin_context *bin = sp->bin;
+   unsigned t;
+
+   if (!bin)
+      return;
+
+   for (t = 1; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      if (thread->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(thread->quad.fs_machine,
+                                       NULL, NULL, NULL, NULL);
+         thread->fs_variant = NULL;
+      }
+   }
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SP_BIN_H
+#define SP_BIN_H
+
+#include "pipe/p_compiler.h"
+
+
+struct softpipe_context;
+struct sp_fragment_shader_variant;
+struct quad_header;
+
+
+boolean
+sp_bin_create(struct softpipe_context *sp, unsigned num_threads);
+
+void
+sp_bin_destroy(struct softpipe_context *sp);
+
+boolean
+sp_bin_begin(struct softpipe_context *sp);
+
+void
+sp_bin_new_prim(struct softpipe_context *sp);
+
+void
+sp_bin_quads(struct softpipe_context *sp,
+             struct quad_header *quads[], unsigned nr);
+
+void
+sp_bin_flush(struct softpipe_context *sp);
+
+void
+sp_bin_flush_tex_caches(struct softpipe_context *sp);
+
+void
+sp_bin_release_fs_variant(struct softpipe_context *sp,
+                          const struct sp_fragment_shader_variant *var);
+
+#endif /* SP_BIN_H */
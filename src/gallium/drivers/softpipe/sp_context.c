@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
 #include "sp_context.h"
@@ -75,17 +76,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
-   if (softpipe->quad.shade)
-      softpipe->quad.shade->destroy( softpipe->quad.shade );
+   sp_bin_destroy(softpipe);
 
-   if (softpipe->quad.depth_test)
-      softpipe->quad.depth_test->destroy( softpipe->quad.depth_test );
-
-   if (softpipe->quad.blend)
-      softpipe->quad.blend->destroy( softpipe->quad.blend );
-
-   if (softpipe->quad.pstipple)
-      softpipe->quad.pstipple->destroy( softpipe->quad.pstipple );
+   sp_destroy_quad_pipeline(&softpipe->quad);
 
    if (softpipe->pipe.stream_uploader)
       u_upload_destroy(softpipe->pipe.stream_uploader);
@@ -275,10 +268,24 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
 
    /* setup quad rendering stages */
-   softpipe->quad.shade = sp_quad_shade_stage(softpipe);
-   softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
-   softpipe->quad.blend = sp_quad_blend_stage(softpipe);
-   softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+   if (!sp_init_quad_pipeline(softpipe, &softpipe->quad))
+      goto fail;
+
+   softpipe->quad.fs_machine = softpipe->fs_machine;
+   softpipe->quad.fs_sampler = softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++)
+      softpipe->quad.fs_tex_cache[i] =
+         softpipe->tex_cache[PIPE_SHADER_FRAGMENT][i];
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      softpipe->quad.cbuf_cache[i] = softpipe->cbuf_cache[i];
+   softpipe->quad.zsbuf_cache = softpipe->zsbuf_cache;
+   softpipe->quad.occlusion_count = &softpipe->occlusion_count;
+   softpipe->quad.ps_invocations =
+      &softpipe->pipeline_statistics.ps_invocations;
+
+   /* and the rasterizer threads, if any */
+   if (!sp_bin_create(softpipe, sp_screen->num_threads))
+      goto fail;
 
    softpipe->pipe.stream_uploader = u_upload_create_default(&softpipe->pipe);
    if (!softpipe->pipe.stream_uploader)
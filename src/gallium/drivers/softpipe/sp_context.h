@@ -36,6 +36,7 @@
 
 #include "draw/draw_vertex.h"
 
+#include "sp_limits.h"
 #include "sp_quad_pipe.h"
 #include "sp_setup.h"
 
@@ -48,6 +49,7 @@
 
 
 struct softpipe_vbuf_render;
+struct sp_bin_context;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -161,13 +163,15 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct sp_quad_pipeline quad;
+
+   /**
+    * The quad pipelines of the rasterizer threads, see sp_bin.c.  The
+    * first one is the context's own.
+    */
+   struct sp_quad_pipeline *thread_quad[SP_MAX_THREADS];
+   unsigned num_threads;
+   struct sp_bin_context *bin;
 
    /** TGSI exec things */
    struct {
@@ -33,6 +33,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
+#include "sp_bin.h"
 #include "sp_flush.h"
 #include "sp_context.h"
 #include "sp_state.h"
@@ -49,7 +50,7 @@ softpipe_flush( struct pipe_context *pipe,
                 struct pipe_fence_handle **fence )
 {
    struct softpipe_context *softpipe = softpipe_context(pipe);
-   uint i;
+   uint i, t;
 
    draw_flush(softpipe->draw);
 
@@ -61,6 +62,7 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+      sp_bin_flush_tex_caches(softpipe);
    }
 
    /* If this is a swapbuffers, just flush color buffers.
@@ -68,12 +70,16 @@ softpipe_flush( struct pipe_context *pipe,
     * The zbuffer changes are not discarded, but held in the cache
     * in the hope that a later clear will wipe them out.
     */
-   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
-      if (softpipe->cbuf_cache[i])
-         sp_flush_tile_cache(softpipe->cbuf_cache[i]);
+   for (t = 0; t < softpipe->num_threads; t++) {
+      struct sp_quad_pipeline *qp = softpipe->thread_quad[t];
 
-   if (softpipe->zsbuf_cache)
-      sp_flush_tile_cache(softpipe->zsbuf_cache);
+      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+         if (qp->cbuf_cache[i])
+            sp_flush_tile_cache(qp->cbuf_cache[i]);
+
+      if (qp->zsbuf_cache)
+         sp_flush_tile_cache(qp->zsbuf_cache);
+   }
 
    softpipe->dirty_render_cache = FALSE;
 
@@ -172,20 +178,25 @@ softpipe_flush_resource(struct pipe_context *pipe,
 void softpipe_texture_barrier(struct pipe_context *pipe, unsigned flags)
 {
    struct softpipe_context *softpipe = softpipe_context(pipe);
-   uint i, sh;
+   uint i, sh, t;
 
    for (sh = 0; sh < ARRAY_SIZE(softpipe->tex_cache); sh++) {
       for (i = 0; i < softpipe->num_sampler_views[sh]; i++) {
          sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
       }
    }
+   sp_bin_flush_tex_caches(softpipe);
 
-   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
-      if (softpipe->cbuf_cache[i])
-         sp_flush_tile_cache(softpipe->cbuf_cache[i]);
+   for (t = 0; t < softpipe->num_threads; t++) {
+      struct sp_quad_pipeline *qp = softpipe->thread_quad[t];
 
-   if (softpipe->zsbuf_cache)
-      sp_flush_tile_cache(softpipe->zsbuf_cache);
+      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+         if (qp->cbuf_cache[i])
+            sp_flush_tile_cache(qp->cbuf_cache[i]);
+
+      if (qp->zsbuf_cache)
+         sp_flush_tile_cache(qp->zsbuf_cache);
+   }
 
    softpipe->dirty_render_cache = FALSE;
 }
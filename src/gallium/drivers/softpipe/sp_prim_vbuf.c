@@ -345,6 +345,8 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   sp_setup_flush(setup);
 }
 
 
@@ -585,6 +587,8 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   sp_setup_flush(setup);
 }
 
 /*
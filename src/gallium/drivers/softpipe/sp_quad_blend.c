@@ -916,6 +916,19 @@ rebase_colors(enum format base_format, float (*quadColor)[4])
    }
 }
 
+
+/**
+ * Round the colors of a quad just written to a tile to what the color
+ * buffer can store, see sp_tile_cache_quantize().
+ */
+static inline void
+quantize_quad(const struct softpipe_tile_cache *tc,
+              struct softpipe_cached_tile *tile, int itx, int ity)
+{
+   sp_tile_cache_quantize(tc, &tile->data.color[ity][itx], 2);
+   sp_tile_cache_quantize(tc, &tile->data.color[ity + 1][itx], 2);
+}
+
 static void
 blend_fallback(struct quad_stage *qs, 
                struct quad_header *quads[],
@@ -934,7 +947,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+            = sp_get_cached_tile(qs->pipeline->cbuf_cache[cbuf],
                                  quads[0]->input.x0, 
                                  quads[0]->input.y0, quads[0]->input.layer);
          const boolean clamp = bqs->clamp[cbuf];
@@ -1018,6 +1031,7 @@ blend_fallback(struct quad_stage *qs,
                   }
                }
             }
+            quantize_quad(qs->pipeline->cbuf_cache[cbuf], tile, itx, ity);
          }
       }
    }
@@ -1037,7 +1051,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1098,6 +1112,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
             }
          }
       }
+      quantize_quad(qs->pipeline->cbuf_cache[0], tile, itx, ity);
    }
 }
 
@@ -1111,7 +1126,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1160,6 +1175,7 @@ blend_single_add_one_one(struct quad_stage *qs,
             }
          }
       }
+      quantize_quad(qs->pipeline->cbuf_cache[0], tile, itx, ity);
    }
 }
 
@@ -1179,7 +1195,7 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1203,6 +1219,7 @@ single_output_color(struct quad_stage *qs,
             }
          }
       }
+      quantize_quad(qs->pipeline->cbuf_cache[0], tile, itx, ity);
    }
 }
 
@@ -31,9 +31,16 @@
 #ifndef SP_QUAD_PIPE_H
 #define SP_QUAD_PIPE_H
 
+#include "pipe/p_state.h"
+
 
 struct softpipe_context;
 struct quad_header;
+struct sp_quad_pipeline;
+struct sp_tgsi_sampler;
+struct softpipe_tile_cache;
+struct softpipe_tex_tile_cache;
+struct tgsi_exec_machine;
 
 
 /**
@@ -43,6 +50,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_quad_pipeline *pipeline; /**< the pipeline we're part of */
 
    struct quad_stage *next;
 
@@ -67,6 +75,34 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
-void sp_build_quad_pipeline(struct softpipe_context *sp);
+
+/**
+ * A set of quad stages and the things they render with.  The context owns
+ * one that uses the context's shader machine and caches; each additional
+ * rasterizer thread (see sp_bin.c) has one with copies of its own.
+ */
+struct sp_quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+
+   struct tgsi_exec_machine *fs_machine;
+   struct sp_tgsi_sampler *fs_sampler;
+   struct softpipe_tex_tile_cache *fs_tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   /** Where the occlusion query and ps_invocations counts go */
+   uint64_t *occlusion_count;
+   uint64_t *ps_invocations;
+};
+
+boolean sp_init_quad_pipeline(struct softpipe_context *sp,
+                              struct sp_quad_pipeline *qp);
+void sp_destroy_quad_pipeline(struct sp_quad_pipeline *qp);
+void sp_build_quad_pipeline(struct softpipe_context *sp,
+                            struct sp_quad_pipeline *qp);
 
 #endif /* SP_QUAD_PIPE_H */
@@ -30,6 +30,7 @@
 #include "util/u_memory.h"
 #include "util/format/u_format.h"
 #include "util/format/u_format_s3tc.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_screen.h"
 #include "util/u_video.h"
 #include "util/os_misc.h"
@@ -45,6 +46,7 @@
 #include "sp_screen.h"
 #include "sp_context.h"
 #include "sp_fence.h"
+#include "sp_limits.h"
 #include "sp_public.h"
 
 static const struct debug_named_value sp_debug_options[] = {
@@ -592,6 +594,11 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_compiler_options = softpipe_get_compiler_options;
    screen->use_llvm = sp_debug & SP_DBG_USE_LLVM;
 
+   util_cpu_detect();
+   screen->num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS",
+                                              util_cpu_caps.nr_cpus);
+   screen->num_threads = CLAMP(screen->num_threads, 1, SP_MAX_THREADS);
+
    softpipe_init_screen_texture_funcs(&screen->base);
    softpipe_init_screen_fence_funcs(&screen->base);
 
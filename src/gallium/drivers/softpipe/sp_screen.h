@@ -47,6 +47,9 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+
+   /** Number of threads rasterizing each draw, see sp_bin.c */
+   unsigned num_threads;
 };
 
 static inline struct softpipe_screen *
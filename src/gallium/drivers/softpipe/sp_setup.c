@@ -32,6 +32,7 @@
  * \author  Brian Paul
  */
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_quad.h"
@@ -94,6 +95,9 @@ struct setup_context {
    float pixel_offset;
    unsigned max_layer;
 
+   /** Pass the quads to the rasterizer threads? see sp_bin.c */
+   boolean binning;
+
    struct quad_header quad[MAX_QUADS];
    struct quad_header *quad_ptrs[MAX_QUADS];
    unsigned count;
@@ -154,6 +158,22 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
 }
 
 
+/**
+ * Pass quads to the quad pipeline, or bin them for the rasterizer threads.
+ */
+static inline void
+emit_quads(struct setup_context *setup, struct quad_header *quads[],
+           unsigned nr)
+{
+   struct softpipe_context *sp = setup->softpipe;
+
+   if (setup->binning)
+      sp_bin_quads(sp, quads, nr);
+   else
+      sp->quad.first->run( sp->quad.first, quads, nr );
+}
+
+
 /**
  * Emit a quad (pass to next stage) with clipping.
  */
@@ -163,13 +183,11 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip(setup, quad);
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
-
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      emit_quads(setup, &quad, 1);
    }
 }
 
@@ -204,7 +222,6 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -249,7 +266,7 @@ flush_spans(struct setup_context *setup)
             lx += 2;
          } while (mask0 | mask1);
 
-         pipe->run( pipe, setup->quad_ptrs, q );
+         emit_quads(setup, setup->quad_ptrs, q);
       }
    }
 
@@ -828,6 +845,8 @@ sp_setup_tri(struct setup_context *setup,
 
    setup_tri_coefficients( setup );
    setup_tri_edges( setup );
+   if (setup->binning)
+      sp_bin_new_prim(setup->softpipe);
 
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_TRIANGLES);
 
@@ -1105,6 +1124,9 @@ sp_setup_line(struct setup_context *setup,
    if (!setup_line_coefficients(setup, v0, v1))
       return;
 
+   if (setup->binning)
+      sp_bin_new_prim(setup->softpipe);
+
    assert(v0[0][0] < 1.0e9);
    assert(v0[0][1] < 1.0e9);
    assert(v1[0][0] < 1.0e9);
@@ -1314,6 +1336,9 @@ sp_setup_point(struct setup_context *setup,
       }
    }
 
+   if (setup->binning)
+      sp_bin_new_prim(setup->softpipe);
+
 
    if (halfSize <= 0.5 && !round) {
       /* special case for 1-pixel points */
@@ -1483,6 +1508,8 @@ sp_setup_prepare(struct setup_context *setup)
 
    sp->quad.first->begin( sp->quad.first );
 
+   setup->binning = sp_bin_begin(sp);
+
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
        sp->rasterizer->fill_back == PIPE_POLYGON_MODE_FILL) {
@@ -1496,6 +1523,18 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Called by vbuf code at the end of a draw, to rasterize what's been
+ * binned.
+ */
+void
+sp_setup_flush(struct setup_context *setup)
+{
+   if (setup->binning)
+      sp_bin_flush(setup->softpipe);
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
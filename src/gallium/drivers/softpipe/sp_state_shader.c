@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_state.h"
@@ -234,6 +235,7 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      sp_bin_release_fs_variant(softpipe, var);
       var->delete(var, softpipe->fs_machine);
    }
 
@@ -49,7 +49,7 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
                                const struct pipe_framebuffer_state *fb)
 {
    struct softpipe_context *sp = softpipe_context(pipe);
-   uint i;
+   uint i, t;
 
    draw_flush(sp->draw);
 
@@ -59,13 +59,15 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
       /* check if changing cbuf */
       if (sp->framebuffer.cbufs[i] != cb) {
          /* flush old */
-         sp_flush_tile_cache(sp->cbuf_cache[i]);
+         for (t = 0; t < sp->num_threads; t++)
+            sp_flush_tile_cache(sp->thread_quad[t]->cbuf_cache[i]);
 
          /* assign new */
          pipe_surface_reference(&sp->framebuffer.cbufs[i], cb);
 
          /* update cache */
-         sp_tile_cache_set_surface(sp->cbuf_cache[i], cb);
+         for (t = 0; t < sp->num_threads; t++)
+            sp_tile_cache_set_surface(sp->thread_quad[t]->cbuf_cache[i], cb);
       }
    }
 
@@ -74,13 +76,16 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
    /* zbuf changing? */
    if (sp->framebuffer.zsbuf != fb->zsbuf) {
       /* flush old */
-      sp_flush_tile_cache(sp->zsbuf_cache);
+      for (t = 0; t < sp->num_threads; t++)
+         sp_flush_tile_cache(sp->thread_quad[t]->zsbuf_cache);
 
       /* assign new */
       pipe_surface_reference(&sp->framebuffer.zsbuf, fb->zsbuf);
 
       /* update cache */
-      sp_tile_cache_set_surface(sp->zsbuf_cache, fb->zsbuf);
+      for (t = 0; t < sp->num_threads; t++)
+         sp_tile_cache_set_surface(sp->thread_quad[t]->zsbuf_cache,
+                                   fb->zsbuf);
 
       /* Tell draw module how deep the Z/depth buffer is
        *
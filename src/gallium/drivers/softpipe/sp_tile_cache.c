@@ -104,6 +104,7 @@ sp_create_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
       tc->pipe = pipe;
+      tc->num_owners = 1;
       for (pos = 0; pos < ARRAY_SIZE(tc->tile_addrs); pos++) {
          tc->tile_addrs[pos].bits.invalid = 1;
       }
@@ -214,10 +215,41 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
       }
 
       tc->depth_stencil = util_format_is_depth_or_stencil(ps->format);
+      tc->quantize = !tc->depth_stencil &&
+                     ps->format != PIPE_FORMAT_R32G32B32A32_FLOAT &&
+                     ps->format != PIPE_FORMAT_R32G32B32A32_UINT &&
+                     ps->format != PIPE_FORMAT_R32G32B32A32_SINT;
    }
 }
 
 
+/**
+ * Round colors to what the surface can store, the way writing them to the
+ * surface and fetching them back would.
+ *
+ * Everything written to a color tile goes through this, so that flushing
+ * a tile and fetching it again doesn't change it.  Otherwise blending
+ * would depend on when tiles get evicted, which varies with the number of
+ * rasterizer threads.
+ */
+void
+sp_tile_cache_quantize(const struct softpipe_tile_cache *tc,
+                       float (*colors)[4], unsigned count)
+{
+   uint64_t packed[TILE_SIZE * 2];
+
+   assert(count <= TILE_SIZE);
+
+   if (!tc->quantize)
+      return;
+
+   util_format_write_4(tc->surface->format, colors, count * sizeof(*colors),
+                       packed, sizeof(packed), 0, 0, count, 1);
+   util_format_read_4(tc->surface->format, colors, count * sizeof(*colors),
+                      packed, sizeof(packed), 0, 0, count, 1);
+}
+
+
 /**
  * Return the transfer being cached.
  */
@@ -359,6 +391,11 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
       for (x = 0; x < w; x += TILE_SIZE) {
          union tile_address addr = tile_address(x, y, layer);
 
+         if (tc->num_owners > 1 &&
+             sp_tile_owner(addr.bits.x, addr.bits.y,
+                           tc->num_owners) != tc->owner)
+            continue;
+
          if (is_clear_flag_set(tc->clear_flags, addr, tc->clear_flags_size)) {
             /* write the scratch tile to the surface */
             if (tc->depth_stencil) {
@@ -564,6 +601,21 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 
 
 
+/**
+ * Make the cache hold only the tiles for which sp_tile_owner() returns
+ * owner.  Flushing then leaves the other tiles to the caches of the other
+ * rasterizer threads.
+ */
+void
+sp_tile_cache_set_owner(struct softpipe_tile_cache *tc,
+                        unsigned owner, unsigned num_owners)
+{
+   assert(owner < num_owners);
+   tc->owner = owner;
+   tc->num_owners = num_owners;
+}
+
+
 /**
  * When a whole surface is being cleared to a value we can avoid
  * fetching tiles above.
@@ -577,6 +629,8 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
    uint pos;
 
    tc->clear_color = *color;
+   if (tc->surface)
+      sp_tile_cache_quantize(tc, &tc->clear_color.f, 1);
 
    tc->clear_val = clearValue;
 
@@ -94,11 +94,15 @@ struct softpipe_tile_cache
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
    boolean depth_stencil; /**< Is the surface a depth/stencil format? */
+   boolean quantize;      /**< Can the surface lose float tile colors? */
 
    struct softpipe_cached_tile *tile;  /**< scratch tile for clears */
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /** With rasterizer threads, only the tiles of one thread are cached */
+   unsigned owner, num_owners;
 };
 
 
@@ -123,10 +127,30 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     const union pipe_color_union *color,
                     uint64_t clearValue);
 
+extern void
+sp_tile_cache_quantize(const struct softpipe_tile_cache *tc,
+                       float (*colors)[4], unsigned count);
+
 extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
 
+extern void
+sp_tile_cache_set_owner(struct softpipe_tile_cache *tc,
+                        unsigned owner, unsigned num_owners);
+
+
+/**
+ * Return which of num_owners rasterizer threads renders to the tile at
+ * (tx, ty), in tiles.  Neighbouring tiles go to different threads so that
+ * small primitives are spread out as well.
+ */
+static inline unsigned
+sp_tile_owner(unsigned tx, unsigned ty, unsigned num_owners)
+{
+   return (tx + ty * ((num_owners + 1) / 2)) % num_owners;
+}
+
 
 static inline union tile_address
 tile_address( unsigned x,
@@ -174,6 +174,16 @@ struct pipe_resource;
 struct pipe_fence_handle;
 struct util_queue_monitoring;
 
+/**
+ * State validation counters of a context, used by the HUD.
+ */
+struct st_validation_stats
+{
+   uint64_t validations;   /**< validations that updated some state */
+   uint64_t atom_updates;  /**< state atoms that were updated */
+   uint64_t time_ns;       /**< CPU time spent updating the atoms */
+};
+
 /**
  * Used in st_manager_iface->get_egl_image.
  */
@@ -445,6 +455,17 @@ struct st_context_iface
     * behind its back.
     */
    void (*invalidate_state)(struct st_context_iface *stctxi, unsigned flags);
+
+   /**
+    * Start counting state validations and return the counters, which are
+    * valid until the context is destroyed.  This adds a little overhead to
+    * every validation, so only call it when the counters are displayed.
+    * Must be called before the API thread is started.
+    *
+    * This function is optional.
+    */
+   const struct st_validation_stats *
+   (*get_validation_stats)(struct st_context_iface *stctxi);
 };
 
 
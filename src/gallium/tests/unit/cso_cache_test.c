@@ -0,0 +1,329 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check cso_hash, and replay streams of sampler and blend states through a
+ * cso_cache the way cso_context does, printing the lookup time and the
+ * cache statistics.
+ *
+ * The sampler stream follows what st/mesa creates: each texture gets the
+ * wrap and filter modes of its material and a max_lod from its mip count,
+ * and texture streaming changes the lod clamps of some textures every few
+ * frames.  The draws in a frame pick textures with a skew towards a hot set.
+ *
+ * Usage: cso_cache_test [frames]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cso_cache/cso_cache.h"
+#include "cso_cache/cso_hash.h"
+#include "pipe/p_defines.h"
+#include "util/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#define NUM_TEXTURES 1500
+#define DRAWS_PER_FRAME 2000
+#define SAMPLERS_PER_DRAW 4
+
+static unsigned num_deleted;
+
+static void
+delete_cso(void *ctx, void *state, enum cso_cache_type type)
+{
+   num_deleted++;
+   FREE(state);
+}
+
+/* The key cso_construct_key used to compute. */
+static unsigned
+xor_key(const void *key, int key_size)
+{
+   const unsigned *ikey = key;
+   unsigned hash = 0;
+
+   for (int i = 0; i < key_size / 4; i++)
+      hash ^= ikey[i];
+   return hash;
+}
+
+static bool
+test_hash(void)
+{
+   const unsigned n = 10000;
+   struct cso_hash hash;
+   unsigned *values = malloc(n * sizeof(*values));
+   bool pass = true;
+
+   cso_hash_init(&hash);
+
+   /* Keys with many duplicates and a narrow range. */
+   for (unsigned i = 0; i < n; i++) {
+      values[i] = i;
+      cso_hash_insert(&hash, i / 4, &values[i]);
+   }
+   if (cso_hash_size(&hash) != n)
+      pass = false;
+
+   for (unsigned i = 0; i < n && pass; i++) {
+      if (cso_hash_find_data_from_template(&hash, i / 4, &i,
+                                           sizeof(i)) != &values[i]) {
+         fprintf(stderr, "cso_hash: entry %u not found\n", i);
+         pass = false;
+      }
+   }
+
+   /* Erase the odd values while iterating, take the others by key. */
+   unsigned visited = 0;
+   struct cso_hash_iter iter = cso_hash_first_node(&hash);
+   while (!cso_hash_iter_is_null(iter)) {
+      unsigned *v = cso_hash_iter_data(iter);
+
+      visited++;
+      if (*v & 1)
+         iter = cso_hash_erase(&hash, iter);
+      else
+         iter = cso_hash_iter_next(iter);
+   }
+   if (visited != n || cso_hash_size(&hash) != n / 2) {
+      fprintf(stderr, "cso_hash: visited %u, %d left\n", visited,
+              cso_hash_size(&hash));
+      pass = false;
+   }
+
+   for (unsigned key = 0; key < n / 4; key++) {
+      for (unsigned j = 0; j < 2; j++) {
+         unsigned *v = cso_hash_take(&hash, key);
+
+         if (!v || *v / 4 != key || (*v & 1)) {
+            fprintf(stderr, "cso_hash: bad take for key %u\n", key);
+            pass = false;
+         }
+      }
+      if (cso_hash_contains(&hash, key)) {
+         fprintf(stderr, "cso_hash: key %u still present\n", key);
+         pass = false;
+      }
+   }
+   if (cso_hash_size(&hash) != 0)
+      pass = false;
+
+   cso_hash_deinit(&hash);
+   free(values);
+   return pass;
+}
+
+static void
+make_sampler(struct pipe_sampler_state *s, unsigned texture, unsigned frame)
+{
+   static const unsigned wraps[] = {
+      PIPE_TEX_WRAP_REPEAT, PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+      PIPE_TEX_WRAP_MIRROR_REPEAT,
+   };
+   unsigned material = texture % 37;
+   unsigned levels = 1 + (texture * 7) % 12;
+
+   memset(s, 0, sizeof(*s));
+   s->wrap_s = wraps[material % 3];
+   s->wrap_t = wraps[(material / 3) % 3];
+   s->wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   s->min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   s->mag_img_filter = material % 5 ? PIPE_TEX_FILTER_LINEAR :
+                                      PIPE_TEX_FILTER_NEAREST;
+   s->min_mip_filter = levels > 1 ? PIPE_TEX_MIPFILTER_LINEAR :
+                                    PIPE_TEX_MIPFILTER_NONE;
+   s->max_anisotropy = material % 4 ? 16 : 0;
+   s->normalized_coords = 1;
+   s->seamless_cube_map = 1;
+
+   /* Streaming: a tenth of the textures get a new lod clamp every 8 frames. */
+   s->min_lod = texture % 10 == 0 ? (float)((frame / 8 + texture) % levels) :
+                                    0.0f;
+   s->max_lod = levels - 1;
+}
+
+static void
+make_blend(struct pipe_blend_state *b, unsigned index)
+{
+   memset(b, 0, sizeof(*b));
+   b->independent_blend_enable = index & 1;
+   for (unsigned rt = 0; rt <= (index & 3); rt++) {
+      b->rt[rt].blend_enable = (index >> 2) & 1;
+      b->rt[rt].rgb_func = PIPE_BLEND_ADD;
+      b->rt[rt].alpha_func = PIPE_BLEND_ADD;
+      b->rt[rt].rgb_src_factor = (index >> 3) % 4 + 1;
+      b->rt[rt].rgb_dst_factor = (index >> 5) % 4 + 1;
+      b->rt[rt].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+      b->rt[rt].alpha_dst_factor = (index >> 7) & 1 ?
+         PIPE_BLENDFACTOR_INV_SRC_ALPHA : PIPE_BLENDFACTOR_ZERO;
+      b->rt[rt].colormask = 0xf ^ (index >> 8);
+   }
+   b->max_rt = index & 3;
+}
+
+/* What cso_context does to look up or create a state. */
+static void
+lookup(struct cso_cache *cache, enum cso_cache_type type, const void *templ,
+       unsigned size, unsigned cso_size)
+{
+   unsigned hash_key = cso_construct_key((void *)templ, size);
+   struct cso_hash_iter iter =
+      cso_find_state_template(cache, hash_key, type, (void *)templ, size);
+
+   if (cso_hash_iter_is_null(iter)) {
+      void *cso = CALLOC(1, cso_size);
+
+      memcpy(cso, templ, size);
+      cso_insert_state(cache, hash_key, type, cso);
+   }
+}
+
+static void
+print_stats(struct cso_cache *cache, enum cso_cache_type type,
+            const char *name, unsigned lookups, int64_t ns)
+{
+   struct cso_cache_stats stats;
+
+   cso_cache_get_stats(cache, type, &stats);
+   printf("%-10s %9u lookups %8.1f ns/lookup  hits %9"PRIu64"  misses %7"PRIu64
+          "  avg probes %.2f  max %u\n", name, lookups, (double)ns / lookups,
+          stats.hits, stats.misses,
+          (double)stats.probes / MAX2(stats.hits + stats.misses, 1),
+          stats.max_probes);
+}
+
+/* Count the states of the list that share a key with a different state. */
+static unsigned
+count_collisions(const void *states, unsigned count, unsigned size,
+                 unsigned (*key)(const void *, int))
+{
+   unsigned *keys = malloc(count * sizeof(*keys));
+   unsigned collisions = 0;
+
+   for (unsigned i = 0; i < count; i++)
+      keys[i] = key((const char *)states + i * size, size);
+
+   for (unsigned i = 0; i < count; i++) {
+      for (unsigned j = 0; j < count; j++) {
+         if (keys[i] == keys[j] &&
+             memcmp((const char *)states + i * size,
+                    (const char *)states + j * size, size)) {
+            collisions++;
+            break;
+         }
+      }
+   }
+   free(keys);
+   return collisions;
+}
+
+static unsigned
+new_key(const void *key, int key_size)
+{
+   return cso_construct_key((void *)key, key_size);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned frames = argc > 1 ? atoi(argv[1]) : 64;
+   struct cso_cache cache;
+   unsigned seed = 1;
+   bool pass;
+
+   pass = test_hash();
+   printf("cso_hash: %s\n", pass ? "pass" : "fail");
+
+   cso_cache_init(&cache, NULL);
+   cso_cache_set_delete_cso_callback(&cache, delete_cso, NULL);
+
+   unsigned lookups = 0;
+   int64_t start = os_time_get_nano();
+   for (unsigned frame = 0; frame < frames; frame++) {
+      for (unsigned draw = 0; draw < DRAWS_PER_FRAME; draw++) {
+         /* Half the draws use the first 10% of the textures. */
+         seed = seed * 1103515245 + 12345;
+         unsigned base = (seed >> 8) % (draw & 1 ? NUM_TEXTURES / 10 :
+                                                  NUM_TEXTURES);
+
+         for (unsigned i = 0; i < SAMPLERS_PER_DRAW; i++) {
+            struct pipe_sampler_state s;
+
+            make_sampler(&s, (base + i * 17) % NUM_TEXTURES, frame);
+            lookup(&cache, CSO_SAMPLER, &s, sizeof(s),
+                   sizeof(struct cso_sampler));
+            lookups++;
+         }
+      }
+   }
+   print_stats(&cache, CSO_SAMPLER, "sampler", lookups,
+               os_time_get_nano() - start);
+
+   lookups = 0;
+   start = os_time_get_nano();
+   for (unsigned frame = 0; frame < frames; frame++) {
+      for (unsigned draw = 0; draw < DRAWS_PER_FRAME; draw++) {
+         struct pipe_blend_state b;
+
+         seed = seed * 1103515245 + 12345;
+         make_blend(&b, (seed >> 8) % 512);
+         lookup(&cache, CSO_BLEND, &b, sizeof(b), sizeof(struct cso_blend));
+         lookups++;
+      }
+   }
+   print_stats(&cache, CSO_BLEND, "blend", lookups,
+               os_time_get_nano() - start);
+
+   cso_cache_delete(&cache);
+
+   /* How well the old and the new key tell the states apart. */
+   unsigned num_samplers = NUM_TEXTURES * 8;
+   struct pipe_sampler_state *samplers =
+      malloc(num_samplers * sizeof(*samplers));
+   for (unsigned i = 0; i < num_samplers; i++)
+      make_sampler(&samplers[i], i % NUM_TEXTURES, (i / NUM_TEXTURES) * 8);
+
+   struct pipe_blend_state *blends = malloc(512 * sizeof(*blends));
+   for (unsigned i = 0; i < 512; i++)
+      make_blend(&blends[i], i);
+
+   unsigned sampler_xor = count_collisions(samplers, num_samplers,
+                                           sizeof(*samplers), xor_key);
+   unsigned sampler_new = count_collisions(samplers, num_samplers,
+                                           sizeof(*samplers), new_key);
+   unsigned blend_xor = count_collisions(blends, 512, sizeof(*blends),
+                                         xor_key);
+   unsigned blend_new = count_collisions(blends, 512, sizeof(*blends),
+                                         new_key);
+   printf("states sharing a key (xor / cso_construct_key): "
+          "sampler %u / %u of %u, blend %u / %u of 512\n",
+          sampler_xor, sampler_new, num_samplers, blend_xor, blend_new);
+
+   free(samplers);
+   free(blends);
+   return pass ? 0 : 1;
+}
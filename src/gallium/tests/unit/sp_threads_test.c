@@ -0,0 +1,385 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check that softpipe renders the same image with SOFTPIPE_NUM_THREADS=1
+ * and with more threads.
+ *
+ * The scene is made of random overlapping triangles, textured, depth
+ * tested, blended and discarding fragments, with a clear of part of the
+ * render target in the middle.  The framebuffer has more tiles than a
+ * tile cache holds, so tiles get evicted and fetched again, at other times
+ * with threads than without.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "softpipe/sp_public.h"
+#include "softpipe/sp_screen.h"
+#include "sw/null/null_sw_winsys.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_draw_quad.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define TEX_SIZE 64
+#define NUM_TRIS 2000
+#define NUM_PASSES 4
+
+static const char fs_tex[] =
+   "FRAG\n"
+   "DCL IN[0], COLOR, PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL TEMP[0]\n"
+   "TEX TEMP[0], IN[1], SAMP[0], 2D\n"
+   "MUL OUT[0], TEMP[0], IN[0]\n"
+   "END\n";
+
+static const char fs_kill[] =
+   "FRAG\n"
+   "DCL IN[0], COLOR, PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL TEMP[0]\n"
+   "IMM[0] FLT32 { 0.3, 0.0, 0.0, 0.0}\n"
+   "ADD TEMP[0], IN[1].xxxx, -IMM[0].xxxx\n"
+   "KILL_IF TEMP[0]\n"
+   "MOV OUT[0], IN[0]\n"
+   "END\n";
+
+/* Position, color and texture coordinates of every vertex. */
+static float verts[NUM_TRIS * 3][3][4];
+
+static float
+rand_float(float scale, float bias)
+{
+   return rand() / (float)RAND_MAX * scale + bias;
+}
+
+static void
+make_scene(void)
+{
+   srand(42);
+   for (unsigned t = 0; t < NUM_TRIS; t++) {
+      float cx = rand_float(2.4f, -1.2f);
+      float cy = rand_float(2.4f, -1.2f);
+      float size = rand_float(0.5f, 0.02f);
+      float z = rand_float(1.0f, 0.0f);
+      float color[4];
+
+      for (unsigned c = 0; c < 4; c++)
+         color[c] = rand_float(1.0f, 0.0f);
+
+      for (unsigned v = 0; v < 3; v++) {
+         float (*vert)[4] = verts[t * 3 + v];
+         float w = rand_float(1.0f, 0.5f);
+
+         vert[0][0] = (cx + rand_float(2.0f, -1.0f) * size) * w;
+         vert[0][1] = (cy + rand_float(2.0f, -1.0f) * size) * w;
+         vert[0][2] = (z + v * 0.01f) * w;
+         vert[0][3] = w;
+         for (unsigned c = 0; c < 4; c++)
+            vert[1][c] = color[c] * (0.5f + 0.25f * v);
+         vert[2][0] = rand_float(3.0f, 0.0f);
+         vert[2][1] = rand_float(3.0f, 0.0f);
+         vert[2][2] = 0.0f;
+         vert[2][3] = 1.0f;
+      }
+   }
+}
+
+static void *
+create_fs(struct pipe_context *pipe, const char *text)
+{
+   struct tgsi_token tokens[1000];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens)))
+      return NULL;
+   pipe_shader_state_from_tgsi(&state, tokens);
+   return pipe->create_fs_state(pipe, &state);
+}
+
+static struct pipe_sampler_view *
+create_texture(struct pipe_screen *screen, struct pipe_context *pipe)
+{
+   struct pipe_resource templ = {
+      .target = PIPE_TEXTURE_2D,
+      .format = PIPE_FORMAT_R8G8B8A8_UNORM,
+      .width0 = TEX_SIZE,
+      .height0 = TEX_SIZE,
+      .depth0 = 1,
+      .array_size = 1,
+      .bind = PIPE_BIND_SAMPLER_VIEW,
+   };
+   struct pipe_resource *tex = screen->resource_create(screen, &templ);
+   struct pipe_sampler_view view_templ, *view;
+   uint32_t texels[TEX_SIZE * TEX_SIZE];
+   struct pipe_box box;
+
+   for (unsigned i = 0; i < TEX_SIZE * TEX_SIZE; i++)
+      texels[i] = ((i >> 2) ^ (i >> 8)) & 1 ?
+                  0xff20c0ff : 0xffff6010 ^ (i * 2654435761u & 0x3f3f3f);
+   u_box_2d(0, 0, TEX_SIZE, TEX_SIZE, &box);
+   pipe->texture_subdata(pipe, tex, 0, 0, &box, texels, TEX_SIZE * 4, 0);
+
+   u_sampler_view_default_template(&view_templ, tex, tex->format);
+   view = pipe->create_sampler_view(pipe, tex, &view_templ);
+   pipe_resource_reference(&tex, NULL);
+   return view;
+}
+
+static void
+read_back(struct pipe_context *pipe, struct pipe_resource *res, uint8_t *dst)
+{
+   struct pipe_transfer *transfer;
+   const uint8_t *map = pipe_transfer_map(pipe, res, 0, 0, PIPE_MAP_READ,
+                                          0, 0, WIDTH, HEIGHT, &transfer);
+
+   for (unsigned y = 0; y < HEIGHT; y++)
+      memcpy(dst + y * WIDTH * 4, map + y * transfer->stride, WIDTH * 4);
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+/* Render the scene with \p num_threads threads, and read back its colors
+ * and depths.  Returns false if the screen doesn't use that many threads.
+ */
+static bool
+render(unsigned num_threads, uint8_t *colors, uint8_t *depths)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   char value[8];
+
+   snprintf(value, sizeof(value), "%u", num_threads);
+   setenv("SOFTPIPE_NUM_THREADS", value, 1);
+   screen = softpipe_create_screen(null_sw_create());
+   if (softpipe_screen(screen)->num_threads != num_threads) {
+      screen->destroy(screen);
+      return false;
+   }
+   pipe = screen->context_create(screen, NULL, 0);
+   cso = cso_create_context(pipe, 0);
+
+   struct pipe_resource templ = {
+      .target = PIPE_TEXTURE_2D,
+      .format = PIPE_FORMAT_B8G8R8A8_UNORM,
+      .width0 = WIDTH,
+      .height0 = HEIGHT,
+      .depth0 = 1,
+      .array_size = 1,
+      .bind = PIPE_BIND_RENDER_TARGET,
+   };
+   struct pipe_resource *target = screen->resource_create(screen, &templ);
+   templ.format = PIPE_FORMAT_Z24_UNORM_S8_UINT;
+   templ.bind = PIPE_BIND_DEPTH_STENCIL;
+   struct pipe_resource *zs = screen->resource_create(screen, &templ);
+
+   struct pipe_surface surf_templ = { .format = target->format };
+   struct pipe_surface *cbuf = pipe->create_surface(pipe, target, &surf_templ);
+   surf_templ.format = zs->format;
+   struct pipe_surface *zsbuf = pipe->create_surface(pipe, zs, &surf_templ);
+
+   struct pipe_framebuffer_state fb = {
+      .width = WIDTH,
+      .height = HEIGHT,
+      .nr_cbufs = 1,
+      .cbufs[0] = cbuf,
+      .zsbuf = zsbuf,
+   };
+   struct pipe_depth_stencil_alpha_state dsa = {
+      .depth_enabled = 1,
+      .depth_writemask = 1,
+      .depth_func = PIPE_FUNC_LESS,
+   };
+   struct pipe_rasterizer_state rast = {
+      .cull_face = PIPE_FACE_NONE,
+      .half_pixel_center = 1,
+      .bottom_edge_rule = 1,
+      .depth_clip_near = 1,
+      .depth_clip_far = 1,
+   };
+   struct pipe_viewport_state vp = {
+      .scale = { WIDTH / 2.0f, HEIGHT / 2.0f, 0.5f },
+      .translate = { WIDTH / 2.0f, HEIGHT / 2.0f, 0.5f },
+      .swizzle_x = PIPE_VIEWPORT_SWIZZLE_POSITIVE_X,
+      .swizzle_y = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Y,
+      .swizzle_z = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Z,
+      .swizzle_w = PIPE_VIEWPORT_SWIZZLE_POSITIVE_W,
+   };
+   struct cso_velems_state velems = { .count = 3 };
+   for (unsigned i = 0; i < 3; i++) {
+      velems.velems[i].src_offset = i * 16;
+      velems.velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+   struct pipe_sampler_state sampler = {
+      .wrap_s = PIPE_TEX_WRAP_REPEAT,
+      .wrap_t = PIPE_TEX_WRAP_REPEAT,
+      .wrap_r = PIPE_TEX_WRAP_REPEAT,
+      .min_img_filter = PIPE_TEX_FILTER_LINEAR,
+      .mag_img_filter = PIPE_TEX_FILTER_LINEAR,
+      .normalized_coords = 1,
+   };
+   const struct pipe_sampler_state *samplers[1] = { &sampler };
+   struct pipe_sampler_view *view = create_texture(screen, pipe);
+
+   const enum tgsi_semantic names[] = {
+      TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_COLOR, TGSI_SEMANTIC_GENERIC
+   };
+   const uint indices[] = { 0, 0, 0 };
+   void *vs = util_make_vertex_passthrough_shader(pipe, 3, names, indices,
+                                                  false);
+   void *fs[2] = { create_fs(pipe, fs_tex), create_fs(pipe, fs_kill) };
+
+   union pipe_color_union clear_color = {{ 0.1f, 0.2f, 0.3f, 1.0f }};
+   union pipe_color_union red = {{ 1.0f, 0.0f, 0.0f, 1.0f }};
+
+   cso_set_framebuffer(cso, &fb);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR | PIPE_CLEAR_DEPTHSTENCIL, NULL,
+               &clear_color, 1.0, 0);
+   cso_set_depth_stencil_alpha(cso, &dsa);
+   cso_set_rasterizer(cso, &rast);
+   cso_set_viewport(cso, &vp);
+   cso_set_vertex_shader_handle(cso, vs);
+   cso_set_vertex_elements(cso, &velems);
+   cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0, &view);
+
+   /* Every draw has enough triangles to be rasterized on the threads. */
+   for (unsigned pass = 0; pass < NUM_PASSES; pass++) {
+      const unsigned count = NUM_TRIS / NUM_PASSES;
+      struct pipe_blend_state blend = {
+         .rt[0].colormask = PIPE_MASK_RGBA,
+      };
+
+      if (pass & 1) {
+         blend.rt[0].blend_enable = 1;
+         blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+         blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+         blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+         blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+         blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+         blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      }
+      cso_set_blend(cso, &blend);
+      cso_set_fragment_shader_handle(cso, fs[pass == 2]);
+      util_draw_user_vertex_buffer(cso, verts + pass * count * 3,
+                                   PIPE_PRIM_TRIANGLES, count * 3, 3);
+
+      if (pass == 1)
+         pipe->clear_render_target(pipe, cbuf, &red, 100, 70, 70, 90, false);
+   }
+   pipe->flush(pipe, NULL, 0);
+
+   read_back(pipe, target, colors);
+   read_back(pipe, zs, depths);
+
+   cso_destroy_context(cso);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_fs_state(pipe, fs[0]);
+   pipe->delete_fs_state(pipe, fs[1]);
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_surface_reference(&cbuf, NULL);
+   pipe_surface_reference(&zsbuf, NULL);
+   pipe_resource_reference(&target, NULL);
+   pipe_resource_reference(&zs, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+   return true;
+}
+
+/* Report the first pixel that differs. */
+static bool
+compare(const char *what, unsigned num_threads,
+        const uint8_t *expected, const uint8_t *actual)
+{
+   for (unsigned i = 0; i < WIDTH * HEIGHT; i++) {
+      uint32_t e, a;
+
+      memcpy(&e, expected + i * 4, 4);
+      memcpy(&a, actual + i * 4, 4);
+      if (e != a) {
+         printf("With %u threads, the %s at (%u, %u) is 0x%08x instead of "
+                "0x%08x.\n", num_threads, what, i % WIDTH, i / WIDTH, a, e);
+         return false;
+      }
+   }
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned thread_counts[] = { 2, 3, 4 };
+   uint8_t *ref_colors = MALLOC(WIDTH * HEIGHT * 4);
+   uint8_t *ref_depths = MALLOC(WIDTH * HEIGHT * 4);
+   uint8_t *colors = MALLOC(WIDTH * HEIGHT * 4);
+   uint8_t *depths = MALLOC(WIDTH * HEIGHT * 4);
+   unsigned fails = 0;
+
+   make_scene();
+
+   if (!render(1, ref_colors, ref_depths)) {
+      printf("SOFTPIPE_NUM_THREADS was ignored.\n");
+      fails++;
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(thread_counts); i++) {
+      if (!render(thread_counts[i], colors, depths)) {
+         printf("SOFTPIPE_NUM_THREADS was ignored.\n");
+         fails++;
+         continue;
+      }
+      if (!compare("color", thread_counts[i], ref_colors, colors))
+         fails++;
+      if (!compare("depth", thread_counts[i], ref_depths, depths))
+         fails++;
+   }
+
+   FREE(ref_colors);
+   FREE(ref_depths);
+   FREE(colors);
+   FREE(depths);
+
+   if (fails) {
+      printf("Failure!\n");
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
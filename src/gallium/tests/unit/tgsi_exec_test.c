@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Run a small vertex shader through the TGSI interpreter, compare the
+ * results against the same math done in C, and print the time per quad.
+ *
+ * Usage: tgsi_exec_test [iterations]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+
+/* A transform, a normalize with partial write masks, a saturated store and
+ * an indirectly addressed constant, so both the direct and the indexed
+ * operand paths get used.
+ */
+static const char shader_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL OUT[2], GENERIC[1]\n"
+   "DCL CONST[0..7]\n"
+   "DCL TEMP[0..1]\n"
+   "DCL ADDR[0]\n"
+   "IMM[0] FLT32 { 0.5000, 4.0000, 1.0000, 0.0000}\n"
+   "  0: MUL TEMP[0], IN[0].xxxx, CONST[0]\n"
+   "  1: MAD TEMP[0], IN[0].yyyy, CONST[1], TEMP[0]\n"
+   "  2: MAD TEMP[0], IN[0].zzzz, CONST[2], TEMP[0]\n"
+   "  3: MAD OUT[0], IN[0].wwww, CONST[3], TEMP[0]\n"
+   "  4: DP3 TEMP[1].x, IN[1], IN[1]\n"
+   "  5: RSQ TEMP[1].x, TEMP[1].xxxx\n"
+   "  6: MUL TEMP[1].xyz, IN[1], TEMP[1].xxxx\n"
+   "  7: MOV TEMP[1].w, IMM[0].zzzz\n"
+   "  8: MAD_SAT OUT[1], TEMP[1], IMM[0].xxxx, IMM[0].xxxx\n"
+   "  9: MUL TEMP[0].x, IN[1].wwww, IMM[0].yyyy\n"
+   " 10: ARL ADDR[0].x, TEMP[0].xxxx\n"
+   " 11: ADD OUT[2], CONST[ADDR[0].x+4], -IN[1].wzyx\n"
+   " 12: END\n";
+
+static float consts[8][4];
+
+static void
+reference(const float in0[4], const float in1[4], float out[3][4])
+{
+   float len, n[4];
+   int a;
+
+   for (unsigned c = 0; c < 4; c++) {
+      out[0][c] = in0[0] * consts[0][c] + in0[1] * consts[1][c] +
+                  in0[2] * consts[2][c] + in0[3] * consts[3][c];
+   }
+
+   len = 1.0f / sqrtf(in1[0] * in1[0] + in1[1] * in1[1] + in1[2] * in1[2]);
+   n[0] = in1[0] * len;
+   n[1] = in1[1] * len;
+   n[2] = in1[2] * len;
+   n[3] = 1.0f;
+   for (unsigned c = 0; c < 4; c++)
+      out[1][c] = fminf(fmaxf(n[c] * 0.5f + 0.5f, 0.0f), 1.0f);
+
+   a = (int)floorf(in1[3] * 4.0f);
+   for (unsigned c = 0; c < 4; c++)
+      out[2][c] = consts[4 + a][c] - in1[3 - c];
+}
+
+static bool
+close_enough(float a, float b)
+{
+   return fabsf(a - b) <= 1e-4f * fmaxf(1.0f, fabsf(b));
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned iterations = argc > 1 ? atoi(argv[1]) : 200000;
+   struct tgsi_token tokens[1024];
+   struct tgsi_exec_machine *mach;
+   const void *bufs[1] = { consts };
+   const unsigned sizes[1] = { sizeof(consts) };
+   float in[TGSI_QUAD_SIZE][2][4];
+   unsigned failures = 0;
+   int64_t start, elapsed;
+
+   if (!tgsi_text_translate(shader_text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to parse the shader\n");
+      return 1;
+   }
+
+   srand(1234);
+   for (unsigned i = 0; i < 8; i++) {
+      for (unsigned c = 0; c < 4; c++)
+         consts[i][c] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+   }
+
+   for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+      for (unsigned c = 0; c < 4; c++) {
+         in[j][0][c] = rand() / (float)RAND_MAX * 10.0f - 5.0f;
+         in[j][1][c] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+      }
+      /* Indirect index 0..3 */
+      in[j][1][3] = (j + 0.5f) / 4.0f;
+   }
+
+   mach = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL, NULL, NULL);
+   tgsi_exec_set_constant_buffers(mach, 1, bufs, sizes);
+
+   for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+      for (unsigned slot = 0; slot < 2; slot++) {
+         for (unsigned c = 0; c < 4; c++)
+            mach->Inputs[slot].xyzw[c].f[j] = in[j][slot][c];
+      }
+   }
+   mach->NonHelperMask = (1 << TGSI_QUAD_SIZE) - 1;
+
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++)
+      tgsi_exec_machine_run(mach, 0);
+   elapsed = os_time_get_nano() - start;
+
+   for (unsigned j = 0; j < TGSI_QUAD_SIZE; j++) {
+      float ref[3][4];
+
+      reference(in[j][0], in[j][1], ref);
+      for (unsigned slot = 0; slot < 3; slot++) {
+         for (unsigned c = 0; c < 4; c++) {
+            float v = mach->Outputs[slot].xyzw[c].f[j];
+
+            if (!close_enough(v, ref[slot][c])) {
+               printf("OUT[%u].%c lane %u: got %f, expected %f\n",
+                      slot, "xyzw"[c], j, v, ref[slot][c]);
+               failures++;
+            }
+         }
+      }
+   }
+
+   if (iterations) {
+      printf("%.1f ns per quad, %.1f ns per instruction\n",
+             (double)elapsed / iterations,
+             (double)elapsed / iterations / 12);
+   }
+
+   tgsi_exec_machine_destroy(mach);
+
+   if (failures) {
+      printf("Failure! %u mismatches\n", failures);
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fetch vertices into float4 attributes, the way draw does, with both the
+ * x86 code generator and the generic C path.  Check that they agree and
+ * print the time per vertex of each.
+ *
+ * Usage: translate_bench [iterations]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "translate/translate.h"
+#include "util/format/u_format.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+
+#define NUM_VERTS 1024
+
+struct layout {
+   const char *name;
+   unsigned nr;
+   enum pipe_format formats[4];
+};
+
+static const struct layout layouts[] = {
+   { "float3", 1, { PIPE_FORMAT_R32G32B32_FLOAT } },
+   { "unorm8x4", 1, { PIPE_FORMAT_R8G8B8A8_UNORM } },
+   { "snorm16x2", 1, { PIPE_FORMAT_R16G16_SNORM } },
+   { "half4", 1, { PIPE_FORMAT_R16G16B16A16_FLOAT } },
+   { "half2", 1, { PIPE_FORMAT_R16G16_FLOAT } },
+   { "unorm10_10_10_2", 1, { PIPE_FORMAT_R10G10B10A2_UNORM } },
+   { "snorm10_10_10_2", 1, { PIPE_FORMAT_B10G10R10A2_SNORM } },
+   { "pos+normal+uv+color", 4,
+     { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R10G10B10A2_SNORM,
+       PIPE_FORMAT_R16G16_FLOAT, PIPE_FORMAT_B8G8R8A8_UNORM } },
+};
+
+static bool
+close_enough(float a, float b)
+{
+   return fabsf(a - b) <= 1e-6f * fmaxf(1.0f, fabsf(b));
+}
+
+static double
+run_translate(struct translate *t, unsigned iterations, float *out)
+{
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < iterations; i++)
+      t->run(t, 0, NUM_VERTS, 0, 0, out);
+
+   return (double)(os_time_get_nano() - start) / iterations / NUM_VERTS;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned iterations = argc > 1 ? atoi(argv[1]) : 200;
+   unsigned failures = 0;
+
+   util_cpu_detect();
+   srand(1234);
+
+   for (unsigned l = 0; l < ARRAY_SIZE(layouts); l++) {
+      const struct layout *layout = &layouts[l];
+      struct translate_key key;
+      struct translate *generic, *x86;
+      unsigned stride = 0;
+      uint8_t *verts;
+      float *out[2];
+
+      memset(&key, 0, sizeof(key));
+      key.nr_elements = layout->nr;
+      key.output_stride = layout->nr * 4 * sizeof(float);
+      for (unsigned e = 0; e < layout->nr; e++) {
+         key.element[e].type = TRANSLATE_ELEMENT_NORMAL;
+         key.element[e].input_format = layout->formats[e];
+         key.element[e].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+         key.element[e].input_offset = stride;
+         key.element[e].output_offset = e * 4 * sizeof(float);
+         stride += util_format_get_blocksize(layout->formats[e]);
+      }
+
+      /* Random attributes in [-1, 1], through the formats' pack functions
+       * so that there are no NaNs.
+       */
+      verts = malloc(stride * NUM_VERTS);
+      for (unsigned v = 0; v < NUM_VERTS; v++) {
+         for (unsigned e = 0; e < layout->nr; e++) {
+            float rgba[4];
+
+            for (unsigned c = 0; c < 4; c++)
+               rgba[c] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+            util_format_pack_rgba(layout->formats[e],
+                                  verts + v * stride +
+                                  key.element[e].input_offset,
+                                  rgba, 1);
+         }
+      }
+
+      out[0] = malloc(key.output_stride * NUM_VERTS);
+      out[1] = malloc(key.output_stride * NUM_VERTS);
+
+      generic = translate_generic_create(&key);
+      x86 = translate_sse2_create(&key);
+
+      generic->set_buffer(generic, 0, verts, stride, NUM_VERTS - 1);
+      printf("%-20s generic %6.2f ns/vertex", layout->name,
+             run_translate(generic, iterations, out[0]));
+
+      if (x86) {
+         unsigned n = NUM_VERTS * layout->nr * 4;
+
+         x86->set_buffer(x86, 0, verts, stride, NUM_VERTS - 1);
+         printf(", x86 %6.2f ns/vertex\n",
+                run_translate(x86, iterations, out[1]));
+
+         for (unsigned i = 0; i < n; i++) {
+            if (!close_enough(out[1][i], out[0][i])) {
+               printf("  vertex %u attrib %u.%c: got %f, expected %f\n",
+                      i / (layout->nr * 4), i / 4 % layout->nr,
+                      "xyzw"[i % 4], out[1][i], out[0][i]);
+               failures++;
+               break;
+            }
+         }
+         x86->release(x86);
+      }
+      else {
+         printf(", no x86 code\n");
+      }
+
+      generic->release(generic);
+      free(out[0]);
+      free(out[1]);
+      free(verts);
+   }
+
+   if (failures) {
+      printf("Failure! %u layouts differ\n", failures);
+      return 1;
+   }
+
+   return 0;
+}
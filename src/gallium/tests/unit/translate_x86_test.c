@@ -0,0 +1,216 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fetch every vertex format into float4 attributes with the x86 code
+ * generator at each instruction set level (SSE2, SSE4.1, AVX2 + F16C)
+ * and check that the results match the generic C path. Levels that the
+ * CPU doesn't support are skipped.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "translate/translate.h"
+#include "util/format/u_format.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "rtasm/rtasm_cpu.h"
+
+/* The generated code converts one vertex per iteration, so the count only
+ * needs to cover reordered elts and a last vertex at max_index.
+ */
+#define NUM_VERTS 37
+
+static bool
+close_enough(float a, float b)
+{
+   if (isnan(a) || isnan(b))
+      return isnan(a) && isnan(b);
+   return fabsf(a - b) <= 1e-6f * fmaxf(1.0f, fabsf(b));
+}
+
+static bool
+is_float_format(const struct util_format_description *desc)
+{
+   for (unsigned i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type == UTIL_FORMAT_TYPE_FLOAT)
+         return true;
+   }
+   return false;
+}
+
+static void
+fill_vertices(enum pipe_format format, uint8_t *verts, unsigned size)
+{
+   const struct util_format_description *desc = util_format_description(format);
+
+   if (!is_float_format(desc)) {
+      for (unsigned i = 0; i < size * NUM_VERTS; i++)
+         verts[i] = rand();
+      return;
+   }
+
+   /* Go through the pack function so that there are no NaNs. */
+   for (unsigned v = 0; v < NUM_VERTS; v++) {
+      float rgba[4];
+
+      for (unsigned c = 0; c < 4; c++)
+         rgba[c] = rand() / (float)RAND_MAX * 200.0f - 100.0f;
+      util_format_pack_rgba(format, verts + v * size, rgba, 1);
+   }
+}
+
+/* Return the number of formats for which the x86 path differs. */
+static unsigned
+test_formats(const char *level, unsigned *num_tested)
+{
+   unsigned failures = 0;
+   unsigned elts[NUM_VERTS];
+
+   for (unsigned i = 0; i < NUM_VERTS; i++)
+      elts[i] = NUM_VERTS - 1 - i;
+
+   for (enum pipe_format format = 1; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_description *desc =
+         util_format_description(format);
+      struct translate_key key;
+      struct translate *generic, *x86;
+      float out[2][NUM_VERTS * 4];
+      uint8_t verts[NUM_VERTS * 32];
+      unsigned size;
+
+      if (!desc ||
+          desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+          desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+          desc->block.bits > 32 * 8 ||
+          !translate_is_output_format_supported(format))
+         continue;
+
+      size = util_format_get_blocksize(format);
+
+      memset(&key, 0, sizeof(key));
+      key.nr_elements = 1;
+      key.output_stride = 4 * sizeof(float);
+      key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[0].input_format = format;
+      key.element[0].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+      x86 = translate_sse2_create(&key);
+      if (!x86)
+         continue;
+
+      generic = translate_generic_create(&key);
+      if (!generic) {
+         x86->release(x86);
+         continue;
+      }
+
+      fill_vertices(format, verts, size);
+      generic->set_buffer(generic, 0, verts, size, NUM_VERTS - 1);
+      x86->set_buffer(x86, 0, verts, size, NUM_VERTS - 1);
+
+      for (unsigned pass = 0; pass < 2; pass++) {
+         memset(out, 0, sizeof(out));
+
+         if (pass == 0) {
+            generic->run(generic, 0, NUM_VERTS, 0, 0, out[0]);
+            x86->run(x86, 0, NUM_VERTS, 0, 0, out[1]);
+         } else {
+            generic->run_elts(generic, elts, NUM_VERTS, 0, 0, out[0]);
+            x86->run_elts(x86, elts, NUM_VERTS, 0, 0, out[1]);
+         }
+
+         for (unsigned i = 0; i < NUM_VERTS * 4; i++) {
+            if (!close_enough(out[1][i], out[0][i])) {
+               printf("FAIL: %s %s %s: vertex %u.%c: got %f, expected %f\n",
+                      level, desc->short_name, pass ? "run_elts" : "run",
+                      i / 4, "xyzw"[i % 4], out[1][i], out[0][i]);
+               failures++;
+               break;
+            }
+         }
+      }
+
+      (*num_tested)++;
+      x86->release(x86);
+      generic->release(generic);
+   }
+
+   return failures;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned failures = 0;
+
+   util_cpu_detect();
+   srand(4359025);
+
+   if (!util_cpu_caps.has_sse2 || !rtasm_cpu_has_sse()) {
+      printf("SSE2 isn't supported, skipping\n");
+      return 77;
+   }
+
+   const struct util_cpu_caps caps = util_cpu_caps;
+   static const struct {
+      const char *name;
+      bool sse4_1, avx2;
+   } levels[] = {
+      { "sse2", false, false },
+      { "sse4.1", true, false },
+      { "avx2", true, true },
+   };
+
+   for (unsigned l = 0; l < ARRAY_SIZE(levels); l++) {
+      unsigned num_tested = 0;
+
+      if ((levels[l].sse4_1 && !caps.has_sse4_1) ||
+          (levels[l].avx2 && (!caps.has_avx2 || !caps.has_f16c))) {
+         printf("%s: not supported by the CPU, skipped\n", levels[l].name);
+         continue;
+      }
+
+      util_cpu_caps = caps;
+      util_cpu_caps.has_sse3 &= levels[l].sse4_1;
+      util_cpu_caps.has_ssse3 &= levels[l].sse4_1;
+      util_cpu_caps.has_sse4_1 = levels[l].sse4_1;
+      util_cpu_caps.has_avx2 = levels[l].avx2;
+      util_cpu_caps.has_f16c = levels[l].avx2;
+
+      failures += test_formats(levels[l].name, &num_tested);
+      printf("%s: %u formats tested\n", levels[l].name, num_tested);
+   }
+
+   util_cpu_caps = caps;
+
+   if (failures) {
+      printf("Failure! %u formats differ\n", failures);
+      return 1;
+   }
+
+   return 0;
+}
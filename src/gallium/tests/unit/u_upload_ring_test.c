@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check that the ring mode of u_upload_mgr only reuses a full buffer once
+ * the GPU is done with all its uses, including the uses by command streams
+ * submitted while a suballocation stayed bound after the buffer was retired.
+ *
+ * The mock screen numbers the command streams.  A fence is signalled once
+ * the "GPU" has completed its command stream, and every command stream
+ * reads the suballocations bound when it was submitted.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_upload_mgr.h"
+
+#define UPLOAD_SIZE 4096
+#define ALLOC_SIZE 1000
+#define BUFFERS_PER_FRAME 3
+
+struct mock_fence {
+   int refcount;
+   unsigned seqno;
+};
+
+static unsigned submitted;  /* Last submitted command stream. */
+static unsigned completed;  /* Last command stream the GPU is done with. */
+static unsigned num_resources;
+
+/* The buffer kept bound, and the last command stream that reads it. */
+static struct pipe_resource *bound;
+static struct pipe_resource *watched; /* Same buffer, not referenced. */
+static unsigned bound_last_use;
+
+static int
+mock_get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   return param == PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT;
+}
+
+static struct pipe_resource *
+mock_resource_create(struct pipe_screen *screen,
+                     const struct pipe_resource *templ)
+{
+   struct pipe_resource *res = CALLOC(1, sizeof(*res) + templ->width0);
+
+   *res = *templ;
+   pipe_reference_init(&res->reference, 1);
+   res->screen = screen;
+   num_resources++;
+   return res;
+}
+
+static void
+mock_resource_destroy(struct pipe_screen *screen, struct pipe_resource *res)
+{
+   if (res == watched)
+      watched = NULL;
+   FREE(res);
+   num_resources--;
+}
+
+static void
+mock_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **dst,
+                     struct pipe_fence_handle *src)
+{
+   struct mock_fence *old = (struct mock_fence *)*dst;
+
+   if (src)
+      ((struct mock_fence *)src)->refcount++;
+   if (old && --old->refcount == 0)
+      FREE(old);
+   *dst = src;
+}
+
+static bool
+mock_fence_finish(struct pipe_screen *screen, struct pipe_context *ctx,
+                  struct pipe_fence_handle *fence, uint64_t timeout)
+{
+   return ((struct mock_fence *)fence)->seqno <= completed;
+}
+
+/* Deferred flushes return a fence for the command stream being recorded. */
+static void
+mock_flush(struct pipe_context *pipe, struct pipe_fence_handle **fence,
+           unsigned flags)
+{
+   if (fence) {
+      struct mock_fence *f = CALLOC_STRUCT(mock_fence);
+
+      f->refcount = 1;
+      f->seqno = submitted + 1;
+      mock_fence_reference(pipe->screen, fence, NULL);
+      *fence = (struct pipe_fence_handle *)f;
+   }
+}
+
+static void *
+mock_transfer_map(struct pipe_context *pipe, struct pipe_resource *res,
+                  unsigned level, unsigned usage, const struct pipe_box *box,
+                  struct pipe_transfer **transfer)
+{
+   *transfer = CALLOC_STRUCT(pipe_transfer);
+   (*transfer)->box = *box;
+   pipe_resource_reference(&(*transfer)->resource, res);
+   return (uint8_t *)(res + 1) + box->x;
+}
+
+static void
+mock_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+   pipe_resource_reference(&transfer->resource, NULL);
+   FREE(transfer);
+}
+
+/* Submit a command stream, which reads the bound buffer. */
+static void
+submit(void)
+{
+   submitted++;
+   if (bound)
+      bound_last_use = submitted;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen screen = {
+      .get_param = mock_get_param,
+      .resource_create = mock_resource_create,
+      .resource_destroy = mock_resource_destroy,
+      .fence_reference = mock_fence_reference,
+      .fence_finish = mock_fence_finish,
+   };
+   struct pipe_context pipe = {
+      .screen = &screen,
+      .flush = mock_flush,
+      .transfer_map = mock_transfer_map,
+      .transfer_unmap = mock_transfer_unmap,
+   };
+   struct u_upload_mgr *upload;
+   struct pipe_resource *buf = NULL;
+   struct u_upload_stats stats;
+   unsigned offset, fails = 0;
+   void *ptr;
+
+   upload = u_upload_create(&pipe, UPLOAD_SIZE, 0, PIPE_USAGE_STREAM, 0);
+   u_upload_enable_ring(upload, 8);
+
+   for (unsigned frame = 0; frame < 64; frame++) {
+      for (unsigned i = 0;
+           i < UPLOAD_SIZE / ALLOC_SIZE * BUFFERS_PER_FRAME; i++) {
+         u_upload_alloc(upload, 0, ALLOC_SIZE, 16, &offset, &buf, &ptr);
+
+         if (buf == watched && completed < bound_last_use) {
+            printf("Frame %u: the bound buffer was reused while command "
+                   "stream %u still reads it (completed: %u)\n",
+                   frame, bound_last_use, completed);
+            fails++;
+         }
+      }
+
+      /* Keep a buffer bound across its retirement and several more
+       * command streams, like a constant buffer that isn't updated.
+       */
+      if (frame == 8) {
+         pipe_resource_reference(&bound, buf);
+         watched = buf;
+      }
+      if (frame == 11)
+         pipe_resource_reference(&bound, NULL);
+
+      submit();
+
+      /* The GPU lags a command stream behind, and stalls while the
+       * buffer is unbound so that its last use is still pending when the
+       * upload manager sees it unreferenced.
+       */
+      if (frame < 11 || frame > 15)
+         completed = submitted - 1;
+   }
+
+   u_upload_get_stats(upload, &stats);
+   pipe_resource_reference(&buf, NULL);
+   u_upload_destroy(upload);
+
+   if (!stats.buffers_reused) {
+      printf("No buffer was reused.\n");
+      fails++;
+   }
+   if (num_resources) {
+      printf("%u buffers were leaked.\n", num_resources);
+      fails++;
+   }
+
+   if (fails) {
+      printf("Failure!\n");
+      return 1;
+   }
+
+   printf("Success! %" PRIu64 " buffers allocated, %" PRIu64 " reused.\n",
+          stats.buffers_allocated, stats.buffers_reused);
+   return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check that u_vbuf reuses the vertices it translated from a real buffer
+ * while the buffer doesn't change, and never draws stale vertices.
+ *
+ * softpipe is told that it can't fetch R16G16B16A16_FLOAT, so u_vbuf
+ * translates it to R32G32B32A32_FLOAT.  The draws don't reach softpipe:
+ * they compare the bound vertices with the buffer contents instead.  A
+ * draw binding the same buffer at the same offset as the previous one
+ * reused its translation, the uploader would have moved on.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+#include "util/half_float.h"
+#include "util/u_inlines.h"
+#include "util/u_vbuf.h"
+
+#define NUM_VERTS 1000
+/* U_VBUF_TRANSLATION_MAX_MISSES in u_vbuf.c */
+#define MAX_MISSES 8
+
+static struct pipe_context *ctx;
+static struct u_vbuf *mgr;
+
+static int (*sp_get_param)(struct pipe_screen *, enum pipe_cap);
+static void (*sp_set_vertex_buffers)(struct pipe_context *, unsigned,
+                                     unsigned, unsigned, bool,
+                                     const struct pipe_vertex_buffer *);
+
+/* The source vertices as the driver should fetch them. */
+static float expected[NUM_VERTS][4];
+
+/* What the last draw fetched from. */
+static struct pipe_resource *bound;
+static unsigned bound_offset, bound_stride;
+static unsigned fails;
+
+static int
+get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   if (param == PIPE_CAP_SIGNED_VERTEX_BUFFER_OFFSET)
+      return 1;
+   return sp_get_param(screen, param);
+}
+
+static void
+set_vertex_buffers(struct pipe_context *pipe, unsigned start_slot,
+                   unsigned count, unsigned unbind_num_trailing_slots,
+                   bool take_ownership,
+                   const struct pipe_vertex_buffer *buffers)
+{
+   /* Keep a reference, so that a new buffer can't get the same address. */
+   if (start_slot == 0 && count && buffers) {
+      pipe_resource_reference(&bound, buffers[0].buffer.resource);
+      bound_offset = buffers[0].buffer_offset;
+      bound_stride = buffers[0].stride;
+   }
+   sp_set_vertex_buffers(pipe, start_slot, count, unbind_num_trailing_slots,
+                         take_ownership, buffers);
+}
+
+static void
+draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
+         const struct pipe_draw_indirect_info *indirect,
+         const struct pipe_draw_start_count *draws, unsigned num_draws)
+{
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   /* Wraps around to the right place for negative buffer offsets. */
+   const unsigned offset = bound_offset + draws[0].start * bound_stride;
+
+   if (!bound || bound_stride != sizeof(expected[0])) {
+      printf("The translated vertices weren't bound.\n");
+      fails++;
+      return;
+   }
+
+   map = pipe_buffer_map(pipe, bound, PIPE_MAP_READ, &transfer);
+   if (memcmp(map + offset, expected[draws[0].start],
+              draws[0].count * sizeof(expected[0]))) {
+      printf("Vertices %u to %u are stale.\n", draws[0].start,
+             draws[0].start + draws[0].count - 1);
+      fails++;
+   }
+   pipe_buffer_unmap(pipe, transfer);
+}
+
+/* Write new half-float vertices to the whole buffer, or to one vertex. */
+static void
+write_vertices(struct pipe_resource *buf, unsigned first, unsigned count,
+               unsigned seed)
+{
+   uint16_t half[NUM_VERTS][4];
+
+   for (unsigned i = first; i < first + count; i++) {
+      for (unsigned c = 0; c < 4; c++) {
+         half[i][c] = _mesa_float_to_half((i * 4 + c + seed * 7) / 64.0f);
+         expected[i][c] = _mesa_half_to_float(half[i][c]);
+      }
+   }
+   ctx->buffer_subdata(ctx, buf, 0, first * sizeof(half[0]),
+                       count * sizeof(half[0]), half[first]);
+}
+
+static void
+bind_buffer(struct pipe_resource *buf)
+{
+   struct pipe_vertex_buffer vb = {
+      .stride = 8,
+      .buffer.resource = buf,
+   };
+
+   u_vbuf_set_vertex_buffers(mgr, 0, 1, 0, false, &vb);
+}
+
+/* Draw, and return whether the vertices of the previous draw were reused. */
+static bool
+draw(unsigned start, unsigned count)
+{
+   struct pipe_resource *prev = NULL;
+   unsigned prev_offset = bound_offset;
+   struct pipe_draw_info info = {
+      .mode = PIPE_PRIM_POINTS,
+      .instance_count = 1,
+      .max_index = ~0,
+   };
+   struct pipe_draw_start_count sc = {
+      .start = start,
+      .count = count,
+   };
+   bool reused;
+
+   pipe_resource_reference(&prev, bound);
+   u_vbuf_draw_vbo(mgr, &info, NULL, sc);
+   reused = prev == bound && prev_offset == bound_offset;
+   pipe_resource_reference(&prev, NULL);
+   return reused;
+}
+
+static void
+check(bool ok, const char *what)
+{
+   if (!ok) {
+      printf("%s\n", what);
+      fails++;
+   }
+}
+
+static struct pipe_resource *
+create_buffer(void)
+{
+   return pipe_buffer_create(ctx->screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT, NUM_VERTS * 8);
+}
+
+/* The first draw uploads, the second keeps the translation. */
+static void
+test_reuse(void)
+{
+   struct pipe_resource *buf = create_buffer();
+
+   write_vertices(buf, 0, NUM_VERTS, 0);
+   bind_buffer(buf);
+   draw(0, NUM_VERTS);
+   check(!draw(0, NUM_VERTS), "The second draw reused the upload.");
+   check(draw(0, NUM_VERTS), "The third draw translated again.");
+   check(draw(0, NUM_VERTS), "The fourth draw translated again.");
+
+   /* Change a single vertex. */
+   write_vertices(buf, 500, 1, 1);
+   check(!draw(0, NUM_VERTS), "buffer_subdata didn't invalidate.");
+   check(!draw(0, NUM_VERTS), "The second draw reused the upload.");
+   check(draw(0, NUM_VERTS), "The rewritten vertices weren't kept.");
+
+   pipe_resource_reference(&buf, NULL);
+}
+
+/* A buffer rewritten before every draw stops being hashed after
+ * MAX_MISSES draws, and keeps going through the uploader after that even
+ * if it stops changing.
+ */
+static void
+test_streaming(unsigned num_changes)
+{
+   struct pipe_resource *buf = create_buffer();
+   bool cached = num_changes < MAX_MISSES;
+
+   bind_buffer(buf);
+   for (unsigned i = 0; i < num_changes; i++) {
+      write_vertices(buf, 0, NUM_VERTS, i);
+      check(!draw(0, NUM_VERTS), "A streaming draw reused its vertices.");
+   }
+
+   check(!draw(0, NUM_VERTS), "The first static draw reused its vertices.");
+   for (unsigned i = 0; i < 3; i++) {
+      if (draw(0, NUM_VERTS) != cached) {
+         printf("After %u changes, a static draw %s.\n", num_changes,
+                cached ? "translated again" : "was cached");
+         fails++;
+      }
+   }
+
+   pipe_resource_reference(&buf, NULL);
+}
+
+/* With signed buffer offsets, draws starting at another vertex are cached
+ * too, and the translation is bound before the start of its buffer.
+ */
+static void
+test_start_vertex(void)
+{
+   struct pipe_resource *buf = create_buffer();
+
+   write_vertices(buf, 0, NUM_VERTS, 2);
+   bind_buffer(buf);
+   for (unsigned i = 0; i < 2; i++) {
+      draw(100, 500);
+      draw(100, 500);
+      check(draw(100, 500), "The draw at vertex 100 translated again.");
+      check((int)bound_offset < 0, "The translation isn't a negative offset.");
+
+      /* Another range of the same buffer is another translation. */
+      draw(0, 500);
+      draw(0, 500);
+      check(draw(0, 500), "The draw at vertex 0 translated again.");
+
+      write_vertices(buf, 0, NUM_VERTS, 3);
+   }
+
+   pipe_resource_reference(&buf, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen *screen = softpipe_create_screen(null_sw_create());
+   struct u_vbuf_caps caps;
+   struct cso_velems_state velems = {
+      .count = 1,
+      .velems[0].src_format = PIPE_FORMAT_R16G16B16A16_FLOAT,
+   };
+
+   sp_get_param = screen->get_param;
+   screen->get_param = get_param;
+   ctx = screen->context_create(screen, NULL, 0);
+   sp_set_vertex_buffers = ctx->set_vertex_buffers;
+   ctx->set_vertex_buffers = set_vertex_buffers;
+   ctx->draw_vbo = draw_vbo;
+
+   u_vbuf_get_caps(screen, &caps, false);
+   caps.format_translation[PIPE_FORMAT_R16G16B16A16_FLOAT] =
+      PIPE_FORMAT_R32G32B32A32_FLOAT;
+   mgr = u_vbuf_create(ctx, &caps);
+   u_vbuf_set_vertex_elements(mgr, &velems);
+
+   test_reuse();
+   test_streaming(MAX_MISSES - 1);
+   test_streaming(MAX_MISSES);
+   test_start_vertex();
+
+   u_vbuf_destroy(mgr);
+   pipe_resource_reference(&bound, NULL);
+   ctx->destroy(ctx);
+   screen->destroy(screen);
+
+   if (fails) {
+      printf("Failure!\n");
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/sse_minmax.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+/* 256-bit versions of the SSE4.1 index kernels in sse_minmax.c, with the
+ * same restart masking.  Whatever is left after the last full vector goes
+ * to the SSE4.1 kernel, which is always there when AVX2 is.
+ */
+#define DEFINE_INDEX_MIN_MAX_AVX2(name, sse_name, type, lanes, min_op,      \
+                                  max_op, cmpeq_op, set1_op)                \
+void                                                                        \
+name(const type *indices, bool restart, unsigned restart_index,             \
+     unsigned *min_index, unsigned *max_index, const unsigned count)        \
+{                                                                           \
+   unsigned max_val = 0;                                                    \
+   unsigned min_val = ~0U;                                                  \
+   unsigned i = 0;                                                          \
+                                                                            \
+   /* A restart index that doesn't fit the index type never matches. */     \
+   if ((type)restart_index != restart_index)                                \
+      restart = false;                                                      \
+                                                                            \
+   if (count >= 2 * (lanes)) {                                              \
+      const unsigned vec_count = count & ~((lanes) - 1);                    \
+      const __m256i ones = _mm256_set1_epi32(~0);                           \
+      __m256i vmax = _mm256_setzero_si256();                                \
+      __m256i vmin = ones;                                                  \
+      __m256i seen;                                                         \
+      type max_arr[lanes], min_arr[lanes];                                  \
+                                                                            \
+      if (restart) {                                                        \
+         const __m256i restart_vec = set1_op((type)restart_index);          \
+         seen = _mm256_setzero_si256();                                     \
+         for (; i < vec_count; i += (lanes)) {                              \
+            __m256i v = _mm256_loadu_si256((const __m256i *)&indices[i]);   \
+            __m256i eq = cmpeq_op(v, restart_vec);                          \
+            seen = _mm256_or_si256(seen, _mm256_andnot_si256(eq, ones));    \
+            vmax = max_op(vmax, _mm256_andnot_si256(eq, v));                \
+            vmin = min_op(vmin, _mm256_or_si256(eq, v));                    \
+         }                                                                  \
+      } else {                                                              \
+         seen = ones;                                                       \
+         for (; i < vec_count; i += (lanes)) {                              \
+            __m256i v = _mm256_loadu_si256((const __m256i *)&indices[i]);   \
+            vmax = max_op(vmax, v);                                         \
+            vmin = min_op(vmin, v);                                         \
+         }                                                                  \
+      }                                                                     \
+                                                                            \
+      if (_mm256_movemask_epi8(seen)) {                                     \
+         _mm256_storeu_si256((__m256i *)max_arr, vmax);                     \
+         _mm256_storeu_si256((__m256i *)min_arr, vmin);                     \
+         for (unsigned j = 0; j < (lanes); j++) {                           \
+            if (max_arr[j] > max_val)                                       \
+               max_val = max_arr[j];                                        \
+            if (min_arr[j] < min_val)                                       \
+               min_val = min_arr[j];                                        \
+         }                                                                  \
+      }                                                                     \
+   }                                                                        \
+                                                                            \
+   if (i < count) {                                                         \
+      unsigned tail_min, tail_max;                                          \
+                                                                            \
+      sse_name(indices + i, restart, restart_index, &tail_min, &tail_max,   \
+               count - i);                                                  \
+      if (tail_max > max_val)                                               \
+         max_val = tail_max;                                                \
+      if (tail_min < min_val)                                               \
+         min_val = tail_min;                                                \
+   }                                                                        \
+                                                                            \
+   *min_index = min_val;                                                    \
+   *max_index = max_val;                                                    \
+}
+
+DEFINE_INDEX_MIN_MAX_AVX2(_mesa_ubyte_index_min_max_avx2,
+                          _mesa_ubyte_index_min_max, uint8_t, 32,
+                          _mm256_min_epu8, _mm256_max_epu8,
+                          _mm256_cmpeq_epi8, _mm256_set1_epi8)
+DEFINE_INDEX_MIN_MAX_AVX2(_mesa_ushort_index_min_max_avx2,
+                          _mesa_ushort_index_min_max, uint16_t, 16,
+                          _mm256_min_epu16, _mm256_max_epu16,
+                          _mm256_cmpeq_epi16, _mm256_set1_epi16)
+DEFINE_INDEX_MIN_MAX_AVX2(_mesa_uint_index_min_max_avx2,
+                          _mesa_uint_index_min_max, uint32_t, 8,
+                          _mm256_min_epu32, _mm256_max_epu32,
+                          _mm256_cmpeq_epi32, _mm256_set1_epi32)
@@ -2007,7 +2007,7 @@ buffer_storage(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    bufObj->Written = GL_TRUE;
    bufObj->Immutable = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(bufObj, 0, -1);
 
    if (memObj) {
       assert(ctx->Driver.BufferDataMem);
@@ -2254,7 +2254,7 @@ buffer_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, 0, 0);
 
    bufObj->Written = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(bufObj, 0, -1);
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -2443,7 +2443,7 @@ _mesa_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    bufObj->NumSubDataCalls++;
    bufObj->Written = GL_TRUE;
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(bufObj, offset, size);
 
    assert(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData(ctx, offset, size, data, bufObj);
@@ -2652,7 +2652,7 @@ clear_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    if (size == 0)
       return;
 
-   bufObj->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(bufObj, offset, size);
 
    if (data == NULL) {
       /* clear to zeros, per the spec */
@@ -3260,7 +3260,7 @@ copy_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *src,
       }
    }
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(dst, writeOffset, size);
 
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
@@ -3278,7 +3278,7 @@ _mesa_CopyBufferSubData_no_error(GLenum readTarget, GLenum writeTarget,
    struct gl_buffer_object **dst_ptr = get_buffer_target(ctx, writeTarget);
    struct gl_buffer_object *dst = *dst_ptr;
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(dst, writeOffset, size);
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset,
                                  size);
 }
@@ -3339,7 +3339,7 @@ _mesa_CopyNamedBufferSubData_no_error(GLuint readBuffer, GLuint writeBuffer,
    struct gl_buffer_object *src = _mesa_lookup_bufferobj(ctx, readBuffer);
    struct gl_buffer_object *dst = _mesa_lookup_bufferobj(ctx, writeBuffer);
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(dst, writeOffset, size);
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset,
                                  size);
 }
@@ -3399,7 +3399,7 @@ _mesa_InternalBufferSubDataCopyMESA(GLintptr srcBuffer, GLuint srcOffset,
    if (!validate_buffer_sub_data(ctx, dst, dstOffset, size, func))
       goto done; /* the error is already set */
 
-   dst->MinMaxCacheDirty = true;
+   _mesa_bufferobj_invalidate_minmax_cache(dst, dstOffset, size);
    ctx->Driver.CopyBufferSubData(ctx, src, dst, srcOffset, dstOffset, size);
 
 done:
@@ -3573,7 +3573,7 @@ map_buffer_range(struct gl_context *ctx, struct gl_buffer_object *bufObj,
 
    if (access & GL_MAP_WRITE_BIT) {
       bufObj->Written = GL_TRUE;
-      bufObj->MinMaxCacheDirty = true;
+      _mesa_bufferobj_invalidate_minmax_cache(bufObj, offset, length);
    }
 
 #ifdef VBO_DEBUG
@@ -134,6 +134,34 @@ _mesa_reference_buffer_object_shared(struct gl_context *ctx,
       _mesa_reference_buffer_object_(ctx, ptr, bufObj, true);
 }
 
+/**
+ * Mark a byte range of the buffer as written so that cached min/max index
+ * values covering it get recomputed.  Pass size = -1 for the whole buffer.
+ *
+ * Most buffers never get a cache, so check that without the mutex first.
+ */
+static inline void
+_mesa_bufferobj_invalidate_minmax_cache(struct gl_buffer_object *bufObj,
+                                        GLintptr offset, GLsizeiptr size)
+{
+   GLintptr end = size < 0 ? INTPTR_MAX : offset + size;
+
+   if (!p_atomic_read(&bufObj->MinMaxCache))
+      return;
+
+   simple_mtx_lock(&bufObj->MinMaxCacheMutex);
+   if (!bufObj->MinMaxCacheDirty) {
+      bufObj->MinMaxCacheDirtyStart = offset;
+      bufObj->MinMaxCacheDirtyEnd = end;
+      bufObj->MinMaxCacheDirty = true;
+   } else {
+      bufObj->MinMaxCacheDirtyStart = MIN2(bufObj->MinMaxCacheDirtyStart,
+                                           offset);
+      bufObj->MinMaxCacheDirtyEnd = MAX2(bufObj->MinMaxCacheDirtyEnd, end);
+   }
+   simple_mtx_unlock(&bufObj->MinMaxCacheMutex);
+}
+
 extern GLuint
 _mesa_total_buffer_object_memory(struct gl_context *ctx);
 
@@ -1356,6 +1356,10 @@ _mesa_free_context_data(struct gl_context *ctx, bool destroy_debug_output)
    _mesa_free_pipeline_data(ctx);
    _mesa_free_program_data(ctx);
    _mesa_free_shader_state(ctx);
+
+   if (util_queue_is_initialized(&ctx->MipmapQueue))
+      util_queue_destroy(&ctx->MipmapQueue);
+
    _mesa_free_queryobj_data(ctx);
    _mesa_free_sync_data(ctx);
    _mesa_free_varray_data(ctx);
@@ -1573,6 +1577,9 @@ check_init_viewport(struct gl_context *ctx, GLuint width, GLuint height)
        */
       ctx->ViewportInitialized = GL_TRUE;
 
+      /* glthread doesn't know the size of the drawable. */
+      ctx->GLThread.ViewportKnown = false;
+
       /* Note: ctx->Const.MaxViewports may not have been set by the driver
        * yet, so just initialize all of them.
        */
@@ -28,6 +28,7 @@
 #include <assert.h>
 
 #include "main/cpuinfo.h"
+#include "util/u_cpu_detect.h"
 
 
 /**
@@ -40,6 +41,8 @@ _mesa_get_cpu_features(void)
 #if defined USE_X86_ASM || defined USE_X86_64_ASM
    _mesa_get_x86_features();
 #endif
+   /* For the kernels that check util_cpu_caps, like the AVX2 ones. */
+   util_cpu_detect();
 }
 
 
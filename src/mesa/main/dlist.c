@@ -1618,6 +1618,7 @@ dlist_alloc(struct gl_context *ctx, OpCode opcode, GLuint bytes, bool align8)
    ctx->ListState.CurrentPos += nopNode + numNodes;
 
    n[0].opcode = opcode;
+   ctx->ListState.LastInstruction = n;
 
    return n;
 }
@@ -1705,6 +1706,23 @@ alloc_instruction(struct gl_context *ctx, OpCode opcode, GLuint nparams)
 }
 
 
+/**
+ * Return the last instruction of the list if it is \p opcode and sets the
+ * same vertex attribute.  Nothing can observe the value it stored before
+ * the next command, so the caller may overwrite it instead of allocating a
+ * new instruction.
+ */
+static inline Node *
+last_attr_instruction(struct gl_context *ctx, OpCode opcode, unsigned attr)
+{
+   Node *n = ctx->ListState.LastInstruction;
+
+   if (n && n[0].opcode == opcode && n[1].ui == attr)
+      return n;
+   return NULL;
+}
+
+
 /**
  * Called by EndList to try to reduce memory used for the list.
  */
@@ -2098,7 +2116,7 @@ save_MultiDrawElementsIndirect(UNUSED GLenum mode,
  * when we start compiling a list, or after glCallList(s)).
  */
 static void
-invalidate_saved_current_state(struct gl_context *ctx)
+invalidate_saved_attrib_state(struct gl_context *ctx)
 {
    GLint i;
 
@@ -2109,11 +2127,31 @@ invalidate_saved_current_state(struct gl_context *ctx)
       ctx->ListState.ActiveMaterialSize[i] = 0;
 
    memset(&ctx->ListState.Current, 0, sizeof ctx->ListState.Current);
+}
+
+
+static void
+invalidate_saved_current_state(struct gl_context *ctx)
+{
+   invalidate_saved_attrib_state(ctx);
 
    ctx->Driver.CurrentSavePrimitive = PRIM_UNKNOWN;
 }
 
 
+/**
+ * Evaluators feed the evaluated color, normal, texcoords and index through
+ * the same vertex state as glColor and friends (and through
+ * GL_COLOR_MATERIAL to the materials), so don't assume that the cached
+ * values survive them.
+ */
+static void
+invalidate_saved_eval_state(struct gl_context *ctx)
+{
+   invalidate_saved_attrib_state(ctx);
+}
+
+
 static void GLAPIENTRY
 save_CallList(GLuint list)
 {
@@ -2475,6 +2513,12 @@ save_ColorMaterial(GLenum face, GLenum mode)
       n[1].e = face;
       n[2].e = mode;
    }
+
+   /* With GL_COLOR_MATERIAL enabled, this copies the current color into
+    * the material, so the cached materials no longer match.
+    */
+   invalidate_saved_attrib_state(ctx);
+
    if (ctx->ExecuteFlag) {
       CALL_ColorMaterial(ctx->Exec, (face, mode));
    }
@@ -2818,6 +2862,7 @@ save_EvalMesh1(GLenum mode, GLint i1, GLint i2)
       n[2].i = i1;
       n[3].i = i2;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalMesh1(ctx->Exec, (mode, i1, i2));
    }
@@ -2838,6 +2883,7 @@ save_EvalMesh2(GLenum mode, GLint i1, GLint i2, GLint j1, GLint j2)
       n[4].i = j1;
       n[5].i = j2;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalMesh2(ctx->Exec, (mode, i1, i2, j1, j2));
    }
@@ -3837,6 +3883,12 @@ save_PopAttrib(void)
    GET_CURRENT_CONTEXT(ctx);
    ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
    (void) alloc_instruction(ctx, OPCODE_POP_ATTRIB, 0);
+
+   /* The popped state may include current values, materials and the
+    * shade model, so the cached values no longer match.
+    */
+   invalidate_saved_attrib_state(ctx);
+
    if (ctx->ExecuteFlag) {
       CALL_PopAttrib(ctx->Exec, ());
    }
@@ -5855,6 +5907,7 @@ save_EvalCoord1f(GLfloat x)
    if (n) {
       n[1].f = x;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalCoord1f(ctx->Exec, (x));
    }
@@ -5877,6 +5930,7 @@ save_EvalCoord2f(GLfloat x, GLfloat y)
       n[1].f = x;
       n[2].f = y;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalCoord2f(ctx->Exec, (x, y));
    }
@@ -5899,6 +5953,7 @@ save_EvalPoint1(GLint x)
    if (n) {
       n[1].i = x;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalPoint1(ctx->Exec, (x));
    }
@@ -5915,6 +5970,7 @@ save_EvalPoint2(GLint x, GLint y)
       n[1].i = x;
       n[2].i = y;
    }
+   invalidate_saved_eval_state(ctx);
    if (ctx->ExecuteFlag) {
       CALL_EvalPoint2(ctx->Exec, (x, y));
    }
@@ -6003,6 +6059,11 @@ save_Materialfv(GLenum face, GLenum pname, const GLfloat * param)
 
    SAVE_FLUSH_VERTICES(ctx);
 
+   /* With GL_COLOR_MATERIAL enabled, a glColor after this overwrites the
+    * material again even if it sets the cached color.
+    */
+   ctx->ListState.ActiveAttribSize[VERT_ATTRIB_COLOR0] = 0;
+
    n = alloc_instruction(ctx, OPCODE_MATERIAL, 6);
    if (n) {
       n[1].e = face;
@@ -6294,7 +6355,22 @@ save_Attr32bit(struct gl_context *ctx, unsigned attr, unsigned size,
       attr -= VERT_ATTRIB_GENERIC0;
    }
 
-   n = alloc_instruction(ctx, base_op + size - 1, 1 + size);
+   /* Try to eliminate redundant state changes of the fixed-function
+    * attributes (glColor, glNormal, ...), which are always floats.  Like
+    * for materials, the size doesn't matter because the current value
+    * always holds all 4 components.
+    */
+   if (index != VERT_ATTRIB_POS && index < VERT_ATTRIB_GENERIC0 &&
+       ctx->ListState.ActiveAttribSize[index] &&
+       ctx->ListState.CurrentAttrib[index][0] == x &&
+       ctx->ListState.CurrentAttrib[index][1] == y &&
+       ctx->ListState.CurrentAttrib[index][2] == z &&
+       ctx->ListState.CurrentAttrib[index][3] == w)
+      goto execute;
+
+   n = last_attr_instruction(ctx, base_op + size - 1, attr);
+   if (!n)
+      n = alloc_instruction(ctx, base_op + size - 1, 1 + size);
    if (n) {
       n[1].ui = attr;
       n[2].ui = x;
@@ -6306,6 +6382,14 @@ save_Attr32bit(struct gl_context *ctx, unsigned attr, unsigned size,
    ctx->ListState.ActiveAttribSize[index] = size;
    ASSIGN_4V(ctx->ListState.CurrentAttrib[index], x, y, z, w);
 
+   /* With GL_COLOR_MATERIAL enabled, the color is also copied into the
+    * materials, so the cached materials may not match anymore.
+    */
+   if (index == VERT_ATTRIB_COLOR0)
+      memset(ctx->ListState.ActiveMaterialSize, 0,
+             sizeof(ctx->ListState.ActiveMaterialSize));
+
+execute:
    if (ctx->ExecuteFlag) {
       if (type == GL_FLOAT) {
          if (base_op == OPCODE_ATTR_1F_NV) {
@@ -6357,7 +6441,9 @@ save_Attr64bit(struct gl_context *ctx, unsigned attr, unsigned size,
    }
 
    attr -= VERT_ATTRIB_GENERIC0;
-   n = alloc_instruction(ctx, base_op + size - 1, 1 + size * 2);
+   n = last_attr_instruction(ctx, base_op + size - 1, attr);
+   if (!n)
+      n = alloc_instruction(ctx, base_op + size - 1, 1 + size * 2);
    if (n) {
       n[1].ui = attr;
       ASSIGN_UINT64_TO_NODES(n, 2, x);
@@ -13634,6 +13720,7 @@ _mesa_NewList(GLuint name, GLenum mode)
    ctx->ListState.CurrentList = make_list(name, BLOCK_SIZE);
    ctx->ListState.CurrentBlock = ctx->ListState.CurrentList->Head;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.LastInstruction = NULL;
 
    vbo_save_NewList(ctx, name, mode);
 
@@ -13693,6 +13780,7 @@ _mesa_EndList(void)
    ctx->ListState.CurrentList = NULL;
    ctx->ListState.CurrentBlock = NULL;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.LastInstruction = NULL;
    ctx->ExecuteFlag = GL_TRUE;
    ctx->CompileFlag = GL_FALSE;
 
@@ -14943,6 +15031,25 @@ _mesa_glthread_execute_list(struct gl_context *ctx, GLuint list)
          case OPCODE_ENABLE:
             _mesa_glthread_Enable(ctx, n[1].e);
             break;
+         /* save_EnableIndexed stores the target in n[1], see glEnablei. */
+         case OPCODE_DISABLE_INDEXED:
+            _mesa_glthread_Enablei(ctx, n[1].e, n[2].ui, false);
+            break;
+         case OPCODE_ENABLE_INDEXED:
+            _mesa_glthread_Enablei(ctx, n[1].e, n[2].ui, true);
+            break;
+         case OPCODE_VIEWPORT:
+            _mesa_glthread_Viewport(ctx, n[1].i, n[2].i, n[3].i, n[4].i);
+            break;
+         case OPCODE_VIEWPORT_INDEXED_F:
+         case OPCODE_VIEWPORT_INDEXED_FV:
+            _mesa_glthread_ViewportIndexedf(ctx, n[1].ui, n[2].f, n[3].f,
+                                            n[4].f, n[5].f);
+            break;
+         case OPCODE_VIEWPORT_ARRAY_V:
+            _mesa_glthread_ViewportArrayv(ctx, n[1].ui, n[2].si,
+                                          get_pointer(&n[3]));
+            break;
          case OPCODE_LIST_BASE:
             _mesa_glthread_ListBase(ctx, n[1].ui);
             break;
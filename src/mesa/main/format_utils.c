@@ -29,6 +29,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "main/sse_swizzle.h"
+#include "x86/common_x86_asm.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(MESA_ARRAY_FORMAT_BASE_FORMAT_RGBA_VARIANTS,
@@ -202,6 +204,27 @@ convert_ubyte_rgba_to_bgra(size_t width, size_t height,
 {
    int row;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      static const uint8_t swap_rb[4] = { 2, 1, 0, 3 };
+
+      for (row = 0; row < height; row++) {
+         const GLuint *s = (const GLuint *) src;
+         GLuint *d = (GLuint *) dst;
+         int i = _mesa_swizzle_ubyte_sse41(dst, 4, src, 4, swap_rb, 0xff,
+                                           width);
+         for (; i < width; i++) {
+            d[i] = ( (s[i] & 0xff00ff00) |
+                    ((s[i] &       0xff) << 16) |
+                    ((s[i] &   0xff0000) >> 16));
+         }
+         src += src_stride;
+         dst += dst_stride;
+      }
+      return;
+   }
+#endif
+
    if (sizeof(void *) == 8 &&
        src_stride % 8 == 0 &&
        dst_stride % 8 == 0 &&
@@ -1540,6 +1563,23 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1 &&
+       src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE &&
+       dst_type == MESA_ARRAY_FORMAT_TYPE_UBYTE) {
+      int done = _mesa_swizzle_ubyte_sse41(void_dst, num_dst_channels,
+                                           void_src, num_src_channels,
+                                           swizzle, normalized ? UINT8_MAX : 1,
+                                           count);
+      if (done == count)
+         return;
+
+      void_dst = (uint8_t *) void_dst + done * num_dst_channels;
+      void_src = (const uint8_t *) void_src + done * num_src_channels;
+      count -= done;
+   }
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
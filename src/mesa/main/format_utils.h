@@ -38,6 +38,10 @@
 #include "util/half_float.h"
 #include "util/format/format_utils.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 extern const mesa_array_format RGBA32_FLOAT;
 extern const mesa_array_format RGBA8_UBYTE;
 extern const mesa_array_format RGBA32_UINT;
@@ -64,4 +68,8 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
                      void *void_src, uint32_t src_format, size_t src_stride,
                      size_t width, size_t height, uint8_t *rebase_swizzle);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
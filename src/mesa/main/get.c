@@ -1525,37 +1525,26 @@ static const struct value_desc error_value =
    { 0, 0, TYPE_INVALID, NO_OFFSET, NO_EXTRA };
 
 /**
- * Find the struct value_desc corresponding to the enum 'pname'.
+ * Find the index in the 'values' array corresponding to the enum 'pname'.
  *
  * We hash the enum value to get an index into the 'table' array,
  * which holds the index in the 'values' array of struct value_desc.
- * Once we've found the entry, we do the extra checks, if any, then
- * look up the value and return a pointer to it.
- *
- * If the value has to be computed (for example, it's the result of a
- * function call or we need to add 1 to it), we use the tmp 'v' to
- * store the result.
+ * Once we've found the entry, we do the extra checks, if any.
  *
  * \param func name of glGet*v() func for error reporting
  * \param pname the enum value we're looking up
- * \param p is were we return the pointer to the value
- * \param v a tmp union value variable in the calling glGet*v() function
  *
- * \return the struct value_desc corresponding to the enum or a struct
- *     value_desc of TYPE_INVALID if not found.  This lets the calling
- *     glGet*v() function jump right into a switch statement and
- *     handle errors there instead of having to check for NULL.
+ * \return the index of the struct value_desc corresponding to the enum,
+ *     or 0 (the invalid first entry of 'values') if not found or if the
+ *     extra checks failed.
  */
-static const struct value_desc *
-find_value(const char *func, GLenum pname, void **p, union value *v)
+static unsigned
+find_value_index(struct gl_context *ctx, const char *func, GLenum pname)
 {
-   GET_CURRENT_CONTEXT(ctx);
    int mask, hash;
    const struct value_desc *d;
    int api;
 
-   *p = NULL;
-
    api = ctx->API;
    /* We index into the table_set[] list of per-API hash tables using the API's
     * value in the gl_api enum. Since GLES 3 doesn't have an API_OPENGL* enum
@@ -1582,17 +1571,46 @@ find_value(const char *func, GLenum pname, void **p, union value *v)
       if (unlikely(idx == 0)) {
          _mesa_error(ctx, GL_INVALID_ENUM, "%s(pname=%s)", func,
                _mesa_enum_to_string(pname));
-         return &error_value;
+         return 0;
       }
 
       d = &values[idx];
-      if (likely(d->pname == pname))
-         break;
+      if (likely(d->pname == pname)) {
+         if (unlikely(d->extra && !check_extra(ctx, func, d)))
+            return 0;
+         return idx;
+      }
 
       hash += prime_step;
    }
+}
 
-   if (unlikely(d->extra && !check_extra(ctx, func, d)))
+/**
+ * Look up the value described by values[idx].
+ *
+ * If the value has to be computed (for example, it's the result of a
+ * function call or we need to add 1 to it), we use the tmp 'v' to
+ * store the result.
+ *
+ * \param func name of glGet*v() func for error reporting
+ * \param idx the index returned by find_value_index()
+ * \param p is were we return the pointer to the value
+ * \param v a tmp union value variable in the calling glGet*v() function
+ *
+ * \return the struct value_desc corresponding to the enum or a struct
+ *     value_desc of TYPE_INVALID if not found.  This lets the calling
+ *     glGet*v() function jump right into a switch statement and
+ *     handle errors there instead of having to check for NULL.
+ */
+static const struct value_desc *
+find_value_location(struct gl_context *ctx, const char *func, unsigned idx,
+                    void **p, union value *v)
+{
+   const struct value_desc *d = &values[idx];
+
+   *p = NULL;
+
+   if (idx == 0)
       return &error_value;
 
    switch (d->location) {
@@ -1612,7 +1630,7 @@ find_value(const char *func, GLenum pname, void **p, union value *v)
          return d;
       }
       _mesa_error(ctx, GL_INVALID_VALUE, "%s(pname=%s,unit=%d)", func,
-                  _mesa_enum_to_string(pname),
+                  _mesa_enum_to_string(d->pname),
                   ctx->Texture.CurrentUnit);
       return &error_value;
    case LOC_CUSTOM:
@@ -1628,6 +1646,19 @@ find_value(const char *func, GLenum pname, void **p, union value *v)
    return &error_value;
 }
 
+/**
+ * Find the struct value_desc corresponding to the enum 'pname' and look up
+ * its value, see find_value_index() and find_value_location().
+ */
+static const struct value_desc *
+find_value(const char *func, GLenum pname, void **p, union value *v)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   return find_value_location(ctx, func, find_value_index(ctx, func, pname),
+                              p, v);
+}
+
 static const int transpose[] = {
    0, 4,  8, 12,
    1, 5,  9, 13,
@@ -1717,7 +1748,14 @@ _mesa_GetBooleanv(GLenum pname, GLboolean *params)
    int shift, i;
    void *p;
 
-   d = find_value("glGetBooleanv", pname, &p, &v);
+   GET_CURRENT_CONTEXT(ctx);
+   unsigned idx = find_value_index(ctx, "glGetBooleanv", pname);
+
+   /* Plain context fields and constants are converted by generated code. */
+   if (get_booleanv_fast(ctx, idx, params))
+      return;
+
+   d = find_value_location(ctx, "glGetBooleanv", idx, &p, &v);
    switch (d->type) {
    case TYPE_INVALID:
       break;
@@ -1834,7 +1872,14 @@ _mesa_GetFloatv(GLenum pname, GLfloat *params)
    int shift, i;
    void *p;
 
-   d = find_value("glGetFloatv", pname, &p, &v);
+   GET_CURRENT_CONTEXT(ctx);
+   unsigned idx = find_value_index(ctx, "glGetFloatv", pname);
+
+   /* Plain context fields and constants are converted by generated code. */
+   if (get_floatv_fast(ctx, idx, params))
+      return;
+
+   d = find_value_location(ctx, "glGetFloatv", idx, &p, &v);
    switch (d->type) {
    case TYPE_INVALID:
       break;
@@ -1960,7 +2005,14 @@ _mesa_GetIntegerv(GLenum pname, GLint *params)
    int shift, i;
    void *p;
 
-   d = find_value("glGetIntegerv", pname, &p, &v);
+   GET_CURRENT_CONTEXT(ctx);
+   unsigned idx = find_value_index(ctx, "glGetIntegerv", pname);
+
+   /* Plain context fields and constants are converted by generated code. */
+   if (get_integerv_fast(ctx, idx, params))
+      return;
+
+   d = find_value_location(ctx, "glGetIntegerv", idx, &p, &v);
    switch (d->type) {
    case TYPE_INVALID:
       break;
@@ -30,7 +30,7 @@
 
 from __future__ import print_function
 
-import os, sys, getopt
+import os, re, sys, getopt
 from collections import defaultdict
 import get_hash_params
 
@@ -58,6 +58,86 @@ def print_params(params):
 
    print("};\n")
 
+# Descriptors of plain scalar context fields and constants get a direct
+# accessor per glGet variant, so the type conversion is chosen here instead
+# of by the run-time type switch in get.c. The value is still read through
+# a pointer of the descriptor's type, exactly like the generic path does.
+fast_field_types = {
+   "CONTEXT_INT": ("GLint", "int"),
+   "CONTEXT_UINT": ("GLuint", "uint"),
+   "CONTEXT_ENUM": ("GLint", "int"),
+   "CONTEXT_ENUM16": ("GLenum16", "int"),
+   "CONTEXT_INT64": ("GLint64", "int64"),
+   "CONTEXT_BOOL": ("GLboolean", "bool"),
+   "CONTEXT_FLOAT": ("GLfloat", "float"),
+}
+
+fast_conversions = {
+   "Booleanv": ("GLboolean", {
+      "int": "INT_TO_BOOLEAN(%s)",
+      "uint": "INT_TO_BOOLEAN(%s)",
+      "int64": "INT64_TO_BOOLEAN(%s)",
+      "bool": "%s",
+      "float": "FLOAT_TO_BOOLEAN(%s)",
+      "bit": "%s",
+   }),
+   "Integerv": ("GLint", {
+      "int": "%s",
+      "uint": "%s",
+      "int64": "INT64_TO_INT(%s)",
+      "bool": "BOOLEAN_TO_INT(%s)",
+      "float": "lroundf(%s)",
+      "bit": "%s",
+   }),
+   "Floatv": ("GLfloat", {
+      "int": "(GLfloat) %s",
+      "uint": "(GLfloat) %s",
+      "int64": "(GLfloat) %s",
+      "bool": "BOOLEAN_TO_FLOAT(%s)",
+      "float": "%s",
+      "bit": "BOOLEAN_TO_FLOAT(%s)",
+   }),
+}
+
+def fast_value(desc):
+   """Return (kind, C expression) of a descriptor that has a direct
+   accessor, or None if it has to go through the generic path."""
+   m = re.match(r"^\s*(\w+)\((.*)\),\s*\w+\s*$", desc)
+   if not m:
+      return None
+
+   macro, arg = m.groups()
+   if macro == "CONST":
+      return ("int", "(GLint) (%s)" % arg)
+   if macro in fast_field_types:
+      ctype, kind = fast_field_types[macro]
+      return (kind, "*(const %s *) &ctx->%s" % (ctype, arg))
+   m = re.match(r"^CONTEXT_BIT([0-7])$", macro)
+   if m:
+      return ("bit", "((*(const GLbitfield *) &ctx->%s >> %s) & 1)" %
+              (arg, m.group(1)))
+   return None
+
+def print_fast_getters(params):
+   for func, (ret_type, conversions) in sorted(fast_conversions.items()):
+      print("static inline bool")
+      print("get_%s_fast(struct gl_context *ctx, unsigned idx, %s *params)" %
+            (func.lower(), ret_type))
+      print("{")
+      print("   switch (idx) {")
+      for i, p in enumerate(params):
+         value = fast_value(p[1]) if i else None
+         if not value:
+            continue
+         kind, expr = value
+         print("   case %d: /* %s */" % (i, p[0]))
+         print("      params[0] = %s;" % (conversions[kind] % expr))
+         print("      return true;")
+      print("   default:")
+      print("      return false;")
+      print("   }")
+      print("}\n")
+
 def api_name(api):
    return "API_OPEN%s" % api
 
@@ -230,3 +310,4 @@ if __name__ == '__main__':
    print_header()
    print_params(params)
    print_tables(hash_tables)
+   print_fast_getters(params)
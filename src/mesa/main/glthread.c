@@ -36,6 +36,8 @@
 #include "main/glthread.h"
 #include "main/glthread_marshal.h"
 #include "main/hash.h"
+#include "util/debug.h"
+#include "util/hash_table.h"
 #include "util/u_atomic.h"
 #include "util/u_thread.h"
 #include "util/u_cpu_detect.h"
@@ -141,6 +143,43 @@ _mesa_glthread_init(struct gl_context *ctx)
 
    glthread->LastDListChangeBatchIndex = -1;
 
+   /* Shadow the enables queried by glIsEnabled/glGet* without syncing. */
+   const struct {
+      enum glthread_enable cap;
+      bool enabled;
+   } enables[] = {
+      { GLTHREAD_ENABLE_BLEND, ctx->Color.BlendEnabled & 1 },
+      { GLTHREAD_ENABLE_CULL_FACE, ctx->Polygon.CullFlag },
+      { GLTHREAD_ENABLE_DEPTH_TEST, ctx->Depth.Test },
+      { GLTHREAD_ENABLE_DITHER, ctx->Color.DitherFlag },
+      { GLTHREAD_ENABLE_POLYGON_OFFSET_FILL, ctx->Polygon.OffsetFill },
+      { GLTHREAD_ENABLE_SCISSOR_TEST, ctx->Scissor.EnableFlags & 1 },
+      { GLTHREAD_ENABLE_STENCIL_TEST, ctx->Stencil.Enabled },
+      { GLTHREAD_ENABLE_ALPHA_TEST, ctx->Color.AlphaEnabled },
+      { GLTHREAD_ENABLE_COLOR_LOGIC_OP, ctx->Color.ColorLogicOpEnabled },
+      { GLTHREAD_ENABLE_COLOR_MATERIAL, ctx->Light.ColorMaterialEnabled },
+      { GLTHREAD_ENABLE_FOG, ctx->Fog.Enabled },
+      { GLTHREAD_ENABLE_LIGHTING, ctx->Light.Enabled },
+      { GLTHREAD_ENABLE_LINE_SMOOTH, ctx->Line.SmoothFlag },
+      { GLTHREAD_ENABLE_NORMALIZE, ctx->Transform.Normalize },
+      { GLTHREAD_ENABLE_POINT_SMOOTH, ctx->Point.SmoothFlag },
+      { GLTHREAD_ENABLE_RESCALE_NORMAL, ctx->Transform.RescaleNormals },
+   };
+   STATIC_ASSERT(ARRAY_SIZE(enables) == GLTHREAD_NUM_ENABLES);
+
+   glthread->Enabled = 0;
+   for (unsigned i = 0; i < ARRAY_SIZE(enables); i++) {
+      if (enables[i].enabled)
+         glthread->Enabled |= BITFIELD_BIT(enables[i].cap);
+   }
+   glthread->ViewportKnown = false;
+
+   if (env_var_as_boolean("MESA_GLTHREAD_SYNC_STATS", false)) {
+      glthread->SyncStats =
+         _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                 _mesa_key_string_equal);
+   }
+
    /* Execute the thread initialization function in the thread. */
    struct util_queue_fence fence;
    util_queue_fence_init(&fence);
@@ -156,6 +195,39 @@ free_vao(void *data, UNUSED void *userData)
    free(data);
 }
 
+static int
+compare_sync_stats(const void *a, const void *b)
+{
+   const struct hash_entry *ea = *(const struct hash_entry **)a;
+   const struct hash_entry *eb = *(const struct hash_entry **)b;
+   uintptr_t ca = (uintptr_t)ea->data, cb = (uintptr_t)eb->data;
+
+   return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static void
+print_sync_stats(struct hash_table *stats)
+{
+   struct hash_entry **entries =
+      malloc(_mesa_hash_table_num_entries(stats) * sizeof(*entries));
+   unsigned num = 0;
+
+   if (!entries)
+      return;
+
+   hash_table_foreach(stats, entry)
+      entries[num++] = entry;
+
+   qsort(entries, num, sizeof(*entries), compare_sync_stats);
+
+   fprintf(stderr, "glthread: syncs per function:\n");
+   for (unsigned i = 0; i < num; i++) {
+      fprintf(stderr, "  %8"PRIuPTR" %s\n", (uintptr_t)entries[i]->data,
+              (const char *)entries[i]->key);
+   }
+   free(entries);
+}
+
 void
 _mesa_glthread_destroy(struct gl_context *ctx)
 {
@@ -173,6 +245,12 @@ _mesa_glthread_destroy(struct gl_context *ctx)
    _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
    _mesa_DeleteHashTable(glthread->VAOs);
 
+   if (glthread->SyncStats) {
+      print_sync_stats(glthread->SyncStats);
+      _mesa_hash_table_destroy(glthread->SyncStats, NULL);
+      glthread->SyncStats = NULL;
+   }
+
    ctx->GLThread.enabled = false;
 
    _mesa_glthread_restore_dispatch(ctx, "destroy");
@@ -313,8 +391,16 @@ _mesa_glthread_finish_before(struct gl_context *ctx, const char *func)
 {
    _mesa_glthread_finish(ctx);
 
-   /* Uncomment this if you want to know where glthread syncs. */
-   /*printf("fallback to sync: %s\n", func);*/
+   /* Set MESA_GLTHREAD_SYNC_STATS=1 to know where glthread syncs. */
+   struct hash_table *stats = ctx->GLThread.SyncStats;
+   if (stats) {
+      struct hash_entry *entry = _mesa_hash_table_search(stats, func);
+
+      if (entry)
+         entry->data = (void *)((uintptr_t)entry->data + 1);
+      else
+         _mesa_hash_table_insert(stats, func, (void *)(uintptr_t)1);
+   }
 }
 
 void
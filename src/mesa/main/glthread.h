@@ -60,6 +60,33 @@ extern "C" {
 struct gl_context;
 struct gl_buffer_object;
 struct _mesa_HashTable;
+struct hash_table;
+
+/**
+ * Enable caps shadowed by glthread, so that glIsEnabled and glGet* don't
+ * have to sync. The first group is valid in all APIs, the rest only in
+ * the compatibility profile and GLES1.
+ */
+enum glthread_enable {
+   GLTHREAD_ENABLE_BLEND,
+   GLTHREAD_ENABLE_CULL_FACE,
+   GLTHREAD_ENABLE_DEPTH_TEST,
+   GLTHREAD_ENABLE_DITHER,
+   GLTHREAD_ENABLE_POLYGON_OFFSET_FILL,
+   GLTHREAD_ENABLE_SCISSOR_TEST,
+   GLTHREAD_ENABLE_STENCIL_TEST,
+
+   GLTHREAD_ENABLE_ALPHA_TEST,
+   GLTHREAD_ENABLE_COLOR_LOGIC_OP,
+   GLTHREAD_ENABLE_COLOR_MATERIAL,
+   GLTHREAD_ENABLE_FOG,
+   GLTHREAD_ENABLE_LIGHTING,
+   GLTHREAD_ENABLE_LINE_SMOOTH,
+   GLTHREAD_ENABLE_NORMALIZE,
+   GLTHREAD_ENABLE_POINT_SMOOTH,
+   GLTHREAD_ENABLE_RESCALE_NORMAL,
+   GLTHREAD_NUM_ENABLES,
+};
 
 struct glthread_attrib_binding {
    struct gl_buffer_object *buffer; /**< where non-VBO data was uploaded */
@@ -129,6 +156,9 @@ struct glthread_attrib_node {
    GLbitfield Mask;
    int ActiveTexture;
    GLenum MatrixMode;
+   GLbitfield Enabled;
+   bool ViewportKnown;
+   GLfloat Viewport[4];
 };
 
 typedef enum {
@@ -227,6 +257,22 @@ struct glthread_state
    struct glthread_attrib_node AttribStack[MAX_ATTRIB_STACK_DEPTH];
    int AttribStackDepth;
    int MatrixStackDepth[M_NUM_MATRIX_STACKS];
+
+   /** Enable caps, a bitmask of BITFIELD_BIT(GLTHREAD_ENABLE_*). */
+   GLbitfield Enabled;
+
+   /**
+    * Viewport 0. The window system sets the initial viewport, so this is
+    * only known once the application has set it.
+    */
+   bool ViewportKnown;
+   GLfloat Viewport[4];
+
+   /**
+    * Number of glthread syncs per GL function, only allocated with
+    * MESA_GLTHREAD_SYNC_STATS=1 and printed when the context is destroyed.
+    */
+   struct hash_table *SyncStats;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -302,6 +348,7 @@ void _mesa_glthread_ClientAttribDefault(struct gl_context *ctx, GLbitfield mask)
 void _mesa_glthread_InterleavedArrays(struct gl_context *ctx, GLenum format,
                                       GLsizei stride, const GLvoid *pointer);
 void _mesa_glthread_ProgramChanged(struct gl_context *ctx);
+GLbitfield _mesa_glthread_enable_attrib_mask(GLbitfield attrib_mask);
 
 #ifdef __cplusplus
 }
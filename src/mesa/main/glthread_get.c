@@ -21,96 +21,207 @@
  * IN THE SOFTWARE.
  */
 
+#include <math.h>
+
 #include "main/glthread_marshal.h"
 #include "main/dispatch.h"
 
-void
-_mesa_unmarshal_GetIntegerv(struct gl_context *ctx,
-                            const struct marshal_cmd_GetIntegerv *cmd)
+/**
+ * Attribute groups other than GL_ENABLE_BIT whose glPopAttrib restores each
+ * GLTHREAD_ENABLE_* cap.
+ */
+static const GLbitfield enable_attrib_groups[GLTHREAD_NUM_ENABLES] = {
+   [GLTHREAD_ENABLE_BLEND] = GL_COLOR_BUFFER_BIT,
+   [GLTHREAD_ENABLE_CULL_FACE] = GL_POLYGON_BIT,
+   [GLTHREAD_ENABLE_DEPTH_TEST] = GL_DEPTH_BUFFER_BIT,
+   [GLTHREAD_ENABLE_DITHER] = GL_COLOR_BUFFER_BIT,
+   [GLTHREAD_ENABLE_POLYGON_OFFSET_FILL] = GL_POLYGON_BIT,
+   [GLTHREAD_ENABLE_SCISSOR_TEST] = GL_SCISSOR_BIT,
+   [GLTHREAD_ENABLE_STENCIL_TEST] = GL_STENCIL_BUFFER_BIT,
+   [GLTHREAD_ENABLE_ALPHA_TEST] = GL_COLOR_BUFFER_BIT,
+   [GLTHREAD_ENABLE_COLOR_LOGIC_OP] = GL_COLOR_BUFFER_BIT,
+   [GLTHREAD_ENABLE_COLOR_MATERIAL] = GL_LIGHTING_BIT,
+   [GLTHREAD_ENABLE_FOG] = GL_FOG_BIT,
+   [GLTHREAD_ENABLE_LIGHTING] = GL_LIGHTING_BIT,
+   [GLTHREAD_ENABLE_LINE_SMOOTH] = GL_LINE_BIT,
+   [GLTHREAD_ENABLE_NORMALIZE] = GL_TRANSFORM_BIT,
+   [GLTHREAD_ENABLE_POINT_SMOOTH] = GL_POINT_BIT,
+   [GLTHREAD_ENABLE_RESCALE_NORMAL] = GL_TRANSFORM_BIT,
+};
+
+/**
+ * Return the GLThread.Enabled bits restored by glPopAttrib for
+ * \p attrib_mask.
+ */
+GLbitfield
+_mesa_glthread_enable_attrib_mask(GLbitfield attrib_mask)
 {
-   unreachable("never executed");
+   GLbitfield restored = 0;
+
+   for (unsigned i = 0; i < GLTHREAD_NUM_ENABLES; i++) {
+      if (attrib_mask & (GL_ENABLE_BIT | enable_attrib_groups[i]))
+         restored |= BITFIELD_BIT(i);
+   }
+   return restored;
 }
 
-void GLAPIENTRY
-_mesa_marshal_GetIntegerv(GLenum pname, GLint *p)
+/**
+ * Return the shadowed glIsEnabled value of \p cap, or -1 if glthread has to
+ * sync to get it.
+ */
+static int
+get_enabled(struct gl_context *ctx, GLenum cap)
 {
-   GET_CURRENT_CONTEXT(ctx);
+   GLbitfield bit = _mesa_glthread_enable_bit(ctx, cap);
+
+   if (bit)
+      return (ctx->GLThread.Enabled & bit) != 0;
+
+   /* glthread only tracks client arrays for the compatibility profile. */
+   if (ctx->API != API_OPENGL_COMPAT)
+      return -1;
+
+   GLbitfield user_enabled = ctx->GLThread.CurrentVAO->UserEnabled;
+
+   switch (cap) {
+   case GL_VERTEX_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_POS)) != 0;
+   case GL_NORMAL_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_NORMAL)) != 0;
+   case GL_COLOR_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_COLOR0)) != 0;
+   case GL_SECONDARY_COLOR_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_COLOR1)) != 0;
+   case GL_FOG_COORD_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_FOG)) != 0;
+   case GL_INDEX_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_COLOR_INDEX)) != 0;
+   case GL_EDGE_FLAG_ARRAY:
+      return (user_enabled & (1 << VERT_ATTRIB_EDGEFLAG)) != 0;
+   case GL_TEXTURE_COORD_ARRAY:
+      return (user_enabled &
+              (1 << (VERT_ATTRIB_TEX0 + ctx->GLThread.ClientActiveTexture))) != 0;
+   default:
+      return -1;
+   }
+}
+
+/** State returned by glGet* without syncing. */
+struct shadowed_value {
+   unsigned count;
+   bool is_float;
+   GLint i[4];
+   GLfloat f[4];
+};
+
+static bool
+get_int(struct shadowed_value *v, GLint value)
+{
+   v->count = 1;
+   v->i[0] = value;
+   return true;
+}
+
+/**
+ * Look up \p pname in the state shadowed by glthread. Return false if
+ * glthread has to sync to get it.
+ */
+static bool
+get_shadowed_value(struct gl_context *ctx, GLenum pname,
+                   struct shadowed_value *v)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
 
    /* TODO: Use get_hash_params.py to return values for items containing:
     * - CONST(
     * - CONTEXT_[A-Z]*(Const
     */
 
+   v->is_float = false;
+
+   if (pname == GL_VIEWPORT) {
+      if (!glthread->ViewportKnown)
+         return false;
+
+      v->count = 4;
+      v->is_float = true;
+      memcpy(v->f, glthread->Viewport, sizeof(v->f));
+      return true;
+   }
+
+   int enabled = get_enabled(ctx, pname);
+   if (enabled >= 0)
+      return get_int(v, enabled);
+
    if (ctx->API != API_OPENGL_COMPAT) {
       /* glthread only tracks these states for the compatibility profile. */
-      _mesa_glthread_finish_before(ctx, "GetIntegerv");
-      CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, p));
-      return;
+      return false;
    }
 
    switch (pname) {
    case GL_ACTIVE_TEXTURE:
-      *p = GL_TEXTURE0 + ctx->GLThread.ActiveTexture;
-      return;
+      return get_int(v, GL_TEXTURE0 + glthread->ActiveTexture);
    case GL_ARRAY_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentArrayBufferName;
-      return;
+      return get_int(v, glthread->CurrentArrayBufferName);
    case GL_ATTRIB_STACK_DEPTH:
-      *p = ctx->GLThread.AttribStackDepth;
-      return;
+      return get_int(v, glthread->AttribStackDepth);
    case GL_CLIENT_ACTIVE_TEXTURE:
-      *p = ctx->GLThread.ClientActiveTexture;
-      return;
+      return get_int(v, glthread->ClientActiveTexture);
    case GL_CLIENT_ATTRIB_STACK_DEPTH:
-      *p = ctx->GLThread.ClientAttribStackTop;
-      return;
+      return get_int(v, glthread->ClientAttribStackTop);
    case GL_DRAW_INDIRECT_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentDrawIndirectBufferName;
-      return;
+      return get_int(v, glthread->CurrentDrawIndirectBufferName);
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      return get_int(v, glthread->CurrentVAO->CurrentElementBufferName);
+   case GL_VERTEX_ARRAY_BINDING:
+      return get_int(v, glthread->CurrentVAO->Name);
+   case GL_PIXEL_PACK_BUFFER_BINDING:
+      if (!ctx->Extensions.EXT_pixel_buffer_object)
+         return false;
+      return get_int(v, glthread->CurrentPixelPackBufferName);
+   case GL_PIXEL_UNPACK_BUFFER_BINDING:
+      if (!ctx->Extensions.EXT_pixel_buffer_object)
+         return false;
+      return get_int(v, glthread->CurrentPixelUnpackBufferName);
+   case GL_LIST_BASE:
+      return get_int(v, glthread->ListBase);
 
    case GL_MATRIX_MODE:
-      *p = ctx->GLThread.MatrixMode;
-      return;
+      return get_int(v, glthread->MatrixMode);
    case GL_CURRENT_MATRIX_STACK_DEPTH_ARB:
-      *p = ctx->GLThread.MatrixStackDepth[ctx->GLThread.MatrixIndex] + 1;
-      return;
+      return get_int(v, glthread->MatrixStackDepth[glthread->MatrixIndex] + 1);
    case GL_MODELVIEW_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_MODELVIEW] + 1;
-      return;
+      return get_int(v, glthread->MatrixStackDepth[M_MODELVIEW] + 1);
    case GL_PROJECTION_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_PROJECTION] + 1;
-      return;
+      return get_int(v, glthread->MatrixStackDepth[M_PROJECTION] + 1);
    case GL_TEXTURE_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_TEXTURE0 + ctx->GLThread.ActiveTexture] + 1;
-      return;
+      return get_int(v, glthread->MatrixStackDepth[M_TEXTURE0 +
+                                                   glthread->ActiveTexture] + 1);
 
-   case GL_VERTEX_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POS)) != 0;
-      return;
-   case GL_NORMAL_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_NORMAL)) != 0;
-      return;
-   case GL_COLOR_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR0)) != 0;
-      return;
-   case GL_SECONDARY_COLOR_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR1)) != 0;
-      return;
-   case GL_FOG_COORD_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_FOG)) != 0;
-      return;
-   case GL_INDEX_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR_INDEX)) != 0;
-      return;
-   case GL_EDGE_FLAG_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_EDGEFLAG)) != 0;
-      return;
-   case GL_TEXTURE_COORD_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled &
-            (1 << (VERT_ATTRIB_TEX0 + ctx->GLThread.ClientActiveTexture))) != 0;
-      return;
    case GL_POINT_SIZE_ARRAY_OES:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POINT_SIZE)) != 0;
+      return get_int(v, (glthread->CurrentVAO->UserEnabled &
+                         (1 << VERT_ATTRIB_POINT_SIZE)) != 0);
+   default:
+      return false;
+   }
+}
+
+void
+_mesa_unmarshal_GetIntegerv(struct gl_context *ctx,
+                            const struct marshal_cmd_GetIntegerv *cmd)
+{
+   unreachable("never executed");
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadowed_value v;
+
+   if (get_shadowed_value(ctx, pname, &v)) {
+      for (unsigned i = 0; i < v.count; i++)
+         p[i] = v.is_float ? lroundf(v.f[i]) : v.i[i];
       return;
    }
 
@@ -118,4 +229,87 @@ _mesa_marshal_GetIntegerv(GLenum pname, GLint *p)
    CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, p));
 }
 
-/* TODO: Implement glGetBooleanv, glGetFloatv, etc. if needed */
+void
+_mesa_unmarshal_GetBooleanv(struct gl_context *ctx,
+                            const struct marshal_cmd_GetBooleanv *cmd)
+{
+   unreachable("never executed");
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadowed_value v;
+
+   if (get_shadowed_value(ctx, pname, &v)) {
+      for (unsigned i = 0; i < v.count; i++)
+         p[i] = (v.is_float ? v.f[i] != 0.0f : v.i[i] != 0) ? GL_TRUE : GL_FALSE;
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, p));
+}
+
+void
+_mesa_unmarshal_GetFloatv(struct gl_context *ctx,
+                          const struct marshal_cmd_GetFloatv *cmd)
+{
+   unreachable("never executed");
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadowed_value v;
+
+   if (get_shadowed_value(ctx, pname, &v)) {
+      for (unsigned i = 0; i < v.count; i++)
+         p[i] = v.is_float ? v.f[i] : (GLfloat) v.i[i];
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetFloatv");
+   CALL_GetFloatv(ctx->CurrentServerDispatch, (pname, p));
+}
+
+void
+_mesa_unmarshal_IsEnabled(struct gl_context *ctx,
+                          const struct marshal_cmd_IsEnabled *cmd)
+{
+   unreachable("never executed");
+}
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   int enabled = get_enabled(ctx, cap);
+
+   if (enabled >= 0)
+      return enabled;
+
+   _mesa_glthread_finish_before(ctx, "IsEnabled");
+   return CALL_IsEnabled(ctx->CurrentServerDispatch, (cap));
+}
+
+void
+_mesa_unmarshal_GetError(struct gl_context *ctx,
+                         const struct marshal_cmd_GetError *cmd)
+{
+   unreachable("never executed");
+}
+
+GLenum GLAPIENTRY
+_mesa_marshal_GetError(void)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   /* Errors are recorded by the driver thread.  Even KHR_no_error contexts
+    * report GL_OUT_OF_MEMORY, so always sync.
+    */
+   _mesa_glthread_finish_before(ctx, "GetError");
+   return CALL_GetError(ctx->CurrentServerDispatch, ());
+}
@@ -435,6 +435,57 @@ _mesa_get_matrix_index(struct gl_context *ctx, GLenum mode)
    return M_DUMMY;
 }
 
+/**
+ * Return the GLThread.Enabled bit tracking \p cap, or 0 if glthread doesn't
+ * track it or it isn't a valid cap in this API.
+ */
+static inline GLbitfield
+_mesa_glthread_enable_bit(struct gl_context *ctx, GLenum cap)
+{
+   switch (cap) {
+   case GL_BLEND:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_BLEND);
+   case GL_CULL_FACE:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_CULL_FACE);
+   case GL_DEPTH_TEST:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_DEPTH_TEST);
+   case GL_DITHER:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_DITHER);
+   case GL_POLYGON_OFFSET_FILL:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_POLYGON_OFFSET_FILL);
+   case GL_SCISSOR_TEST:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_SCISSOR_TEST);
+   case GL_STENCIL_TEST:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_STENCIL_TEST);
+   }
+
+   if (ctx->API != API_OPENGL_COMPAT && ctx->API != API_OPENGLES)
+      return 0;
+
+   switch (cap) {
+   case GL_ALPHA_TEST:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_ALPHA_TEST);
+   case GL_COLOR_LOGIC_OP:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_COLOR_LOGIC_OP);
+   case GL_COLOR_MATERIAL:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_COLOR_MATERIAL);
+   case GL_FOG:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_FOG);
+   case GL_LIGHTING:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_LIGHTING);
+   case GL_LINE_SMOOTH:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_LINE_SMOOTH);
+   case GL_NORMALIZE:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_NORMALIZE);
+   case GL_POINT_SMOOTH:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_POINT_SMOOTH);
+   case GL_RESCALE_NORMAL:
+      return BITFIELD_BIT(GLTHREAD_ENABLE_RESCALE_NORMAL);
+   default:
+      return 0;
+   }
+}
+
 static inline void
 _mesa_glthread_Enable(struct gl_context *ctx, GLenum cap)
 {
@@ -446,6 +497,8 @@ _mesa_glthread_Enable(struct gl_context *ctx, GLenum cap)
       _mesa_glthread_set_prim_restart(ctx, cap, true);
    else if (cap == GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB)
       _mesa_glthread_disable(ctx, "Enable(DEBUG_OUTPUT_SYNCHRONOUS)");
+   else
+      ctx->GLThread.Enabled |= _mesa_glthread_enable_bit(ctx, cap);
 }
 
 static inline void
@@ -457,6 +510,99 @@ _mesa_glthread_Disable(struct gl_context *ctx, GLenum cap)
    if (cap == GL_PRIMITIVE_RESTART ||
        cap == GL_PRIMITIVE_RESTART_FIXED_INDEX)
       _mesa_glthread_set_prim_restart(ctx, cap, false);
+   else
+      ctx->GLThread.Enabled &= ~_mesa_glthread_enable_bit(ctx, cap);
+}
+
+/* glIsEnabled(GL_BLEND) and glIsEnabled(GL_SCISSOR_TEST) return the state
+ * of index 0, which is the only index tracked.
+ */
+static inline void
+_mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap, GLuint index,
+                       bool enable)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE)
+      return;
+
+   /* Same errors as _mesa_set_enablei(), which don't change anything. */
+   switch (cap) {
+   case GL_BLEND:
+      if (!ctx->Extensions.EXT_draw_buffers2 ||
+          index >= ctx->Const.MaxDrawBuffers)
+         return;
+      break;
+   case GL_SCISSOR_TEST:
+      if (index >= ctx->Const.MaxViewports)
+         return;
+      break;
+   default:
+      return;
+   }
+
+   if (index != 0)
+      return;
+
+   if (enable)
+      ctx->GLThread.Enabled |= _mesa_glthread_enable_bit(ctx, cap);
+   else
+      ctx->GLThread.Enabled &= ~_mesa_glthread_enable_bit(ctx, cap);
+}
+
+static inline void
+_mesa_glthread_ViewportIndexedf(struct gl_context *ctx, GLuint index,
+                                GLfloat x, GLfloat y,
+                                GLfloat width, GLfloat height)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE || index != 0)
+      return;
+
+   /* Invalid sizes are errors and don't change the viewport. */
+   if (width < 0 || height < 0)
+      return;
+
+   /* Same clamping as clamp_viewport() in viewport.c. */
+   width = MIN2(width, (GLfloat) ctx->Const.MaxViewportWidth);
+   height = MIN2(height, (GLfloat) ctx->Const.MaxViewportHeight);
+
+   if (_mesa_has_ARB_viewport_array(ctx) ||
+       _mesa_has_OES_viewport_array(ctx)) {
+      x = CLAMP(x, ctx->Const.ViewportBounds.Min,
+                ctx->Const.ViewportBounds.Max);
+      y = CLAMP(y, ctx->Const.ViewportBounds.Min,
+                ctx->Const.ViewportBounds.Max);
+   }
+
+   ctx->GLThread.ViewportKnown = true;
+   ctx->GLThread.Viewport[0] = x;
+   ctx->GLThread.Viewport[1] = y;
+   ctx->GLThread.Viewport[2] = width;
+   ctx->GLThread.Viewport[3] = height;
+}
+
+static inline void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   _mesa_glthread_ViewportIndexedf(ctx, 0, x, y, width, height);
+}
+
+static inline void
+_mesa_glthread_ViewportArrayv(struct gl_context *ctx, GLuint first,
+                              GLsizei count, const GLfloat *v)
+{
+   if (first != 0 || count <= 0 ||
+       count > (GLsizei) ctx->Const.MaxViewports)
+      return;
+
+   /* Like _mesa_ViewportArrayv, the whole call is an error and changes no
+    * viewport if any of the sizes is invalid.
+    */
+   for (GLsizei i = 0; i < count; i++) {
+      if (v[i * 4 + 2] < 0 || v[i * 4 + 3] < 0)
+         return;
+   }
+
+   _mesa_glthread_ViewportIndexedf(ctx, 0, v[0], v[1], v[2], v[3]);
 }
 
 static inline void
@@ -475,6 +621,13 @@ _mesa_glthread_PushAttrib(struct gl_context *ctx, GLbitfield mask)
 
    if (mask & GL_TRANSFORM_BIT)
       attr->MatrixMode = ctx->GLThread.MatrixMode;
+
+   attr->Enabled = ctx->GLThread.Enabled;
+
+   if (mask & GL_VIEWPORT_BIT) {
+      attr->ViewportKnown = ctx->GLThread.ViewportKnown;
+      memcpy(attr->Viewport, ctx->GLThread.Viewport, sizeof(attr->Viewport));
+   }
 }
 
 static inline void
@@ -494,6 +647,15 @@ _mesa_glthread_PopAttrib(struct gl_context *ctx)
       ctx->GLThread.MatrixMode = attr->MatrixMode;
       ctx->GLThread.MatrixIndex = _mesa_get_matrix_index(ctx, attr->MatrixMode);
    }
+
+   GLbitfield restored = _mesa_glthread_enable_attrib_mask(mask);
+   ctx->GLThread.Enabled = (ctx->GLThread.Enabled & ~restored) |
+                           (attr->Enabled & restored);
+
+   if (mask & GL_VIEWPORT_BIT) {
+      ctx->GLThread.ViewportKnown = attr->ViewportKnown;
+      memcpy(ctx->GLThread.Viewport, attr->Viewport, sizeof(attr->Viewport));
+   }
 }
 
 static inline void
@@ -156,3 +156,28 @@ _mesa_marshal_GetActiveUniform(GLuint program, GLuint index, GLsizei bufSize,
    _mesa_GetActiveUniform_impl(program, index, bufSize, length, size, type,
                                name, true);
 }
+
+void
+_mesa_unmarshal_GetUniformLocation(struct gl_context *ctx,
+                                   const struct marshal_cmd_GetUniformLocation *cmd)
+{
+   unreachable("never executed");
+}
+
+GLint GLAPIENTRY
+_mesa_marshal_GetUniformLocation(GLuint program, const GLchar *name)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   /* Wait for the last glLinkProgram call. */
+   int batch = p_atomic_read(&ctx->GLThread.LastProgramChangeBatch);
+   if (batch != -1) {
+      util_queue_fence_wait(&ctx->GLThread.batches[batch].fence);
+      assert(p_atomic_read(&ctx->GLThread.LastProgramChangeBatch) == -1);
+   }
+
+   /* Uniform locations are immutable after glLinkProgram, so this is safe
+    * for the same reasons as glGetActiveUniform above.
+    */
+   return _mesa_GetUniformLocation_impl(program, name, true);
+}
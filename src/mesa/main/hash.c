@@ -38,9 +38,13 @@
 #include "glheader.h"
 #include "hash.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/u_idalloc.h"
 
+/* Number of keys in each node of _mesa_HashTable::array. */
+#define HASH_ARRAY_NODE_SIZE 256
+
 
 /**
  * Create a new hash table.
@@ -62,6 +66,8 @@ _mesa_NewHashTable(void)
       }
 
       _mesa_hash_table_set_deleted_key(table->ht, uint_key(DELETED_KEY_VALUE));
+      util_sparse_array_init(&table->array, sizeof(void *),
+                             HASH_ARRAY_NODE_SIZE);
       /*
        * Needs to be recursive, since the callback in _mesa_HashWalk()
        * is allowed to call _mesa_HashRemove().
@@ -95,6 +101,7 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
+   util_sparse_array_finish(&table->array);
    if (table->id_alloc) {
       util_idalloc_fini(table->id_alloc);
       free(table->id_alloc);
@@ -120,32 +127,37 @@ _mesa_HashEnableNameReuse(struct _mesa_HashTable *table)
 
 /**
  * Lookup an entry in the hash table, without locking.
+ *
+ * This is safe to call concurrently with insertions and removals: the
+ * array slot for a key never moves, and is written with a single store.
+ * Lookups never allocate, so looking up keys that were never inserted
+ * doesn't grow the array.
  * \sa _mesa_HashLookup
  */
 static inline void *
 _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 {
-   const struct hash_entry *entry;
-
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   void **slot = util_sparse_array_get_existing(&table->array, key);
+   return slot ? p_atomic_read(slot) : NULL;
+}
 
-   entry = _mesa_hash_table_search_pre_hashed(table->ht,
-                                              uint_hash(key),
-                                              uint_key(key));
-   if (!entry)
-      return NULL;
 
-   return entry->data;
+static inline void
+hash_array_set(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   void **slot = util_sparse_array_get(&table->array, key);
+   p_atomic_set(slot, data);
 }
 
 
 /**
  * Lookup an entry in the hash table.
- * 
+ *
+ * This doesn't need to lock the mutex.
+ *
  * \param table the hash table.
  * \param key the key.
  * 
@@ -154,19 +166,15 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
-   void *res;
-   _mesa_HashLockMutex(table);
-   res = _mesa_HashLookup_unlocked(table, key);
-   _mesa_HashUnlockMutex(table);
-   return res;
+   return _mesa_HashLookup_unlocked(table, key);
 }
 
 
 /**
- * Lookup an entry in the hash table without locking the mutex.
+ * Lookup an entry in the hash table.
  *
- * The hash table mutex must be locked manually by calling
- * _mesa_HashLockMutex() before calling this function.
+ * This is the same as _mesa_HashLookup(), for callers that already locked
+ * the mutex with _mesa_HashLockMutex().
  *
  * \param table the hash table.
  * \param key the key.
@@ -189,6 +197,8 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    assert(table);
    assert(key);
 
+   hash_array_set(table, key, data);
+
    if (key > table->MaxKey)
       table->MaxKey = key;
 
@@ -270,6 +280,8 @@ _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
     */
    assert(!table->InDeleteAll);
 
+   hash_array_set(table, key, NULL);
+
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = NULL;
    } else {
@@ -317,10 +329,12 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    table->InDeleteAll = GL_TRUE;
    hash_table_foreach(table->ht, entry) {
       callback(entry->data, userData);
+      hash_array_set(table, (uintptr_t)entry->key, NULL);
       _mesa_hash_table_remove(table->ht, entry);
    }
    if (table->deleted_key_data) {
       callback(table->deleted_key_data, userData);
+      hash_array_set(table, DELETED_KEY_VALUE, NULL);
       table->deleted_key_data = NULL;
    }
    table->InDeleteAll = GL_FALSE;
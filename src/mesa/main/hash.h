@@ -37,6 +37,11 @@
 #include "glheader.h"
 
 #include "c11/threads.h"
+#include "util/sparse_array.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 struct util_idalloc;
 
@@ -99,9 +104,15 @@ uint_key(GLuint id)
 
 /**
  * The hash table data structure.
+ *
+ * Entries are stored twice: in a struct hash_table, which is used to walk
+ * the table, and in a util_sparse_array directly indexed by key, which lets
+ * lookups run without taking the mutex. Both are only modified with the
+ * mutex held.
  */
 struct _mesa_HashTable {
    struct hash_table *ht;
+   struct util_sparse_array array;       /**< key -> data, for lookups */
    GLuint MaxKey;                        /**< highest key inserted so far */
    mtx_t Mutex;                          /**< mutual exclusion lock */
    GLboolean InDeleteAll;                /**< Debug check */
@@ -204,9 +215,9 @@ _mesa_HashLookupMaybeLocked(struct _mesa_HashTable *table, GLuint key,
                             bool locked)
 {
    if (locked)
-      return _mesa_HashLookupLocked(table, key);
+      return (struct gl_buffer_object *)_mesa_HashLookupLocked(table, key);
    else
-      return _mesa_HashLookup(table, key);
+      return (struct gl_buffer_object *)_mesa_HashLookup(table, key);
 }
 
 static inline void
@@ -234,4 +245,8 @@ _mesa_HashUnlockMaybeLocked(struct _mesa_HashTable *table, bool locked)
       _mesa_HashUnlockMutex(table);
 }
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -41,6 +41,12 @@
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -163,6 +169,89 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#ifdef __SSE2__
+/*
+ * SSE2 versions of the 2:1 horizontal reductions of do_row() for the most
+ * common formats.  They compute bit-identical results to the C loops and
+ * return the number of destination texels written; do_row() finishes the
+ * rest of the row.
+ */
+
+static GLuint
+do_row_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                   GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      __m128i sum[2];
+
+      for (unsigned h = 0; h < 2; h++) {
+         const __m128i a =
+            _mm_loadu_si128((const __m128i *)(rowA + 8 * i + 16 * h));
+         const __m128i b =
+            _mm_loadu_si128((const __m128i *)(rowB + 8 * i + 16 * h));
+         /* Column sums of texel pairs (0, 1) and (2, 3) as 16-bit values */
+         const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                          _mm_unpacklo_epi8(b, zero));
+         const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                          _mm_unpackhi_epi8(b, zero));
+
+         sum[h] = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi),
+                                _mm_unpackhi_epi64(lo, hi));
+         sum[h] = _mm_srli_epi16(sum[h], 2);
+      }
+
+      _mm_storeu_si128((__m128i *)(dst + 4 * i),
+                       _mm_packus_epi16(sum[0], sum[1]));
+   }
+
+   return i;
+}
+
+static GLuint
+do_row_float4_sse2(const GLfloat *rowA, const GLfloat *rowB,
+                   GLuint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+
+   for (GLuint i = 0; i < dstWidth; i++) {
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(rowA + 8 * i),
+                              _mm_loadu_ps(rowA + 8 * i + 4));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(rowB + 8 * i));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(rowB + 8 * i + 4));
+      _mm_storeu_ps(dst + 4 * i, _mm_mul_ps(sum, quarter));
+   }
+
+   return dstWidth;
+}
+
+static GLuint
+do_row_float1_sse2(const GLfloat *rowA, const GLfloat *rowB,
+                   GLuint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128 a0 = _mm_loadu_ps(rowA + 2 * i);
+      const __m128 a1 = _mm_loadu_ps(rowA + 2 * i + 4);
+      const __m128 b0 = _mm_loadu_ps(rowB + 2 * i);
+      const __m128 b1 = _mm_loadu_ps(rowB + 2 * i + 4);
+      /* Same summation order as the C loop: ((A[j] + A[k]) + B[j]) + B[k] */
+      __m128 sum = _mm_add_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+      sum = _mm_add_ps(sum, _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+      sum = _mm_add_ps(sum, _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+      _mm_storeu_ps(dst + i, _mm_mul_ps(sum, quarter));
+   }
+
+   return i;
+}
+#endif
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -187,11 +276,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    */
 
    if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
       const GLubyte(*rowB)[4] = (const GLubyte(*)[4]) srcRowB;
       GLubyte(*dst)[4] = (GLubyte(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_ubyte4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) / 4;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) / 4;
@@ -375,11 +468,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    }
 
    else if (datatype == GL_FLOAT && comps == 4) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLfloat(*rowA)[4] = (const GLfloat(*)[4]) srcRowA;
       const GLfloat(*rowB)[4] = (const GLfloat(*)[4]) srcRowB;
       GLfloat(*dst)[4] = (GLfloat(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_float4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] +
                       rowB[j][0] + rowB[k][0]) * 0.25F;
@@ -420,11 +517,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       }
    }
    else if (datatype == GL_FLOAT && comps == 1) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLfloat *rowA = (const GLfloat *) srcRowA;
       const GLfloat *rowB = (const GLfloat *) srcRowB;
       GLfloat *dst = (GLfloat *) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_float1_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i] = (rowA[j] + rowA[k] + rowB[j] + rowB[k]) * 0.25F;
       }
@@ -1943,6 +2044,112 @@ _mesa_prepare_mipmap_levels(struct gl_context *ctx,
 }
 
 
+/** Levels smaller than this are generated on the calling thread only. */
+#define MIPMAP_THREAD_MIN_PIXELS (256 * 256)
+#define MIPMAP_MAX_THREADS 8
+
+struct mipmap_band_job {
+   struct util_queue_fence fence;
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, srcHeight;
+   const GLubyte *src;
+   GLint srcRowStride;
+   GLint dstWidth, dstHeight;
+   GLubyte *dst;
+   GLint dstRowStride;
+};
+
+static void
+mipmap_band_execute(void *data, UNUSED int thread_index)
+{
+   struct mipmap_band_job *job = data;
+
+   make_2d_mipmap(job->datatype, job->comps, 0,
+                  job->srcWidth, job->srcHeight, job->src, job->srcRowStride,
+                  job->dstWidth, job->dstHeight, job->dst, job->dstRowStride);
+}
+
+static struct util_queue *
+get_mipmap_queue(struct gl_context *ctx)
+{
+   /* Classic drivers don't detect the CPU otherwise. */
+   util_cpu_detect();
+
+   if (util_cpu_caps.nr_cpus < 2)
+      return NULL;
+
+   if (!util_queue_is_initialized(&ctx->MipmapQueue)) {
+      unsigned threads = MIN2(util_cpu_caps.nr_cpus - 1, MIPMAP_MAX_THREADS);
+
+      if (!util_queue_init(&ctx->MipmapQueue, "mipmap",
+                           MIPMAP_MAX_THREADS, threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                           UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY))
+         return NULL;
+   }
+
+   return &ctx->MipmapQueue;
+}
+
+/**
+ * Same as make_2d_mipmap() without a border, but large images are split into
+ * bands of destination rows that are filtered in parallel by the mipmap
+ * queue and the calling thread.
+ */
+static void
+make_2d_mipmap_threaded(struct gl_context *ctx, GLenum datatype, GLuint comps,
+                        GLint srcWidth, GLint srcHeight,
+                        const GLubyte *srcPtr, GLint srcRowStride,
+                        GLint dstWidth, GLint dstHeight,
+                        GLubyte *dstPtr, GLint dstRowStride)
+{
+   struct mipmap_band_job jobs[MIPMAP_MAX_THREADS + 1];
+   struct util_queue *queue = NULL;
+   unsigned num_jobs = 1;
+
+   /* Source rows consumed per destination row, as in make_2d_mipmap() */
+   const GLint srcRowStep = (srcHeight > 1 && srcHeight > dstHeight) ? 2 : 1;
+
+   if (dstWidth * dstHeight >= MIPMAP_THREAD_MIN_PIXELS)
+      queue = get_mipmap_queue(ctx);
+   if (queue)
+      num_jobs = MIN2(queue->num_threads + 1, dstHeight);
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      struct mipmap_band_job *job = &jobs[i];
+      GLint first_row = dstHeight * i / num_jobs;
+      GLint last_row = dstHeight * (i + 1) / num_jobs;
+
+      job->datatype = datatype;
+      job->comps = comps;
+      job->srcWidth = srcWidth;
+      job->srcHeight = num_jobs == 1 ? srcHeight :
+                       (last_row - first_row) * srcRowStep;
+      job->src = srcPtr + first_row * srcRowStep * srcRowStride;
+      job->srcRowStride = srcRowStride;
+      job->dstWidth = dstWidth;
+      job->dstHeight = last_row - first_row;
+      job->dst = dstPtr + first_row * dstRowStride;
+      job->dstRowStride = dstRowStride;
+
+      /* The calling thread filters the last band itself. */
+      if (i == num_jobs - 1) {
+         mipmap_band_execute(job, 0);
+      } else {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(queue, job, &job->fence,
+                            mipmap_band_execute, NULL, 0);
+      }
+   }
+
+   for (unsigned i = 0; i + 1 < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 static void
 generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
                              struct gl_texture_object *texObj,
@@ -2026,7 +2233,19 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
          success = GL_FALSE;
       }
 
-      if (success) {
+      if (success && border == 0 &&
+          (target == GL_TEXTURE_2D || _mesa_is_cube_face(target) ||
+           target == GL_TEXTURE_2D_ARRAY ||
+           target == GL_TEXTURE_CUBE_MAP_ARRAY)) {
+         for (slice = 0; slice < dstDepth; slice++) {
+            make_2d_mipmap_threaded(ctx, datatype, comps,
+                                    srcWidth, srcHeight, srcMaps[slice],
+                                    srcRowStride,
+                                    dstWidth, dstHeight, dstMaps[slice],
+                                    dstRowStride);
+         }
+      }
+      else if (success) {
          /* generate one mipmap level (for 1D/2D/3D/array/etc texture) */
          _mesa_generate_mipmap_level(target, datatype, comps, border,
                                      srcWidth, srcHeight, srcDepth,
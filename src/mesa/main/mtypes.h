@@ -1449,6 +1449,9 @@ struct gl_buffer_object
    unsigned MinMaxCacheHitIndices;
    unsigned MinMaxCacheMissIndices;
    bool MinMaxCacheDirty;
+   /** Byte range written since the cache was last validated */
+   GLintptr MinMaxCacheDirtyStart;
+   GLintptr MinMaxCacheDirtyEnd;
 
    bool HandleAllocated; /**< GL_ARB_bindless_texture */
 };
@@ -2707,6 +2710,12 @@ struct gl_shader
 
    enum gl_compile_status CompileStatus;
 
+   /**
+    * Signalled when a deferred compile of this shader has completed, see
+    * _mesa_shader_wait_compile().
+    */
+   struct util_queue_fence CompileFence;
+
 #ifdef DEBUG
    unsigned SourceChecksum;       /**< for debug/logging purposes */
 #endif
@@ -4157,6 +4166,14 @@ struct gl_constants
     */
    bool GenerateTemporaryNames;
 
+   /**
+    * Whether glCompileShader may run the GLSL front-end on a context-owned
+    * thread pool (GL_KHR_parallel_shader_compile).  Set by drivers that
+    * don't compile shaders on their own threads.  The shader is synchronized
+    * on the first query or link that needs the compile result.
+    */
+   bool DeferShaderCompile;
+
    /*
     * Maximum value supported for an index in DrawElements and friends.
     *
@@ -4713,6 +4730,7 @@ struct gl_dlist_state
    struct gl_display_list *CurrentList; /**< List currently being compiled */
    union gl_dlist_node *CurrentBlock; /**< Pointer to current block of nodes */
    GLuint CurrentPos;		/**< Index into current block of nodes */
+   union gl_dlist_node *LastInstruction; /**< Most recently allocated one */
    GLuint CallDepth;		/**< Current recursion calling depth */
 
    GLvertexformat ListVtxfmt;
@@ -5557,6 +5575,18 @@ struct gl_context
 
    struct disk_cache *Cache;
 
+   /**
+    * Thread pool for deferred GLSL compilation, see
+    * gl_constants::DeferShaderCompile.  Created on first use.
+    */
+   struct util_queue ShaderCompilerQueue;
+
+   /**
+    * Thread pool for software mipmap generation of large images, see
+    * mipmap.c.  Created on first use.
+    */
+   struct util_queue MipmapQueue;
+
    /**
     * \name GL_ARB_bindless_texture
     */
@@ -38,6 +38,7 @@
 
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/debug_output.h"
 #include "draw_validate.h"
 #include "main/enums.h"
 #include "main/glspirv.h"
@@ -65,6 +66,7 @@
 #include "util/os_file.h"
 #include "util/simple_list.h"
 #include "util/u_string.h"
+#include "util/u_cpu_detect.h"
 
 /**
  * Return mask of GLSL_x flags by examining the MESA_GLSL env var.
@@ -159,6 +161,14 @@ _mesa_init_shader_state(struct gl_context *ctx)
 void
 _mesa_free_shader_state(struct gl_context *ctx)
 {
+   /* Deferred compiles reference the context, so they must complete before
+    * anything else is torn down.
+    */
+   if (util_queue_is_initialized(&ctx->ShaderCompilerQueue)) {
+      util_queue_finish(&ctx->ShaderCompilerQueue);
+      util_queue_destroy(&ctx->ShaderCompilerQueue);
+   }
+
    for (int i = 0; i < MESA_SHADER_STAGES; i++) {
       _mesa_reference_program(ctx, &ctx->Shader.CurrentProgram[i], NULL);
       _mesa_reference_shader_program(ctx,
@@ -1020,6 +1030,13 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       return;
    }
 
+   if (pname == GL_COMPLETION_STATUS_ARB) {
+      *params = util_queue_fence_is_signalled(&shader->CompileFence);
+      return;
+   }
+
+   _mesa_shader_wait_compile(shader);
+
    switch (pname) {
    case GL_SHADER_TYPE:
       *params = shader->Type;
@@ -1027,10 +1044,6 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
    case GL_DELETE_STATUS:
       *params = shader->DeletePending;
       break;
-   case GL_COMPLETION_STATUS_ARB:
-      /* _mesa_glsl_compile_shader is not offloaded to other threads. */
-      *params = GL_TRUE;
-      return;
    case GL_COMPILE_STATUS:
       *params = shader->CompileStatus ? GL_TRUE : GL_FALSE;
       break;
@@ -1100,6 +1113,7 @@ get_shader_info_log(struct gl_context *ctx, GLuint shader, GLsizei bufSize,
       return;
    }
 
+   _mesa_shader_wait_compile(sh);
    _mesa_copy_string(infoLog, bufSize, length, sh->InfoLog);
 }
 
@@ -1135,6 +1149,9 @@ set_shader_source(struct gl_shader *sh, const GLchar *source)
 {
    assert(sh);
 
+   /* A deferred compile may still be reading the old source. */
+   _mesa_shader_wait_compile(sh);
+
    /* The GL_ARB_gl_spirv spec adds the following to the end of the description
     * of ShaderSource:
     *
@@ -1171,6 +1188,66 @@ ensure_builtin_types(struct gl_context *ctx)
    }
 }
 
+struct compile_shader_job {
+   struct gl_context *ctx;
+   struct gl_shader *sh;
+};
+
+static void
+compile_shader_execute(void *data, int thread_index)
+{
+   struct compile_shader_job *job = (struct compile_shader_job *) data;
+
+   _mesa_glsl_compile_shader(job->ctx, job->sh, false, false, false);
+}
+
+static void
+compile_shader_cleanup(void *data, int thread_index)
+{
+   free(data);
+}
+
+/**
+ * Return the compiler thread pool if the front-end compile of \p sh can be
+ * moved off the calling thread (GL_KHR_parallel_shader_compile), or NULL if
+ * it must be compiled synchronously.
+ */
+static struct util_queue *
+get_shader_compiler_queue(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct util_queue *queue = &ctx->ShaderCompilerQueue;
+
+   /* glMaxShaderCompilerThreadsKHR(0) disables parallel compilation. */
+   if (!ctx->Const.DeferShaderCompile ||
+       ctx->Hint.MaxShaderCompilerThreads == 0)
+      return NULL;
+
+   /* Keep debug output in order with the API calls that caused it. The
+    * include tree of GL_ARB_shading_language_include is only valid for the
+    * duration of the call, so such shaders are compiled right away too.
+    */
+   if (ctx->Shader.Flags ||
+       _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS) ||
+       strstr(sh->Source, "#include"))
+      return NULL;
+
+   unsigned max_threads = CLAMP(util_cpu_caps.nr_cpus - 1, 1, 8);
+   unsigned num_threads = MIN2(ctx->Hint.MaxShaderCompilerThreads,
+                               max_threads);
+
+   if (!util_queue_is_initialized(queue)) {
+      if (!util_queue_init(queue, "glsl", 32, max_threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                           UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY))
+         return NULL;
+   }
+
+   if (queue->num_threads != num_threads)
+      util_queue_adjust_num_threads(queue, num_threads);
+
+   return queue;
+}
+
 /**
  * Compile a shader.
  */
@@ -1180,6 +1257,9 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
    if (!sh)
       return;
 
+   /* A previous glCompileShader may still be running. */
+   _mesa_shader_wait_compile(sh);
+
    /* The GL_ARB_gl_spirv spec says:
     *
     *    "Add a new error for the CompileShader command:
@@ -1206,6 +1286,20 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 
       ensure_builtin_types(ctx);
 
+      struct util_queue *queue = get_shader_compiler_queue(ctx, sh);
+      if (queue) {
+         struct compile_shader_job *job = malloc(sizeof(*job));
+
+         if (job) {
+            job->ctx = ctx;
+            job->sh = sh;
+            util_queue_add_job(queue, job, &sh->CompileFence,
+                               compile_shader_execute, compile_shader_cleanup,
+                               0);
+            return;
+         }
+      }
+
       /* this call will set the shader->CompileStatus field to indicate if
        * compilation was successful.
        */
@@ -1297,6 +1391,10 @@ link_program(struct gl_context *ctx, struct gl_shader_program *shProg,
       }
    }
 
+   /* Linking needs the IR of every attached shader. */
+   for (unsigned i = 0; i < shProg->NumShaders; i++)
+      _mesa_shader_wait_compile(shProg->Shaders[i]);
+
    unsigned programs_in_use = 0;
    if (ctx->_Shader)
       for (unsigned stage = 0; stage < MESA_SHADER_STAGES; stage++) {
@@ -91,6 +91,7 @@ static void
 _mesa_init_shader(struct gl_shader *shader)
 {
    shader->RefCount = 1;
+   util_queue_fence_init(&shader->CompileFence);
    shader->info.Geom.VerticesOut = -1;
    shader->info.Geom.InputType = GL_TRIANGLES;
    shader->info.Geom.OutputType = GL_TRIANGLE_STRIP;
@@ -116,12 +117,27 @@ _mesa_new_shader(GLuint name, gl_shader_stage stage)
 }
 
 
+/**
+ * Wait until a deferred compile of the shader (see
+ * gl_constants::DeferShaderCompile) has finished, so that its compile status,
+ * info log and IR can be accessed.
+ */
+void
+_mesa_shader_wait_compile(struct gl_shader *sh)
+{
+   util_queue_fence_wait(&sh->CompileFence);
+}
+
+
 /**
  * Delete a shader object.
  */
 void
 _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
+   _mesa_shader_wait_compile(sh);
+   util_queue_fence_destroy(&sh->CompileFence);
+
    _mesa_shader_spirv_data_reference(&sh->spirv_data, NULL);
    free((void *)sh->Source);
    free((void *)sh->FallbackSource);
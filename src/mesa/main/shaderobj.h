@@ -63,6 +63,9 @@ _mesa_lookup_shader(struct gl_context *ctx, GLuint name);
 extern struct gl_shader *
 _mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller);
 
+extern void
+_mesa_shader_wait_compile(struct gl_shader *sh);
+
 
 
 extern void
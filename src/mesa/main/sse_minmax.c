@@ -92,3 +92,83 @@ _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
    *min_index = min_ui;
    *max_index = max_ui;
 }
+
+
+/* Unaligned-load version of the above for any index size.  Restart indices
+ * are masked to 0 for the max and to all ones for the min, so they never
+ * win; "seen" records whether any lane held a real index at all.
+ */
+#define DEFINE_INDEX_MIN_MAX(name, type, lanes, min_op, max_op, cmpeq_op,   \
+                             set1_op)                                       \
+void                                                                        \
+name(const type *indices, bool restart, unsigned restart_index,             \
+     unsigned *min_index, unsigned *max_index, const unsigned count)        \
+{                                                                           \
+   unsigned max_val = 0;                                                    \
+   unsigned min_val = ~0U;                                                  \
+   unsigned i = 0;                                                          \
+                                                                            \
+   /* A restart index that doesn't fit the index type never matches. */     \
+   if ((type)restart_index != restart_index)                                \
+      restart = false;                                                      \
+                                                                            \
+   if (count >= 2 * (lanes)) {                                              \
+      const unsigned vec_count = count & ~((lanes) - 1);                    \
+      const __m128i ones = _mm_set1_epi32(~0);                              \
+      __m128i vmax = _mm_setzero_si128();                                   \
+      __m128i vmin = ones;                                                  \
+      __m128i seen;                                                         \
+      type max_arr[lanes], min_arr[lanes];                                  \
+                                                                            \
+      if (restart) {                                                        \
+         const __m128i restart_vec = set1_op((type)restart_index);          \
+         seen = _mm_setzero_si128();                                        \
+         for (; i < vec_count; i += (lanes)) {                              \
+            __m128i v = _mm_loadu_si128((const __m128i *)&indices[i]);      \
+            __m128i eq = cmpeq_op(v, restart_vec);                          \
+            seen = _mm_or_si128(seen, _mm_andnot_si128(eq, ones));          \
+            vmax = max_op(vmax, _mm_andnot_si128(eq, v));                   \
+            vmin = min_op(vmin, _mm_or_si128(eq, v));                       \
+         }                                                                  \
+      } else {                                                              \
+         seen = ones;                                                       \
+         for (; i < vec_count; i += (lanes)) {                              \
+            __m128i v = _mm_loadu_si128((const __m128i *)&indices[i]);      \
+            vmax = max_op(vmax, v);                                         \
+            vmin = min_op(vmin, v);                                         \
+         }                                                                  \
+      }                                                                     \
+                                                                            \
+      if (_mm_movemask_epi8(seen)) {                                        \
+         _mm_storeu_si128((__m128i *)max_arr, vmax);                        \
+         _mm_storeu_si128((__m128i *)min_arr, vmin);                        \
+         for (unsigned j = 0; j < (lanes); j++) {                           \
+            if (max_arr[j] > max_val)                                       \
+               max_val = max_arr[j];                                        \
+            if (min_arr[j] < min_val)                                       \
+               min_val = min_arr[j];                                        \
+         }                                                                  \
+      }                                                                     \
+   }                                                                        \
+                                                                            \
+   for (; i < count; i++) {                                                 \
+      if (restart && indices[i] == restart_index)                           \
+         continue;                                                          \
+      if (indices[i] > max_val)                                             \
+         max_val = indices[i];                                              \
+      if (indices[i] < min_val)                                             \
+         min_val = indices[i];                                              \
+   }                                                                        \
+                                                                            \
+   *min_index = min_val;                                                    \
+   *max_index = max_val;                                                    \
+}
+
+DEFINE_INDEX_MIN_MAX(_mesa_ubyte_index_min_max, uint8_t, 16,
+                     _mm_min_epu8, _mm_max_epu8, _mm_cmpeq_epi8, _mm_set1_epi8)
+DEFINE_INDEX_MIN_MAX(_mesa_ushort_index_min_max, uint16_t, 8,
+                     _mm_min_epu16, _mm_max_epu16, _mm_cmpeq_epi16,
+                     _mm_set1_epi16)
+DEFINE_INDEX_MIN_MAX(_mesa_uint_index_min_max, uint32_t, 4,
+                     _mm_min_epu32, _mm_max_epu32, _mm_cmpeq_epi32,
+                     _mm_set1_epi32)
@@ -28,8 +28,55 @@
 #ifndef SSE_MINMAX_H
 #define SSE_MINMAX_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void
 _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
                          unsigned *max_index, const unsigned count);
 
+/* Variants that can skip the primitive restart index.  If every index is
+ * the restart index, *min_index is ~0 and *max_index is 0.
+ */
+void
+_mesa_ubyte_index_min_max(const uint8_t *indices, bool restart,
+                          unsigned restart_index, unsigned *min_index,
+                          unsigned *max_index, const unsigned count);
+
+void
+_mesa_ushort_index_min_max(const uint16_t *indices, bool restart,
+                           unsigned restart_index, unsigned *min_index,
+                           unsigned *max_index, const unsigned count);
+
+void
+_mesa_uint_index_min_max(const uint32_t *indices, bool restart,
+                         unsigned restart_index, unsigned *min_index,
+                         unsigned *max_index, const unsigned count);
+
+/* AVX2 versions of the above, in avx2_minmax.c.  Only built with USE_AVX2
+ * and only to be called when util_cpu_caps.has_avx2 is set.
+ */
+void
+_mesa_ubyte_index_min_max_avx2(const uint8_t *indices, bool restart,
+                               unsigned restart_index, unsigned *min_index,
+                               unsigned *max_index, const unsigned count);
+
+void
+_mesa_ushort_index_min_max_avx2(const uint16_t *indices, bool restart,
+                                unsigned restart_index, unsigned *min_index,
+                                unsigned *max_index, const unsigned count);
+
+void
+_mesa_uint_index_min_max_avx2(const uint32_t *indices, bool restart,
+                              unsigned restart_index, unsigned *min_index,
+                              unsigned *max_index, const unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* SSE_MINMAX_H */
@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/sse_swizzle.h"
+#include "main/formats.h"
+#include <smmintrin.h>
+#include <string.h>
+
+/**
+ * Swizzle 8-bit pixels with 3 or 4 channels into 8-bit pixels with 3 or 4
+ * channels with one pshufb per 4 pixels.  This does the same as the
+ * UBYTE -> UBYTE case of _mesa_swizzle_and_convert().
+ *
+ * \param one  value of MESA_FORMAT_SWIZZLE_ONE in the destination
+ * \return the number of leading pixels converted, the caller converts the
+ *         rest.  0 if the channel counts or the swizzle aren't supported.
+ */
+int
+_mesa_swizzle_ubyte_sse41(uint8_t *dst, int num_dst_channels,
+                          const uint8_t *src, int num_src_channels,
+                          const uint8_t swizzle[4], uint8_t one, int count)
+{
+   uint8_t shuffle_bytes[16], fill_bytes[16];
+   int i;
+
+   if (num_src_channels < 3 || num_dst_channels < 3)
+      return 0;
+
+   memset(shuffle_bytes, 0x80, sizeof(shuffle_bytes));
+   memset(fill_bytes, 0, sizeof(fill_bytes));
+
+   for (int p = 0; p < 4; p++) {
+      for (int c = 0; c < num_dst_channels; c++) {
+         const int b = p * num_dst_channels + c;
+
+         if (swizzle[c] < num_src_channels)
+            shuffle_bytes[b] = p * num_src_channels + swizzle[c];
+         else if (swizzle[c] == MESA_FORMAT_SWIZZLE_ONE)
+            fill_bytes[b] = one;
+         else if (swizzle[c] != MESA_FORMAT_SWIZZLE_ZERO)
+            return 0;
+      }
+   }
+
+   const __m128i shuffle = _mm_loadu_si128((const __m128i *)shuffle_bytes);
+   const __m128i fill = _mm_loadu_si128((const __m128i *)fill_bytes);
+
+   /* Each step loads 16 source bytes but only uses 4 pixels, so stop while
+    * the load is still inside the source row.
+    */
+   const int last = count - (16 + num_src_channels - 1) / num_src_channels;
+
+   for (i = 0; i <= last; i += 4) {
+      const __m128i pixels =
+         _mm_loadu_si128((const __m128i *)(src + i * num_src_channels));
+      const __m128i result =
+         _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), fill);
+
+      if (num_dst_channels == 4) {
+         _mm_storeu_si128((__m128i *)(dst + i * 4), result);
+      } else {
+         const int hi = _mm_cvtsi128_si32(_mm_srli_si128(result, 8));
+
+         _mm_storel_epi64((__m128i *)(dst + i * 3), result);
+         memcpy(dst + i * 3 + 8, &hi, sizeof(hi));
+      }
+   }
+
+   return i;
+}
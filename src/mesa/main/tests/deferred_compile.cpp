@@ -0,0 +1,253 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name deferred_compile.cpp
+ *
+ * Check that everything that needs the result of a glCompileShader running
+ * on the compiler queue (GL_KHR_parallel_shader_compile) waits for it.
+ *
+ * The queue gets a single thread, and a job that blocks it until another
+ * thread opens a gate, so that the compiles queued behind it are still
+ * pending when they are queried.  Runs on a compatibility context without
+ * any driver.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/shaderapi.h"
+#include "main/shaderobj.h"
+#include "drivers/common/driverfuncs.h"
+#include "util/u_queue.h"
+
+static const char vs_source[] =
+   "void main() { gl_Position = gl_Vertex; }\n";
+static const char fs_source[] =
+   "void main() { gl_FragColor = vec4(1.0); }\n";
+static const char bad_source[] =
+   "void main() { gl_FragColor = undeclared; }\n";
+
+/* Nothing to do after linking without a driver. */
+static GLboolean
+link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   return GL_TRUE;
+}
+
+struct gate {
+   struct util_queue_fence fence;
+   struct util_queue_fence open;
+   std::atomic<bool> opened;
+};
+
+static void
+gate_execute(void *data, int thread_index)
+{
+   struct gate *gate = (struct gate *) data;
+
+   util_queue_fence_wait(&gate->open);
+}
+
+class DeferredCompileTest : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   GLuint create_shader(GLenum type, const char *source);
+   void close_gate();
+   void open_gate_later();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct gate gate;
+   std::thread opener;
+};
+
+void
+DeferredCompileTest::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.LinkShader = link_shader;
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   ctx.Extensions.ARB_vertex_shader = true;
+   ctx.Extensions.ARB_fragment_shader = true;
+   ctx.Const.DeferShaderCompile = true;
+   ctx.Version = 20;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+
+   ctx.Hint.MaxShaderCompilerThreads = 1;
+
+   /* The first deferred compile creates the queue. */
+   GLuint warm_up = create_shader(GL_VERTEX_SHADER, vs_source);
+   _mesa_CompileShader(warm_up);
+   _mesa_DeleteShader(warm_up);
+   ASSERT_TRUE(util_queue_is_initialized(&ctx.ShaderCompilerQueue));
+   ASSERT_EQ(ctx.ShaderCompilerQueue.num_threads, 1u);
+
+   util_queue_fence_init(&gate.fence);
+   util_queue_fence_init(&gate.open);
+}
+
+void
+DeferredCompileTest::TearDown()
+{
+   if (opener.joinable())
+      opener.join();
+   util_queue_fence_wait(&gate.fence);
+   util_queue_fence_destroy(&gate.fence);
+   util_queue_fence_destroy(&gate.open);
+
+   EXPECT_EQ(ctx.ErrorValue, (GLenum)GL_NO_ERROR);
+
+   _mesa_make_current(NULL, NULL, NULL);
+   _mesa_free_context_data(&ctx, true);
+}
+
+GLuint
+DeferredCompileTest::create_shader(GLenum type, const char *source)
+{
+   GLuint shader = _mesa_CreateShader(type);
+
+   _mesa_ShaderSource(shader, 1, &source, NULL);
+   return shader;
+}
+
+/* Block the compiler thread until open_gate_later(). */
+void
+DeferredCompileTest::close_gate()
+{
+   gate.opened = false;
+   util_queue_fence_reset(&gate.open);
+   util_queue_add_job(&ctx.ShaderCompilerQueue, &gate, &gate.fence,
+                      gate_execute, NULL, 0);
+}
+
+/* Open the gate from another thread, after giving a call that doesn't wait
+ * time to return first.
+ */
+void
+DeferredCompileTest::open_gate_later()
+{
+   opener = std::thread([this] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      gate.opened = true;
+      util_queue_fence_signal(&gate.open);
+   });
+}
+
+static GLint
+get_shaderiv(GLuint shader, GLenum pname)
+{
+   GLint value = -1;
+
+   _mesa_GetShaderiv(shader, pname, &value);
+   return value;
+}
+
+TEST_F(DeferredCompileTest, CompileStatus)
+{
+   GLuint shader = create_shader(GL_VERTEX_SHADER, vs_source);
+
+   close_gate();
+   _mesa_CompileShader(shader);
+   EXPECT_EQ(get_shaderiv(shader, GL_COMPLETION_STATUS_ARB), GL_FALSE);
+
+   open_gate_later();
+   EXPECT_EQ(get_shaderiv(shader, GL_COMPILE_STATUS), GL_TRUE);
+   EXPECT_TRUE(gate.opened);
+   EXPECT_EQ(get_shaderiv(shader, GL_COMPLETION_STATUS_ARB), GL_TRUE);
+
+   _mesa_DeleteShader(shader);
+}
+
+TEST_F(DeferredCompileTest, InfoLog)
+{
+   GLuint shader = create_shader(GL_FRAGMENT_SHADER, bad_source);
+   GLchar log[1000];
+   GLsizei length = 0;
+
+   close_gate();
+   _mesa_CompileShader(shader);
+   EXPECT_EQ(get_shaderiv(shader, GL_COMPLETION_STATUS_ARB), GL_FALSE);
+
+   open_gate_later();
+   _mesa_GetShaderInfoLog(shader, sizeof(log), &length, log);
+   EXPECT_TRUE(gate.opened);
+   EXPECT_GT(length, 0);
+   EXPECT_EQ(get_shaderiv(shader, GL_COMPILE_STATUS), GL_FALSE);
+
+   _mesa_DeleteShader(shader);
+}
+
+TEST_F(DeferredCompileTest, Link)
+{
+   GLuint vs = create_shader(GL_VERTEX_SHADER, vs_source);
+   GLuint fs = create_shader(GL_FRAGMENT_SHADER, fs_source);
+   GLuint program = _mesa_CreateProgram();
+   GLint status = GL_FALSE;
+
+   close_gate();
+   _mesa_CompileShader(vs);
+   _mesa_CompileShader(fs);
+   _mesa_AttachShader(program, vs);
+   _mesa_AttachShader(program, fs);
+
+   open_gate_later();
+   _mesa_LinkProgram(program);
+   EXPECT_TRUE(gate.opened);
+   _mesa_GetProgramiv(program, GL_LINK_STATUS, &status);
+   EXPECT_EQ(status, GL_TRUE);
+
+   _mesa_DeleteProgram(program);
+   _mesa_DeleteShader(vs);
+   _mesa_DeleteShader(fs);
+}
+
+/* Deleting a shader whose compile hasn't run yet waits for it, instead of
+ * freeing the shader under the compiler thread.
+ */
+TEST_F(DeferredCompileTest, DeletePending)
+{
+   GLuint shader = create_shader(GL_FRAGMENT_SHADER, fs_source);
+
+   close_gate();
+   _mesa_CompileShader(shader);
+
+   open_gate_later();
+   _mesa_DeleteShader(shader);
+   EXPECT_TRUE(gate.opened);
+   EXPECT_EQ(_mesa_lookup_shader(&ctx, shader), nullptr);
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name dlist.cpp
+ *
+ * Check that compiling a display list doesn't drop attribute calls that
+ * look redundant but have side effects through GL_COLOR_MATERIAL or
+ * evaluators.  Runs on a compatibility context without any driver.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/extensions.h"
+#include "main/vtxfmt.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+static const GLfloat red[4] = { 1, 0, 0, 1 };
+static const GLfloat green[4] = { 0, 1, 0, 1 };
+static const GLfloat blue[4] = { 0, 0, 1, 1 };
+
+class DlistTest : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   /* Switches between ctx.Exec and ctx.Save with glNewList/glEndList. */
+   struct _glapi_table *disp() { return ctx.CurrentClientDispatch; }
+
+   /* Update the current values and the materials. */
+   void flush()
+   {
+      struct gl_context *c = &ctx;
+      FLUSH_CURRENT(c, 0);
+   }
+
+   void expect_vec4(const GLfloat *value, const GLfloat *expected)
+   {
+      for (unsigned i = 0; i < 4; i++)
+         EXPECT_EQ(value[i], expected[i]) << "component " << i;
+   }
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+DlistTest::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   _vbo_CreateContext(&ctx, false);
+   _mesa_override_extensions(&ctx);
+   ctx.Version = 30;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+}
+
+void
+DlistTest::TearDown()
+{
+   EXPECT_EQ(ctx.ErrorValue, (GLenum)GL_NO_ERROR);
+
+   _mesa_make_current(NULL, NULL, NULL);
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx, false);
+}
+
+/* With GL_COLOR_MATERIAL, the second glColor sets the material again. */
+TEST_F(DlistTest, ColorAfterMaterial)
+{
+   CALL_Enable(disp(), (GL_COLOR_MATERIAL));
+   CALL_ColorMaterial(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE));
+
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Color4fv(disp(), (red));
+   CALL_Materialfv(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE, green));
+   CALL_Color4fv(disp(), (red));
+   CALL_EndList(disp(), ());
+
+   CALL_CallList(disp(), (1));
+   flush();
+
+   expect_vec4(ctx.Light.Material.Attrib[MAT_ATTRIB_FRONT_DIFFUSE], red);
+   expect_vec4(ctx.Light.Material.Attrib[MAT_ATTRIB_BACK_DIFFUSE], red);
+}
+
+/* With GL_COLOR_MATERIAL, glColor overwrites the material, so setting the
+ * same material again isn't redundant.
+ */
+TEST_F(DlistTest, MaterialAfterColor)
+{
+   CALL_Enable(disp(), (GL_COLOR_MATERIAL));
+   CALL_ColorMaterial(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE));
+
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Materialfv(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE, green));
+   CALL_Color4fv(disp(), (red));
+   CALL_Disable(disp(), (GL_COLOR_MATERIAL));
+   CALL_Materialfv(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE, green));
+   CALL_EndList(disp(), ());
+
+   CALL_CallList(disp(), (1));
+   flush();
+
+   expect_vec4(ctx.Light.Material.Attrib[MAT_ATTRIB_FRONT_DIFFUSE], green);
+   expect_vec4(ctx.Current.Attrib[VERT_ATTRIB_COLOR0], red);
+}
+
+/* glColorMaterial copies the current color into the material. */
+TEST_F(DlistTest, MaterialAfterColorMaterial)
+{
+   CALL_Color4fv(disp(), (red));
+   CALL_Enable(disp(), (GL_COLOR_MATERIAL));
+   CALL_ColorMaterial(disp(), (GL_FRONT_AND_BACK, GL_AMBIENT));
+
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Materialfv(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE, green));
+   CALL_ColorMaterial(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE));
+   CALL_Disable(disp(), (GL_COLOR_MATERIAL));
+   CALL_Materialfv(disp(), (GL_FRONT_AND_BACK, GL_DIFFUSE, green));
+   CALL_EndList(disp(), ());
+
+   CALL_CallList(disp(), (1));
+   flush();
+
+   expect_vec4(ctx.Light.Material.Attrib[MAT_ATTRIB_FRONT_DIFFUSE], green);
+}
+
+/* The color evaluated by glEvalCoord doesn't replace the list's color. */
+TEST_F(DlistTest, ColorAfterEvaluator)
+{
+   const GLfloat points[2][4] = {
+      { blue[0], blue[1], blue[2], blue[3] },
+      { blue[0], blue[1], blue[2], blue[3] },
+   };
+
+   CALL_Map1f(disp(), (GL_MAP1_COLOR_4, 0, 1, 4, 2, &points[0][0]));
+   CALL_Enable(disp(), (GL_MAP1_COLOR_4));
+
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Color4fv(disp(), (red));
+   CALL_EvalCoord1f(disp(), (0.5));
+   CALL_Color4fv(disp(), (red));
+   CALL_EndList(disp(), ());
+
+   CALL_Color4fv(disp(), (green));
+   CALL_CallList(disp(), (1));
+   flush();
+
+   expect_vec4(ctx.Current.Attrib[VERT_ATTRIB_COLOR0], red);
+}
+
+/* Repeated colors between other attributes can be dropped. */
+TEST_F(DlistTest, RedundantColor)
+{
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Color4fv(disp(), (red));
+   CALL_Normal3f(disp(), (0, 0, 1));
+   CALL_Color4fv(disp(), (red));
+   CALL_Normal3f(disp(), (0, 1, 0));
+   CALL_Color4fv(disp(), (red));
+   CALL_EndList(disp(), ());
+
+   CALL_Color4fv(disp(), (green));
+   CALL_CallList(disp(), (1));
+   flush();
+
+   expect_vec4(ctx.Current.Attrib[VERT_ATTRIB_COLOR0], red);
+   EXPECT_EQ(ctx.Current.Attrib[VERT_ATTRIB_NORMAL][1], 1.0f);
+}
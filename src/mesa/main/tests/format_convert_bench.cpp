@@ -0,0 +1,104 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name format_convert_bench.cpp
+ *
+ * Measure the throughput of _mesa_format_convert() for the format pairs
+ * that glTexImage and glReadPixels hit most often.
+ *
+ * Usage: format_convert_bench [width height [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/formats.h"
+#include "main/format_utils.h"
+#include "util/os_time.h"
+
+static const struct {
+   mesa_format src, dst;
+} pairs[] = {
+   { MESA_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_B8G8R8A8_UNORM },
+   { MESA_FORMAT_B8G8R8A8_UNORM, MESA_FORMAT_R8G8B8A8_UNORM },
+   { MESA_FORMAT_RGB_UNORM8, MESA_FORMAT_R8G8B8A8_UNORM },
+   { MESA_FORMAT_RGB_UNORM8, MESA_FORMAT_B8G8R8A8_UNORM },
+   { MESA_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_RGB_UNORM8 },
+   { MESA_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_RGBA_FLOAT32 },
+   { MESA_FORMAT_RGBA_FLOAT32, MESA_FORMAT_R8G8B8A8_UNORM },
+};
+
+int
+main(int argc, char **argv)
+{
+   const unsigned width = argc > 2 ? atoi(argv[1]) : 4096;
+   const unsigned height = argc > 2 ? atoi(argv[2]) : 2048;
+   const unsigned iterations = argc > 3 ? atoi(argv[3]) : 10;
+   const size_t max_size = (size_t) width * height * 16;
+   uint8_t *src = (uint8_t *) malloc(max_size);
+   uint8_t *dst = (uint8_t *) malloc(max_size);
+
+   if (!src || !dst || !width || !height || !iterations) {
+      fprintf(stderr, "usage: %s [width height [iterations]]\n", argv[0]);
+      return 1;
+   }
+
+   for (size_t i = 0; i < max_size; i++)
+      src[i] = i * 37 + 11;
+
+   printf("%ux%u, %u iterations\n", width, height, iterations);
+   printf("%-32s %-32s %10s %10s\n", "src", "dst", "ms", "GB/s");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(pairs); i++) {
+      const unsigned src_bpp = _mesa_get_format_bytes(pairs[i].src);
+      const unsigned dst_bpp = _mesa_get_format_bytes(pairs[i].dst);
+
+      /* Float sources would be full of NaNs otherwise. */
+      if (_mesa_get_format_datatype(pairs[i].src) == GL_FLOAT) {
+         float *f = (float *) src;
+         for (size_t j = 0; j < (size_t) width * height * 4; j++)
+            f[j] = (j % 256) / 255.0f;
+      }
+
+      int64_t start = os_time_get_nano();
+      for (unsigned it = 0; it < iterations; it++) {
+         _mesa_format_convert(dst, pairs[i].dst, width * dst_bpp,
+                              src, pairs[i].src, width * src_bpp,
+                              width, height, NULL);
+      }
+      int64_t elapsed = os_time_get_nano() - start;
+
+      /* Bytes read plus bytes written */
+      double bytes = (double) width * height * (src_bpp + dst_bpp) *
+                     iterations;
+      printf("%-32s %-32s %10.2f %10.2f\n",
+             _mesa_get_format_name(pairs[i].src),
+             _mesa_get_format_name(pairs[i].dst),
+             elapsed / 1e6 / iterations, bytes / elapsed);
+   }
+
+   free(src);
+   free(dst);
+   return 0;
+}
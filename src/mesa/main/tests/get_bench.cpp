@@ -0,0 +1,127 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name get_bench.cpp
+ *
+ * Measure the cost of glGetBooleanv, glGetIntegerv and glGetFloatv for a
+ * few pnames of each kind of value_desc in get.c, on a compatibility
+ * context without any driver.
+ *
+ * Usage: get_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/extensions.h"
+#include "main/get.h"
+#include "main/vtxfmt.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+#include "util/os_time.h"
+
+static const struct {
+   GLenum pname;
+   const char *name;
+} pnames[] = {
+   /* Scalar context fields and constants */
+   { GL_MAX_TEXTURE_SIZE, "GL_MAX_TEXTURE_SIZE" },
+   { GL_DEPTH_FUNC, "GL_DEPTH_FUNC" },
+   { GL_DEPTH_WRITEMASK, "GL_DEPTH_WRITEMASK" },
+   { GL_LINE_WIDTH, "GL_LINE_WIDTH" },
+   { GL_BLEND, "GL_BLEND" },
+   { GL_MAX_LABEL_LENGTH, "GL_MAX_LABEL_LENGTH" },
+   /* Computed values */
+   { GL_VIEWPORT, "GL_VIEWPORT" },
+   { GL_MAJOR_VERSION, "GL_MAJOR_VERSION" },
+   { GL_COLOR_CLEAR_VALUE, "GL_COLOR_CLEAR_VALUE" },
+};
+
+template<typename T>
+static double
+time_get(void (GLAPIENTRY *get)(GLenum, T *), GLenum pname,
+         unsigned iterations)
+{
+   T result[16];
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++)
+      get(pname, result);
+   int64_t elapsed = os_time_get_nano() - start;
+
+   return (double) elapsed / iterations;
+}
+
+int
+main(int argc, char **argv)
+{
+   const unsigned iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+   struct dd_function_table driver_functions;
+   struct gl_config visual;
+   struct gl_context ctx;
+
+   if (!iterations) {
+      fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+      return 1;
+   }
+
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&visual, 0, sizeof(visual));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   if (!_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                                 &driver_functions)) {
+      fprintf(stderr, "failed to create a context\n");
+      return 1;
+   }
+   _vbo_CreateContext(&ctx, false);
+   _mesa_override_extensions(&ctx);
+   ctx.Version = 30;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+
+   printf("%u iterations\n", iterations);
+   printf("%-24s %12s %12s %12s\n", "pname",
+          "Booleanv ns", "Integerv ns", "Floatv ns");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(pnames); i++) {
+      printf("%-24s %12.2f %12.2f %12.2f\n", pnames[i].name,
+             time_get(_mesa_GetBooleanv, pnames[i].pname, iterations),
+             time_get(_mesa_GetIntegerv, pnames[i].pname, iterations),
+             time_get(_mesa_GetFloatv, pnames[i].pname, iterations));
+   }
+
+   if (ctx.ErrorValue != GL_NO_ERROR)
+      fprintf(stderr, "unexpected GL error 0x%x\n", ctx.ErrorValue);
+
+   _mesa_make_current(NULL, NULL, NULL);
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx, false);
+   return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name glthread.cpp
+ *
+ * Check that the glIsEnabled and glGet* queries answered from the state
+ * shadowed by glthread don't sync, and return what the context returns
+ * after syncing.  Runs on a compatibility context without any driver.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/extensions.h"
+#include "main/framebuffer.h"
+#include "main/glthread.h"
+#include "main/vtxfmt.h"
+#include "drivers/common/driverfuncs.h"
+#include "util/hash_table.h"
+#include "vbo/vbo.h"
+
+static void
+set_background_context(struct gl_context *ctx,
+                       struct util_queue_monitoring *queue_info)
+{
+}
+
+class GlthreadGetTest : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct _glapi_table *disp() { return ctx.CurrentClientDispatch; }
+
+   /* Number of times glthread has synced for a query. */
+   unsigned syncs()
+   {
+      unsigned count = 0;
+
+      hash_table_foreach(ctx.GLThread.SyncStats, entry)
+         count += (uintptr_t)entry->data;
+      return count;
+   }
+
+   void expect_viewport(GLint x, GLint y, GLint width, GLint height,
+                        bool shadowed = true);
+   void expect_enabled(GLenum cap, bool enabled);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+GlthreadGetTest::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.SetBackgroundContext = set_background_context;
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   _vbo_CreateContext(&ctx, false);
+   _mesa_override_extensions(&ctx);
+   ctx.Version = 30;
+   ctx.Const.MaxViewports = 16;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+
+   setenv("MESA_GLTHREAD_SYNC_STATS", "1", 1);
+   _mesa_glthread_init(&ctx);
+   ASSERT_TRUE(ctx.GLThread.enabled);
+}
+
+void
+GlthreadGetTest::TearDown()
+{
+   _mesa_glthread_destroy(&ctx);
+   EXPECT_EQ(ctx.ErrorValue, (GLenum)GL_NO_ERROR);
+
+   _mesa_make_current(NULL, NULL, NULL);
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx, false);
+}
+
+/* Check GL_VIEWPORT through all the getters, and that it was answered
+ * without syncing if it's \p shadowed.
+ */
+void
+GlthreadGetTest::expect_viewport(GLint x, GLint y, GLint width, GLint height,
+                                 bool shadowed)
+{
+   const GLint expected[4] = { x, y, width, height };
+   GLint i[4], actual[4];
+   GLfloat f[4];
+   GLboolean b[4];
+   unsigned old_syncs = syncs();
+
+   CALL_GetIntegerv(disp(), (GL_VIEWPORT, i));
+   CALL_GetFloatv(disp(), (GL_VIEWPORT, f));
+   CALL_GetBooleanv(disp(), (GL_VIEWPORT, b));
+   if (shadowed)
+      EXPECT_EQ(syncs(), old_syncs);
+   else
+      EXPECT_GT(syncs(), old_syncs);
+
+   _mesa_glthread_finish(&ctx);
+   CALL_GetIntegerv(ctx.CurrentServerDispatch, (GL_VIEWPORT, actual));
+
+   for (unsigned c = 0; c < 4; c++) {
+      EXPECT_EQ(actual[c], expected[c]) << "component " << c;
+      EXPECT_EQ(i[c], expected[c]) << "component " << c;
+      EXPECT_EQ(f[c], (GLfloat)expected[c]) << "component " << c;
+      EXPECT_EQ(b[c], expected[c] ? GL_TRUE : GL_FALSE) << "component " << c;
+   }
+}
+
+void
+GlthreadGetTest::expect_enabled(GLenum cap, bool enabled)
+{
+   unsigned old_syncs = syncs();
+   GLboolean b;
+   GLint i;
+
+   EXPECT_EQ(CALL_IsEnabled(disp(), (cap)), enabled);
+   CALL_GetBooleanv(disp(), (cap, &b));
+   CALL_GetIntegerv(disp(), (cap, &i));
+   EXPECT_EQ(syncs(), old_syncs);
+   EXPECT_EQ(b, enabled);
+   EXPECT_EQ(i, enabled);
+
+   _mesa_glthread_finish(&ctx);
+   EXPECT_EQ(CALL_IsEnabled(ctx.CurrentServerDispatch, (cap)), enabled);
+}
+
+TEST_F(GlthreadGetTest, Viewport)
+{
+   /* The initial viewport is the size of the drawable. */
+   expect_viewport(0, 0, 0, 0, false);
+
+   CALL_Viewport(disp(), (1, 2, 30, 40));
+   expect_viewport(1, 2, 30, 40);
+
+   /* Errors don't change the viewport. */
+   CALL_Viewport(disp(), (5, 6, -1, 40));
+   expect_viewport(1, 2, 30, 40);
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_INVALID_VALUE);
+
+   const GLfloat v[] = { 5, 6, 70, 80 };
+   CALL_ViewportIndexedfv(disp(), (0, v));
+   expect_viewport(5, 6, 70, 80);
+}
+
+TEST_F(GlthreadGetTest, ViewportArray)
+{
+   const GLfloat valid[] = {
+      7, 8, 90, 100,
+      0, 0, 10, 10,
+   };
+   const GLfloat invalid[] = {
+      1, 2, 30, 40,
+      0, 0, 10, -10,
+   };
+
+   CALL_ViewportArrayv(disp(), (0, 2, valid));
+   expect_viewport(7, 8, 90, 100);
+
+   /* A negative size in any viewport makes the whole call an error. */
+   CALL_ViewportArrayv(disp(), (0, 2, invalid));
+   expect_viewport(7, 8, 90, 100);
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_INVALID_VALUE);
+
+   CALL_ViewportArrayv(disp(), (0, 17, valid));
+   expect_viewport(7, 8, 90, 100);
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_INVALID_VALUE);
+}
+
+/* Binding a drawable for the first time sets the viewport to its size. */
+TEST_F(GlthreadGetTest, ViewportOfFirstDrawable)
+{
+   CALL_Viewport(disp(), (1, 2, 30, 40));
+   expect_viewport(1, 2, 30, 40);
+
+   struct gl_framebuffer *fb = _mesa_create_framebuffer(&visual);
+   fb->Width = 100;
+   fb->Height = 50;
+
+   _mesa_glthread_finish(&ctx);
+   _mesa_make_current(&ctx, fb, fb);
+   expect_viewport(0, 0, 100, 50, false);
+
+   CALL_Viewport(disp(), (3, 4, 50, 60));
+   expect_viewport(3, 4, 50, 60);
+
+   _mesa_glthread_finish(&ctx);
+   _mesa_make_current(&ctx, NULL, NULL);
+   _mesa_reference_framebuffer(&fb, NULL);
+}
+
+TEST_F(GlthreadGetTest, ViewportAttrib)
+{
+   CALL_Viewport(disp(), (1, 2, 30, 40));
+   CALL_PushAttrib(disp(), (GL_VIEWPORT_BIT));
+   CALL_Viewport(disp(), (5, 6, 70, 80));
+   expect_viewport(5, 6, 70, 80);
+   CALL_PopAttrib(disp(), ());
+   expect_viewport(1, 2, 30, 40);
+}
+
+TEST_F(GlthreadGetTest, Enables)
+{
+   expect_enabled(GL_DEPTH_TEST, false);
+   expect_enabled(GL_DITHER, true);
+   expect_enabled(GL_LIGHTING, false);
+
+   CALL_Enable(disp(), (GL_DEPTH_TEST));
+   CALL_Disable(disp(), (GL_DITHER));
+   CALL_Enablei(disp(), (GL_SCISSOR_TEST, 0));
+   expect_enabled(GL_DEPTH_TEST, true);
+   expect_enabled(GL_DITHER, false);
+   expect_enabled(GL_SCISSOR_TEST, true);
+
+   /* glEnablei(GL_BLEND) needs EXT_draw_buffers2. */
+   CALL_Enablei(disp(), (GL_BLEND, 0));
+   expect_enabled(GL_BLEND, false);
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_INVALID_ENUM);
+
+   ctx.Extensions.EXT_draw_buffers2 = true;
+   CALL_Enablei(disp(), (GL_BLEND, 0));
+   expect_enabled(GL_BLEND, true);
+
+   CALL_PushAttrib(disp(), (GL_ENABLE_BIT));
+   CALL_Disable(disp(), (GL_DEPTH_TEST));
+   CALL_Enable(disp(), (GL_LIGHTING));
+   expect_enabled(GL_DEPTH_TEST, false);
+   expect_enabled(GL_LIGHTING, true);
+   CALL_PopAttrib(disp(), ());
+   expect_enabled(GL_DEPTH_TEST, true);
+   expect_enabled(GL_LIGHTING, false);
+
+   /* GL_DEPTH_BUFFER_BIT restores the depth test, not the blend enable. */
+   CALL_PushAttrib(disp(), (GL_DEPTH_BUFFER_BIT));
+   CALL_Disable(disp(), (GL_BLEND));
+   CALL_Disable(disp(), (GL_DEPTH_TEST));
+   CALL_PopAttrib(disp(), ());
+   expect_enabled(GL_BLEND, false);
+   expect_enabled(GL_DEPTH_TEST, true);
+}
+
+/* Enables compiled into a display list are applied when it's called. */
+TEST_F(GlthreadGetTest, EnablesInDisplayList)
+{
+   CALL_NewList(disp(), (1, GL_COMPILE));
+   CALL_Enable(disp(), (GL_CULL_FACE));
+   CALL_Viewport(disp(), (1, 2, 30, 40));
+   CALL_EndList(disp(), ());
+   expect_enabled(GL_CULL_FACE, false);
+
+   CALL_CallList(disp(), (1));
+   expect_enabled(GL_CULL_FACE, true);
+   expect_viewport(1, 2, 30, 40);
+}
+
+/* KHR_no_error contexts still report GL_OUT_OF_MEMORY. */
+TEST_F(GlthreadGetTest, OutOfMemoryWithNoError)
+{
+   ctx.Const.ContextFlags |= GL_CONTEXT_FLAG_NO_ERROR_BIT_KHR;
+
+   _mesa_glthread_finish(&ctx);
+   ctx.ErrorValue = GL_OUT_OF_MEMORY;
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_OUT_OF_MEMORY);
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_NO_ERROR);
+
+   _mesa_glthread_finish(&ctx);
+   ctx.ErrorValue = GL_INVALID_VALUE;
+   EXPECT_EQ(CALL_GetError(disp(), ()), (GLenum)GL_NO_ERROR);
+}
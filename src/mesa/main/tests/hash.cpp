@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name hash.cpp
+ *
+ * Check the lookups of _mesa_HashTable, which don't take the mutex.
+ */
+
+#include <gtest/gtest.h>
+
+#include "c11/threads.h"
+#include "main/hash.h"
+
+static void *
+value(GLuint key)
+{
+   return (void *)(uintptr_t)(key * 4 + 4);
+}
+
+TEST(MesaHashTest, InsertLookupRemove)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+
+   for (GLuint key = 1; key < 1000; key += 3)
+      _mesa_HashInsert(table, key, value(key), GL_TRUE);
+
+   EXPECT_EQ(_mesa_HashNumEntries(table), 333u);
+
+   for (GLuint key = 1; key < 1000; key++) {
+      void *expected = key % 3 == 1 ? value(key) : NULL;
+
+      EXPECT_EQ(_mesa_HashLookup(table, key), expected) << key;
+
+      _mesa_HashLockMutex(table);
+      EXPECT_EQ(_mesa_HashLookupLocked(table, key), expected) << key;
+      _mesa_HashUnlockMutex(table);
+   }
+
+   /* DELETED_KEY_VALUE is stored outside of the struct hash_table. */
+   EXPECT_EQ(_mesa_HashLookup(table, DELETED_KEY_VALUE),
+             value(DELETED_KEY_VALUE));
+   _mesa_HashRemove(table, DELETED_KEY_VALUE);
+   EXPECT_EQ(_mesa_HashLookup(table, DELETED_KEY_VALUE), (void *)NULL);
+
+   _mesa_HashRemove(table, 4);
+   EXPECT_EQ(_mesa_HashLookup(table, 4), (void *)NULL);
+   EXPECT_EQ(_mesa_HashLookup(table, 7), value(7));
+   EXPECT_EQ(_mesa_HashNumEntries(table), 331u);
+
+   _mesa_DeleteHashTable(table);
+}
+
+static void
+count_entry(void *data, void *userData)
+{
+   (*(unsigned *)userData)++;
+}
+
+TEST(MesaHashTest, DeleteAll)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   unsigned count = 0;
+
+   for (GLuint key = 1; key < 100; key++)
+      _mesa_HashInsert(table, key, value(key), GL_TRUE);
+
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   EXPECT_EQ(count, 99u);
+
+   for (GLuint key = 1; key < 100; key++)
+      EXPECT_EQ(_mesa_HashLookup(table, key), (void *)NULL) << key;
+
+   _mesa_DeleteHashTable(table);
+}
+
+/* Looking up names that were never inserted, as applications do to check
+ * if a name is valid, must not grow the table.
+ */
+TEST(MesaHashTest, LookupDoesntAllocate)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+
+   EXPECT_EQ(_mesa_HashLookup(table, 12345), (void *)NULL);
+   EXPECT_EQ(table->array.root, 0u);
+
+   _mesa_HashInsert(table, 3, value(3), GL_TRUE);
+   _mesa_HashInsert(table, 1 << 20, value(1 << 20), GL_TRUE);
+
+   const uintptr_t root = table->array.root;
+   for (GLuint key = 1 << 10; key < 1 << 20; key += 997)
+      EXPECT_EQ(_mesa_HashLookup(table, key), (void *)NULL) << key;
+   EXPECT_EQ(_mesa_HashLookup(table, ~0u - 1), (void *)NULL);
+   EXPECT_EQ(_mesa_HashLookup(table, ~0u), (void *)NULL);
+   EXPECT_EQ(table->array.root, root);
+
+   EXPECT_EQ(_mesa_HashLookup(table, 3), value(3));
+   EXPECT_EQ(_mesa_HashLookup(table, 1 << 20), value(1 << 20));
+
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(MesaHashTest, MaybeLocked)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+
+   _mesa_HashInsertMaybeLocked(table, 5, value(5), GL_TRUE, false);
+   EXPECT_EQ(_mesa_HashLookupMaybeLocked(table, 5, false),
+             (struct gl_buffer_object *)value(5));
+
+   _mesa_HashLockMaybeLocked(table, false);
+   _mesa_HashInsertMaybeLocked(table, 6, value(6), GL_TRUE, true);
+   EXPECT_EQ(_mesa_HashLookupMaybeLocked(table, 6, true),
+             (struct gl_buffer_object *)value(6));
+   EXPECT_EQ(_mesa_HashLookupMaybeLocked(table, 7, true),
+             (struct gl_buffer_object *)NULL);
+   _mesa_HashUnlockMaybeLocked(table, false);
+
+   _mesa_DeleteHashTable(table);
+}
+
+struct writer_state {
+   struct _mesa_HashTable *table;
+   GLuint first_key;
+   GLuint num_keys;
+};
+
+static int
+writer_thread(void *data)
+{
+   struct writer_state *state = (struct writer_state *)data;
+
+   for (unsigned i = 0; i < 16; i++) {
+      for (GLuint k = 0; k < state->num_keys; k++) {
+         GLuint key = state->first_key + k;
+         _mesa_HashInsert(state->table, key, value(key), GL_TRUE);
+      }
+      for (GLuint k = 0; k < state->num_keys; k++)
+         _mesa_HashRemove(state->table, state->first_key + k);
+   }
+   return 0;
+}
+
+/* Lookups run concurrently with insertions and removals of other keys, and
+ * only ever see NULL or the inserted value.
+ */
+TEST(MesaHashTest, ConcurrentLookups)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   struct writer_state state = { table, 1000, 4096 };
+   thrd_t writer;
+
+   for (GLuint key = 1; key < 1000; key++)
+      _mesa_HashInsert(table, key, value(key), GL_TRUE);
+
+   ASSERT_EQ(thrd_create(&writer, writer_thread, &state), thrd_success);
+
+   for (unsigned i = 0; i < 64; i++) {
+      for (GLuint key = 1; key < 1000 + state.num_keys; key += 7) {
+         void *data = _mesa_HashLookup(table, key);
+
+         if (key < 1000 || data) {
+            ASSERT_EQ(data, value(key)) << key;
+         }
+      }
+   }
+
+   thrd_join(writer, NULL);
+
+   for (GLuint key = 1000; key < 1000 + state.num_keys; key++)
+      EXPECT_EQ(_mesa_HashLookup(table, key), (void *)NULL) << key;
+
+   _mesa_DeleteHashTable(table);
+}
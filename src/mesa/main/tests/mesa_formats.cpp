@@ -35,6 +35,7 @@
 #include "main/glformats.h"
 #include "main/format_unpack.h"
 #include "main/format_pack.h"
+#include "main/format_utils.h"
 
 /**
  * Debug/test: check that all uncompressed formats are handled in the
@@ -282,3 +283,63 @@ TEST(MesaFormatsTest, PackUbyteRGBARounding)
       EXPECT_EQ(result, (i * 31 + 127) / 255);
    }
 }
+
+/* The 8-bit swizzles have SIMD paths that handle a prefix of the row, check
+ * them against the generic per-pixel loop for every row length tail.
+ */
+TEST(MesaFormatsTest, SwizzleAndConvertUbyte)
+{
+   static const uint8_t swizzles[][4] = {
+      { 0, 1, 2, 3 }, { 2, 1, 0, 3 }, { 0, 1, 2, MESA_FORMAT_SWIZZLE_ONE },
+      { 2, 1, 0, MESA_FORMAT_SWIZZLE_ONE }, { 3, 2, 1, 0 },
+      { 0, 0, 0, MESA_FORMAT_SWIZZLE_ONE },
+      { 1, MESA_FORMAT_SWIZZLE_ZERO, 2, MESA_FORMAT_SWIZZLE_ONE },
+   };
+   uint8_t src[64 * 4], dst[64 * 4 + 16], expected[64 * 4 + 16];
+
+   for (unsigned i = 0; i < sizeof(src); i++)
+      src[i] = i * 37 + 11;
+
+   for (int src_chans = 3; src_chans <= 4; src_chans++) {
+      for (int dst_chans = 3; dst_chans <= 4; dst_chans++) {
+         for (unsigned s = 0; s < ARRAY_SIZE(swizzles); s++) {
+            const uint8_t *swz = swizzles[s];
+
+            if (swz[0] >= src_chans && swz[0] < 4)
+               continue;
+            if (swz[1] >= src_chans && swz[1] < 4)
+               continue;
+            if (swz[2] >= src_chans && swz[2] < 4)
+               continue;
+            if (dst_chans == 4 && swz[3] >= src_chans && swz[3] < 4)
+               continue;
+
+            for (int count = 0; count <= 64; count++) {
+               memset(dst, 0xcd, sizeof(dst));
+               memset(expected, 0xcd, sizeof(expected));
+
+               for (int p = 0; p < count; p++) {
+                  for (int c = 0; c < dst_chans; c++) {
+                     uint8_t v;
+                     if (swz[c] == MESA_FORMAT_SWIZZLE_ZERO)
+                        v = 0;
+                     else if (swz[c] == MESA_FORMAT_SWIZZLE_ONE)
+                        v = 0xff;
+                     else
+                        v = src[p * src_chans + swz[c]];
+                     expected[p * dst_chans + c] = v;
+                  }
+               }
+
+               _mesa_swizzle_and_convert(dst, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                                         dst_chans,
+                                         src, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                                         src_chans, swz, true, count);
+               EXPECT_EQ(memcmp(dst, expected, sizeof(dst)), 0)
+                  << "src " << src_chans << " dst " << dst_chans
+                  << " swizzle " << s << " count " << count;
+            }
+         }
+      }
+   }
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name mipmap.cpp
+ *
+ * Check the software mipmap generation: the SSE2 row filters against plain
+ * C box filters, and the levels filtered in bands by the mipmap queue
+ * against levels filtered on a single thread, for all uncompressed formats.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "main/context.h"
+#include "main/formats.h"
+#include "main/mipmap.h"
+#include "main/teximage.h"
+#include "main/texobj.h"
+#include "drivers/common/driverfuncs.h"
+#include "util/u_cpu_detect.h"
+
+/* Sizes that leave a tail after the vector loops, and odd sizes that drop
+ * the last column or row.
+ */
+static const GLint sizes[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33 };
+
+template<typename T>
+static void
+fill_random(T *data, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++)
+      data[i] = rand();
+}
+
+static void
+fill_random(GLfloat *data, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++)
+      data[i] = (rand() - RAND_MAX / 2) / 1024.0f;
+}
+
+/* Same as the C loops of do_row() and make_2d_mipmap(). */
+static GLubyte
+box(GLubyte a, GLubyte b, GLubyte c, GLubyte d)
+{
+   return (a + b + c + d) / 4;
+}
+
+static GLfloat
+box(GLfloat a, GLfloat b, GLfloat c, GLfloat d)
+{
+   return (a + b + c + d) * 0.25F;
+}
+
+template<typename T>
+static void
+test_box_filter(GLenum datatype, GLuint comps)
+{
+   for (unsigned wi = 0; wi < ARRAY_SIZE(sizes); wi++) {
+      for (unsigned hi = 0; hi < ARRAY_SIZE(sizes); hi++) {
+         const GLint srcWidth = sizes[wi], srcHeight = sizes[hi];
+         const GLint dstWidth = MAX2(srcWidth / 2, 1);
+         const GLint dstHeight = MAX2(srcHeight / 2, 1);
+         /* Strides that aren't a multiple of the vector size. */
+         const GLint srcStride = srcWidth * comps + 1;
+         const GLint dstStride = dstWidth * comps + 3;
+         T *src = new T[srcHeight * srcStride];
+         T *dst = new T[dstHeight * dstStride];
+         const GLubyte *srcData = (const GLubyte *)src;
+         GLubyte *dstData = (GLubyte *)dst;
+
+         SCOPED_TRACE(testing::Message() << srcWidth << "x" << srcHeight);
+
+         fill_random(src, srcHeight * srcStride);
+         _mesa_generate_mipmap_level(GL_TEXTURE_2D, datatype, comps, 0,
+                                     srcWidth, srcHeight, 1,
+                                     &srcData, srcStride * sizeof(T),
+                                     dstWidth, dstHeight, 1,
+                                     &dstData, dstStride * sizeof(T));
+
+         for (GLint y = 0; y < dstHeight; y++) {
+            const T *rowA = src + (srcHeight > 1 ? 2 * y : 0) * srcStride;
+            const T *rowB = rowA + (srcHeight > 1 ? srcStride : 0);
+
+            for (GLint x = 0; x < dstWidth; x++) {
+               const GLint j = srcWidth > 1 ? 2 * x : 0;
+               const GLint k = srcWidth > 1 ? j + 1 : 0;
+
+               for (GLuint c = 0; c < comps; c++) {
+                  T expected = box(rowA[j * comps + c], rowA[k * comps + c],
+                                   rowB[j * comps + c], rowB[k * comps + c]);
+
+                  ASSERT_EQ(dst[y * dstStride + x * comps + c], expected)
+                     << "x " << x << ", y " << y << ", component " << c;
+               }
+            }
+         }
+
+         delete[] src;
+         delete[] dst;
+      }
+   }
+}
+
+/* The formats with SSE2 row filters. */
+TEST(MipmapTest, BoxFilterUnsignedByte4)
+{
+   test_box_filter<GLubyte>(GL_UNSIGNED_BYTE, 4);
+}
+
+TEST(MipmapTest, BoxFilterFloat4)
+{
+   test_box_filter<GLfloat>(GL_FLOAT, 4);
+}
+
+TEST(MipmapTest, BoxFilterFloat1)
+{
+   test_box_filter<GLfloat>(GL_FLOAT, 1);
+}
+
+/* Without SSE2 row filters, to check the reference itself. */
+TEST(MipmapTest, BoxFilterUnsignedByte1)
+{
+   test_box_filter<GLubyte>(GL_UNSIGNED_BYTE, 1);
+}
+
+class MipmapThreadTest : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void test_format(mesa_format format, GLint width, GLint height);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+MipmapThreadTest::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   _mesa_make_current(&ctx, NULL, NULL);
+
+   /* Split the levels into bands even on a single CPU.  The mipmap queue
+    * is created on first use, after this.
+    */
+   util_cpu_detect();
+   util_cpu_caps.nr_cpus = MAX2(util_cpu_caps.nr_cpus, 4);
+}
+
+void
+MipmapThreadTest::TearDown()
+{
+   _mesa_make_current(NULL, NULL, NULL);
+   _mesa_free_context_data(&ctx, false);
+}
+
+/* Generate all levels of a random texture, and filter each level again on
+ * the calling thread to compare.
+ */
+void
+MipmapThreadTest::test_format(mesa_format format, GLint width, GLint height)
+{
+   struct gl_texture_object *texObj =
+      ctx.Driver.NewTextureObject(&ctx, 1, GL_TEXTURE_2D);
+   struct gl_texture_image *image =
+      _mesa_get_tex_image(&ctx, texObj, GL_TEXTURE_2D, 0);
+   GLenum datatype;
+   GLuint comps;
+   GLubyte *map;
+   GLint stride;
+
+   _mesa_uncompressed_format_to_type_and_comps(format, &datatype, &comps);
+
+   _mesa_init_teximage_fields(&ctx, image, width, height, 1, 0, GL_RGBA,
+                              format);
+   ASSERT_TRUE(ctx.Driver.AllocTextureImageBuffer(&ctx, image));
+
+   ctx.Driver.MapTextureImage(&ctx, image, 0, 0, 0, width, height,
+                              GL_MAP_WRITE_BIT, &map, &stride);
+   ASSERT_TRUE(map);
+   for (GLint y = 0; y < height; y++)
+      fill_random(map + y * stride, _mesa_format_row_stride(format, width));
+   ctx.Driver.UnmapTextureImage(&ctx, image, 0);
+
+   _mesa_generate_mipmap(&ctx, GL_TEXTURE_2D, texObj);
+
+   ASSERT_TRUE(texObj->Image[0][1]);
+
+   for (GLuint level = 1;
+        level < MAX_TEXTURE_LEVELS && texObj->Image[0][level]; level++) {
+      struct gl_texture_image *src = texObj->Image[0][level - 1];
+      struct gl_texture_image *dst = texObj->Image[0][level];
+      GLubyte *srcMap, *dstMap;
+      GLint srcStride, dstStride;
+
+      SCOPED_TRACE(testing::Message() << "level " << level);
+
+      ctx.Driver.MapTextureImage(&ctx, src, 0, 0, 0, src->Width,
+                                 src->Height, GL_MAP_READ_BIT,
+                                 &srcMap, &srcStride);
+      ctx.Driver.MapTextureImage(&ctx, dst, 0, 0, 0, dst->Width,
+                                 dst->Height, GL_MAP_READ_BIT,
+                                 &dstMap, &dstStride);
+
+      /* Start from the generated level, because some formats have bits
+       * that aren't filtered, like the stencil of Z32_FLOAT_S8X24_UINT.
+       */
+      std::vector<GLubyte> expected(dst->Height * dstStride);
+      memcpy(expected.data(), dstMap, expected.size());
+      GLubyte *expectedData = expected.data();
+
+      _mesa_generate_mipmap_level(GL_TEXTURE_2D, datatype, comps, 0,
+                                  src->Width, src->Height, 1,
+                                  (const GLubyte **)&srcMap, srcStride,
+                                  dst->Width, dst->Height, 1,
+                                  &expectedData, dstStride);
+
+      for (GLuint y = 0; y < dst->Height; y++) {
+         EXPECT_EQ(memcmp(dstMap + y * dstStride, &expected[y * dstStride],
+                          dstStride), 0) << "row " << y;
+      }
+
+      ctx.Driver.UnmapTextureImage(&ctx, src, 0);
+      ctx.Driver.UnmapTextureImage(&ctx, dst, 0);
+   }
+
+   _mesa_reference_texobj(&texObj, NULL);
+}
+
+/* The first level is large enough to be split into bands, and the odd
+ * size leaves a last row and column that isn't filtered.
+ */
+TEST_F(MipmapThreadTest, AllFormats)
+{
+   for (int f = MESA_FORMAT_NONE + 1; f < MESA_FORMAT_COUNT; f++) {
+      const mesa_format format = (mesa_format)f;
+
+      /* glGenerateMipmap rejects integer formats.  do_row() has no filter
+       * for the packed types of R3G3B2 and A2R10G10B10, and filters YCbCr
+       * as two 16-bit components per 16-bit texel, on any thread.
+       */
+      if (!_mesa_get_format_name(format) ||
+          _mesa_is_format_compressed(format) ||
+          _mesa_is_format_integer(format) ||
+          _mesa_get_format_base_format(format) == GL_YCBCR_MESA ||
+          format == MESA_FORMAT_R3G3B2_UNORM ||
+          format == MESA_FORMAT_A2R10G10B10_UNORM ||
+          format == MESA_FORMAT_A2B10G10R10_UNORM)
+         continue;
+
+      SCOPED_TRACE(_mesa_get_format_name(format));
+      test_format(format, 1023, 517);
+   }
+}
+
+/* Fewer destination rows than bands. */
+TEST_F(MipmapThreadTest, WideAndShort)
+{
+   test_format(MESA_FORMAT_R8G8B8A8_UNORM, 65536 + 1, 5);
+}
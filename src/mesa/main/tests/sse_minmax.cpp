@@ -0,0 +1,251 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name sse_minmax.cpp
+ *
+ * Compare the SSE4.1 and AVX2 min/max index kernels with a scalar loop, for
+ * every index size, with and without primitive restart, for all alignments
+ * of the first index and for counts that leave a tail after the vector loop.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/sse_minmax.h"
+#include "util/macros.h"
+#include "util/u_cpu_detect.h"
+
+#define MAX_COUNT 100
+#define MAX_SKEW 16
+
+template<typename T>
+static void
+scalar_min_max(const T *indices, bool restart, unsigned restart_index,
+               unsigned count, unsigned *min_index, unsigned *max_index)
+{
+   *min_index = ~0u;
+   *max_index = 0;
+
+   for (unsigned i = 0; i < count; i++) {
+      if (restart && indices[i] == restart_index)
+         continue;
+      *min_index = MIN2(*min_index, indices[i]);
+      *max_index = MAX2(*max_index, indices[i]);
+   }
+}
+
+static void
+sse_min_max(const uint8_t *indices, bool restart, unsigned restart_index,
+            unsigned count, unsigned *min_index, unsigned *max_index,
+            bool avx2)
+{
+#ifdef USE_AVX2
+   if (avx2) {
+      _mesa_ubyte_index_min_max_avx2(indices, restart, restart_index,
+                                     min_index, max_index, count);
+      return;
+   }
+#endif
+   _mesa_ubyte_index_min_max(indices, restart, restart_index,
+                             min_index, max_index, count);
+}
+
+static void
+sse_min_max(const uint16_t *indices, bool restart, unsigned restart_index,
+            unsigned count, unsigned *min_index, unsigned *max_index,
+            bool avx2)
+{
+#ifdef USE_AVX2
+   if (avx2) {
+      _mesa_ushort_index_min_max_avx2(indices, restart, restart_index,
+                                      min_index, max_index, count);
+      return;
+   }
+#endif
+   _mesa_ushort_index_min_max(indices, restart, restart_index,
+                              min_index, max_index, count);
+}
+
+static void
+sse_min_max(const uint32_t *indices, bool restart, unsigned restart_index,
+            unsigned count, unsigned *min_index, unsigned *max_index,
+            bool avx2)
+{
+#ifdef USE_AVX2
+   if (avx2) {
+      _mesa_uint_index_min_max_avx2(indices, restart, restart_index,
+                                    min_index, max_index, count);
+      return;
+   }
+#endif
+   _mesa_uint_index_min_max(indices, restart, restart_index,
+                            min_index, max_index, count);
+
+   if (!restart) {
+      unsigned min_array, max_array;
+
+      _mesa_uint_array_min_max(indices, &min_array, &max_array, count);
+      EXPECT_EQ(min_array, *min_index);
+      EXPECT_EQ(max_array, *max_index);
+   }
+}
+
+/* Generate indices with the extremes of the type at random places, and
+ * the restart index every few indices.
+ */
+template<typename T>
+static void
+fill_indices(T *indices, unsigned count, unsigned restart_index,
+             unsigned seed)
+{
+   srand(seed);
+   for (unsigned i = 0; i < count; i++) {
+      switch (rand() % 8) {
+      case 0:
+         indices[i] = (T)~0u;
+         break;
+      case 1:
+         indices[i] = 0;
+         break;
+      case 2:
+         indices[i] = restart_index;
+         break;
+      default:
+         indices[i] = rand();
+         break;
+      }
+   }
+}
+
+template<typename T>
+static void
+test_index_type(unsigned restart_index, bool avx2 = false)
+{
+   T buffer[MAX_SKEW + MAX_COUNT] __attribute__((aligned(16)));
+
+   for (unsigned skew = 0; skew < MAX_SKEW; skew++) {
+      for (unsigned count = 0; count <= MAX_COUNT; count++) {
+         T *indices = buffer + skew;
+
+         fill_indices(indices, count, restart_index, skew * 1000 + count);
+
+         for (unsigned restart = 0; restart < 2; restart++) {
+            unsigned min_ref, max_ref, min_sse, max_sse;
+
+            SCOPED_TRACE(testing::Message() << "skew " << skew
+                         << ", count " << count << ", restart " << restart);
+
+            scalar_min_max(indices, restart, restart_index, count,
+                           &min_ref, &max_ref);
+            sse_min_max(indices, restart, restart_index, count,
+                        &min_sse, &max_sse, avx2);
+            EXPECT_EQ(min_ref, min_sse);
+            EXPECT_EQ(max_ref, max_sse);
+         }
+      }
+   }
+
+   if ((T)restart_index != restart_index)
+      return;
+
+   /* Only restart indices. */
+   for (unsigned count = 1; count <= MAX_COUNT; count++) {
+      unsigned min_sse, max_sse;
+
+      for (unsigned i = 0; i < count; i++)
+         buffer[i] = restart_index;
+
+      sse_min_max(buffer, true, restart_index, count, &min_sse, &max_sse,
+                  avx2);
+      EXPECT_EQ(min_sse, ~0u) << count;
+      EXPECT_EQ(max_sse, 0u) << count;
+   }
+}
+
+class SseMinMaxTest : public ::testing::Test {
+protected:
+   void SetUp() override
+   {
+      util_cpu_detect();
+      if (!util_cpu_caps.has_sse4_1)
+         GTEST_SKIP() << "no SSE4.1";
+   }
+};
+
+TEST_F(SseMinMaxTest, UnsignedByte)
+{
+   test_index_type<uint8_t>(0xff);
+   test_index_type<uint8_t>(0x7f);
+   test_index_type<uint8_t>(0);
+   test_index_type<uint8_t>(0xffff); /* never matches */
+}
+
+TEST_F(SseMinMaxTest, UnsignedShort)
+{
+   test_index_type<uint16_t>(0xffff);
+   test_index_type<uint16_t>(0x8000);
+   test_index_type<uint16_t>(0);
+   test_index_type<uint16_t>(0xffffffff); /* never matches */
+}
+
+TEST_F(SseMinMaxTest, UnsignedInt)
+{
+   test_index_type<uint32_t>(0xffffffff);
+   test_index_type<uint32_t>(0x80000000);
+   test_index_type<uint32_t>(0);
+}
+
+#ifdef USE_AVX2
+class Avx2MinMaxTest : public ::testing::Test {
+protected:
+   void SetUp() override
+   {
+      util_cpu_detect();
+      if (!util_cpu_caps.has_avx2)
+         GTEST_SKIP() << "no AVX2";
+   }
+};
+
+TEST_F(Avx2MinMaxTest, UnsignedByte)
+{
+   test_index_type<uint8_t>(0xff, true);
+   test_index_type<uint8_t>(0x7f, true);
+   test_index_type<uint8_t>(0, true);
+   test_index_type<uint8_t>(0xffff, true); /* never matches */
+}
+
+TEST_F(Avx2MinMaxTest, UnsignedShort)
+{
+   test_index_type<uint16_t>(0xffff, true);
+   test_index_type<uint16_t>(0x8000, true);
+   test_index_type<uint16_t>(0, true);
+   test_index_type<uint16_t>(0xffffffff, true); /* never matches */
+}
+
+TEST_F(Avx2MinMaxTest, UnsignedInt)
+{
+   test_index_type<uint32_t>(0xffffffff, true);
+   test_index_type<uint32_t>(0x80000000, true);
+   test_index_type<uint32_t>(0, true);
+}
+#endif
@@ -222,6 +222,9 @@ void GLAPIENTRY
 _mesa_GetnUniformdvARB(GLuint, GLint, GLsizei, GLdouble *);
 void GLAPIENTRY
 _mesa_GetUniformdv(GLuint, GLint, GLdouble *);
+GLint
+_mesa_GetUniformLocation_impl(GLuint programObj, const GLcharARB *name,
+                              bool glthread);
 GLint GLAPIENTRY
 _mesa_GetUniformLocation(GLuint, const GLcharARB *);
 GLint GLAPIENTRY
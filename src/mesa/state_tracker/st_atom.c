@@ -34,9 +34,12 @@
 #include "pipe/p_defines.h"
 #include "st_context.h"
 #include "st_atom.h"
+#include "st_cb_readpixels.h"
 #include "st_program.h"
 #include "st_manager.h"
 #include "st_util.h"
+#include "st_debug.h"
+#include "util/os_time.h"
 
 
 typedef void (*update_func_t)(struct st_context *st);
@@ -50,15 +53,95 @@ static const update_func_t update_functions[] =
 };
 
 
+static const char *update_names[] =
+{
+#define ST_STATE(FLAG, st_update) #st_update,
+#include "st_atom_list.h"
+#undef ST_STATE
+};
+
+struct st_atom_stats {
+   struct st_validation_stats total;
+   uint64_t calls[ARRAY_SIZE(update_functions)];
+   int64_t time_ns[ARRAY_SIZE(update_functions)];
+};
+
+
 void st_init_atoms( struct st_context *st )
 {
    STATIC_ASSERT(ARRAY_SIZE(update_functions) <= 64);
+
+   if (ST_DEBUG & DEBUG_ATOMS)
+      st_enable_atom_stats(st);
+}
+
+
+static void
+print_atom_stats(const struct st_atom_stats *stats)
+{
+   fprintf(stderr, "st: %"PRIu64" state validations\n",
+           stats->total.validations);
+   fprintf(stderr, "st: %-36s %12s %12s %10s\n",
+           "atom", "calls", "total (us)", "avg (ns)");
+   for (unsigned i = 0; i < ARRAY_SIZE(update_functions); i++) {
+      if (!stats->calls[i])
+         continue;
+
+      fprintf(stderr, "st: %-36s %12"PRIu64" %12"PRId64" %10"PRId64"\n",
+              update_names[i], stats->calls[i], stats->time_ns[i] / 1000,
+              stats->time_ns[i] / (int64_t)stats->calls[i]);
+   }
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   struct st_atom_stats *stats = st->atom_stats;
+
+   if (!stats)
+      return;
+
+   if (ST_DEBUG & DEBUG_ATOMS)
+      print_atom_stats(stats);
+
+   free(stats);
+   st->atom_stats = NULL;
+}
+
+
+/**
+ * Start collecting the counters with ST_DEBUG=atoms, or for the HUD.
+ */
+const struct st_validation_stats *
+st_enable_atom_stats(struct st_context *st)
+{
+   if (!st->atom_stats)
+      st->atom_stats = ST_CALLOC_STRUCT(st_atom_stats);
+
+   return st->atom_stats ? &st->atom_stats->total : NULL;
+}
+
+
+/* Same as the loop at the end of st_validate_state, but time each atom. */
+static void
+run_atoms_with_stats(struct st_context *st, uint64_t dirty)
+{
+   struct st_atom_stats *stats = st->atom_stats;
+
+   stats->total.validations++;
+
+   while (dirty) {
+      unsigned i = u_bit_scan64(&dirty);
+      int64_t start = os_time_get_nano();
+
+      update_functions[i](st);
+
+      int64_t time = os_time_get_nano() - start;
+      stats->time_ns[i] += time;
+      stats->calls[i]++;
+      stats->total.time_ns += time;
+      stats->total.atom_updates++;
+   }
 }
 
 
@@ -183,6 +266,12 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    st->dirty |= ctx->NewDriverState & st->active_states & ST_ALL_STATES_MASK;
    ctx->NewDriverState &= ~st->dirty;
 
+   /* Pending glReadPixels into buffers that are now bound for GPU reads
+    * must land first.
+    */
+   if (st->readpix_async.num_jobs && pipeline != ST_PIPELINE_UPDATE_FRAMEBUFFER)
+      st_finish_async_readpixels_gpu_access(st);
+
    /* Get pipeline state. */
    switch (pipeline) {
    case ST_PIPELINE_RENDER:
@@ -251,6 +340,12 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    if (!dirty)
       return;
 
+   if (unlikely(st->atom_stats)) {
+      run_atoms_with_stats(st, dirty);
+      st->dirty &= ~pipeline_mask;
+      return;
+   }
+
    dirty_lo = dirty;
    dirty_hi = dirty >> 32;
 
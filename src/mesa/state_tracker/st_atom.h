@@ -42,6 +42,7 @@ struct st_common_variant;
 struct pipe_vertex_buffer;
 struct pipe_vertex_element;
 struct cso_velems_state;
+struct st_validation_stats;
 
 /**
  * Enumeration of state tracker pipelines.
@@ -56,6 +57,7 @@ enum st_pipeline {
 
 void st_init_atoms( struct st_context *st );
 void st_destroy_atoms( struct st_context *st );
+const struct st_validation_stats *st_enable_atom_stats( struct st_context *st );
 void st_validate_state( struct st_context *st, enum st_pipeline pipeline );
 GLuint st_compare_func_to_pipe(GLenum func);
 
@@ -42,6 +42,7 @@
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
 #include "st_cb_memoryobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_debug.h"
 #include "st_util.h"
 
@@ -143,6 +144,8 @@ st_bufferobj_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_sync_async_readpixels(st_context(ctx), obj);
+
    /* Now that transfers are per-context, we don't have to figure out
     * flushing here.  Usually drivers won't need to flush in this case
     * even if the buffer is currently referenced by hardware - they
@@ -185,6 +188,8 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_sync_async_readpixels(st_context(ctx), obj);
+
    pipe_buffer_read(st_context(ctx)->pipe, st_obj->buffer,
                     offset, size, data);
 }
@@ -315,6 +320,8 @@ bufferobj_data(struct gl_context *ctx,
       return GL_FALSE;
    }
 
+   st_sync_async_readpixels(st, obj);
+
    if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
        size && st_obj->buffer &&
        st_obj->Base.Size == size &&
@@ -467,6 +474,8 @@ st_bufferobj_invalidate(struct gl_context *ctx,
    if (!st_obj->buffer || _mesa_bufferobj_mapped(obj, MAP_USER))
       return;
 
+   st_sync_async_readpixels(st, obj);
+
    pipe->invalidate_resource(pipe, st_obj->buffer);
 }
 
@@ -543,6 +552,11 @@ st_bufferobj_map_range(struct gl_context *ctx,
       st_access_flags_to_transfer_flags(access,
                                         offset == 0 && length == obj->Size);
 
+   /* Even unsynchronized maps must see glReadPixels results, because the
+    * application can't fence the readback thread.
+    */
+   st_sync_async_readpixels(st_context(ctx), obj);
+
    obj->Mappings[index].Pointer = pipe_buffer_map_range(pipe,
                                                         st_obj->buffer,
                                                         offset, length,
@@ -628,6 +642,9 @@ st_copy_buffer_subdata(struct gl_context *ctx,
    assert(!_mesa_check_disallowed_mapping(src));
    /* dst can be mapped, just not the same range as the target range */
 
+   st_sync_async_readpixels(st_context(ctx), src);
+   st_sync_async_readpixels(st_context(ctx), dst);
+
    u_box_1d(readOffset, size, &box);
 
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
@@ -648,6 +665,8 @@ st_clear_buffer_subdata(struct gl_context *ctx,
    struct st_buffer_object *buf = st_buffer_object(bufObj);
    static const char zeros[16] = {0};
 
+   st_sync_async_readpixels(st_context(ctx), bufObj);
+
    if (!pipe->clear_buffer) {
       _mesa_ClearBufferSubData_sw(ctx, offset, size,
                                   clearValue, clearValueSize, bufObj);
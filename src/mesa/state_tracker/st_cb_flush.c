@@ -39,6 +39,7 @@
 #include "st_cb_flush.h"
 #include "st_cb_clear.h"
 #include "st_cb_fbo.h"
+#include "st_cb_readpixels.h"
 #include "st_context.h"
 #include "st_manager.h"
 #include "pipe/p_context.h"
@@ -58,6 +59,11 @@ st_flush(struct st_context *st,
    st_context_free_zombie_objects(st);
 
    st->pipe->flush(st->pipe, fence, flags);
+
+   /* Other contexts of the share group may read the PBOs once this
+    * context is flushed, so the asynchronous readbacks must have landed.
+    */
+   st_sync_async_readpixels(st, NULL);
 }
 
 
@@ -78,6 +84,8 @@ st_finish(struct st_context *st)
       st->screen->fence_reference(st->screen, &fence, NULL);
    }
 
+   st_sync_async_readpixels(st, NULL);
+
    st_manager_flush_swapbuffers();
 }
 
@@ -32,10 +32,13 @@
 #include "main/readpix.h"
 #include "main/enums.h"
 #include "main/framebuffer.h"
+#include "main/format_utils.h"
+#include "main/glformats.h"
 #include "util/u_inlines.h"
 #include "util/format/u_format.h"
 #include "cso_cache/cso_context.h"
 
+#include "st_cb_bufferobjects.h"
 #include "st_cb_fbo.h"
 #include "st_atom.h"
 #include "st_context.h"
@@ -400,6 +403,314 @@ try_cached_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    return dst;
 }
 
+/* Asynchronous PBO readback for software rasterizers, which don't prefer
+ * blit-based transfers and would otherwise wait for all queued rendering in
+ * _mesa_readpixels().
+ *
+ * The region is blitted into a staging texture, which only queues the copy,
+ * and the context is flushed. Once the flush fence has signalled, the thread
+ * owning the context maps the staging texture and the PBO, and a worker
+ * thread copies or converts the pixels, so the readback of one frame
+ * overlaps the rendering of the next one. The fences are polled by
+ * glReadPixels; accesses to the PBO, flushes and glFenceSync wait for them.
+ *
+ * Until a job has been retired, the PBO must not be accessed in any other
+ * way. st_sync_async_readpixels() is called by everything that touches
+ * buffer contents, and jobs are only started for buffers that have never
+ * been used for anything but GL_PIXEL_PACK_BUFFER and aren't mapped.
+ */
+#define ASYNC_READPIXELS_MAX_JOBS 4
+
+struct async_readpixels_job {
+   struct list_head list;
+   struct util_queue_fence fence;
+
+   struct pipe_fence_handle *gpu_fence;
+   bool started;
+
+   struct gl_buffer_object *bufobj;
+   struct pipe_resource *buffer;
+   struct pipe_resource *staging;
+   struct pipe_transfer *src_xfer;
+   struct pipe_transfer *dst_xfer;
+
+   const GLubyte *src;
+   int src_stride;
+   mesa_format src_format;
+
+   GLubyte *dst;
+   unsigned dst_offset;
+   unsigned dst_size;
+   int dst_stride;
+   uint32_t dst_format;
+
+   unsigned width, height;
+   bool memcpy;
+};
+
+static void
+async_readpixels_execute(void *data, int thread_index)
+{
+   struct async_readpixels_job *job = data;
+   const GLubyte *src = job->src;
+   GLubyte *dst = job->dst;
+
+   if (job->memcpy) {
+      const unsigned bytes_per_row =
+         job->width * _mesa_get_format_bytes(job->src_format);
+
+      for (unsigned row = 0; row < job->height; row++) {
+         memcpy(dst, src, bytes_per_row);
+         src += job->src_stride;
+         dst += job->dst_stride;
+      }
+   } else {
+      _mesa_format_convert(dst, job->dst_format, job->dst_stride,
+                           (void *) src, job->src_format, job->src_stride,
+                           job->width, job->height, NULL);
+   }
+}
+
+/**
+ * Map the staging texture and the PBO, and hand the copy to the worker.
+ * The rendering into the staging texture must have finished, so that the
+ * maps don't block.
+ */
+static void
+start_async_readpixels_copy(struct st_context *st,
+                            struct async_readpixels_job *job)
+{
+   struct pipe_context *pipe = st->pipe;
+
+   job->started = true;
+
+   job->src = pipe_transfer_map(pipe, job->staging, 0, 0, PIPE_MAP_READ,
+                                0, 0, job->width, job->height,
+                                &job->src_xfer);
+   job->dst = pipe_buffer_map_range(pipe, job->buffer, job->dst_offset,
+                                    job->dst_size, PIPE_MAP_WRITE,
+                                    &job->dst_xfer);
+   if (!job->src || !job->dst)
+      return;
+
+   job->src_stride = job->src_xfer->stride;
+   util_queue_add_job(&st->readpix_async.queue, job, &job->fence,
+                      async_readpixels_execute, NULL, 0);
+}
+
+/**
+ * Wait for \p job and release everything it holds. Must be called from the
+ * thread owning the context, because it maps and unmaps transfers.
+ */
+static void
+retire_async_readpixels_job(struct st_context *st,
+                            struct async_readpixels_job *job)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = st->screen;
+
+   if (!job->started) {
+      screen->fence_finish(screen, NULL, job->gpu_fence,
+                           PIPE_TIMEOUT_INFINITE);
+      start_async_readpixels_copy(st, job);
+   }
+
+   util_queue_fence_wait(&job->fence);
+   util_queue_fence_destroy(&job->fence);
+
+   if (job->src_xfer)
+      pipe_transfer_unmap(pipe, job->src_xfer);
+   if (job->dst_xfer)
+      pipe_buffer_unmap(pipe, job->dst_xfer);
+   pipe_resource_reference(&job->staging, NULL);
+   pipe_resource_reference(&job->buffer, NULL);
+   screen->fence_reference(screen, &job->gpu_fence, NULL);
+   _mesa_reference_buffer_object(st->ctx, &job->bufobj, NULL);
+
+   list_del(&job->list);
+   st->readpix_async.num_jobs--;
+   free(job);
+}
+
+/**
+ * Start the copies of the readbacks whose rendering has finished, and
+ * retire the copies that are done, without blocking.
+ */
+void
+st_poll_async_readpixels(struct st_context *st)
+{
+   struct pipe_screen *screen = st->screen;
+
+   list_for_each_entry_safe(struct async_readpixels_job, job,
+                            &st->readpix_async.jobs, list) {
+      if (!job->started) {
+         /* Fences signal in order. */
+         if (!screen->fence_finish(screen, NULL, job->gpu_fence, 0))
+            break;
+         start_async_readpixels_copy(st, job);
+      }
+
+      if (util_queue_fence_is_signalled(&job->fence))
+         retire_async_readpixels_job(st, job);
+   }
+}
+
+/**
+ * Wait for the asynchronous readbacks into \p obj, or into any buffer if
+ * \p obj is NULL.
+ */
+void
+st_finish_async_readpixels(struct st_context *st,
+                           const struct gl_buffer_object *obj)
+{
+   list_for_each_entry_safe(struct async_readpixels_job, job,
+                            &st->readpix_async.jobs, list) {
+      if (!obj || job->bufobj == obj)
+         retire_async_readpixels_job(st, job);
+   }
+}
+
+/**
+ * Wait for the asynchronous readbacks into buffers that have since been
+ * bound for something the GPU reads (vertices, uniforms, textures, ...).
+ */
+void
+st_finish_async_readpixels_gpu_access(struct st_context *st)
+{
+   list_for_each_entry_safe(struct async_readpixels_job, job,
+                            &st->readpix_async.jobs, list) {
+      if (job->bufobj->UsageHistory & ~USAGE_PIXEL_PACK_BUFFER)
+         retire_async_readpixels_job(st, job);
+   }
+}
+
+/**
+ * Copy \p staging, which holds the \p width x \p height region read back
+ * in the linear format \p src_format, into the PBO bound to \p pack once
+ * the rendering signalling \p fence has finished. The caller keeps its
+ * references to \p staging and \p fence.
+ */
+bool
+st_queue_async_readpixels(struct st_context *st,
+                          struct pipe_resource *staging,
+                          struct pipe_fence_handle *fence,
+                          mesa_format src_format,
+                          GLsizei width, GLsizei height,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *pack,
+                          void *pixels)
+{
+   struct pipe_screen *screen = st->screen;
+   struct gl_buffer_object *bufobj = pack->BufferObj;
+   struct async_readpixels_job *job;
+
+   if (!util_queue_is_initialized(&st->readpix_async.queue) &&
+       !util_queue_init(&st->readpix_async.queue, "readpix",
+                        ASYNC_READPIXELS_MAX_JOBS, 1,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+      return false;
+
+   job = ST_CALLOC_STRUCT(async_readpixels_job);
+   if (!job)
+      return false;
+
+   if (st->readpix_async.num_jobs >= ASYNC_READPIXELS_MAX_JOBS) {
+      retire_async_readpixels_job(st,
+         list_first_entry(&st->readpix_async.jobs,
+                          struct async_readpixels_job, list));
+   }
+
+   job->src_format = src_format;
+   job->memcpy = _mesa_format_matches_format_and_type(src_format, format,
+                                                      type, false, NULL);
+   if (!job->memcpy)
+      job->dst_format = _mesa_format_from_format_and_type(format, type);
+
+   /* Map only the rows written, the bounds were validated by the caller. */
+   job->dst_stride = _mesa_image_row_stride(pack, width, format, type);
+   job->dst_offset = (uintptr_t) _mesa_image_address2d(pack, pixels,
+                                                       width, height,
+                                                       format, type, 0, 0);
+   job->dst_size = job->dst_stride * (height - 1) +
+                   width * _mesa_bytes_per_pixel(format, type);
+   job->width = width;
+   job->height = height;
+
+   pipe_resource_reference(&job->staging, staging);
+   pipe_resource_reference(&job->buffer, st_buffer_object(bufobj)->buffer);
+   screen->fence_reference(screen, &job->gpu_fence, fence);
+   _mesa_reference_buffer_object(st->ctx, &job->bufobj, bufobj);
+   util_queue_fence_init(&job->fence);
+
+   list_addtail(&job->list, &st->readpix_async.jobs);
+   st->readpix_async.num_jobs++;
+
+   /* Software rasterizers may have finished already. */
+   st_poll_async_readpixels(st);
+   return true;
+}
+
+static bool
+try_async_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
+                         bool invert_y,
+                         GLint x, GLint y, GLsizei width, GLsizei height,
+                         GLenum format, GLenum type,
+                         const struct gl_pixelstore_attrib *pack,
+                         void *pixels)
+{
+   struct gl_context *ctx = st->ctx;
+   struct pipe_screen *screen = st->screen;
+   struct gl_renderbuffer *rb = &strb->Base;
+   struct gl_buffer_object *bufobj = pack->BufferObj;
+   struct pipe_resource *staging;
+   struct pipe_fence_handle *fence = NULL;
+   enum pipe_format src_format;
+   bool queued;
+
+   if (!st->readpix_async.enabled)
+      return false;
+
+   if (!st_buffer_object(bufobj)->buffer || !width || !height ||
+       strb->texture->nr_samples > 1 ||
+       bufobj->UsageHistory != USAGE_PIXEL_PACK_BUFFER ||
+       _mesa_bufferobj_mapped(bufobj, MAP_USER) ||
+       pack->SwapBytes || pack->Invert)
+      return false;
+
+   /* Only color formats that _mesa_format_convert can produce directly,
+    * which is what read_rgba_pixels does without transfer ops and
+    * luminance conversions.
+    */
+   if (!_mesa_is_color_format(format) ||
+       _mesa_readpixels_needs_slow_path(ctx, format, type, GL_FALSE) ||
+       rb->_BaseFormat != _mesa_get_format_base_format(rb->Format) ||
+       rb->_BaseFormat == GL_LUMINANCE ||
+       rb->_BaseFormat == GL_LUMINANCE_ALPHA ||
+       rb->_BaseFormat == GL_INTENSITY)
+      return false;
+
+   /* Snapshot the region, so that rendering after this call can't modify
+    * it before the worker reads it.
+    */
+   src_format = util_format_linear(rb->Format);
+   staging = blit_to_staging(st, strb, invert_y, x, y, width, height,
+                             format, src_format, src_format);
+   if (!staging)
+      return false;
+
+   /* Not st_flush(), which would wait for the previous readbacks. */
+   st->pipe->flush(st->pipe, &fence, 0);
+   queued = fence &&
+            st_queue_async_readpixels(st, staging, fence,
+                                      _mesa_get_srgb_format_linear(rb->Format),
+                                      width, height, format, type,
+                                      pack, pixels);
+
+   screen->fence_reference(screen, &fence, NULL);
+   pipe_resource_reference(&staging, NULL);
+   return queued;
+}
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
@@ -438,7 +749,18 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
    st_validate_state(st, ST_PIPELINE_UPDATE_FRAMEBUFFER);
    st_flush_bitmap_cache(st);
 
+   /* Start the pending asynchronous readbacks whose rendering has
+    * finished, and release the memory of the completed ones.
+    */
+   st_poll_async_readpixels(st);
+
    if (!st->prefer_blit_based_texture_transfer) {
+      if (pack->BufferObj &&
+          try_async_pbo_readpixels(st, strb,
+                                   st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
+                                   x, y, width, height, format, type,
+                                   pack, pixels))
+         return;
       goto fallback;
    }
 
@@ -30,11 +30,48 @@
 #define ST_CB_READPIXELS_H
 
 #include "main/glheader.h"
+#include "st_context.h"
 
 struct dd_function_table;
+struct gl_buffer_object;
+struct gl_pixelstore_attrib;
+struct pipe_fence_handle;
+struct pipe_resource;
 
 extern void
 st_init_readpixels_functions(struct dd_function_table *functions);
 
+extern bool
+st_queue_async_readpixels(struct st_context *st,
+                          struct pipe_resource *staging,
+                          struct pipe_fence_handle *fence,
+                          mesa_format src_format,
+                          GLsizei width, GLsizei height,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *pack,
+                          void *pixels);
+
+extern void
+st_poll_async_readpixels(struct st_context *st);
+
+extern void
+st_finish_async_readpixels(struct st_context *st,
+                           const struct gl_buffer_object *obj);
+
+extern void
+st_finish_async_readpixels_gpu_access(struct st_context *st);
+
+/**
+ * Wait for the asynchronous glReadPixels writing into \p obj (or into any
+ * buffer if \p obj is NULL) before the buffer is accessed in another way.
+ */
+static inline void
+st_sync_async_readpixels(struct st_context *st,
+                         const struct gl_buffer_object *obj)
+{
+   if (st->readpix_async.num_jobs)
+      st_finish_async_readpixels(st, obj);
+}
+
 
 #endif /* ST_CB_READPIXELS_H */
@@ -36,6 +36,7 @@
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "st_context.h"
+#include "st_cb_readpixels.h"
 #include "st_cb_syncobj.h"
 
 struct st_sync_object {
@@ -69,7 +70,8 @@ static void st_delete_sync_object(struct gl_context *ctx,
 static void st_fence_sync(struct gl_context *ctx, struct gl_sync_object *obj,
                           GLenum condition, GLbitfield flags)
 {
-   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
    struct st_sync_object *so = (struct st_sync_object*)obj;
 
    assert(condition == GL_SYNC_GPU_COMMANDS_COMPLETE && flags == 0);
@@ -77,6 +79,11 @@ static void st_fence_sync(struct gl_context *ctx, struct gl_sync_object *obj,
 
    /* Deferred flush are only allowed when there's a single context. See issue 1430 */
    pipe->flush(pipe, &so->fence, ctx->Shared->RefCount == 1 ? PIPE_FLUSH_DEFERRED : 0);
+
+   /* The fence covers the readbacks into PBOs queued before it, but their
+    * copies are done by the CPU, so finish them now.
+    */
+   st_sync_async_readpixels(st, NULL);
 }
 
 static void st_client_wait_sync(struct gl_context *ctx,
@@ -75,6 +75,8 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 #include "util/u_simple_shaders.h"
 #include "cso_cache/cso_context.h"
 #include "tgsi/tgsi_ureg.h"
@@ -363,6 +365,124 @@ st_MapTextureImage(struct gl_context *ctx,
 }
 
 
+/* Images with fewer pixels than this aren't worth splitting across threads
+ * when decompressing them for a compressed format fallback.
+ */
+#define FALLBACK_DECOMPRESS_MIN_PIXELS (256 * 256)
+#define FALLBACK_DECOMPRESS_MAX_THREADS 8
+
+struct fallback_decompress_job {
+   struct util_queue_fence fence;
+   mesa_format format;
+   bool bgra;
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width;
+   unsigned height;
+};
+
+static void
+fallback_decompress_execute(void *data, UNUSED int thread_index)
+{
+   struct fallback_decompress_job *job = data;
+
+   if (job->format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(job->dst, job->dst_stride,
+                                 job->src, job->src_stride,
+                                 job->width, job->height);
+   } else if (_mesa_is_format_etc2(job->format)) {
+      _mesa_unpack_etc2_format(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format, job->bgra);
+   } else if (_mesa_is_format_astc_2d(job->format)) {
+      _mesa_unpack_astc_2d_ldr(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format);
+   } else {
+      unreachable("unexpected format for a compressed format fallback");
+   }
+}
+
+static struct util_queue *
+get_fallback_decompress_queue(struct st_context *st)
+{
+   if (!util_queue_is_initialized(&st->decompress_queue)) {
+      if (util_cpu_caps.nr_cpus < 2)
+         return NULL;
+
+      unsigned threads = MIN2(util_cpu_caps.nr_cpus - 1,
+                              FALLBACK_DECOMPRESS_MAX_THREADS);
+
+      if (!util_queue_init(&st->decompress_queue, "texdec",
+                           FALLBACK_DECOMPRESS_MAX_THREADS, threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                           UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY))
+         return NULL;
+   }
+
+   return &st->decompress_queue;
+}
+
+/**
+ * Decompress an image uploaded in a compressed format the driver doesn't
+ * support. Large images are split into horizontal strips of whole blocks,
+ * which are decompressed in parallel by the decompress queue and the
+ * calling thread.
+ */
+void
+st_fallback_decompress(struct st_context *st, mesa_format format, bool bgra,
+                       uint8_t *dst, unsigned dst_stride,
+                       const uint8_t *src, unsigned src_stride,
+                       unsigned width, unsigned height)
+{
+   struct fallback_decompress_job jobs[FALLBACK_DECOMPRESS_MAX_THREADS + 1];
+   struct util_queue *queue = NULL;
+   unsigned num_jobs = 1;
+
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+   unsigned y_blocks = DIV_ROUND_UP(height, blk_h);
+
+   if (width * height >= FALLBACK_DECOMPRESS_MIN_PIXELS)
+      queue = get_fallback_decompress_queue(st);
+   if (queue)
+      num_jobs = MIN2(queue->num_threads + 1, y_blocks);
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      struct fallback_decompress_job *job = &jobs[i];
+      unsigned first_block = y_blocks * i / num_jobs;
+      unsigned last_block = y_blocks * (i + 1) / num_jobs;
+
+      job->format = format;
+      job->bgra = bgra;
+      job->dst = dst + first_block * blk_h * dst_stride;
+      job->dst_stride = dst_stride;
+      job->src = src + first_block * src_stride;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(last_block * blk_h, height) - first_block * blk_h;
+
+      /* The calling thread decompresses the last strip itself. */
+      if (i == num_jobs - 1) {
+         fallback_decompress_execute(job, 0);
+      } else {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(queue, job, &job->fence,
+                            fallback_decompress_execute, NULL, 0);
+      }
+   }
+
+   for (unsigned i = 0; i + 1 < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 /** called via ctx->Driver.UnmapTextureImage() */
 static void
 st_UnmapTextureImage(struct gl_context *ctx,
@@ -382,29 +502,12 @@ st_UnmapTextureImage(struct gl_context *ctx,
       assert(z == transfer->box.z);
 
       if (transfer->usage & PIPE_MAP_WRITE) {
-         if (texImage->TexFormat == MESA_FORMAT_ETC1_RGB8) {
-            _mesa_etc1_unpack_rgba8888(itransfer->map, transfer->stride,
-                                       itransfer->temp_data,
-                                       itransfer->temp_stride,
-                                       transfer->box.width,
-                                       transfer->box.height);
-         } else if (_mesa_is_format_etc2(texImage->TexFormat)) {
-            bool bgra = stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB;
-            _mesa_unpack_etc2_format(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat,
-                                     bgra);
-         } else if (_mesa_is_format_astc_2d(texImage->TexFormat)) {
-            _mesa_unpack_astc_2d_ldr(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat);
-         } else {
-            unreachable("unexpected format for a compressed format fallback");
-         }
+         bool bgra = stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB;
+
+         st_fallback_decompress(st, texImage->TexFormat, bgra,
+                                itransfer->map, transfer->stride,
+                                itransfer->temp_data, itransfer->temp_stride,
+                                transfer->box.width, transfer->box.height);
       }
 
       itransfer->temp_data = NULL;
@@ -31,6 +31,7 @@
 
 
 #include "main/glheader.h"
+#include "main/formats.h"
 
 struct dd_function_table;
 struct gl_context;
@@ -52,6 +53,12 @@ st_finalize_texture(struct gl_context *ctx,
 		    GLuint cubeMapFace);
 
 
+extern void
+st_fallback_decompress(struct st_context *st, mesa_format format, bool bgra,
+                       uint8_t *dst, unsigned dst_stride,
+                       const uint8_t *src, unsigned src_stride,
+                       unsigned width, unsigned height);
+
 extern void
 st_init_texture_functions(struct dd_function_table *functions);
 
@@ -476,6 +476,11 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_invalidate_readpix_cache(st);
    util_throttle_deinit(st->screen, &st->throttle);
 
+   if (util_queue_is_initialized(&st->decompress_queue))
+      util_queue_destroy(&st->decompress_queue);
+   if (util_queue_is_initialized(&st->readpix_async.queue))
+      util_queue_destroy(&st->readpix_async.queue);
+
    cso_destroy_context(st->cso_context);
 
    if (st->pipe && destroy_pipe)
@@ -685,6 +690,9 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
                                   PIPE_TEXTURE_2D, 0, 0, PIPE_BIND_SAMPLER_VIEW);
    st->prefer_blit_based_texture_transfer = screen->get_param(screen,
                               PIPE_CAP_PREFER_BLIT_BASED_TEXTURE_TRANSFER);
+   st->readpix_async.enabled = !st->prefer_blit_based_texture_transfer &&
+      !screen->get_param(screen, PIPE_CAP_ACCELERATED) &&
+      !(ST_DEBUG & DEBUG_NOREADPIXASYNC);
    st->force_persample_in_shader =
       screen->get_param(screen, PIPE_CAP_SAMPLE_SHADING) &&
       !screen->get_param(screen, PIPE_CAP_FORCE_PERSAMPLE_INTERP);
@@ -879,6 +887,7 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
 
    /* Initialize context's winsys buffers list */
    list_inithead(&st->winsys_buffers);
+   list_inithead(&st->readpix_async.jobs);
 
    list_inithead(&st->zombie_sampler_views.list.node);
    simple_mtx_init(&st->zombie_sampler_views.mutex, mtx_plain);
@@ -1052,6 +1061,13 @@ st_create_context(gl_api api, struct pipe_context *pipe,
    if (pipe->screen->get_disk_shader_cache)
       ctx->Cache = pipe->screen->get_disk_shader_cache(pipe->screen);
 
+   /* Drivers that don't compile shaders on their own threads (softpipe,
+    * llvmpipe, ...) get GL_KHR_parallel_shader_compile behaviour by running
+    * the GLSL front-end on a thread pool instead.
+    */
+   if (!pipe->screen->set_max_shader_compiler_threads)
+      ctx->Const.DeferShaderCompile = true;
+
    /* XXX: need a capability bit in gallium to query if the pipe
     * driver prefers DP4 or MUL/MAD for vertex transformation.
     */
@@ -1125,6 +1141,9 @@ st_destroy_context(struct st_context *st)
    /* This must be called first so that glthread has a chance to finish */
    _mesa_glthread_destroy(ctx);
 
+   /* Asynchronous glReadPixels still reference buffers and transfers. */
+   st_finish_async_readpixels(st, NULL);
+
    _mesa_HashWalk(ctx->Shared->TexObjects, destroy_tex_sampler_cb, st);
 
    /* For the fallback textures, free any sampler views belonging to this
@@ -36,6 +36,7 @@
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "vbo/vbo.h"
 #include "util/list.h"
 #include "cso_cache/cso_context.h"
@@ -307,6 +308,14 @@ struct st_context
       unsigned hits;
    } readpix_cache;
 
+   /** glReadPixels into PBOs finished by a worker thread, oldest first */
+   struct {
+      bool enabled;
+      struct util_queue queue;
+      struct list_head jobs;
+      unsigned num_jobs;
+   } readpix_async;
+
    /** for glClear */
    struct {
       struct pipe_rasterizer_state raster;
@@ -365,6 +374,14 @@ struct st_context
    /* Winsys buffers */
    struct list_head winsys_buffers;
 
+   /** Threads decompressing textures in formats the driver lacks. */
+   struct util_queue decompress_queue;
+
+   /** Per-atom validation counters, allocated with ST_DEBUG=atoms or for
+    * the HUD.
+    */
+   struct st_atom_stats *atom_stats;
+
    /* Throttling for texture uploads and similar operations to limit memory
     * usage by limiting the number of in-flight operations based on
     * the estimated allocated size needed to execute those operations.
@@ -52,6 +52,8 @@ static const struct debug_named_value st_debug_flags[] = {
    { "wf",       DEBUG_WIREFRAME, NULL },
    { "gremedy",  DEBUG_GREMEDY, "Enable GREMEDY debug extensions" },
    { "noreadpixcache", DEBUG_NOREADPIXCACHE, NULL },
+   { "atoms",    DEBUG_ATOMS, "Print how often and how long each state atom ran" },
+   { "noreadpixasync", DEBUG_NOREADPIXASYNC, "Read back into PBOs synchronously on software drivers" },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -41,6 +41,7 @@
 #include "util/hash_table.h"
 #include "st_texture.h"
 
+#include "st_atom.h"
 #include "st_context.h"
 #include "st_debug.h"
 #include "st_extensions.h"
@@ -833,6 +834,13 @@ st_thread_finish(struct st_context_iface *stctxi)
 }
 
 
+static const struct st_validation_stats *
+st_context_get_validation_stats(struct st_context_iface *stctxi)
+{
+   return st_enable_atom_stats((struct st_context *) stctxi);
+}
+
+
 static void
 st_context_invalidate_state(struct st_context_iface *stctxi,
                             unsigned flags)
@@ -1003,6 +1011,7 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
    st->iface.start_thread = st_start_thread;
    st->iface.thread_finish = st_thread_finish;
    st->iface.invalidate_state = st_context_invalidate_state;
+   st->iface.get_validation_stats = st_context_get_validation_stats;
    st->iface.st_context_private = (void *) smapi;
    st->iface.cso_context = st->cso_context;
    st->iface.pipe = st->pipe;
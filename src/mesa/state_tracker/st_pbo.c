@@ -32,6 +32,7 @@
 #include "state_tracker/st_nir.h"
 #include "state_tracker/st_pbo.h"
 #include "state_tracker/st_cb_bufferobjects.h"
+#include "state_tracker/st_cb_readpixels.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
@@ -121,6 +122,9 @@ st_pbo_addresses_pixelstore(struct st_context *st,
    if (buf_offset % addr->bytes_per_pixel)
       return false;
 
+   /* The buffer is about to be accessed by the GPU. */
+   st_sync_async_readpixels(st, store->BufferObj);
+
    /* Convert to texels */
    buf_offset = buf_offset / addr->bytes_per_pixel;
 
@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check the decompression of ETC and ASTC uploads for drivers without
+ * those formats, which splits large images into strips decompressed on
+ * several threads.
+ *
+ * ETC1 images made of known colors must come back as those colors.  For
+ * the other formats, random blocks, many of them invalid, must decompress
+ * to what decompressing the whole image in one go gives.  Images end with
+ * partial blocks, and the source and destination are allocated to their
+ * exact size, so that reading or writing past a strip shows up with a
+ * memory checker.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/texcompress_astc.h"
+#include "main/texcompress_etc.h"
+#include "state_tracker/st_cb_texture.h"
+#include "state_tracker/st_context.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+
+/* The decompress queue gets this many threads whatever the CPU count. */
+#define NUM_THREADS 3
+
+static const int etc1_modifiers[8][4] = {
+   {  2,   8,  -2,   -8},
+   {  5,  17,  -5,  -17},
+   {  9,  29,  -9,  -29},
+   { 13,  42, -13,  -42},
+   { 18,  60, -18,  -60},
+   { 24,  80, -24,  -80},
+   { 33, 106, -33, -106},
+   { 47, 183, -47, -183}
+};
+
+static unsigned fails;
+
+static uint8_t
+clamp_ubyte(int value)
+{
+   return CLAMP(value, 0, 255);
+}
+
+/* Make an image of random ETC1 blocks in individual mode, and what they
+ * decode to according to the spec.
+ */
+static void
+make_etc1_image(uint8_t *blocks, uint8_t *pixels, unsigned width,
+                unsigned height)
+{
+   const unsigned blocks_x = DIV_ROUND_UP(width, 4);
+
+   for (unsigned by = 0; by < DIV_ROUND_UP(height, 4); by++) {
+      for (unsigned bx = 0; bx < blocks_x; bx++) {
+         uint8_t *block = blocks + (by * blocks_x + bx) * 8;
+         unsigned color[2][3], table[2];
+         bool flip = rand() & 1;
+         uint32_t indices = 0;
+
+         for (unsigned sub = 0; sub < 2; sub++) {
+            for (unsigned c = 0; c < 3; c++)
+               color[sub][c] = rand() & 0xf;
+            table[sub] = rand() & 0x7;
+         }
+         for (unsigned c = 0; c < 3; c++)
+            block[c] = color[0][c] << 4 | color[1][c];
+         block[3] = table[0] << 5 | table[1] << 2 | flip;
+
+         for (unsigned x = 0; x < 4; x++) {
+            for (unsigned y = 0; y < 4; y++) {
+               const unsigned bit = x * 4 + y;
+               const unsigned sub = flip ? y >= 2 : x >= 2;
+               const unsigned idx = rand() & 0x3;
+               const unsigned px = bx * 4 + x, py = by * 4 + y;
+
+               indices |= (idx >> 1) << (16 + bit) | (idx & 1) << bit;
+               if (px >= width || py >= height)
+                  continue;
+
+               uint8_t *dst = pixels + (py * width + px) * 4;
+               for (unsigned c = 0; c < 3; c++) {
+                  dst[c] = clamp_ubyte(color[sub][c] * 17 +
+                                       etc1_modifiers[table[sub]][idx]);
+               }
+               dst[3] = 255;
+            }
+         }
+         for (unsigned i = 0; i < 4; i++)
+            block[4 + i] = indices >> (24 - i * 8);
+      }
+   }
+}
+
+/* Decompress the whole image in one go, like for small images. */
+static void
+decompress_serially(mesa_format format, bool bgra, uint8_t *dst,
+                    unsigned dst_stride, const uint8_t *src,
+                    unsigned src_stride, unsigned width, unsigned height)
+{
+   if (format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(dst, dst_stride, src, src_stride,
+                                 width, height);
+   } else if (_mesa_is_format_etc2(format)) {
+      _mesa_unpack_etc2_format(dst, dst_stride, src, src_stride,
+                               width, height, format, bgra);
+   } else {
+      _mesa_unpack_astc_2d_ldr(dst, dst_stride, src, src_stride,
+                               width, height, format);
+   }
+}
+
+static void
+test_image(struct st_context *st, mesa_format format, bool bgra,
+           unsigned width, unsigned height)
+{
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+   const unsigned src_stride = DIV_ROUND_UP(width, blk_w) *
+                               _mesa_get_format_bytes(format);
+   const unsigned src_size = src_stride * DIV_ROUND_UP(height, blk_h);
+   const unsigned dst_stride = width * 4;
+   uint8_t *src = malloc(src_size);
+   uint8_t *expected = malloc(dst_stride * height);
+   uint8_t *actual = malloc(dst_stride * height);
+
+   if (format == MESA_FORMAT_ETC1_RGB8) {
+      make_etc1_image(src, expected, width, height);
+   } else {
+      for (unsigned i = 0; i < src_size; i++)
+         src[i] = rand();
+      decompress_serially(format, bgra, expected, dst_stride, src,
+                          src_stride, width, height);
+   }
+
+   memset(actual, 0xcd, dst_stride * height);
+   st_fallback_decompress(st, format, bgra, actual, dst_stride,
+                          src, src_stride, width, height);
+
+   for (unsigned y = 0; y < height; y++) {
+      if (memcmp(expected + y * dst_stride, actual + y * dst_stride,
+                 dst_stride)) {
+         printf("%s %ux%u%s: row %u differs.\n", _mesa_get_format_name(format),
+                width, height, bgra ? " (BGRA)" : "", y);
+         fails++;
+         break;
+      }
+   }
+
+   free(src);
+   free(expected);
+   free(actual);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const struct {
+      mesa_format format;
+      bool bgra;
+   } formats[] = {
+      { MESA_FORMAT_ETC1_RGB8 },
+      { MESA_FORMAT_ETC2_RGB8 },
+      { MESA_FORMAT_ETC2_RGBA8_EAC },
+      { MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1 },
+      { MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC, true },
+      { MESA_FORMAT_RGBA_ASTC_4x4 },
+      { MESA_FORMAT_RGBA_ASTC_8x5 },
+      { MESA_FORMAT_SRGB8_ALPHA8_ASTC_12x12 },
+   };
+   /* Small enough for one strip, more rows of blocks than strips with a
+    * partial last block, and fewer rows of blocks than strips.
+    */
+   static const unsigned sizes[][2] = {
+      { 64, 64 }, { 256, 256 }, { 301, 259 }, { 8193, 9 },
+   };
+   struct st_context *st = CALLOC_STRUCT(st_context);
+
+   util_cpu_detect();
+   if (!util_queue_init(&st->decompress_queue, "texdec", 8, NUM_THREADS, 0)) {
+      printf("Failed to create the decompress queue.\n");
+      return 1;
+   }
+
+   srand(42);
+   for (unsigned f = 0; f < ARRAY_SIZE(formats); f++) {
+      for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+         test_image(st, formats[f].format, formats[f].bgra,
+                    sizes[s][0], sizes[s][1]);
+      }
+   }
+
+   util_queue_destroy(&st->decompress_queue);
+   FREE(st);
+
+   if (fails) {
+      printf("Failure!\n");
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
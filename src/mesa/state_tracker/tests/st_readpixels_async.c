@@ -0,0 +1,378 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Check the deferred glReadPixels into PBOs: the staging texture holding
+ * the pixels read back must only be mapped, and without
+ * PIPE_MAP_UNSYNCHRONIZED, once the fence of the rendering into it has
+ * signalled; polling must not wait for that fence, and syncing with the
+ * buffer, or creating a fence sync object, must leave the pixels in it.
+ *
+ * The mock screen keeps resources in plain memory. Its fences signal when
+ * the test says so, or when they are waited for.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "state_tracker/st_cb_bufferobjects.h"
+#include "state_tracker/st_cb_readpixels.h"
+#include "state_tracker/st_cb_syncobj.h"
+#include "state_tracker/st_context.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#define WIDTH 4
+#define HEIGHT 3
+#define PBO_SIZE 1024
+
+struct mock_fence {
+   int refcount;
+   bool signalled;
+};
+
+struct mock_resource {
+   struct pipe_resource base;
+   struct pipe_fence_handle *rendering; /* The last rendering into it. */
+   uint8_t data[];
+};
+
+static unsigned num_resources;
+static unsigned staging_maps;
+static unsigned fence_waits;
+static unsigned fails;
+
+static struct pipe_resource *
+mock_resource_create(struct pipe_screen *screen,
+                     const struct pipe_resource *templ)
+{
+   unsigned size = templ->width0 * templ->height0 * 16;
+   struct mock_resource *res = CALLOC(1, sizeof(*res) + size);
+
+   res->base = *templ;
+   pipe_reference_init(&res->base.reference, 1);
+   res->base.screen = screen;
+   num_resources++;
+   return &res->base;
+}
+
+static void
+mock_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **dst,
+                     struct pipe_fence_handle *src);
+
+static void
+mock_resource_destroy(struct pipe_screen *screen, struct pipe_resource *res)
+{
+   mock_fence_reference(screen, &((struct mock_resource *)res)->rendering,
+                        NULL);
+   FREE(res);
+   num_resources--;
+}
+
+static void
+mock_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **dst,
+                     struct pipe_fence_handle *src)
+{
+   struct mock_fence *old = (struct mock_fence *)*dst;
+
+   if (src)
+      ((struct mock_fence *)src)->refcount++;
+   if (old && --old->refcount == 0)
+      FREE(old);
+   *dst = src;
+}
+
+/* Waiting makes the "GPU" finish, polling doesn't. */
+static bool
+mock_fence_finish(struct pipe_screen *screen, struct pipe_context *ctx,
+                  struct pipe_fence_handle *fence, uint64_t timeout)
+{
+   struct mock_fence *f = (struct mock_fence *)fence;
+
+   if (timeout && !f->signalled) {
+      f->signalled = true;
+      fence_waits++;
+   }
+   return f->signalled;
+}
+
+static void *
+mock_transfer_map(struct pipe_context *pipe, struct pipe_resource *res,
+                  unsigned level, unsigned usage, const struct pipe_box *box,
+                  struct pipe_transfer **transfer)
+{
+   struct mock_resource *mres = (struct mock_resource *)res;
+   uint8_t *data = mres->data;
+   unsigned stride = res->width0 * 4;
+
+   if (res->target != PIPE_BUFFER) {
+      staging_maps++;
+      if (!((struct mock_fence *)mres->rendering)->signalled) {
+         printf("The staging texture was mapped before the rendering into "
+                "it finished.\n");
+         fails++;
+      }
+      if (usage & PIPE_MAP_UNSYNCHRONIZED) {
+         printf("The staging texture was mapped unsynchronized.\n");
+         fails++;
+      }
+   } else {
+      stride = 0;
+   }
+
+   *transfer = CALLOC_STRUCT(pipe_transfer);
+   (*transfer)->box = *box;
+   (*transfer)->usage = usage;
+   (*transfer)->stride = stride;
+   pipe_resource_reference(&(*transfer)->resource, res);
+
+   if (res->target == PIPE_BUFFER)
+      return data + box->x;
+   return data + box->y * stride + box->x * 4;
+}
+
+static void
+mock_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+   pipe_resource_reference(&transfer->resource, NULL);
+   FREE(transfer);
+}
+
+/* Queue the rendering of the pixels read back into a new staging texture.
+ * The returned fence signals once it has finished.
+ */
+static struct pipe_resource *
+render_staging(struct pipe_screen *screen, struct pipe_fence_handle **fence)
+{
+   struct pipe_resource templ = {
+      .target = PIPE_TEXTURE_2D,
+      .format = PIPE_FORMAT_R8G8B8A8_UNORM,
+      .width0 = WIDTH,
+      .height0 = HEIGHT,
+      .depth0 = 1,
+      .array_size = 1,
+   };
+   struct pipe_resource *staging = screen->resource_create(screen, &templ);
+   struct mock_resource *mres = (struct mock_resource *)staging;
+
+   for (unsigned i = 0; i < WIDTH * HEIGHT * 4; i++)
+      mres->data[i] = i * 7 + 1;
+
+   *fence = NULL;
+   mock_fence_reference(screen, fence,
+                        (struct pipe_fence_handle *)CALLOC_STRUCT(mock_fence));
+   mock_fence_reference(screen, &mres->rendering, *fence);
+   return staging;
+}
+
+static void
+mock_flush(struct pipe_context *pipe, struct pipe_fence_handle **fence,
+           unsigned flags)
+{
+   if (fence) {
+      *fence = NULL;
+      mock_fence_reference(pipe->screen, fence,
+                           (struct pipe_fence_handle *)
+                           CALLOC_STRUCT(mock_fence));
+   }
+}
+
+static void
+check(bool condition, const char *what)
+{
+   if (!condition) {
+      printf("%s\n", what);
+      fails++;
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen screen = {
+      .resource_create = mock_resource_create,
+      .resource_destroy = mock_resource_destroy,
+      .fence_reference = mock_fence_reference,
+      .fence_finish = mock_fence_finish,
+   };
+   struct pipe_context pipe = {
+      .screen = &screen,
+      .transfer_map = mock_transfer_map,
+      .transfer_unmap = mock_transfer_unmap,
+      .flush = mock_flush,
+   };
+   static struct gl_context ctx;
+   struct gl_shared_state shared = { .RefCount = 1 };
+   struct st_context local_st = {
+      .ctx = &ctx,
+      .pipe = &pipe,
+      .screen = &screen,
+   };
+   struct st_context *st = &local_st;
+   struct pipe_resource buf_templ = {
+      .target = PIPE_BUFFER,
+      .format = PIPE_FORMAT_R8_UNORM,
+      .width0 = PBO_SIZE,
+      .height0 = 1,
+      .depth0 = 1,
+      .array_size = 1,
+   };
+   struct st_buffer_object pbo = {
+      .Base.RefCount = 1,
+      .Base.Size = PBO_SIZE,
+      .Base.UsageHistory = USAGE_PIXEL_PACK_BUFFER,
+   };
+   struct gl_pixelstore_attrib pack = {
+      .Alignment = 4,
+      .RowLength = 8,
+      .SkipRows = 1,
+      .BufferObj = &pbo.Base,
+   };
+   struct pipe_resource *staging;
+   struct pipe_fence_handle *fence;
+   const uint8_t *texels, *pixels;
+
+   list_inithead(&st->readpix_async.jobs);
+   ctx.st = st;
+   ctx.Shared = &shared;
+   st_init_syncobj_functions(&ctx.Driver);
+
+   pbo.buffer = screen.resource_create(&screen, &buf_templ);
+   pixels = ((struct mock_resource *)pbo.buffer)->data;
+
+   /* Matching layouts are copied, once the rendering has finished. */
+   staging = render_staging(&screen, &fence);
+   texels = ((struct mock_resource *)staging)->data;
+
+   check(st_queue_async_readpixels(st, staging, fence,
+                                   MESA_FORMAT_R8G8B8A8_UNORM,
+                                   WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+                                   &pack, (void *)16),
+         "Queuing a readback failed.");
+   st_poll_async_readpixels(st);
+   check(!staging_maps && !fence_waits && st->readpix_async.num_jobs == 1,
+         "Polling waited for the rendering.");
+
+   ((struct mock_fence *)fence)->signalled = true;
+   st_poll_async_readpixels(st);
+   check(staging_maps == 1, "Polling didn't start the copy.");
+
+   st_sync_async_readpixels(st, &pbo.Base);
+   check(!st->readpix_async.num_jobs, "Syncing didn't retire the readback.");
+   check(!fence_waits, "Syncing waited for a signalled fence.");
+
+   for (unsigned y = 0; y < HEIGHT; y++) {
+      const unsigned offset = 16 + (1 + y) * 8 * 4;
+
+      check(!memcmp(pixels + offset, texels + y * WIDTH * 4, WIDTH * 4),
+            "The copied pixels are wrong.");
+      check(!pixels[offset + WIDTH * 4], "The row padding was written.");
+   }
+   screen.fence_reference(&screen, &fence, NULL);
+   pipe_resource_reference(&staging, NULL);
+
+   /* Other formats are converted; syncing waits for the rendering. */
+   memset(&pack, 0, sizeof(pack));
+   pack.Alignment = 4;
+   pack.BufferObj = &pbo.Base;
+
+   staging = render_staging(&screen, &fence);
+   texels = ((struct mock_resource *)staging)->data;
+
+   st_queue_async_readpixels(st, staging, fence, MESA_FORMAT_R8G8B8A8_UNORM,
+                             WIDTH, HEIGHT, GL_RGBA, GL_FLOAT, &pack, NULL);
+   check(staging_maps == 1, "The staging texture was mapped too early.");
+   st_sync_async_readpixels(st, NULL);
+   check(fence_waits == 1 && staging_maps == 2,
+         "Syncing didn't wait for the rendering.");
+
+   for (unsigned i = 0; i < WIDTH * HEIGHT * 4; i++) {
+      if (fabsf(((const float *)pixels)[i] - texels[i] / 255.0f) > 1e-6) {
+         printf("Pixel %u was converted to %f instead of %f.\n",
+                i, ((const float *)pixels)[i], texels[i] / 255.0f);
+         fails++;
+         break;
+      }
+   }
+   screen.fence_reference(&screen, &fence, NULL);
+   pipe_resource_reference(&staging, NULL);
+
+   /* A fence sync created after the readback must find the pixels in the
+    * buffer once it has signalled.
+    */
+   memset((void *)pixels, 0, PBO_SIZE);
+   staging = render_staging(&screen, &fence);
+   texels = ((struct mock_resource *)staging)->data;
+
+   st_queue_async_readpixels(st, staging, fence, MESA_FORMAT_R8G8B8A8_UNORM,
+                             WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, &pack,
+                             NULL);
+   check(st->readpix_async.num_jobs == 1, "The readback wasn't queued.");
+
+   struct gl_sync_object *sync = ctx.Driver.NewSyncObject(&ctx);
+   ctx.Driver.FenceSync(&ctx, sync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   ctx.Driver.ClientWaitSync(&ctx, sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GL_TIMEOUT_IGNORED);
+   check(sync->StatusFlag, "The fence sync didn't signal.");
+   check(!st->readpix_async.num_jobs,
+         "The readback is still pending after glFenceSync.");
+   check(!memcmp(pixels, texels, WIDTH * HEIGHT * 4),
+         "The pixels aren't in the buffer when the fence sync signals.");
+   ctx.Driver.DeleteSyncObject(&ctx, sync);
+
+   screen.fence_reference(&screen, &fence, NULL);
+   pipe_resource_reference(&staging, NULL);
+
+   /* The number of readbacks in flight is bounded. */
+   for (unsigned i = 0; i < 10; i++) {
+      staging = render_staging(&screen, &fence);
+      st_queue_async_readpixels(st, staging, fence,
+                                MESA_FORMAT_R8G8B8A8_UNORM, WIDTH, HEIGHT,
+                                GL_RGBA, GL_UNSIGNED_BYTE, &pack, NULL);
+      screen.fence_reference(&screen, &fence, NULL);
+      pipe_resource_reference(&staging, NULL);
+      check(st->readpix_async.num_jobs <= 4, "Too many readbacks in flight.");
+   }
+   st_sync_async_readpixels(st, NULL);
+
+   util_queue_destroy(&st->readpix_async.queue);
+   pipe_resource_reference(&pbo.buffer, NULL);
+
+   if (num_resources) {
+      printf("%u resources were leaked.\n", num_resources);
+      fails++;
+   }
+
+   if (fails) {
+      printf("Failure!\n");
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
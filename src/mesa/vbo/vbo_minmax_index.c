@@ -33,6 +33,7 @@
 #include "main/sse_minmax.h"
 #include "x86/common_x86_asm.h"
 #include "util/hash_table.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "pipe/p_state.h"
 
@@ -102,6 +103,33 @@ vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
 }
 
 
+/**
+ * Drop the cached entries whose index range overlaps the written bytes
+ * [start, end).  Entries for other parts of the buffer stay valid, which
+ * keeps the cache useful for apps that sub-allocate one big index buffer.
+ */
+static void
+vbo_minmax_cache_invalidate_range(struct gl_buffer_object *bufferObj,
+                                  GLintptr start, GLintptr end)
+{
+   if (start <= 0 && end >= bufferObj->Size) {
+      _mesa_hash_table_clear(bufferObj->MinMaxCache,
+                             vbo_minmax_cache_delete_entry);
+      return;
+   }
+
+   hash_table_foreach(bufferObj->MinMaxCache, entry) {
+      const struct minmax_cache_key *key = entry->key;
+      GLintptr key_end = key->offset + (GLintptr)key->count * key->index_size;
+
+      if (key->offset < end && key_end > start) {
+         free(entry->data);
+         _mesa_hash_table_remove(bufferObj->MinMaxCache, entry);
+      }
+   }
+}
+
+
 static GLboolean
 vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
                       unsigned index_size, GLintptr offset, GLuint count,
@@ -135,9 +163,10 @@ vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
          goto out_disable;
       }
 
-      _mesa_hash_table_clear(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
+      vbo_minmax_cache_invalidate_range(bufferObj,
+                                        bufferObj->MinMaxCacheDirtyStart,
+                                        bufferObj->MinMaxCacheDirtyEnd);
       bufferObj->MinMaxCacheDirty = false;
-      goto out_invalidate;
    }
 
    key.index_size = index_size;
@@ -152,7 +181,6 @@ vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
       found = GL_TRUE;
    }
 
-out_invalidate:
    if (found) {
       /* The hit counter saturates so that we don't accidently disable the
        * cache in a long-running program.
@@ -235,6 +263,51 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
                             const void *indices,
                             unsigned *min_index, unsigned *max_index)
 {
+#if defined(USE_AVX2)
+   if (util_cpu_caps.has_avx2) {
+      switch (index_size) {
+      case 4:
+         _mesa_uint_index_min_max_avx2(indices, restart, restartIndex,
+                                       min_index, max_index, count);
+         return;
+      case 2:
+         _mesa_ushort_index_min_max_avx2(indices, restart, restartIndex,
+                                         min_index, max_index, count);
+         return;
+      case 1:
+         _mesa_ubyte_index_min_max_avx2(indices, restart, restartIndex,
+                                        min_index, max_index, count);
+         return;
+      default:
+         unreachable("not reached");
+      }
+   }
+#endif
+
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      switch (index_size) {
+      case 4:
+         if (restart)
+            _mesa_uint_index_min_max(indices, true, restartIndex,
+                                     min_index, max_index, count);
+         else
+            _mesa_uint_array_min_max(indices, min_index, max_index, count);
+         return;
+      case 2:
+         _mesa_ushort_index_min_max(indices, restart, restartIndex,
+                                    min_index, max_index, count);
+         return;
+      case 1:
+         _mesa_ubyte_index_min_max(indices, restart, restartIndex,
+                                   min_index, max_index, count);
+         return;
+      default:
+         unreachable("not reached");
+      }
+   }
+#endif
+
    switch (index_size) {
    case 4: {
       const GLuint *ui_indices = (const GLuint *)indices;
@@ -249,16 +322,10 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
          }
       }
       else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
+         for (unsigned i = 0; i < count; i++) {
+            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
          }
-         else
-#endif
-            for (unsigned i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
       }
       *min_index = min_ui;
       *max_index = max_ui;
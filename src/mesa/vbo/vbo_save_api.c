@@ -922,6 +922,16 @@ copy_to_current(struct gl_context *ctx)
          COPY_CLEAN_4V_TYPE_AS_UNION(save->current[i], save->attrsz[i],
                                      save->attrptr[i], save->attrtype[i]);
    }
+
+   /* With GL_COLOR_MATERIAL enabled, colors and materials overwrite each
+    * other, so dlist.c must not drop a later glColor or glMaterial that
+    * sets the cached value.
+    */
+   if (save->enabled & VBO_ATTRIBS_MATERIALS)
+      ctx->ListState.ActiveAttribSize[VERT_ATTRIB_COLOR0] = 0;
+   if (save->enabled & BITFIELD64_BIT(VBO_ATTRIB_COLOR0))
+      memset(ctx->ListState.ActiveMaterialSize, 0,
+             sizeof(ctx->ListState.ActiveMaterialSize));
 }
 
 
@@ -37,6 +37,8 @@
 #include <zlib.h>
 #endif
 #include "crc32.h"
+#include "u_cpu_detect.h"
+#include "u_hash_accel.h"
 
 
 static const uint32_t 
@@ -116,7 +118,31 @@ util_hash_crc32(const void *data, size_t size)
 {
    const uint8_t *p = data;
    uint32_t crc = 0xffffffff;
- 
+
+#if defined(UTIL_HAVE_HASH_ACCEL_X86) || defined(UTIL_HAVE_HASH_ACCEL_AARCH64)
+   util_cpu_detect();
+#endif
+#if defined(UTIL_HAVE_HASH_ACCEL_X86)
+   /* The folding loop wants whole 16 byte blocks, the tail goes through the
+    * table below.
+    */
+   if (size >= 64 && util_cpu_caps.has_pclmul && util_cpu_caps.has_sse4_1) {
+      size_t folded = size & ~(size_t)15;
+
+      crc = util_crc32_pclmul(crc, p, folded);
+      p += folded;
+      size -= folded;
+
+      while (size--)
+         crc = util_crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+      return crc;
+   }
+#endif
+#if defined(UTIL_HAVE_HASH_ACCEL_AARCH64)
+   if (util_cpu_caps.has_arm_crc32)
+      return util_crc32_armv8(crc, p, size);
+#endif
+
 #ifdef HAVE_ZLIB
    /* Prefer zlib's implementation for better performance.
     * zlib's uInt is always "unsigned int" while size_t can be 64bit.
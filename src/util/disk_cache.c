@@ -39,6 +39,8 @@
 
 #include "util/crc32.h"
 #include "util/debug.h"
+#include "util/hash_table.h"
+#include "util/list.h"
 #include "util/rand_xor.h"
 #include "util/u_atomic.h"
 #include "util/mesa-sha1.h"
@@ -68,6 +70,183 @@ do {                                       \
    _dst += _src_size;                      \
 } while (0);
 
+/* Default size of the in-memory cache of recently loaded items. */
+#define MEM_CACHE_DEFAULT_SIZE (4 * 1024 * 1024)
+
+/* An item in the in-memory cache, holding uncompressed data exactly as
+ * returned by disk_cache_get().
+ */
+struct mem_cache_item {
+   struct list_head link;
+   cache_key key;
+   size_t size;
+   uint8_t data[];
+};
+
+/* Parse a size optionally followed by K, M or G, defaulting to gigabytes.
+ * Returns 0 if the string doesn't start with a number.
+ */
+static uint64_t
+parse_cache_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoul(str, &end, 10);
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      return size * 1024;
+   case 'M':
+   case 'm':
+      return size * 1024 * 1024;
+   case '\0':
+   case 'G':
+   case 'g':
+   default:
+      return size * 1024 * 1024 * 1024;
+   }
+}
+
+static uint32_t
+mem_cache_key_hash(const void *key)
+{
+   /* Keys are SHA-1 hashes, so any 32 bits of them will do. */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+mem_cache_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static bool
+mem_cache_init(struct disk_cache *cache, uint64_t max_size)
+{
+   cache->mem_cache = _mesa_hash_table_create(cache, mem_cache_key_hash,
+                                              mem_cache_key_equal);
+   if (!cache->mem_cache)
+      return false;
+
+   simple_mtx_init(&cache->mem_cache_mtx, mtx_plain);
+   list_inithead(&cache->mem_cache_lru);
+   cache->mem_cache_max_size = max_size;
+
+   return true;
+}
+
+static void
+mem_cache_remove_item(struct disk_cache *cache, struct mem_cache_item *item)
+{
+   _mesa_hash_table_remove_key(cache->mem_cache, item->key);
+   list_del(&item->link);
+   cache->mem_cache_size -= item->size;
+   free(item);
+}
+
+static void
+mem_cache_clear(struct disk_cache *cache)
+{
+   simple_mtx_lock(&cache->mem_cache_mtx);
+   list_for_each_entry_safe(struct mem_cache_item, item,
+                            &cache->mem_cache_lru, link)
+      mem_cache_remove_item(cache, item);
+   simple_mtx_unlock(&cache->mem_cache_mtx);
+}
+
+static void
+mem_cache_finish(struct disk_cache *cache)
+{
+   mem_cache_clear(cache);
+   simple_mtx_destroy(&cache->mem_cache_mtx);
+}
+
+static void *
+mem_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   void *data = NULL;
+
+   simple_mtx_lock(&cache->mem_cache_mtx);
+
+   struct hash_entry *entry = _mesa_hash_table_search(cache->mem_cache, key);
+   if (entry) {
+      struct mem_cache_item *item = entry->data;
+
+      /* Move the item to the most recently used end of the list. */
+      list_del(&item->link);
+      list_addtail(&item->link, &cache->mem_cache_lru);
+
+      data = malloc(item->size);
+      if (data) {
+         memcpy(data, item->data, item->size);
+         if (size)
+            *size = item->size;
+      }
+
+      cache->mem_cache_hits++;
+   } else {
+      cache->mem_cache_misses++;
+   }
+
+   simple_mtx_unlock(&cache->mem_cache_mtx);
+
+   return data;
+}
+
+static void
+mem_cache_put(struct disk_cache *cache, const cache_key key,
+              const void *data, size_t size)
+{
+   /* Don't let a single large item flush everything else. */
+   if (size > cache->mem_cache_max_size / 4)
+      return;
+
+   struct mem_cache_item *item = malloc(sizeof(*item) + size);
+   if (!item)
+      return;
+
+   memcpy(item->key, key, CACHE_KEY_SIZE);
+   memcpy(item->data, data, size);
+   item->size = size;
+
+   simple_mtx_lock(&cache->mem_cache_mtx);
+
+   /* Another thread may have loaded the same item in the meantime. */
+   if (_mesa_hash_table_search(cache->mem_cache, key)) {
+      simple_mtx_unlock(&cache->mem_cache_mtx);
+      free(item);
+      return;
+   }
+
+   while (cache->mem_cache_size + size > cache->mem_cache_max_size) {
+      mem_cache_remove_item(cache,
+                            list_first_entry(&cache->mem_cache_lru,
+                                             struct mem_cache_item, link));
+   }
+
+   _mesa_hash_table_insert(cache->mem_cache, item->key, item);
+   list_addtail(&item->link, &cache->mem_cache_lru);
+   cache->mem_cache_size += size;
+
+   simple_mtx_unlock(&cache->mem_cache_mtx);
+}
+
+static void
+mem_cache_remove(struct disk_cache *cache, const cache_key key)
+{
+   simple_mtx_lock(&cache->mem_cache_mtx);
+
+   struct hash_entry *entry = _mesa_hash_table_search(cache->mem_cache, key);
+   if (entry)
+      mem_cache_remove_item(cache, entry->data);
+
+   simple_mtx_unlock(&cache->mem_cache_mtx);
+}
+
 struct disk_cache *
 disk_cache_create(const char *gpu_name, const char *driver_id,
                   uint64_t driver_flags)
@@ -129,30 +308,8 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    }
    #endif
 
-   if (max_size_str) {
-      char *end;
-      max_size = strtoul(max_size_str, &end, 10);
-      if (end == max_size_str) {
-         max_size = 0;
-      } else {
-         switch (*end) {
-         case 'K':
-         case 'k':
-            max_size *= 1024;
-            break;
-         case 'M':
-         case 'm':
-            max_size *= 1024*1024;
-            break;
-         case '\0':
-         case 'G':
-         case 'g':
-         default:
-            max_size *= 1024*1024*1024;
-            break;
-         }
-      }
-   }
+   if (max_size_str)
+      max_size = parse_cache_size(max_size_str);
 
    /* Default to 1GB for maximum cache size. */
    if (max_size == 0) {
@@ -161,6 +318,12 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   /* The single file cache is only shrunk when writing to it, so also check
+    * here in case a previous run left it larger than the current limit.
+    */
+   if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false))
+      disk_cache_evict_lru_items_foz(cache);
+
    /* 4 threads were chosen below because just about all modern CPUs currently
     * available that run Mesa have *at least* 4 cores. For these CPUs allowing
     * more threads can result in the queue being processed faster, thus
@@ -177,6 +340,20 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
                         UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY))
       goto fail;
 
+   /* Keep recently loaded items in memory, so that items loaded over and
+    * over by the same process don't have to be read from disk, checked and
+    * decompressed each time. Setting the size to 0 disables this.
+    */
+   uint64_t mem_cache_size = MEM_CACHE_DEFAULT_SIZE;
+   const char *mem_cache_size_str = getenv("MESA_GLSL_CACHE_MEMORY_SIZE");
+   if (mem_cache_size_str)
+      mem_cache_size = parse_cache_size(mem_cache_size_str);
+
+   if (mem_cache_size && !mem_cache_init(cache, mem_cache_size)) {
+      util_queue_destroy(&cache->cache_queue);
+      goto fail;
+   }
+
    cache->path_init_failed = false;
 
  path_fail:
@@ -236,6 +413,9 @@ disk_cache_destroy(struct disk_cache *cache)
       if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false))
          foz_destroy(&cache->foz_db);
 
+      if (cache->mem_cache)
+         mem_cache_finish(cache);
+
       disk_cache_destroy_mmap(cache);
    }
 
@@ -251,6 +431,9 @@ disk_cache_wait_for_idle(struct disk_cache *cache)
 void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
+   if (cache->mem_cache)
+      mem_cache_remove(cache, key);
+
    char *filename = disk_cache_get_cache_filename(cache, key);
    if (filename == NULL) {
       return;
@@ -325,7 +508,11 @@ cache_put(void *job, int thread_index)
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
    if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
-      disk_cache_write_item_to_disk_foz(dc_job);
+      /* If the cache is too large, evict the least recently used items. */
+      if (disk_cache_write_item_to_disk_foz(dc_job) &&
+          disk_cache_evict_lru_items_foz(dc_job->cache) &&
+          dc_job->cache->mem_cache)
+         mem_cache_clear(dc_job->cache);
    } else {
       filename = disk_cache_get_cache_filename(dc_job->cache, dc_job->key);
       if (filename == NULL)
@@ -338,6 +525,12 @@ cache_put(void *job, int thread_index)
          i++;
       }
 
+      /* We don't know which items were evicted, so make sure that they
+       * aren't still returned from memory.
+       */
+      if (i && dc_job->cache->mem_cache)
+         mem_cache_clear(dc_job->cache);
+
       disk_cache_write_item_to_disk(dc_job, filename);
 
 done:
@@ -396,15 +589,129 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (cache->mem_cache) {
+      void *data = mem_cache_get(cache, key, size);
+      if (data)
+         return data;
+   }
+
+   size_t item_size = 0;
+   void *data;
+
    if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
-      return disk_cache_load_item_foz(cache, key, size);
+      data = disk_cache_load_item_foz(cache, key, &item_size);
    } else {
       char *filename = disk_cache_get_cache_filename(cache, key);
       if (filename == NULL)
          return NULL;
 
-      return disk_cache_load_item(cache, filename, size);
+      data = disk_cache_load_item(cache, filename, &item_size);
    }
+
+   if (data && cache->mem_cache)
+      mem_cache_put(cache, key, data, item_size);
+
+   if (size)
+      *size = item_size;
+
+   return data;
+}
+
+struct disk_cache_batch_item {
+   struct util_queue_fence fence;
+   struct disk_cache *cache;
+   cache_key key;
+   void *data;
+   size_t size;
+   bool queued;
+};
+
+struct disk_cache_batch {
+   unsigned num_items;
+   struct disk_cache_batch_item items[];
+};
+
+static void
+cache_get(void *job, int thread_index)
+{
+   struct disk_cache_batch_item *item = (struct disk_cache_batch_item *) job;
+
+   item->data = disk_cache_get(item->cache, item->key, &item->size);
+}
+
+struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys)
+{
+   struct disk_cache_batch *batch =
+      malloc(sizeof(*batch) + num_keys * sizeof(batch->items[0]));
+   if (!batch)
+      return NULL;
+
+   batch->num_items = num_keys;
+
+   for (unsigned i = 0; i < num_keys; i++) {
+      struct disk_cache_batch_item *item = &batch->items[i];
+
+      util_queue_fence_init(&item->fence);
+      item->cache = cache;
+      memcpy(item->key, keys[i], sizeof(cache_key));
+      item->data = NULL;
+      item->size = 0;
+
+      /* Without a cache queue (e.g. when only the blob callbacks are used)
+       * items are loaded by disk_cache_batch_get() instead.
+       */
+      item->queued = !cache->path_init_failed;
+      if (item->queued) {
+         util_queue_add_job(&cache->cache_queue, item, &item->fence,
+                            cache_get, NULL, 0);
+      }
+   }
+
+   return batch;
+}
+
+void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size)
+{
+   struct disk_cache_batch_item *item = &batch->items[index];
+   void *data;
+
+   assert(index < batch->num_items);
+
+   if (item->queued) {
+      util_queue_fence_wait(&item->fence);
+      data = item->data;
+      if (size)
+         *size = data ? item->size : 0;
+   } else {
+      data = disk_cache_get(item->cache, item->key, size);
+   }
+
+   /* The caller owns the data now. */
+   item->data = NULL;
+   item->queued = false;
+
+   return data;
+}
+
+void
+disk_cache_batch_destroy(struct disk_cache_batch *batch)
+{
+   if (!batch)
+      return;
+
+   for (unsigned i = 0; i < batch->num_items; i++) {
+      struct disk_cache_batch_item *item = &batch->items[i];
+
+      util_queue_fence_wait(&item->fence);
+      free(item->data);
+      util_queue_fence_destroy(&item->fence);
+   }
+
+   free(batch);
 }
 
 void
@@ -475,4 +782,20 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    cache->blob_get_cb = get;
 }
 
+void
+disk_cache_get_mem_stats(struct disk_cache *cache, uint64_t *hits,
+                         uint64_t *misses)
+{
+   *hits = 0;
+   *misses = 0;
+
+   if (!cache || !cache->mem_cache)
+      return;
+
+   simple_mtx_lock(&cache->mem_cache_mtx);
+   *hits = cache->mem_cache_hits;
+   *misses = cache->mem_cache_misses;
+   simple_mtx_unlock(&cache->mem_cache_mtx);
+}
+
 #endif /* ENABLE_SHADER_CACHE */
@@ -76,6 +76,7 @@ struct cache_item_metadata {
 };
 
 struct disk_cache;
+struct disk_cache_batch;
 
 static inline char *
 disk_cache_format_hex_id(char *buf, const uint8_t *hex_id, unsigned size)
@@ -223,6 +224,36 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
 
+/**
+ * Start loading the items named by \keys in the background, so that reading
+ * and decompressing them overlaps with whatever the caller does next.
+ *
+ * Each item is then retrieved with disk_cache_batch_get(), which waits for
+ * that item only. The batch must be destroyed with
+ * disk_cache_batch_destroy() before the cache is destroyed.
+ *
+ * \return A batch, or NULL on allocation failure.
+ */
+struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys);
+
+/**
+ * Wait for item \index of a batch started by disk_cache_get_batch() and
+ * return it, exactly as disk_cache_get() would have returned it for
+ * keys[index]. The returned data is malloc'ed so the caller should call
+ * free() it when finished. Each item can only be retrieved once.
+ */
+void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size);
+
+/**
+ * Wait for all items of a batch and free the ones that weren't retrieved.
+ */
+void
+disk_cache_batch_destroy(struct disk_cache_batch *batch);
+
 /**
  * Store the name \key within the cache, (without any associated data).
  *
@@ -259,6 +290,14 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Return how many disk_cache_get() calls were served by, or missed, the
+ * in-memory cache of recently loaded items.
+ */
+void
+disk_cache_get_mem_stats(struct disk_cache *cache, uint64_t *hits,
+                         uint64_t *misses);
+
 #else
 
 static inline struct disk_cache *
@@ -293,6 +332,26 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+static inline struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys)
+{
+   return NULL;
+}
+
+static inline void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size)
+{
+   return NULL;
+}
+
+static inline void
+disk_cache_batch_destroy(struct disk_cache_batch *batch)
+{
+   return;
+}
+
 static inline void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
@@ -319,6 +378,14 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    return;
 }
 
+static inline void
+disk_cache_get_mem_stats(struct disk_cache *cache, uint64_t *hits,
+                         uint64_t *misses)
+{
+   *hits = 0;
+   *misses = 0;
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
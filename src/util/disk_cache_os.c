@@ -952,6 +952,20 @@ disk_cache_write_item_to_disk_foz(struct disk_cache_put_job *dc_job)
                           dc_job->size);
 }
 
+/* Returns true if any items were evicted. */
+bool
+disk_cache_evict_lru_items_foz(struct disk_cache *cache)
+{
+   if (p_atomic_read(&cache->foz_db.size) <= cache->max_size)
+      return false;
+
+   /* Evicting from the single file cache means rewriting the whole db, so
+    * shrink it well below the limit to avoid doing so on every write.
+    */
+   return foz_compact(&cache->foz_db, cache->max_size,
+                      cache->max_size / 4 * 3);
+}
+
 bool
 disk_cache_load_cache_index(void *mem_ctx, struct disk_cache *cache,
                             char *path)
@@ -24,6 +24,8 @@
 #ifndef DISK_CACHE_OS_H
 #define DISK_CACHE_OS_H
 
+#include "util/list.h"
+#include "util/simple_mtx.h"
 #include "util/u_queue.h"
 
 #if DETECT_OS_WINDOWS
@@ -75,6 +77,17 @@ struct disk_cache {
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* In-memory LRU cache of recently loaded items, keyed by cache_key.
+    * NULL if disabled.
+    */
+   struct hash_table *mem_cache;
+   struct list_head mem_cache_lru;
+   simple_mtx_t mem_cache_mtx;
+   uint64_t mem_cache_size;
+   uint64_t mem_cache_max_size;
+   uint64_t mem_cache_hits;
+   uint64_t mem_cache_misses;
 };
 
 struct disk_cache_put_job {
@@ -116,6 +129,9 @@ disk_cache_get_cache_filename(struct disk_cache *cache, const cache_key key);
 bool
 disk_cache_write_item_to_disk_foz(struct disk_cache_put_job *dc_job);
 
+bool
+disk_cache_evict_lru_items_foz(struct disk_cache *cache);
+
 void
 disk_cache_write_item_to_disk(struct disk_cache_put_job *dc_job,
                               char *filename);
@@ -38,7 +38,10 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -48,12 +51,17 @@
 #include "hash_table.h"
 #include "mesa-sha1.h"
 #include "ralloc.h"
+#include "u_atomic.h"
+#include "u_math.h"
 
 /* 3 is the recomended level, with 22 as the absolute maximum */
 #define ZSTD_COMPRESSION_LEVEL 3
 
 #define FOZ_REF_MAGIC_SIZE 16
 
+/* Smallest mapping of the writable foz db, see foz_map_db() */
+#define FOZ_MIN_MAP_SIZE (1024 * 1024)
+
 static const uint8_t stream_reference_magic_and_version[FOZ_REF_MAGIC_SIZE] = {
    0x81, 'F', 'O', 'S',
    'S', 'I', 'L', 'I',
@@ -78,6 +86,109 @@ truncate_hash_to_64bits(const uint8_t *cache_key)
    return hash;
 }
 
+static uint64_t
+get_file_size(FILE *file)
+{
+   struct stat st;
+
+   fflush(file);
+   if (fstat(fileno(file), &st) == -1)
+      return 0;
+
+   return st.st_size;
+}
+
+/* A read only mapping of a foz db. Readers hold a reference while they
+ * decompress an entry, so the mapping can be replaced (when the writable db
+ * outgrows it or is compacted) without waiting for them.
+ */
+struct foz_db_map {
+   uint8_t *data;
+   size_t size;
+   int refcount;
+};
+
+static void
+foz_db_map_unref(struct foz_db_map *map)
+{
+   if (p_atomic_dec_zero(&map->refcount)) {
+      munmap(map->data, map->size);
+      free(map);
+   }
+}
+
+/* Map a foz db so that entries can be read without seeking its FILE, which
+ * would otherwise serialise all readers. The writable db keeps growing, so
+ * its mapping extends past the end of the file and is replaced whenever an
+ * entry is written beyond it. If mapping fails entries are read with
+ * pread() instead.
+ */
+static void
+foz_map_db(struct foz_db *foz_db, uint8_t file_idx, bool read_only)
+{
+   uint64_t file_size = get_file_size(foz_db->file[file_idx]);
+   uint64_t map_size = file_size;
+
+   if (!read_only) {
+      map_size = MAX2(FOZ_MIN_MAP_SIZE,
+                      util_next_power_of_two64(file_size + 1));
+   }
+
+   if (foz_db->map[file_idx]) {
+      foz_db_map_unref(foz_db->map[file_idx]);
+      foz_db->map[file_idx] = NULL;
+   }
+
+   foz_db->data_size[file_idx] = file_size;
+
+   if (map_size == 0 || map_size > SIZE_MAX)
+      return;
+
+   struct foz_db_map *map = malloc(sizeof(*map));
+   if (!map)
+      return;
+
+   map->data = mmap(NULL, map_size, PROT_READ, MAP_SHARED,
+                    fileno(foz_db->file[file_idx]), 0);
+   if (map->data == MAP_FAILED) {
+      free(map);
+      return;
+   }
+
+   map->size = map_size;
+   map->refcount = 1;
+   foz_db->map[file_idx] = map;
+}
+
+/* Return size bytes at offset in a foz db, either straight from its mapping
+ * or read into a new allocation returned in *copy that the caller frees.
+ */
+static const uint8_t *
+foz_get_bytes(struct foz_db *foz_db, struct foz_db_map *map,
+              uint8_t file_idx, uint64_t data_size, uint64_t offset,
+              size_t size, uint8_t **copy)
+{
+   /* Never touch the mapping past the end of the file. */
+   if (offset > data_size || size > data_size - offset)
+      return NULL;
+
+   if (map)
+      return map->data + offset;
+
+   *copy = malloc(size);
+   if (!*copy)
+      return NULL;
+
+   if (pread(fileno(foz_db->file[file_idx]), *copy, size, offset) !=
+       (ssize_t)size) {
+      free(*copy);
+      *copy = NULL;
+      return NULL;
+   }
+
+   return *copy;
+}
+
 static bool
 check_files_opened_successfully(FILE *file, FILE *db_idx)
 {
@@ -182,6 +293,7 @@ load_foz_dbs(struct foz_db *foz_db, FILE *db_idx, uint8_t file_idx,
                                              struct foz_db_entry);
          entry->header = *header;
          entry->file_idx = file_idx;
+         entry->last_used = 0;
          _mesa_sha1_hex_to_sha1(entry->key, hash_str);
 
          /* read cache item offset from index file */
@@ -199,6 +311,11 @@ load_foz_dbs(struct foz_db *foz_db, FILE *db_idx, uint8_t file_idx,
          uint64_t key = strtoull(hash_str, NULL, 16);
          _mesa_hash_table_u64_insert(foz_db->index_db, key, entry);
 
+         if (!read_only) {
+            util_dynarray_append(&foz_db->writable_entries,
+                                 struct foz_db_entry *, entry);
+         }
+
          offset += header->payload_size;
       }
 
@@ -219,6 +336,13 @@ load_foz_dbs(struct foz_db *foz_db, FILE *db_idx, uint8_t file_idx,
          goto fail;
    }
 
+   if (!read_only) {
+      foz_db->size = get_file_size(foz_db->file[file_idx]) +
+                     get_file_size(db_idx);
+   }
+
+   foz_map_db(foz_db, file_idx, read_only);
+
    foz_db->alive = true;
    return true;
 
@@ -245,15 +369,22 @@ foz_prepare(struct foz_db *foz_db, char *base_filename)
    foz_db->file[0] = fopen(filename, "a+b");
    foz_db->db_idx = fopen(idx_filename, "a+b");
 
-   free(filename);
-   free(idx_filename);
-
-   if (!check_files_opened_successfully(foz_db->file[0], foz_db->db_idx))
+   if (!check_files_opened_successfully(foz_db->file[0], foz_db->db_idx)) {
+      free(filename);
+      free(idx_filename);
       return false;
+   }
 
    simple_mtx_init(&foz_db->mtx, mtx_plain);
+   u_rwlock_init(&foz_db->rwlock);
    foz_db->mem_ctx = ralloc_context(NULL);
    foz_db->index_db = _mesa_hash_table_u64_create(NULL);
+   foz_db->filename = ralloc_strdup(foz_db->mem_ctx, filename);
+   foz_db->idx_filename = ralloc_strdup(foz_db->mem_ctx, idx_filename);
+   util_dynarray_init(&foz_db->writable_entries, foz_db->mem_ctx);
+
+   free(filename);
+   free(idx_filename);
 
    if (!load_foz_dbs(foz_db, foz_db->db_idx, 0, false))
       return false;
@@ -309,17 +440,24 @@ foz_destroy(struct foz_db *foz_db)
    for (unsigned i = 0; i < FOZ_MAX_DBS; i++) {
       if (foz_db->file[i])
          fclose(foz_db->file[i]);
+      if (foz_db->map[i])
+         foz_db_map_unref(foz_db->map[i]);
    }
 
    if (foz_db->mem_ctx) {
       _mesa_hash_table_u64_destroy(foz_db->index_db, NULL);
       ralloc_free(foz_db->mem_ctx);
+      u_rwlock_destroy(&foz_db->rwlock);
       simple_mtx_destroy(&foz_db->mtx);
    }
 }
 
 /* Here we lookup a cache entry in the index hash table. If an entry is found
- * we use the retrieved offset to read the cache entry from disk.
+ * we use the retrieved offset to read the cache entry from the mapped db.
+ *
+ * The read side of foz_db::rwlock only covers the lookup. The entry is then
+ * checked and decompressed from the mapping without holding any lock, so
+ * any number of threads can load entries at the same time.
  */
 void *
 foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
@@ -327,55 +465,79 @@ foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
 {
    uint64_t hash = truncate_hash_to_64bits(cache_key_160bit);
 
-   uint8_t *compressed_data = NULL;
+   struct foz_db_map *map = NULL;
+   uint8_t *record_copy = NULL;
+   uint8_t *compressed_copy = NULL;
    void *blob = NULL;
 
    if (!foz_db->alive)
       return NULL;
 
-   simple_mtx_lock(&foz_db->mtx);
+   u_rwlock_rdlock(&foz_db->rwlock);
 
    struct foz_db_entry *entry =
       _mesa_hash_table_u64_search(foz_db->index_db, hash);
-   if (!entry) {
-      simple_mtx_unlock(&foz_db->mtx);
+
+   /* Check for collision using full 160bit hash for increased assurance
+    * against potential collisions.
+    */
+   if (!entry || memcmp(cache_key_160bit, entry->key, sizeof(entry->key))) {
+      u_rwlock_rdunlock(&foz_db->rwlock);
       return NULL;
    }
 
    uint8_t file_idx = entry->file_idx;
-   off_t offset = ftell(foz_db->file[file_idx]);
-   if (fseek(foz_db->file[file_idx], entry->offset, SEEK_SET) < 0)
+   uint64_t offset = entry->offset;
+   uint64_t data_size = foz_db->data_size[file_idx];
+   p_atomic_set(&entry->last_used, p_atomic_inc_return(&foz_db->use_count));
+
+   /* Without a mapping we pread() from the FILE, which must not be closed
+    * under us, so keep the lock in that case.
+    */
+   map = foz_db->map[file_idx];
+   if (map) {
+      p_atomic_inc(&map->refcount);
+      u_rwlock_rdunlock(&foz_db->rwlock);
+   }
+
+   if (offset < FOSSILIZE_BLOB_HASH_LENGTH)
       goto fail;
 
-   uint32_t header_size = sizeof(struct foz_payload_header);
-   if (fread(&entry->header, 1, header_size, foz_db->file[file_idx]) !=
-       header_size)
+   const uint8_t *record =
+      foz_get_bytes(foz_db, map, file_idx, data_size,
+                    offset - FOSSILIZE_BLOB_HASH_LENGTH,
+                    FOSSILIZE_BLOB_HASH_LENGTH +
+                    sizeof(struct foz_payload_header), &record_copy);
+   if (!record)
       goto fail;
 
-   /* Check for collision using full 160bit hash for increased assurance
-    * against potential collisions.
+   /* The db stores the hash of each entry in front of its header. Checking
+    * it protects against an idx that doesn't match its db, e.g. if we were
+    * killed while foz_compact() was replacing the files.
     */
-   for (int i = 0; i < 20; i++) {
-      if (cache_key_160bit[i] != entry->key[i])
-         goto fail;
-   }
+   char hash_str[FOSSILIZE_BLOB_HASH_LENGTH + 1];
+   _mesa_sha1_format(hash_str, cache_key_160bit);
+   if (memcmp(record, hash_str, FOSSILIZE_BLOB_HASH_LENGTH))
+      goto fail;
 
-   uint32_t compressed_data_sz = entry->header.payload_size;
-   compressed_data = malloc(compressed_data_sz);
-   if (!compressed_data ||
-       (fread(compressed_data, 1, compressed_data_sz, foz_db->file[file_idx]) !=
-        compressed_data_sz))
+   struct foz_payload_header header;
+   memcpy(&header, record + FOSSILIZE_BLOB_HASH_LENGTH, sizeof(header));
+
+   uint32_t compressed_data_sz = header.payload_size;
+   const uint8_t *compressed_data =
+      foz_get_bytes(foz_db, map, file_idx, data_size, offset + sizeof(header),
+                    compressed_data_sz, &compressed_copy);
+   if (!compressed_data)
       goto fail;
 
    /* verify checksum */
-   if (entry->header.crc != 0) {
-      if (util_hash_crc32(compressed_data, compressed_data_sz) !=
-          entry->header.crc)
+   if (header.crc != 0) {
+      if (util_hash_crc32(compressed_data, compressed_data_sz) != header.crc)
          goto fail;
    }
 
-   /* Uncompress the db entry */
-   uint32_t out_size = entry->header.uncompressed_size;
+   /* Uncompress the db entry straight from the mapping */
+   uint32_t out_size = header.uncompressed_size;
    blob = malloc(out_size);
    if (!blob)
       goto fail;
@@ -385,27 +547,28 @@ foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
    if (ZSTD_isError(ret))
       goto fail;
 
-   free(compressed_data);
+   if (map)
+      foz_db_map_unref(map);
+   else
+      u_rwlock_rdunlock(&foz_db->rwlock);
 
-   simple_mtx_unlock(&foz_db->mtx);
+   free(record_copy);
+   free(compressed_copy);
 
    if (size)
       *size = out_size;
 
-   /* Reset file offset to the end of the file ready for writing */
-   fseek(foz_db->file[file_idx], offset, SEEK_SET);
-
    return blob;
 
 fail:
-   if (compressed_data)
-      free(compressed_data);
-   if (blob)
-      free(blob);
+   if (map)
+      foz_db_map_unref(map);
+   else
+      u_rwlock_rdunlock(&foz_db->rwlock);
 
-   /* reading db entry failed. reset the file offset */
-   fseek(foz_db->file[file_idx], offset, SEEK_SET);
-   simple_mtx_unlock(&foz_db->mtx);
+   free(record_copy);
+   free(compressed_copy);
+   free(blob);
 
    return NULL;
 }
@@ -457,6 +620,7 @@ foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
       goto fail;
 
    off_t offset = ftell(foz_db->file[0]);
+   uint64_t end_offset = offset + sizeof(header) + blob_size;
 
    /* Write db entry header */
    if (fwrite(&header, 1, sizeof(header), foz_db->file[0]) != sizeof(header))
@@ -494,8 +658,22 @@ foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
    entry->header = header;
    entry->offset = offset;
    entry->file_idx = 0;
+   entry->last_used = p_atomic_inc_return(&foz_db->use_count);
    _mesa_sha1_hex_to_sha1(entry->key, hash_str);
+
+   /* Only now make the entry visible to readers. */
+   u_rwlock_wrlock(&foz_db->rwlock);
    _mesa_hash_table_u64_insert(foz_db->index_db, hash, entry);
+   if (!foz_db->map[0] || end_offset > foz_db->map[0]->size)
+      foz_map_db(foz_db, 0, false);
+   else
+      foz_db->data_size[0] = end_offset;
+   u_rwlock_wrunlock(&foz_db->rwlock);
+   util_dynarray_append(&foz_db->writable_entries, struct foz_db_entry *,
+                        entry);
+
+   foz_db->size += 2 * (FOSSILIZE_BLOB_HASH_LENGTH + sizeof(header)) +
+                   blob_size + sizeof(uint64_t);
 
    simple_mtx_unlock(&foz_db->mtx);
    free(out);
@@ -507,6 +685,294 @@ fail:
    free(out);
    return false;
 }
+
+struct foz_compact_item {
+   struct foz_db_entry *entry;
+   uint64_t last_used;
+   uint32_t payload_size;
+   uint64_t new_offset;
+   bool keep;
+};
+
+static int
+compare_items_by_use(const void *a, const void *b)
+{
+   const struct foz_compact_item *item_a = a;
+   const struct foz_compact_item *item_b = b;
+
+   /* Most recently used first. Entries that haven't been used by this
+    * process are ordered newest (last appended) first.
+    */
+   if (item_a->last_used != item_b->last_used)
+      return item_a->last_used > item_b->last_used ? -1 : 1;
+
+   if (item_a->entry->offset != item_b->entry->offset)
+      return item_a->entry->offset > item_b->entry->offset ? -1 : 1;
+
+   return 0;
+}
+
+static int
+compare_items_by_offset(const void *a, const void *b)
+{
+   const struct foz_compact_item *item_a = a;
+   const struct foz_compact_item *item_b = b;
+
+   if (item_a->entry->offset == item_b->entry->offset)
+      return 0;
+
+   return item_a->entry->offset < item_b->entry->offset ? -1 : 1;
+}
+
+/* Create (or truncate) "<filename>.tmp" in append mode and lock it the same
+ * way load_foz_dbs() locks the files it owns.
+ */
+static FILE *
+create_locked_tmp_file(const char *filename, char **tmp_filename)
+{
+   if (asprintf(tmp_filename, "%s.tmp", filename) == -1)
+      return NULL;
+
+   int fd = open(*tmp_filename,
+                 O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+   if (fd == -1)
+      goto fail;
+
+   if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+      close(fd);
+      goto fail;
+   }
+
+   FILE *file = fdopen(fd, "a+b");
+   if (!file) {
+      close(fd);
+      goto fail;
+   }
+
+   return file;
+
+fail:
+   free(*tmp_filename);
+   *tmp_filename = NULL;
+   return NULL;
+}
+
+/* If the writable foz db and its idx together have grown larger than
+ * max_size, rewrite them keeping only the most recently used entries that
+ * fit in target_size. Passing a max_size of 0 always rewrites the db, which
+ * also drops any incomplete entries left behind by a killed process.
+ *
+ * The new files are written next to the old ones and renamed over them.
+ * They are locked before they become visible, so other processes keep
+ * failing to take ownership of the db exactly as they did before. Read only
+ * dbs are never modified.
+ */
+bool
+foz_compact(struct foz_db *foz_db, uint64_t max_size, uint64_t target_size)
+{
+   struct foz_compact_item *items = NULL;
+   uint8_t *buf = NULL;
+   size_t buf_size = 0;
+   char *tmp_filename = NULL;
+   char *tmp_idx_filename = NULL;
+   FILE *new_file = NULL;
+   FILE *new_idx = NULL;
+
+   if (!foz_db->alive)
+      return false;
+
+   simple_mtx_lock(&foz_db->mtx);
+
+   if (max_size && foz_db->size <= max_size) {
+      simple_mtx_unlock(&foz_db->mtx);
+      return true;
+   }
+
+   FILE *old_file = foz_db->file[0];
+   off_t old_file_offset = ftell(old_file);
+   unsigned num_items =
+      util_dynarray_num_elements(&foz_db->writable_entries,
+                                 struct foz_db_entry *);
+
+   items = calloc(MAX2(num_items, 1), sizeof(*items));
+   if (!items)
+      goto fail;
+
+   /* Gather the payload sizes, which the idx doesn't store. */
+   for (unsigned i = 0; i < num_items; i++) {
+      struct foz_payload_header header;
+
+      items[i].entry = *util_dynarray_element(&foz_db->writable_entries,
+                                              struct foz_db_entry *, i);
+      /* Readers keep updating last_used, so sort on a snapshot of it. */
+      items[i].last_used = p_atomic_read(&items[i].entry->last_used);
+      if (fseek(old_file, items[i].entry->offset, SEEK_SET) < 0 ||
+          fread(&header, 1, sizeof(header), old_file) != sizeof(header))
+         continue;
+
+      items[i].payload_size = header.payload_size;
+      items[i].keep = true;
+   }
+
+   /* Keep the most recently used entries that fit in target_size. */
+   const uint64_t entry_overhead =
+      2 * (FOSSILIZE_BLOB_HASH_LENGTH + sizeof(struct foz_payload_header)) +
+      sizeof(uint64_t);
+   uint64_t new_size = 2 * FOZ_REF_MAGIC_SIZE;
+
+   qsort(items, num_items, sizeof(*items), compare_items_by_use);
+   for (unsigned i = 0; i < num_items; i++) {
+      uint64_t entry_size = entry_overhead + items[i].payload_size;
+
+      if (!items[i].keep || new_size + entry_size > target_size) {
+         items[i].keep = false;
+         continue;
+      }
+
+      new_size += entry_size;
+   }
+
+   new_file = create_locked_tmp_file(foz_db->filename, &tmp_filename);
+   new_idx = create_locked_tmp_file(foz_db->idx_filename, &tmp_idx_filename);
+   if (!new_file || !new_idx)
+      goto fail;
+
+   if (fwrite(stream_reference_magic_and_version, 1, FOZ_REF_MAGIC_SIZE,
+              new_file) != FOZ_REF_MAGIC_SIZE ||
+       fwrite(stream_reference_magic_and_version, 1, FOZ_REF_MAGIC_SIZE,
+              new_idx) != FOZ_REF_MAGIC_SIZE)
+      goto fail;
+
+   /* Copy the kept entries in their original order, so that the next
+    * compaction still sees the oldest entries first.
+    */
+   qsort(items, num_items, sizeof(*items), compare_items_by_offset);
+
+   uint64_t new_offset = FOZ_REF_MAGIC_SIZE;
+   for (unsigned i = 0; i < num_items; i++) {
+      struct foz_db_entry *entry = items[i].entry;
+
+      if (!items[i].keep)
+         continue;
+
+      size_t record_size = FOSSILIZE_BLOB_HASH_LENGTH +
+                           sizeof(struct foz_payload_header) +
+                           items[i].payload_size;
+      if (record_size > buf_size) {
+         uint8_t *new_buf = realloc(buf, record_size);
+         if (!new_buf)
+            goto fail;
+         buf = new_buf;
+         buf_size = record_size;
+      }
+
+      char hash_str[FOSSILIZE_BLOB_HASH_LENGTH + 1];
+      _mesa_sha1_format(hash_str, entry->key);
+
+      /* Drop entries that can't be read back or that belong to another
+       * key, rather than failing the whole compaction.
+       */
+      if (fseek(old_file, entry->offset - FOSSILIZE_BLOB_HASH_LENGTH,
+                SEEK_SET) < 0 ||
+          fread(buf, 1, record_size, old_file) != record_size ||
+          memcmp(buf, hash_str, FOSSILIZE_BLOB_HASH_LENGTH)) {
+         items[i].keep = false;
+         continue;
+      }
+
+      if (fwrite(buf, 1, record_size, new_file) != record_size)
+         goto fail;
+
+      items[i].new_offset = new_offset + FOSSILIZE_BLOB_HASH_LENGTH;
+      new_offset += record_size;
+
+      struct foz_payload_header idx_header;
+      idx_header.uncompressed_size = sizeof(uint64_t);
+      idx_header.format = FOSSILIZE_COMPRESSION_NONE;
+      idx_header.payload_size = sizeof(uint64_t);
+      idx_header.crc = 0;
+
+      if (fwrite(hash_str, 1, FOSSILIZE_BLOB_HASH_LENGTH, new_idx) !=
+          FOSSILIZE_BLOB_HASH_LENGTH ||
+          fwrite(&idx_header, 1, sizeof(idx_header), new_idx) !=
+          sizeof(idx_header) ||
+          fwrite(&items[i].new_offset, 1, sizeof(uint64_t), new_idx) !=
+          sizeof(uint64_t))
+         goto fail;
+   }
+
+   if (fflush(new_file) != 0 || fflush(new_idx) != 0)
+      goto fail;
+
+   /* Replace the db before the idx: an idx that outlives its db is caught
+    * by the hash check in foz_read_entry().
+    */
+   if (rename(tmp_filename, foz_db->filename) == -1)
+      goto fail;
+
+   if (rename(tmp_idx_filename, foz_db->idx_filename) == -1) {
+      /* The files on disk no longer match, stop using them. */
+      foz_db->alive = false;
+      unlink(tmp_idx_filename);
+   }
+
+   u_rwlock_wrlock(&foz_db->rwlock);
+
+   fclose(foz_db->file[0]);
+   fclose(foz_db->db_idx);
+   foz_db->file[0] = new_file;
+   foz_db->db_idx = new_idx;
+   foz_map_db(foz_db, 0, false);
+
+   /* Update the index to point into the new files. */
+   util_dynarray_clear(&foz_db->writable_entries);
+   for (unsigned i = 0; i < num_items; i++) {
+      struct foz_db_entry *entry = items[i].entry;
+
+      if (items[i].keep) {
+         entry->offset = items[i].new_offset;
+         util_dynarray_append(&foz_db->writable_entries,
+                              struct foz_db_entry *, entry);
+      } else {
+         _mesa_hash_table_u64_remove(foz_db->index_db,
+                                     truncate_hash_to_64bits(entry->key));
+         ralloc_free(entry);
+      }
+   }
+
+   u_rwlock_wrunlock(&foz_db->rwlock);
+
+   foz_db->size = get_file_size(new_file) + get_file_size(new_idx);
+
+   simple_mtx_unlock(&foz_db->mtx);
+
+   free(tmp_filename);
+   free(tmp_idx_filename);
+   free(items);
+   free(buf);
+
+   return true;
+
+fail:
+   if (new_file) {
+      fclose(new_file);
+      unlink(tmp_filename);
+   }
+   if (new_idx) {
+      fclose(new_idx);
+      unlink(tmp_idx_filename);
+   }
+
+   fseek(old_file, old_file_offset, SEEK_SET);
+   simple_mtx_unlock(&foz_db->mtx);
+
+   free(tmp_filename);
+   free(tmp_idx_filename);
+   free(items);
+   free(buf);
+
+   return false;
+}
 #else
 
 bool
@@ -537,4 +1003,10 @@ foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
    return false;
 }
 
+bool
+foz_compact(struct foz_db *foz_db, uint64_t max_size, uint64_t target_size)
+{
+   return false;
+}
+
 #endif
@@ -43,7 +43,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "rwlock.h"
 #include "simple_mtx.h"
+#include "u_dynarray.h"
 
 /* Max number of DBs our implementation can read from at once */
 #define FOZ_MAX_DBS 9 /* Default DB + 8 Read only DBs */
@@ -71,15 +73,26 @@ struct foz_db_entry {
    uint8_t file_idx;
    uint8_t key[20];
    uint64_t offset;
+   uint64_t last_used;               /* foz_db::use_count at the last hit */
    struct foz_payload_header header;
 };
 
+struct foz_db_map;
+
 struct foz_db {
    FILE *file[FOZ_MAX_DBS];          /* An array of all foz dbs */
    FILE *db_idx;                     /* The default writable foz db idx */
-   simple_mtx_t mtx;                 /* Mutex for file/hash table read/writes */
+   simple_mtx_t mtx;                 /* Mutex for file writes */
+   struct u_rwlock rwlock;           /* Protects index_db and the mappings */
    void *mem_ctx;
    struct hash_table_u64 *index_db;  /* Hash table of all foz db entries */
+   struct foz_db_map *map[FOZ_MAX_DBS]; /* Read only mappings of the foz dbs */
+   uint64_t data_size[FOZ_MAX_DBS];  /* Bytes of each foz db safe to read */
+   char *filename;                   /* The default writable foz db path */
+   char *idx_filename;               /* The default writable foz db idx path */
+   struct util_dynarray writable_entries; /* Entries of the writable db */
+   uint64_t size;                    /* Size of the writable db and its idx */
+   uint64_t use_count;               /* Clock for foz_db_entry::last_used */
    bool alive;
 };
 
@@ -97,4 +110,7 @@ bool
 foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
                 const void *blob, size_t size);
 
+bool
+foz_compact(struct foz_db *foz_db, uint64_t max_size, uint64_t target_size);
+
 #endif /* FOSSILIZE_DB_H */
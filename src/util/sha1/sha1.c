@@ -17,6 +17,8 @@
 #include <stdint.h>
 #include <string.h>
 #include "u_endian.h"
+#include "u_cpu_detect.h"
+#include "u_hash_accel.h"
 #include "sha1.h"
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
@@ -101,6 +103,33 @@ SHA1Transform(uint32_t state[5], const uint8_t buffer[SHA1_BLOCK_LENGTH])
 }
 
 
+/*
+ * Hash consecutive 512-bit blocks, with the SHA instructions if the CPU
+ * has them.
+ */
+static void
+SHA1TransformBlocks(uint32_t state[5], const uint8_t *data, size_t num_blocks)
+{
+#if defined(UTIL_HAVE_HASH_ACCEL_X86) || defined(UTIL_HAVE_HASH_ACCEL_AARCH64)
+	util_cpu_detect();
+#endif
+#if defined(UTIL_HAVE_HASH_ACCEL_X86)
+	if (util_cpu_caps.has_sha && util_cpu_caps.has_sse4_1) {
+		util_sha1_blocks_shani(state, data, num_blocks);
+		return;
+	}
+#endif
+#if defined(UTIL_HAVE_HASH_ACCEL_AARCH64)
+	if (util_cpu_caps.has_arm_sha1) {
+		util_sha1_blocks_armv8(state, data, num_blocks);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < num_blocks; i++)
+		SHA1Transform(state, data + i * SHA1_BLOCK_LENGTH);
+}
+
+
 /*
  * SHA1Init - Initialize new context
  */
@@ -130,9 +159,12 @@ SHA1Update(SHA1_CTX *context, const uint8_t *data, size_t len)
 	context->count += (len << 3);
 	if ((j + len) > 63) {
 		(void)memcpy(&context->buffer[j], data, (i = 64-j));
-		SHA1Transform(context->state, context->buffer);
-		for ( ; i + 63 < len; i += 64)
-			SHA1Transform(context->state, (uint8_t *)&data[i]);
+		SHA1TransformBlocks(context->state, context->buffer, 1);
+		if (len - i >= 64) {
+			SHA1TransformBlocks(context->state, &data[i],
+			    (len - i) / 64);
+			i += (len - i) & ~(size_t)63;
+		}
 		j = 0;
 	} else {
 		i = 0;
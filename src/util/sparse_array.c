@@ -191,6 +191,41 @@ util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx)
    return (void *)((char *)node_data + (elem_idx * arr->elem_size));
 }
 
+/** Like util_sparse_array_get() but never allocates
+ *
+ * Returns NULL if the node holding the element was never allocated, i.e. if
+ * util_sparse_array_get() was never called for an index near "idx".
+ * Otherwise, returns the same pointer as util_sparse_array_get().
+ */
+void *
+util_sparse_array_get_existing(struct util_sparse_array *arr, uint64_t idx)
+{
+   const unsigned node_size_log2 = arr->node_size_log2;
+   uintptr_t node = p_atomic_read(&arr->root);
+   if (!node)
+      return NULL;
+
+   unsigned node_level = _util_sparse_array_node_level(node);
+   if ((idx >> (node_level * node_size_log2)) >= (1ull << node_size_log2))
+      return NULL;
+
+   while (node_level > 0) {
+      uint64_t child_idx = (idx >> (node_level * node_size_log2)) &
+                           ((1ull << node_size_log2) - 1);
+
+      uintptr_t *children = _util_sparse_array_node_data(node);
+      node = p_atomic_read(&children[child_idx]);
+      if (!node)
+         return NULL;
+
+      node_level = _util_sparse_array_node_level(node);
+   }
+
+   uint64_t elem_idx = idx & ((1ull << node_size_log2) - 1);
+   return (void *)((char *)_util_sparse_array_node_data(node) +
+                   (elem_idx * arr->elem_size));
+}
+
 static void
 validate_node_level(struct util_sparse_array *arr,
                     uintptr_t node, unsigned level)
@@ -79,6 +79,9 @@ void util_sparse_array_finish(struct util_sparse_array *arr);
 
 void *util_sparse_array_get(struct util_sparse_array *arr, uint64_t idx);
 
+void *util_sparse_array_get_existing(struct util_sparse_array *arr,
+                                     uint64_t idx);
+
 void util_sparse_array_validate(struct util_sparse_array *arr);
 
 /** A thread-safe free list for use with struct util_sparse_array
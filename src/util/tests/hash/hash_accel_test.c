@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Check that the SHA-1 and CRC32 paths picked through util_cpu_caps give
+ * the same results as the portable code, and print the throughput of both.
+ *
+ * Usage: hash_accel_test [megabytes]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/crc32.h"
+#include "util/macros.h"
+#include "util/mesa-sha1.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+
+static struct util_cpu_caps detected_caps;
+
+static void
+use_accel(bool enable)
+{
+   util_cpu_caps = detected_caps;
+   if (!enable) {
+      util_cpu_caps.has_sha = 0;
+      util_cpu_caps.has_pclmul = 0;
+      util_cpu_caps.has_arm_sha1 = 0;
+      util_cpu_caps.has_arm_crc32 = 0;
+   }
+}
+
+/* Hash data in pieces of chunk bytes to go through the partial block code
+ * of SHA1Update.
+ */
+static void
+sha1_chunked(const uint8_t *data, size_t size, size_t chunk,
+             unsigned char result[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   for (size_t i = 0; i < size; i += chunk)
+      _mesa_sha1_update(&ctx, data + i, MIN2(chunk, size - i));
+   _mesa_sha1_final(&ctx, result);
+}
+
+static bool
+check_known_answers(void)
+{
+   static const uint8_t abc_sha1[20] = {
+      0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+      0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d,
+   };
+   static const uint8_t million_a_sha1[20] = {
+      0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+      0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f,
+   };
+   unsigned char sha1[20];
+   uint8_t *a = malloc(1000000);
+   bool pass = true;
+
+   memset(a, 'a', 1000000);
+
+   _mesa_sha1_compute("abc", 3, sha1);
+   if (memcmp(sha1, abc_sha1, 20)) {
+      fprintf(stderr, "SHA-1 of \"abc\" is wrong\n");
+      pass = false;
+   }
+
+   sha1_chunked(a, 1000000, 1000000, sha1);
+   if (memcmp(sha1, million_a_sha1, 20)) {
+      fprintf(stderr, "SHA-1 of a million 'a' is wrong\n");
+      pass = false;
+   }
+
+   /* util_hash_crc32 leaves out the final inversion. */
+   if (util_hash_crc32("123456789", 9) != ~0xcbf43926u) {
+      fprintf(stderr, "CRC32 of \"123456789\" is wrong\n");
+      pass = false;
+   }
+
+   free(a);
+   return pass;
+}
+
+static bool
+check_sizes(const uint8_t *data)
+{
+   static const size_t chunks[] = { 1, 7, 63, 64, 65, 1000, 4096 };
+   unsigned char sha1_ref[20], sha1[20];
+   bool pass = true;
+
+   for (size_t size = 0; size <= 4096 && pass; size += size < 300 ? 1 : 97) {
+      for (unsigned c = 0; c < ARRAY_SIZE(chunks); c++) {
+         use_accel(false);
+         sha1_chunked(data, size, chunks[c], sha1_ref);
+         use_accel(true);
+         sha1_chunked(data, size, chunks[c], sha1);
+
+         if (memcmp(sha1, sha1_ref, 20)) {
+            fprintf(stderr, "SHA-1 mismatch, size %zu, chunk %zu\n", size,
+                    chunks[c]);
+            pass = false;
+            break;
+         }
+      }
+
+      /* Also check unaligned starts. */
+      for (unsigned offset = 0; offset < 16; offset += 5) {
+         use_accel(false);
+         uint32_t crc_ref = util_hash_crc32(data + offset, size);
+         use_accel(true);
+         uint32_t crc = util_hash_crc32(data + offset, size);
+
+         if (crc != crc_ref) {
+            fprintf(stderr, "CRC32 mismatch, size %zu, offset %u: "
+                    "0x%08x != 0x%08x\n", size, offset, crc, crc_ref);
+            pass = false;
+            break;
+         }
+      }
+   }
+
+   return pass;
+}
+
+static void
+bench(const uint8_t *data, size_t size, bool accel)
+{
+   unsigned char sha1[20];
+   volatile uint32_t crc;
+   int64_t start;
+   double sha1_s, crc_s;
+
+   use_accel(accel);
+
+   start = os_time_get_nano();
+   _mesa_sha1_compute(data, size, sha1);
+   sha1_s = (os_time_get_nano() - start) / 1e9;
+
+   start = os_time_get_nano();
+   crc = util_hash_crc32(data, size);
+   crc_s = (os_time_get_nano() - start) / 1e9;
+   (void)crc;
+
+   printf("%-12s SHA-1 %8.2f GB/s   CRC32 %8.2f GB/s\n",
+          accel ? "accelerated" : "portable",
+          size / sha1_s / 1e9, size / crc_s / 1e9);
+}
+
+int
+main(int argc, char **argv)
+{
+   size_t size = (argc > 1 ? atoi(argv[1]) : 16) << 20;
+   uint8_t *data;
+   bool pass;
+
+   if (size < 4096 + 16) {
+      fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+      return 1;
+   }
+
+   util_cpu_detect();
+   detected_caps = util_cpu_caps;
+
+   printf("SHA: %s, PCLMULQDQ: %s, ARMv8 SHA1: %s, ARMv8 CRC32: %s\n",
+          detected_caps.has_sha ? "yes" : "no",
+          detected_caps.has_pclmul ? "yes" : "no",
+          detected_caps.has_arm_sha1 ? "yes" : "no",
+          detected_caps.has_arm_crc32 ? "yes" : "no");
+
+   data = malloc(size);
+   srand(0x5eed);
+   for (size_t i = 0; i < size; i++)
+      data[i] = rand();
+
+   use_accel(false);
+   pass = check_known_answers();
+   use_accel(true);
+   pass &= check_known_answers();
+   pass &= check_sizes(data);
+
+   bench(data, size, false);
+   bench(data, size, true);
+
+   free(data);
+   return pass ? 0 : 1;
+}
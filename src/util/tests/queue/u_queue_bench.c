@@ -0,0 +1,419 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Check util_queue with many small jobs and print how long they took:
+ * - several threads adding jobs to a queue with several threads,
+ * - jobs adding more jobs with UTIL_QUEUE_INIT_LOCAL_QUEUES,
+ * - a small ring with UTIL_QUEUE_INIT_RESIZE_IF_FULL,
+ * - the execution order with 1 thread and util_queue_drop_job,
+ * - that adding a job blocks once exactly max_jobs jobs are queued.
+ *
+ * Usage: u_queue_bench [num_jobs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "c11/threads.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
+#include "util/u_queue.h"
+
+#define NUM_PRODUCERS 4
+#define NUM_THREADS 4
+#define NUM_CHILDREN 8
+
+struct test_job {
+   struct util_queue_fence fence;
+   struct util_queue *queue;
+   unsigned index;
+   unsigned executed;
+   struct test_job *children;
+};
+
+static unsigned num_executed;
+static unsigned next_order;
+static unsigned *order;
+
+static void
+spin(void)
+{
+   volatile unsigned x = 0;
+
+   for (unsigned i = 0; i < 64; i++)
+      x += i;
+}
+
+static void
+execute_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   spin();
+   p_atomic_inc(&job->executed);
+   p_atomic_inc(&num_executed);
+}
+
+static void
+execute_parent_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   for (unsigned i = 0; i < NUM_CHILDREN; i++) {
+      util_queue_add_job(job->queue, &job->children[i],
+                         &job->children[i].fence, execute_job, NULL, 0);
+   }
+   execute_job(data, thread_index);
+}
+
+static void
+execute_ordered_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   order[p_atomic_inc_return(&next_order) - 1] = job->index;
+   execute_job(data, thread_index);
+}
+
+struct producer {
+   struct util_queue *queue;
+   struct test_job *jobs;
+   unsigned num_jobs;
+};
+
+static int
+producer_func(void *data)
+{
+   struct producer *p = data;
+
+   for (unsigned i = 0; i < p->num_jobs; i++) {
+      util_queue_add_job(p->queue, &p->jobs[i], &p->jobs[i].fence,
+                         execute_job, NULL, 0);
+   }
+   for (unsigned i = 0; i < p->num_jobs; i++)
+      util_queue_fence_wait(&p->jobs[i].fence);
+   return 0;
+}
+
+static struct test_job *
+create_jobs(struct util_queue *queue, unsigned num)
+{
+   struct test_job *jobs = calloc(num, sizeof(*jobs));
+
+   for (unsigned i = 0; i < num; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      jobs[i].queue = queue;
+      jobs[i].index = i;
+   }
+   return jobs;
+}
+
+static void
+destroy_jobs(struct test_job *jobs, unsigned num)
+{
+   for (unsigned i = 0; i < num; i++)
+      util_queue_fence_destroy(&jobs[i].fence);
+   free(jobs);
+}
+
+static bool
+check_executed(const char *test, struct test_job *jobs, unsigned num,
+               unsigned expected)
+{
+   for (unsigned i = 0; i < num; i++) {
+      if (jobs[i].executed != expected) {
+         fprintf(stderr, "%s: job %u executed %u times\n", test, i,
+                 jobs[i].executed);
+         return false;
+      }
+   }
+   return true;
+}
+
+static void
+report(const char *test, unsigned num, int64_t start)
+{
+   double ms = (os_time_get_nano() - start) / 1e6;
+
+   printf("%-24s %9u jobs %10.2f ms %10.2f Mjobs/s\n", test, num, ms,
+          num / ms / 1000);
+}
+
+/* Several threads adding jobs at the same time. */
+static bool
+test_producers(unsigned num_jobs, unsigned flags)
+{
+   struct util_queue queue;
+   struct producer producers[NUM_PRODUCERS];
+   thrd_t threads[NUM_PRODUCERS];
+   unsigned per_producer = num_jobs / NUM_PRODUCERS;
+   struct test_job *jobs;
+   bool pass;
+
+   if (!util_queue_init(&queue, "bench", 64, NUM_THREADS, flags))
+      return false;
+
+   jobs = create_jobs(&queue, per_producer * NUM_PRODUCERS);
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < NUM_PRODUCERS; i++) {
+      producers[i].queue = &queue;
+      producers[i].jobs = &jobs[i * per_producer];
+      producers[i].num_jobs = per_producer;
+      thrd_create(&threads[i], producer_func, &producers[i]);
+   }
+   for (unsigned i = 0; i < NUM_PRODUCERS; i++)
+      thrd_join(threads[i], NULL);
+   report(flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL ? "producers, resize" :
+                                                   "producers",
+          per_producer * NUM_PRODUCERS, start);
+
+   pass = check_executed("producers", jobs, per_producer * NUM_PRODUCERS, 1);
+
+   util_queue_destroy(&queue);
+   destroy_jobs(jobs, per_producer * NUM_PRODUCERS);
+   return pass;
+}
+
+/* Jobs adding jobs, which go to the local queues. */
+static bool
+test_local_queues(unsigned num_jobs)
+{
+   struct util_queue queue;
+   unsigned num_parents = num_jobs / (NUM_CHILDREN + 1);
+   struct test_job *parents, *children;
+   bool pass;
+
+   if (!util_queue_init(&queue, "bench", 64, NUM_THREADS,
+                        UTIL_QUEUE_INIT_LOCAL_QUEUES))
+      return false;
+
+   parents = create_jobs(&queue, num_parents);
+   children = create_jobs(&queue, num_parents * NUM_CHILDREN);
+   for (unsigned i = 0; i < num_parents; i++)
+      parents[i].children = &children[i * NUM_CHILDREN];
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < num_parents; i++) {
+      util_queue_add_job(&queue, &parents[i], &parents[i].fence,
+                         execute_parent_job, NULL, 0);
+   }
+   /* The children are added before their parent fence is signalled. */
+   for (unsigned i = 0; i < num_parents; i++)
+      util_queue_fence_wait(&parents[i].fence);
+   util_queue_finish(&queue);
+   report("local queues", num_parents * (NUM_CHILDREN + 1), start);
+
+   pass = check_executed("local queues", parents, num_parents, 1) &&
+          check_executed("local queues", children,
+                         num_parents * NUM_CHILDREN, 1);
+
+   util_queue_destroy(&queue);
+   destroy_jobs(parents, num_parents);
+   destroy_jobs(children, num_parents * NUM_CHILDREN);
+   return pass;
+}
+
+static void
+execute_gate_job(void *data, int thread_index)
+{
+   util_queue_fence_wait(data);
+}
+
+/* One thread must execute the jobs in order, skipping dropped jobs. */
+static bool
+test_order_and_drop(unsigned num_jobs)
+{
+   struct util_queue queue;
+   struct util_queue_fence gate, gate_job;
+   struct test_job *jobs;
+   bool pass = true;
+
+   if (!util_queue_init(&queue, "bench", 16, 1,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+      return false;
+
+   jobs = create_jobs(&queue, num_jobs);
+   order = calloc(num_jobs, sizeof(*order));
+   next_order = 0;
+
+   /* Block the thread so that the ring fills up and the jobs can be dropped
+    * before they are executed.
+    */
+   util_queue_fence_init(&gate);
+   util_queue_fence_init(&gate_job);
+   util_queue_fence_reset(&gate);
+   util_queue_add_job(&queue, &gate, &gate_job, execute_gate_job, NULL, 0);
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < num_jobs; i++) {
+      util_queue_add_job(&queue, &jobs[i], &jobs[i].fence,
+                         execute_ordered_job, NULL, 0);
+   }
+   for (unsigned i = 1; i < num_jobs; i += 2)
+      util_queue_drop_job(&queue, &jobs[i].fence);
+
+   util_queue_fence_signal(&gate);
+   util_queue_finish(&queue);
+   report("ordered, drop", num_jobs, start);
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      if (!util_queue_fence_is_signalled(&jobs[i].fence) ||
+          jobs[i].executed != !(i & 1)) {
+         fprintf(stderr, "ordered: job %u executed %u times\n", i,
+                 jobs[i].executed);
+         pass = false;
+         break;
+      }
+   }
+   for (unsigned i = 0; pass && i < next_order; i++) {
+      if (order[i] != i * 2) {
+         fprintf(stderr, "ordered: job %u executed at position %u\n",
+                 order[i], i);
+         pass = false;
+      }
+   }
+
+   util_queue_destroy(&queue);
+   util_queue_fence_destroy(&gate_job);
+   util_queue_fence_destroy(&gate);
+   destroy_jobs(jobs, num_jobs);
+   free(order);
+   return pass;
+}
+
+struct blocked_producer {
+   struct util_queue *queue;
+   struct test_job *jobs;
+   unsigned num_jobs;
+   unsigned num_added;
+};
+
+static int
+blocked_producer_func(void *data)
+{
+   struct blocked_producer *p = data;
+
+   for (unsigned i = 0; i < p->num_jobs; i++) {
+      util_queue_add_job(p->queue, &p->jobs[i], &p->jobs[i].fence,
+                         execute_job, NULL, 0);
+      p_atomic_inc(&p->num_added);
+   }
+   return 0;
+}
+
+struct gate {
+   struct util_queue_fence fence;
+   struct util_queue_fence release;
+   unsigned started;
+};
+
+static void
+execute_started_gate_job(void *data, int thread_index)
+{
+   struct gate *gate = data;
+
+   p_atomic_set(&gate->started, 1);
+   util_queue_fence_wait(&gate->release);
+}
+
+/* glthread and u_threaded_context reuse their batches without waiting for
+ * them, counting on util_queue_add_job to block once max_jobs jobs are
+ * queued, even if the ring has more slots.
+ */
+static bool
+test_capacity(unsigned max_jobs)
+{
+   struct util_queue queue;
+   struct gate gate;
+   struct blocked_producer producer;
+   thrd_t thread;
+   bool pass = true;
+
+   if (!util_queue_init(&queue, "bench", max_jobs, 1, 0))
+      return false;
+
+   /* Keep the thread busy with a job that isn't queued anymore. */
+   util_queue_fence_init(&gate.fence);
+   util_queue_fence_init(&gate.release);
+   util_queue_fence_reset(&gate.release);
+   gate.started = 0;
+   util_queue_add_job(&queue, &gate, &gate.fence, execute_started_gate_job,
+                      NULL, 0);
+   while (!p_atomic_read(&gate.started))
+      thrd_yield();
+
+   producer.queue = &queue;
+   producer.jobs = create_jobs(&queue, max_jobs + 1);
+   producer.num_jobs = max_jobs + 1;
+   producer.num_added = 0;
+   thrd_create(&thread, blocked_producer_func, &producer);
+
+   int64_t start = os_time_get_nano();
+   while (p_atomic_read(&producer.num_added) < max_jobs &&
+          os_time_get_nano() - start < 5000000000ll)
+      thrd_yield();
+   os_time_sleep(50000);
+
+   if (p_atomic_read(&producer.num_added) != max_jobs) {
+      fprintf(stderr, "capacity %u: %u jobs were added before blocking\n",
+              max_jobs, p_atomic_read(&producer.num_added));
+      pass = false;
+   }
+
+   util_queue_fence_signal(&gate.release);
+   thrd_join(thread, NULL);
+   util_queue_finish(&queue);
+   pass &= check_executed("capacity", producer.jobs, max_jobs + 1, 1);
+
+   util_queue_destroy(&queue);
+   util_queue_fence_destroy(&gate.fence);
+   util_queue_fence_destroy(&gate.release);
+   destroy_jobs(producer.jobs, max_jobs + 1);
+   return pass;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_jobs = argc > 1 ? atoi(argv[1]) : 100000;
+   bool pass = true;
+
+   if (num_jobs < NUM_PRODUCERS * (NUM_CHILDREN + 1)) {
+      fprintf(stderr, "usage: %s [num_jobs]\n", argv[0]);
+      return 1;
+   }
+
+   pass &= test_producers(num_jobs, 0);
+   pass &= test_producers(num_jobs, UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   pass &= test_local_queues(num_jobs);
+   /* Dropping a job scans the queue, so keep this one smaller. */
+   pass &= test_order_and_drop(MIN2(num_jobs, 10000));
+   pass &= test_capacity(1);
+   pass &= test_capacity(3);
+   pass &= test_capacity(6);
+   pass &= test_capacity(8);
+
+   return pass ? 0 : 1;
+}
@@ -69,6 +69,9 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <elf.h>
+#if defined(PIPE_ARCH_AARCH64)
+#include <sys/auxv.h>
+#endif
 #endif
 
 #ifdef PIPE_OS_UNIX
@@ -428,6 +431,14 @@ static void
 check_os_arm_support(void)
 {
     util_cpu_caps.has_neon = true;
+
+#if defined(PIPE_OS_LINUX)
+    /* HWCAP_SHA1 and HWCAP_CRC32 */
+    unsigned long hwcap = getauxval(AT_HWCAP);
+
+    util_cpu_caps.has_arm_sha1 = (hwcap >> 5) & 1;
+    util_cpu_caps.has_arm_crc32 = (hwcap >> 7) & 1;
+#endif
 }
 #endif /* PIPE_ARCH_ARM || PIPE_ARCH_AARCH64 */
 
@@ -619,6 +630,7 @@ util_cpu_detect_once(void)
          util_cpu_caps.has_sse4_1 = (regs2[2] >> 19) & 1;
          util_cpu_caps.has_sse4_2 = (regs2[2] >> 20) & 1;
          util_cpu_caps.has_popcnt = (regs2[2] >> 23) & 1;
+         util_cpu_caps.has_pclmul = (regs2[2] >>  1) & 1;
          util_cpu_caps.has_avx    = ((regs2[2] >> 28) & 1) && // AVX
                                     ((regs2[2] >> 27) & 1) && // OSXSAVE
                                     ((xgetbv() & 6) == 6);    // XMM & YMM
@@ -642,6 +654,12 @@ util_cpu_detect_once(void)
          util_cpu_caps.has_avx2 = (regs7[1] >> 5) & 1;
       }
 
+      if (regs[0] >= 0x00000007) {
+         uint32_t regs7[4];
+         cpuid_count(0x00000007, 0x00000000, regs7);
+         util_cpu_caps.has_sha = (regs7[1] >> 29) & 1;
+      }
+
       // check for avx512
       if (((regs2[2] >> 27) & 1) && // OSXSAVE
           (xgetbv() & (0x7 << 5)) && // OPMASK: upper-256 enabled by OS
@@ -726,12 +744,16 @@ util_cpu_detect_once(void)
       debug_printf("util_cpu_caps.has_avx2 = %u\n", util_cpu_caps.has_avx2);
       debug_printf("util_cpu_caps.has_f16c = %u\n", util_cpu_caps.has_f16c);
       debug_printf("util_cpu_caps.has_popcnt = %u\n", util_cpu_caps.has_popcnt);
+      debug_printf("util_cpu_caps.has_pclmul = %u\n", util_cpu_caps.has_pclmul);
+      debug_printf("util_cpu_caps.has_sha = %u\n", util_cpu_caps.has_sha);
       debug_printf("util_cpu_caps.has_3dnow = %u\n", util_cpu_caps.has_3dnow);
       debug_printf("util_cpu_caps.has_3dnow_ext = %u\n", util_cpu_caps.has_3dnow_ext);
       debug_printf("util_cpu_caps.has_xop = %u\n", util_cpu_caps.has_xop);
       debug_printf("util_cpu_caps.has_altivec = %u\n", util_cpu_caps.has_altivec);
       debug_printf("util_cpu_caps.has_vsx = %u\n", util_cpu_caps.has_vsx);
       debug_printf("util_cpu_caps.has_neon = %u\n", util_cpu_caps.has_neon);
+      debug_printf("util_cpu_caps.has_arm_sha1 = %u\n", util_cpu_caps.has_arm_sha1);
+      debug_printf("util_cpu_caps.has_arm_crc32 = %u\n", util_cpu_caps.has_arm_crc32);
       debug_printf("util_cpu_caps.has_daz = %u\n", util_cpu_caps.has_daz);
       debug_printf("util_cpu_caps.has_avx512f = %u\n", util_cpu_caps.has_avx512f);
       debug_printf("util_cpu_caps.has_avx512dq = %u\n", util_cpu_caps.has_avx512dq);
@@ -74,6 +74,8 @@ struct util_cpu_caps {
    unsigned has_sse4_1:1;
    unsigned has_sse4_2:1;
    unsigned has_popcnt:1;
+   unsigned has_pclmul:1;
+   unsigned has_sha:1;
    unsigned has_avx:1;
    unsigned has_avx2:1;
    unsigned has_f16c:1;
@@ -85,6 +87,8 @@ struct util_cpu_caps {
    unsigned has_vsx:1;
    unsigned has_daz:1;
    unsigned has_neon:1;
+   unsigned has_arm_sha1:1;
+   unsigned has_arm_crc32:1;
 
    unsigned has_avx512f:1;
    unsigned has_avx512dq:1;
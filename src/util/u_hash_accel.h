@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * SHA-1 and CRC32 kernels using the x86 SHA/PCLMULQDQ or the ARMv8 SHA1/CRC32
+ * instructions.
+ *
+ * They are built with extra compiler flags, only when the build system
+ * defines UTIL_HAVE_HASH_ACCEL_X86 or UTIL_HAVE_HASH_ACCEL_AARCH64, and must
+ * only be called when util_cpu_caps reports the instructions.  Use
+ * _mesa_sha1_*() and util_hash_crc32() instead, which pick them at runtime.
+ */
+
+#ifndef U_HASH_ACCEL_H
+#define U_HASH_ACCEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(UTIL_HAVE_HASH_ACCEL_X86)
+
+/* Needs has_sha and has_sse4_1. */
+void
+util_sha1_blocks_shani(uint32_t state[5], const uint8_t *data,
+                       size_t num_blocks);
+
+/* Needs has_pclmul and has_sse4_1.  size must be a multiple of 16 and at
+ * least 64.  crc is the running CRC, without the final inversion.
+ */
+uint32_t
+util_crc32_pclmul(uint32_t crc, const uint8_t *data, size_t size);
+
+#endif
+
+#if defined(UTIL_HAVE_HASH_ACCEL_AARCH64)
+
+/* Needs has_arm_sha1. */
+void
+util_sha1_blocks_armv8(uint32_t state[5], const uint8_t *data,
+                       size_t num_blocks);
+
+/* Needs has_arm_crc32.  crc is the running CRC, without the final
+ * inversion.
+ */
+uint32_t
+util_crc32_armv8(uint32_t crc, const uint8_t *data, size_t size);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_HASH_ACCEL_H */
@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * SHA-1 and CRC32 with the ARMv8 crypto and CRC32 extensions.
+ *
+ * This file is compiled with -march=armv8-a+crc+crypto.
+ */
+
+#include <string.h>
+#include <arm_acle.h>
+#include <arm_neon.h>
+
+#include "u_hash_accel.h"
+
+void
+util_sha1_blocks_armv8(uint32_t state[5], const uint8_t *data,
+                       size_t num_blocks)
+{
+   static const uint32_t k[4] = {
+      0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+   };
+   uint32x4_t abcd = vld1q_u32(state);
+   uint32_t e = state[4];
+
+   for (size_t b = 0; b < num_blocks; b++, data += 64) {
+      const uint32x4_t abcd_save = abcd;
+      const uint32_t e_save = e;
+      uint32x4_t w[20];
+
+      /* Message words are big endian. */
+      for (unsigned i = 0; i < 4; i++)
+         w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+      for (unsigned i = 4; i < 20; i++) {
+         w[i] = vsha1su1q_u32(vsha1su0q_u32(w[i - 4], w[i - 3], w[i - 2]),
+                              w[i - 1]);
+      }
+
+      /* Each step does four rounds.  Rounds 0-19 use the choose function,
+       * 40-59 majority and the others parity.
+       */
+      for (unsigned i = 0; i < 20; i++) {
+         uint32x4_t wk = vaddq_u32(w[i], vdupq_n_u32(k[i / 5]));
+         uint32_t e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+         if (i < 5)
+            abcd = vsha1cq_u32(abcd, e, wk);
+         else if (i >= 10 && i < 15)
+            abcd = vsha1mq_u32(abcd, e, wk);
+         else
+            abcd = vsha1pq_u32(abcd, e, wk);
+         e = e_next;
+      }
+
+      abcd = vaddq_u32(abcd, abcd_save);
+      e += e_save;
+   }
+
+   vst1q_u32(state, abcd);
+   state[4] = e;
+}
+
+uint32_t
+util_crc32_armv8(uint32_t crc, const uint8_t *data, size_t size)
+{
+   while (size && ((uintptr_t)data & 7)) {
+      crc = __crc32b(crc, *data++);
+      size--;
+   }
+
+   while (size >= 8) {
+      uint64_t v;
+
+      memcpy(&v, data, sizeof(v));
+      crc = __crc32d(crc, v);
+      data += 8;
+      size -= 8;
+   }
+
+   while (size--)
+      crc = __crc32b(crc, *data++);
+
+   return crc;
+}
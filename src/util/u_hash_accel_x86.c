@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2021 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * SHA-1 with the SHA extensions and CRC32 with PCLMULQDQ.
+ *
+ * This file is compiled with -msse4.1 -msha -mpclmul.
+ */
+
+#include <immintrin.h>
+
+#include "u_hash_accel.h"
+
+/*
+ * Four rounds of SHA-1.  group is the index of the four rounds (0..19).
+ * The rounds alternate between e0 and e1 for the E value, and each group
+ * also advances the message schedule held in msg[0..3] for the next groups.
+ */
+#define SHA1_GROUP(group, e_cur, e_next)                                      \
+   do {                                                                       \
+      __m128i m = msg[(group) % 4];                                           \
+      if ((group) == 0)                                                       \
+         e_cur = _mm_add_epi32(e_cur, m);                                     \
+      else                                                                    \
+         e_cur = _mm_sha1nexte_epu32(e_cur, m);                               \
+      e_next = abcd;                                                          \
+      if ((group) >= 3 && (group) <= 18)                                      \
+         msg[((group) + 1) % 4] = _mm_sha1msg2_epu32(msg[((group) + 1) % 4], m); \
+      abcd = _mm_sha1rnds4_epu32(abcd, e_cur, (group) / 5);                   \
+      if ((group) >= 1 && (group) <= 16)                                      \
+         msg[((group) + 3) % 4] = _mm_sha1msg1_epu32(msg[((group) + 3) % 4], m); \
+      if ((group) >= 2 && (group) <= 17)                                      \
+         msg[((group) + 2) % 4] = _mm_xor_si128(msg[((group) + 2) % 4], m);   \
+   } while (0)
+
+void
+util_sha1_blocks_shani(uint32_t state[5], const uint8_t *data,
+                       size_t num_blocks)
+{
+   /* Message words are big endian. */
+   const __m128i bswap = _mm_set_epi64x(0x0001020304050607ull,
+                                        0x08090a0b0c0d0e0full);
+   __m128i abcd, e0, e1;
+
+   /* The SHA instructions want A in the highest lane. */
+   abcd = _mm_loadu_si128((const __m128i *)state);
+   abcd = _mm_shuffle_epi32(abcd, 0x1b);
+   e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+   for (size_t b = 0; b < num_blocks; b++, data += 64) {
+      const __m128i abcd_save = abcd;
+      const __m128i e0_save = e0;
+      __m128i msg[4];
+
+      for (unsigned i = 0; i < 4; i++) {
+         msg[i] = _mm_loadu_si128((const __m128i *)(data + i * 16));
+         msg[i] = _mm_shuffle_epi8(msg[i], bswap);
+      }
+
+      SHA1_GROUP(0, e0, e1);
+      SHA1_GROUP(1, e1, e0);
+      SHA1_GROUP(2, e0, e1);
+      SHA1_GROUP(3, e1, e0);
+      SHA1_GROUP(4, e0, e1);
+      SHA1_GROUP(5, e1, e0);
+      SHA1_GROUP(6, e0, e1);
+      SHA1_GROUP(7, e1, e0);
+      SHA1_GROUP(8, e0, e1);
+      SHA1_GROUP(9, e1, e0);
+      SHA1_GROUP(10, e0, e1);
+      SHA1_GROUP(11, e1, e0);
+      SHA1_GROUP(12, e0, e1);
+      SHA1_GROUP(13, e1, e0);
+      SHA1_GROUP(14, e0, e1);
+      SHA1_GROUP(15, e1, e0);
+      SHA1_GROUP(16, e0, e1);
+      SHA1_GROUP(17, e1, e0);
+      SHA1_GROUP(18, e0, e1);
+      SHA1_GROUP(19, e1, e0);
+
+      e0 = _mm_sha1nexte_epu32(e0, e0_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+   }
+
+   abcd = _mm_shuffle_epi32(abcd, 0x1b);
+   _mm_storeu_si128((__m128i *)state, abcd);
+   state[4] = _mm_extract_epi32(e0, 3);
+}
+
+/*
+ * CRC32 (the gzip/PNG polynomial) by folding with carry-less multiplies, as
+ * described in "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction" (Gopal et al., Intel, 2009).  All constants are bit-reflected.
+ */
+static inline __m128i
+crc32_fold(__m128i x, __m128i k, __m128i next)
+{
+   __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+   __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+
+   return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+uint32_t
+util_crc32_pclmul(uint32_t crc, const uint8_t *data, size_t size)
+{
+   /* Folding constants for 64 byte and 16 byte distances, and the last
+    * 64 -> 32 bit step.
+    */
+   const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596ull, 0x0154442bd4ull);
+   const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eull, 0x01751997d0ull);
+   const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124ull);
+   /* P and the Barrett constant floor(x^64 / P) */
+   const __m128i poly = _mm_set_epi64x(0x01f7011641ull, 0x01db710641ull);
+   const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+   __m128i x0, x1, x2, x3, t;
+
+   x0 = _mm_loadu_si128((const __m128i *)(data + 0));
+   x1 = _mm_loadu_si128((const __m128i *)(data + 16));
+   x2 = _mm_loadu_si128((const __m128i *)(data + 32));
+   x3 = _mm_loadu_si128((const __m128i *)(data + 48));
+   x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128(crc));
+   data += 64;
+   size -= 64;
+
+   /* Four independent accumulators hide the multiply latency. */
+   while (size >= 64) {
+      x0 = crc32_fold(x0, k1k2, _mm_loadu_si128((const __m128i *)(data + 0)));
+      x1 = crc32_fold(x1, k1k2, _mm_loadu_si128((const __m128i *)(data + 16)));
+      x2 = crc32_fold(x2, k1k2, _mm_loadu_si128((const __m128i *)(data + 32)));
+      x3 = crc32_fold(x3, k1k2, _mm_loadu_si128((const __m128i *)(data + 48)));
+      data += 64;
+      size -= 64;
+   }
+
+   /* Reduce to one accumulator, then eat the remaining 16 byte blocks. */
+   x0 = crc32_fold(x0, k3k4, x1);
+   x0 = crc32_fold(x0, k3k4, x2);
+   x0 = crc32_fold(x0, k3k4, x3);
+
+   while (size >= 16) {
+      x0 = crc32_fold(x0, k3k4, _mm_loadu_si128((const __m128i *)data));
+      data += 16;
+      size -= 16;
+   }
+
+   /* 128 bits -> 64 bits */
+   t = _mm_clmulepi64_si128(x0, k3k4, 0x10);
+   x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), t);
+
+   t = _mm_srli_si128(x0, 4);
+   x0 = _mm_and_si128(x0, mask32);
+   x0 = _mm_clmulepi64_si128(x0, k5, 0x00);
+   x0 = _mm_xor_si128(x0, t);
+
+   /* Barrett reduction to 32 bits */
+   t = _mm_and_si128(x0, mask32);
+   t = _mm_clmulepi64_si128(t, poly, 0x10);
+   t = _mm_and_si128(t, mask32);
+   t = _mm_clmulepi64_si128(t, poly, 0x00);
+   x0 = _mm_xor_si128(x0, t);
+
+   return _mm_extract_epi32(x0, 1);
+}
@@ -28,6 +28,7 @@
 
 #include "c11/threads.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_math.h"
 #include "util/os_time.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
@@ -242,6 +243,300 @@ util_queue_fence_destroy(struct util_queue_fence *fence)
  * util_queue implementation
  */
 
+/* The job ring is a bounded multi-producer multi-consumer queue where every
+ * slot has a sequence number. A slot is free for the producer that claims
+ * write_idx == seq and holds a job for the consumer that claims
+ * read_idx == seq - 1. Claiming an index is a compare-and-swap and the
+ * sequence number is updated after the job has been copied, so producers
+ * and consumers only contend when they touch the same index.
+ */
+static bool
+util_queue_ring_push(struct util_queue *queue,
+                     const struct util_queue_job *job)
+{
+   unsigned mask = queue->slot_mask;
+   unsigned pos = p_atomic_read_relaxed(&queue->write_idx);
+
+   while (1) {
+      struct util_queue_slot *slot = &queue->slots[pos & mask];
+      int diff = (int)(p_atomic_read(&slot->seq) - pos);
+
+      if (diff == 0) {
+         /* read_idx only increases, so this still holds if pos is claimed.
+          * If pos is stale, this is negative and claiming it fails.
+          */
+         if ((int)(pos - p_atomic_read(&queue->read_idx)) >=
+             (int)queue->max_jobs)
+            return false; /* full */
+
+         unsigned old = p_atomic_cmpxchg(&queue->write_idx, pos, pos + 1);
+
+         if (old == pos) {
+            slot->job = *job;
+            p_atomic_set(&slot->seq, pos + 1);
+            return true;
+         }
+         pos = old;
+      } else if (diff < 0) {
+         return false; /* full */
+      } else {
+         pos = p_atomic_read_relaxed(&queue->write_idx);
+      }
+   }
+}
+
+static bool
+util_queue_ring_pop(struct util_queue *queue, struct util_queue_job *job)
+{
+   unsigned mask = queue->slot_mask;
+   unsigned pos = p_atomic_read_relaxed(&queue->read_idx);
+
+   while (1) {
+      struct util_queue_slot *slot = &queue->slots[pos & mask];
+      int diff = (int)(p_atomic_read(&slot->seq) - (pos + 1));
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&queue->read_idx, pos, pos + 1);
+
+         if (old == pos) {
+            *job = slot->job;
+
+            /* Take the fence from util_queue_drop_job. If it was dropped,
+             * the job becomes a no-op.
+             */
+            if (job->fence &&
+                p_atomic_cmpxchg(&slot->job.fence, job->fence, NULL) !=
+                job->fence)
+               job->fence = NULL;
+
+            p_atomic_set(&slot->seq, pos + mask + 1);
+            return true;
+         }
+         pos = old;
+      } else if (diff < 0) {
+         return false; /* empty */
+      } else {
+         pos = p_atomic_read_relaxed(&queue->read_idx);
+      }
+   }
+}
+
+/* Overflow jobs, the queue lock must be held. */
+static bool
+util_queue_overflow_push(struct util_queue *queue,
+                         const struct util_queue_job *job)
+{
+   if (queue->num_overflow == queue->max_overflow) {
+      unsigned new_max = queue->max_overflow + 8;
+      struct util_queue_job *jobs =
+         (struct util_queue_job*)calloc(new_max, sizeof(*jobs));
+      if (!jobs)
+         return false;
+
+      for (unsigned i = 0; i < queue->num_overflow; i++) {
+         jobs[i] = queue->overflow[(queue->overflow_read_idx + i) %
+                                   queue->max_overflow];
+      }
+      free(queue->overflow);
+      queue->overflow = jobs;
+      queue->overflow_read_idx = 0;
+      queue->max_overflow = new_max;
+   }
+
+   queue->overflow[(queue->overflow_read_idx + queue->num_overflow) %
+                   queue->max_overflow] = *job;
+   queue->overflow_jobs_size += job->job_size;
+   p_atomic_set(&queue->num_overflow, queue->num_overflow + 1);
+   return true;
+}
+
+static bool
+util_queue_overflow_pop(struct util_queue *queue, struct util_queue_job *job)
+{
+   if (!queue->num_overflow)
+      return false;
+
+   *job = queue->overflow[queue->overflow_read_idx];
+   queue->overflow_read_idx = (queue->overflow_read_idx + 1) %
+                              queue->max_overflow;
+   queue->overflow_jobs_size -= job->job_size;
+   p_atomic_set(&queue->num_overflow, queue->num_overflow - 1);
+   return true;
+}
+
+/* Local queues. The owner pushes and pops the newest job, other threads
+ * steal the oldest one.
+ */
+static int
+util_queue_get_local_index(struct util_queue *queue)
+{
+   if (!queue->locals)
+      return -1;
+
+   thrd_t current = thrd_current();
+   unsigned num_threads = p_atomic_read(&queue->num_threads);
+
+   for (unsigned i = 0; i < num_threads; i++) {
+      if (thrd_equal(queue->threads[i], current))
+         return i;
+   }
+   return -1;
+}
+
+static bool
+util_queue_local_push(struct util_queue *queue, struct util_queue_local *local,
+                      const struct util_queue_job *job)
+{
+   bool pushed = false;
+
+   mtx_lock(&local->lock);
+   if (local->tail - local->head < queue->max_jobs) {
+      local->jobs[local->tail & queue->slot_mask] = *job;
+      p_atomic_set(&local->tail, local->tail + 1);
+      pushed = true;
+   }
+   mtx_unlock(&local->lock);
+   return pushed;
+}
+
+static bool
+util_queue_local_pop(struct util_queue *queue, struct util_queue_local *local,
+                     bool newest, struct util_queue_job *job)
+{
+   bool popped = false;
+
+   if (p_atomic_read(&local->tail) == p_atomic_read(&local->head))
+      return false;
+
+   mtx_lock(&local->lock);
+   if (local->tail != local->head) {
+      if (newest) {
+         *job = local->jobs[(local->tail - 1) & queue->slot_mask];
+         p_atomic_set(&local->tail, local->tail - 1);
+      } else {
+         *job = local->jobs[local->head & queue->slot_mask];
+         p_atomic_set(&local->head, local->head + 1);
+      }
+      popped = true;
+   }
+   mtx_unlock(&local->lock);
+   return popped;
+}
+
+static bool
+util_queue_has_work(struct util_queue *queue)
+{
+   /* A claimed slot whose job hasn't been copied yet counts as work, so that
+    * threads don't go to sleep right before the job is published.
+    */
+   if (p_atomic_read(&queue->write_idx) != p_atomic_read(&queue->read_idx) ||
+       p_atomic_read(&queue->num_overflow))
+      return true;
+
+   if (queue->locals) {
+      for (unsigned i = 0; i < queue->max_threads; i++) {
+         struct util_queue_local *local = &queue->locals[i];
+
+         if (p_atomic_read(&local->tail) != p_atomic_read(&local->head))
+            return true;
+      }
+   }
+   return false;
+}
+
+/* Wake up one thread waiting on "cond" if "num_waiting" is non-zero.
+ *
+ * The waiting thread increments "num_waiting" before checking its
+ * condition, and the caller reads it with a read-modify-write after making
+ * the condition true. Both are atomic read-modify-writes of the same
+ * variable, so either the waiter sees the new state or the caller sees the
+ * waiter. The queue lock then makes sure the signal isn't lost.
+ */
+static void
+util_queue_wake_up(struct util_queue *queue, int *num_waiting, cnd_t *cond)
+{
+   if (p_atomic_add_return(num_waiting, 0) > 0) {
+      mtx_lock(&queue->lock);
+      cnd_signal(cond);
+      mtx_unlock(&queue->lock);
+   }
+}
+
+static bool
+util_queue_get_job(struct util_queue *queue, unsigned thread_index,
+                   struct util_queue_job *job)
+{
+   bool found = false;
+
+   if (queue->locals &&
+       util_queue_local_pop(queue, &queue->locals[thread_index], true, job))
+      return true;
+
+   if (util_queue_ring_pop(queue, job)) {
+      found = true;
+   } else if (p_atomic_read(&queue->num_overflow)) {
+      mtx_lock(&queue->lock);
+      found = util_queue_overflow_pop(queue, job);
+      mtx_unlock(&queue->lock);
+   }
+
+   if (found) {
+      util_queue_wake_up(queue, &queue->num_waiting_for_space,
+                         &queue->has_space_cond);
+      return true;
+   }
+
+   if (queue->locals) {
+      for (unsigned i = 1; i < queue->max_threads; i++) {
+         unsigned victim = (thread_index + i) % queue->max_threads;
+
+         if (util_queue_local_pop(queue, &queue->locals[victim], false, job))
+            return true;
+      }
+   }
+   return false;
+}
+
+static void
+util_queue_wait_for_work(struct util_queue *queue, unsigned thread_index)
+{
+   mtx_lock(&queue->lock);
+   p_atomic_inc(&queue->num_sleeping);
+
+   /* wait if the queue is empty */
+   while (thread_index < queue->num_threads && !util_queue_has_work(queue))
+      cnd_wait(&queue->has_queued_cond, &queue->lock);
+
+   p_atomic_dec(&queue->num_sleeping);
+   mtx_unlock(&queue->lock);
+}
+
+static bool
+util_queue_is_full(struct util_queue *queue)
+{
+   return p_atomic_read(&queue->num_overflow) ||
+          p_atomic_read(&queue->write_idx) - p_atomic_read(&queue->read_idx) >=
+          queue->max_jobs;
+}
+
+/* Return false if all threads were terminated. */
+static bool
+util_queue_wait_for_space(struct util_queue *queue)
+{
+   bool alive;
+
+   mtx_lock(&queue->lock);
+   p_atomic_inc(&queue->num_waiting_for_space);
+
+   while (queue->num_threads && util_queue_is_full(queue))
+      cnd_wait(&queue->has_space_cond, &queue->lock);
+
+   p_atomic_dec(&queue->num_waiting_for_space);
+   alive = queue->num_threads != 0;
+   mtx_unlock(&queue->lock);
+   return alive;
+}
+
 struct thread_input {
    struct util_queue *queue;
    int thread_index;
@@ -282,30 +577,25 @@ util_queue_thread_func(void *input)
    while (1) {
       struct util_queue_job job;
 
-      mtx_lock(&queue->lock);
-      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
-
-      /* wait if the queue is empty */
-      while (thread_index < queue->num_threads && queue->num_queued == 0)
-         cnd_wait(&queue->has_queued_cond, &queue->lock);
-
       /* only kill threads that are above "num_threads" */
-      if (thread_index >= queue->num_threads) {
-         mtx_unlock(&queue->lock);
+      if (thread_index >= p_atomic_read(&queue->num_threads))
          break;
-      }
 
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
+      if (!util_queue_get_job(queue, thread_index, &job)) {
+         util_queue_wait_for_work(queue, thread_index);
+         continue;
+      }
 
-      queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
-      if (job.job)
-         queue->total_jobs_size -= job.job_size;
-      mtx_unlock(&queue->lock);
+      /* The thread that added the job only woke up one thread, so wake up
+       * the next one if there is more work.
+       */
+      if (util_queue_has_work(queue)) {
+         util_queue_wake_up(queue, &queue->num_sleeping,
+                            &queue->has_queued_cond);
+      }
 
-      if (job.job) {
+      /* Dropped jobs don't have a fence. */
+      if (job.fence) {
          job.execute(job.job, thread_index);
          util_queue_fence_signal(job.fence);
          if (job.cleanup)
@@ -313,20 +603,6 @@ util_queue_thread_func(void *input)
       }
    }
 
-   /* signal remaining jobs if all threads are being terminated */
-   mtx_lock(&queue->lock);
-   if (queue->num_threads == 0) {
-      for (unsigned i = queue->read_idx; i != queue->write_idx;
-           i = (i + 1) % queue->max_jobs) {
-         if (queue->jobs[i].job) {
-            util_queue_fence_signal(queue->jobs[i].fence);
-            queue->jobs[i].job = NULL;
-         }
-      }
-      queue->read_idx = queue->write_idx;
-      queue->num_queued = 0;
-   }
-   mtx_unlock(&queue->lock);
    return 0;
 }
 
@@ -387,7 +663,7 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
     * We need to update num_threads first, because threads terminate
     * when thread_index < num_threads.
     */
-   queue->num_threads = num_threads;
+   p_atomic_set(&queue->num_threads, num_threads);
    for (unsigned i = old_num_threads; i < num_threads; i++) {
       if (!util_queue_create_thread(queue, i))
          break;
@@ -395,6 +671,22 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
    mtx_unlock(&queue->finish_lock);
 }
 
+static void
+util_queue_free_locals(struct util_queue *queue)
+{
+   if (!queue->locals)
+      return;
+
+   for (unsigned i = 0; i < queue->max_threads; i++) {
+      if (queue->locals[i].jobs) {
+         mtx_destroy(&queue->locals[i].lock);
+         free(queue->locals[i].jobs);
+      }
+   }
+   free(queue->locals);
+   queue->locals = NULL;
+}
+
 bool
 util_queue_init(struct util_queue *queue,
                 const char *name,
@@ -435,30 +727,54 @@ util_queue_init(struct util_queue *queue,
    queue->flags = flags;
    queue->max_threads = num_threads;
    queue->num_threads = num_threads;
-   queue->max_jobs = max_jobs;
+   /* Users like glthread rely on adding a job blocking once exactly
+    * max_jobs are queued, but the ring indexing needs a power of two, and
+    * the sequence numbers can't tell a full slot from a free one with only
+    * one slot.
+    */
+   queue->max_jobs = MAX2(max_jobs, 1);
+   queue->slot_mask = util_next_power_of_two(MAX2(max_jobs, 2)) - 1;
 
-   queue->jobs = (struct util_queue_job*)
-                 calloc(max_jobs, sizeof(struct util_queue_job));
-   if (!queue->jobs)
+   queue->slots = (struct util_queue_slot*)
+                  calloc(queue->slot_mask + 1, sizeof(struct util_queue_slot));
+   if (!queue->slots)
       goto fail;
 
+   for (i = 0; i <= queue->slot_mask; i++)
+      queue->slots[i].seq = i;
+
+   if (flags & UTIL_QUEUE_INIT_LOCAL_QUEUES) {
+      queue->locals = (struct util_queue_local*)
+                      calloc(num_threads, sizeof(struct util_queue_local));
+      if (!queue->locals)
+         goto fail;
+
+      for (i = 0; i < num_threads; i++) {
+         queue->locals[i].jobs = (struct util_queue_job*)
+                                 calloc(queue->slot_mask + 1,
+                                        sizeof(struct util_queue_job));
+         if (!queue->locals[i].jobs)
+            goto fail;
+         (void) mtx_init(&queue->locals[i].lock, mtx_plain);
+      }
+   }
+
    (void) mtx_init(&queue->lock, mtx_plain);
    (void) mtx_init(&queue->finish_lock, mtx_plain);
 
-   queue->num_queued = 0;
    cnd_init(&queue->has_queued_cond);
    cnd_init(&queue->has_space_cond);
 
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
    if (!queue->threads)
-      goto fail;
+      goto fail_threads;
 
    /* start threads */
    for (i = 0; i < num_threads; i++) {
       if (!util_queue_create_thread(queue, i)) {
          if (i == 0) {
             /* no threads created, fail */
-            goto fail;
+            goto fail_threads;
          } else {
             /* at least one thread created, so use it */
             queue->num_threads = i;
@@ -470,15 +786,15 @@ util_queue_init(struct util_queue *queue,
    add_to_atexit_list(queue);
    return true;
 
-fail:
+fail_threads:
    free(queue->threads);
-
-   if (queue->jobs) {
-      cnd_destroy(&queue->has_space_cond);
-      cnd_destroy(&queue->has_queued_cond);
-      mtx_destroy(&queue->lock);
-      free(queue->jobs);
-   }
+   cnd_destroy(&queue->has_space_cond);
+   cnd_destroy(&queue->has_queued_cond);
+   mtx_destroy(&queue->finish_lock);
+   mtx_destroy(&queue->lock);
+fail:
+   util_queue_free_locals(queue);
+   free(queue->slots);
    /* also util_queue_is_initialized can be used to check for success */
    memset(queue, 0, sizeof(*queue));
    return false;
@@ -504,13 +820,24 @@ util_queue_kill_threads(struct util_queue *queue, unsigned keep_num_threads,
    /* Setting num_threads is what causes the threads to terminate.
     * Then cnd_broadcast wakes them up and they will exit their function.
     */
-   queue->num_threads = keep_num_threads;
+   p_atomic_set(&queue->num_threads, keep_num_threads);
    cnd_broadcast(&queue->has_queued_cond);
+   cnd_broadcast(&queue->has_space_cond);
    mtx_unlock(&queue->lock);
 
    for (i = keep_num_threads; i < old_num_threads; i++)
       thrd_join(queue->threads[i], NULL);
 
+   /* signal remaining jobs if all threads are being terminated */
+   if (keep_num_threads == 0) {
+      struct util_queue_job job;
+
+      while (util_queue_get_job(queue, 0, &job)) {
+         if (job.fence)
+            util_queue_fence_signal(job.fence);
+      }
+   }
+
    if (!finish_locked)
       mtx_unlock(&queue->finish_lock);
 }
@@ -525,7 +852,9 @@ util_queue_destroy(struct util_queue *queue)
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
-   free(queue->jobs);
+   util_queue_free_locals(queue);
+   free(queue->overflow);
+   free(queue->slots);
    free(queue->threads);
 }
 
@@ -537,11 +866,9 @@ util_queue_add_job(struct util_queue *queue,
                    util_queue_execute_func cleanup,
                    const size_t job_size)
 {
-   struct util_queue_job *ptr;
+   struct util_queue_job ptr;
 
-   mtx_lock(&queue->lock);
-   if (queue->num_threads == 0) {
-      mtx_unlock(&queue->lock);
+   if (p_atomic_read(&queue->num_threads) == 0) {
       /* well no good option here, but any leaks will be
        * short-lived as things are shutting down..
        */
@@ -550,57 +877,48 @@ util_queue_add_job(struct util_queue *queue,
 
    util_queue_fence_reset(fence);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+   ptr.job = job;
+   ptr.job_size = job_size;
+   ptr.fence = fence;
+   ptr.execute = execute;
+   ptr.cleanup = cleanup;
+
+   int local = util_queue_get_local_index(queue);
 
-   if (queue->num_queued == queue->max_jobs) {
-      if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL &&
-          queue->total_jobs_size + job_size < S_256MB) {
-         /* If the queue is full, make it larger to avoid waiting for a free
-          * slot.
+   if (local < 0 ||
+       !util_queue_local_push(queue, &queue->locals[local], &ptr)) {
+      while (1) {
+         /* Jobs can't go into the ring while older ones are in the overflow
+          * list, or they would be executed first.
           */
-         unsigned new_max_jobs = queue->max_jobs + 8;
-         struct util_queue_job *jobs =
-            (struct util_queue_job*)calloc(new_max_jobs,
-                                           sizeof(struct util_queue_job));
-         assert(jobs);
-
-         /* Copy all queued jobs into the new list. */
-         unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
-
-         do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
-
-         assert(num_jobs == queue->num_queued);
-
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
-      } else {
+         if (!p_atomic_read(&queue->num_overflow) &&
+             util_queue_ring_push(queue, &ptr))
+            break;
+
+         if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
+            /* If the queue is full, keep the job aside to avoid waiting for
+             * a free slot.
+             */
+            bool added = false;
+
+            mtx_lock(&queue->lock);
+            if (queue->overflow_jobs_size + job_size < S_256MB)
+               added = util_queue_overflow_push(queue, &ptr);
+            mtx_unlock(&queue->lock);
+
+            if (added)
+               break;
+         }
+
          /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
-            cnd_wait(&queue->has_space_cond, &queue->lock);
+         if (!util_queue_wait_for_space(queue)) {
+            util_queue_fence_signal(fence);
+            return;
+         }
       }
    }
 
-   ptr = &queue->jobs[queue->write_idx];
-   assert(ptr->job == NULL);
-   ptr->job = job;
-   ptr->fence = fence;
-   ptr->execute = execute;
-   ptr->cleanup = cleanup;
-   ptr->job_size = job_size;
-
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
-   queue->total_jobs_size += ptr->job_size;
-
-   queue->num_queued++;
-   cnd_signal(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   util_queue_wake_up(queue, &queue->num_sleeping, &queue->has_queued_cond);
 }
 
 /**
@@ -621,20 +939,67 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
    if (util_queue_fence_is_signalled(fence))
       return;
 
-   mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].fence == fence) {
-         if (queue->jobs[i].cleanup)
-            queue->jobs[i].cleanup(queue->jobs[i].job, -1);
-
-         /* Just clear it. The threads will treat as a no-op job. */
-         memset(&queue->jobs[i], 0, sizeof(queue->jobs[i]));
+   /* A job is owned by whoever clears the fence pointer of its slot: this
+    * function or the thread that pops it. Fences of queued jobs are unique,
+    * so the job and cleanup read before the compare-and-swap belong to it.
+    */
+   for (unsigned i = p_atomic_read(&queue->read_idx);
+        i != p_atomic_read(&queue->write_idx); i++) {
+      struct util_queue_slot *slot = &queue->slots[i & queue->slot_mask];
+
+      if (p_atomic_read(&slot->seq) != i + 1 ||
+          p_atomic_read(&slot->job.fence) != fence)
+         continue;
+
+      void *job = slot->job.job;
+      util_queue_execute_func cleanup = slot->job.cleanup;
+
+      if (p_atomic_cmpxchg(&slot->job.fence, fence, NULL) == fence) {
+         if (cleanup)
+            cleanup(job, -1);
          removed = true;
-         break;
       }
+      break;
+   }
+
+   if (!removed && p_atomic_read(&queue->num_overflow)) {
+      mtx_lock(&queue->lock);
+      for (unsigned i = 0; i < queue->num_overflow; i++) {
+         struct util_queue_job *ptr =
+            &queue->overflow[(queue->overflow_read_idx + i) %
+                             queue->max_overflow];
+
+         if (ptr->fence == fence) {
+            if (ptr->cleanup)
+               ptr->cleanup(ptr->job, -1);
+
+            /* Just clear it. The threads will treat as a no-op job. */
+            ptr->fence = NULL;
+            removed = true;
+            break;
+         }
+      }
+      mtx_unlock(&queue->lock);
+   }
+
+   for (unsigned t = 0; queue->locals && !removed && t < queue->max_threads;
+        t++) {
+      struct util_queue_local *local = &queue->locals[t];
+
+      mtx_lock(&local->lock);
+      for (unsigned i = local->head; i != local->tail; i++) {
+         struct util_queue_job *ptr = &local->jobs[i & queue->slot_mask];
+
+         if (ptr->fence == fence) {
+            if (ptr->cleanup)
+               ptr->cleanup(ptr->job, -1);
+            ptr->fence = NULL;
+            removed = true;
+            break;
+         }
+      }
+      mtx_unlock(&local->lock);
    }
-   mtx_unlock(&queue->lock);
 
    if (removed)
       util_queue_fence_signal(fence);
@@ -49,6 +49,11 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+/* Jobs added by a job of the same queue go to a queue local to the worker
+ * thread, which executes the newest one first. Idle threads steal the oldest
+ * ones. Jobs are not executed in the order they were added anymore.
+ */
+#define UTIL_QUEUE_INIT_LOCAL_QUEUES              (1 << 3)
 
 #if UTIL_FUTEX_SUPPORTED
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -199,22 +204,57 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+/* A slot of the job ring. "seq" tells whether the slot is free for the
+ * producer of a given write_idx or holds a job for the consumer of a given
+ * read_idx, see util_queue_add_job.
+ */
+struct util_queue_slot {
+   unsigned seq;
+   struct util_queue_job job;
+};
+
+/* Jobs added by a worker thread with UTIL_QUEUE_INIT_LOCAL_QUEUES. */
+struct util_queue_local {
+   mtx_t lock;
+   unsigned head, tail; /* written with the lock held, read atomically */
+   struct util_queue_job *jobs; /* slot_mask + 1 entries */
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
    mtx_t finish_lock; /* for util_queue_finish and protects threads/num_threads */
-   mtx_t lock;
+   mtx_t lock; /* for sleeping threads and the overflow jobs */
    cnd_t has_queued_cond;
    cnd_t has_space_cond;
    thrd_t *threads;
    unsigned flags;
-   int num_queued;
    unsigned max_threads;
    unsigned num_threads; /* decreasing this number will terminate threads */
-   int max_jobs;
-   int write_idx, read_idx; /* ring buffer pointers */
-   size_t total_jobs_size;  /* memory use of all jobs in the queue */
-   struct util_queue_job *jobs;
+
+   /* Lock-free bounded ring of at most max_jobs jobs, which can be filled
+    * and drained by any number of threads. It has slot_mask + 1 slots, a
+    * power of two, but adding a job blocks once max_jobs are queued.
+    */
+   unsigned max_jobs;
+   unsigned slot_mask;
+   unsigned write_idx, read_idx; /* only increase, the slot is idx & mask */
+   struct util_queue_slot *slots;
+
+   /* Threads that sleep until a job is added or a slot is freed. Adding a
+    * job or freeing a slot only wakes threads up if they are non-zero.
+    */
+   int num_sleeping, num_waiting_for_space;
+
+   /* Jobs added with UTIL_QUEUE_INIT_RESIZE_IF_FULL when the ring was full,
+    * protected by lock.
+    */
+   unsigned num_overflow; /* also read atomically */
+   unsigned overflow_read_idx, max_overflow;
+   size_t overflow_jobs_size; /* memory use of the overflow jobs */
+   struct util_queue_job *overflow;
+
+   struct util_queue_local *locals; /* max_threads entries, or NULL */
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;